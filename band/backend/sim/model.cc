@@ -0,0 +1,213 @@
+// Copyright 2023 Seoul National University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "band/backend/sim/model.h"
+
+#include <algorithm>
+#include <memory>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+#include "band/json_util.h"
+
+namespace band {
+namespace sim {
+namespace {
+
+absl::StatusOr<DeviceFlag> GetDeviceFlag(const std::string& name) {
+  for (size_t flag = 0; flag < EnumLength<DeviceFlag>(); flag++) {
+    const DeviceFlag device_flag = static_cast<DeviceFlag>(flag);
+    if (name == ToString(device_flag)) {
+      return device_flag;
+    }
+  }
+  return absl::InvalidArgumentError(
+      absl::StrFormat("Unknown device `%s` in simulated model", name));
+}
+
+std::set<int> ToIndexSet(const Json::Value& indices) {
+  std::set<int> index_set;
+  for (const Json::Value& index : indices) {
+    index_set.insert(index.asInt());
+  }
+  return index_set;
+}
+
+}  // anonymous namespace
+
+SimModel::SimModel(ModelId id) : interface::IModel(id) {}
+
+BackendType SimModel::GetBackendType() const { return BackendType::kSimulated; }
+
+absl::Status SimModel::FromPath(const char* filename) {
+  Json::Value root = json::LoadFromFile(filename);
+  if (root.isNull()) {
+    return absl::InternalError(
+        absl::StrFormat("Cannot load simulated model from %s", filename));
+  }
+  path_ = filename;
+  return Parse(root);
+}
+
+absl::Status SimModel::FromBuffer(const char* buffer, size_t buffer_size) {
+  Json::Value root;
+  Json::CharReaderBuilder builder;
+  std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+  if (!reader->parse(buffer, buffer + buffer_size, &root, nullptr)) {
+    return absl::InternalError("Cannot load simulated model from buffer.");
+  }
+  return Parse(root);
+}
+
+bool SimModel::IsInitialized() const { return is_initialized_; }
+
+absl::Status SimModel::Parse(const Json::Value& root) {
+  SimModelDef model_def;
+
+  // A chain of `num_ops` ops unless the graph is given
+  if (root["ops"].isArray()) {
+    for (const Json::Value& op : root["ops"]) {
+      model_def.op_input_tensors.push_back(ToIndexSet(op["inputs"]));
+      model_def.op_output_tensors.push_back(ToIndexSet(op["outputs"]));
+    }
+  } else if (root["num_ops"].isInt()) {
+    for (int op = 0; op < root["num_ops"].asInt(); op++) {
+      model_def.op_input_tensors.push_back({op});
+      model_def.op_output_tensors.push_back({op + 1});
+    }
+  }
+  const int num_ops = model_def.op_input_tensors.size();
+  if (num_ops == 0) {
+    return absl::InvalidArgumentError(
+        "Simulated model requires either `ops` or `num_ops`");
+  }
+
+  std::set<int> consumed, produced;
+  for (int op = 0; op < num_ops; op++) {
+    for (int tensor : model_def.op_input_tensors[op]) {
+      consumed.insert(tensor);
+      model_def.num_tensors = std::max(model_def.num_tensors, tensor + 1);
+    }
+    for (int tensor : model_def.op_output_tensors[op]) {
+      produced.insert(tensor);
+      model_def.num_tensors = std::max(model_def.num_tensors, tensor + 1);
+    }
+  }
+  // Model inputs are never produced and outputs are never consumed by default
+  if (root["inputs"].isArray()) {
+    model_def.input_tensors = ToIndexSet(root["inputs"]);
+  } else {
+    for (int tensor : consumed) {
+      if (produced.find(tensor) == produced.end()) {
+        model_def.input_tensors.insert(tensor);
+      }
+    }
+  }
+  if (root["outputs"].isArray()) {
+    model_def.output_tensors = ToIndexSet(root["outputs"]);
+  } else {
+    for (int tensor : produced) {
+      if (consumed.find(tensor) == consumed.end()) {
+        model_def.output_tensors.insert(tensor);
+      }
+    }
+  }
+
+  std::vector<int> tensor_shape = {1};
+  if (root["tensor_shape"].isArray()) {
+    tensor_shape.clear();
+    for (const Json::Value& dim : root["tensor_shape"]) {
+      tensor_shape.push_back(dim.asInt());
+    }
+  }
+  model_def.tensor_dims.assign(model_def.num_tensors, tensor_shape);
+
+  const Json::Value& op_latency = root["op_latency_us"];
+  for (auto it = op_latency.begin(); it != op_latency.end(); ++it) {
+    auto status_or_device = GetDeviceFlag(it.key().asString());
+    if (!status_or_device.ok()) {
+      return status_or_device.status();
+    }
+    std::vector<int64_t>& latency =
+        model_def.op_latency_us[status_or_device.value()];
+    if (it->isArray()) {
+      if (it->size() != num_ops) {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "`op_latency_us` of %s has %d entries for %d ops",
+            it.key().asString(), it->size(), num_ops));
+      }
+      for (const Json::Value& op_latency_us : *it) {
+        latency.push_back(op_latency_us.asInt64());
+      }
+    } else {
+      latency.assign(num_ops, it->asInt64());
+    }
+  }
+
+  const Json::Value& unsupported_ops = root["unsupported_ops"];
+  for (auto it = unsupported_ops.begin(); it != unsupported_ops.end(); ++it) {
+    auto status_or_device = GetDeviceFlag(it.key().asString());
+    if (!status_or_device.ok()) {
+      return status_or_device.status();
+    }
+    model_def.unsupported_ops[status_or_device.value()] = ToIndexSet(*it);
+  }
+
+  for (const Json::Value& device : root["unavailable_devices"]) {
+    auto status_or_device = GetDeviceFlag(device.asString());
+    if (!status_or_device.ok()) {
+      return status_or_device.status();
+    }
+    model_def.unavailable_devices.insert(status_or_device.value());
+  }
+
+  const Json::Value& throttling = root["throttling"];
+  for (auto it = throttling.begin(); it != throttling.end(); ++it) {
+    auto status_or_device = GetDeviceFlag(it.key().asString());
+    if (!status_or_device.ok()) {
+      return status_or_device.status();
+    }
+    SimThrottling& device_throttling =
+        model_def.throttling[status_or_device.value()];
+    json::AssignIfValid(device_throttling.probability, *it, "probability");
+    json::AssignIfValid(device_throttling.duration_us, *it, "duration_us");
+  }
+
+  json::AssignIfValid(model_def.jitter, root, "jitter");
+  json::AssignIfValid(model_def.busy_wait, root, "busy_wait");
+  json::AssignIfValid(model_def.seed, root, "seed");
+
+  // Replays the entries of `model` in a profile of `LatencyEstimator`
+  const Json::Value& profile = root["profile"];
+  if (profile.isObject()) {
+    std::string profile_path, profile_model;
+    if (!json::AssignIfValid(profile_path, profile, "path") ||
+        !json::AssignIfValid(profile_model, profile, "model")) {
+      return absl::InvalidArgumentError(
+          "`profile` of a simulated model requires `path` and `model`");
+    }
+    model_def.profile = json::LoadFromFile(profile_path)[profile_model];
+    if (model_def.profile.isNull()) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Profile %s has no entries for %s", profile_path, profile_model));
+    }
+  }
+
+  model_def_ = model_def;
+  is_initialized_ = true;
+  return absl::OkStatus();
+}
+
+}  // namespace sim
+}  // namespace band
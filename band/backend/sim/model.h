@@ -0,0 +1,85 @@
+/*
+ * Copyright 2023 Seoul National University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BAND_BACKEND_SIM_MODEL_H_
+#define BAND_BACKEND_SIM_MODEL_H_
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <json/json.h>
+
+#include "band/interface/model.h"
+
+namespace band {
+namespace sim {
+
+struct SimThrottling {
+  // Chance that an invoke starts a throttling event
+  double probability = 0.;
+  // The device rejects every invoke during the event
+  int64_t duration_us = 0;
+};
+
+// Graph and per-device cost of a simulated model. See
+// band/docs/simulated_backend.md for the JSON format.
+struct SimModelDef {
+  int num_tensors = 0;
+  std::vector<std::vector<int>> tensor_dims;
+  std::set<int> input_tensors;
+  std::set<int> output_tensors;
+  std::vector<std::set<int>> op_input_tensors;
+  std::vector<std::set<int>> op_output_tensors;
+
+  // Latency of each op, per device. Devices without an entry can only run
+  // subgraphs that are found in `profile`.
+  std::map<DeviceFlag, std::vector<int64_t>> op_latency_us;
+  std::map<DeviceFlag, std::set<int>> unsupported_ops;
+  std::set<DeviceFlag> unavailable_devices;
+  std::map<DeviceFlag, SimThrottling> throttling;
+  // Standard deviation of the latency, relative to the mean
+  double jitter = 0.;
+  // Spins instead of sleeping during a simulated invoke
+  bool busy_wait = false;
+  uint32_t seed = 0;
+
+  // Entries of the model in a profile written by `LatencyEstimator`
+  // ({unit indices: [latency per worker]})
+  Json::Value profile;
+};
+
+class SimModel : public interface::IModel {
+ public:
+  SimModel(ModelId id);
+  BackendType GetBackendType() const override;
+  absl::Status FromPath(const char* filename) override;
+  absl::Status FromBuffer(const char* buffer, size_t buffer_size) override;
+  bool IsInitialized() const override;
+
+  const SimModelDef& GetModelDef() const { return model_def_; }
+
+ private:
+  absl::Status Parse(const Json::Value& root);
+
+  bool is_initialized_ = false;
+  SimModelDef model_def_;
+};
+}  // namespace sim
+}  // namespace band
+
+#endif  // BAND_BACKEND_SIM_MODEL_H_
@@ -0,0 +1,397 @@
+// Copyright 2023 Seoul National University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "band/backend/sim/model_executor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+#include "absl/strings/str_format.h"
+
+namespace band {
+namespace sim {
+namespace {
+
+// Throttling events of the devices, shared by the executors on a clock
+struct DeviceThrottling {
+  int num_executors = 0;
+  std::atomic<int64_t>
+      throttled_until[static_cast<size_t>(DeviceFlag::kNPU) + 1] = {};
+};
+
+std::mutex throttling_mtx;
+std::map<const Clock*, DeviceThrottling> throttlings;
+
+}  // anonymous namespace
+
+SimModelExecutor::SimModelExecutor(ModelId model_id, WorkerId worker_id,
+                                   DeviceFlag device_flag,
+                                   CpuSet thread_affinity_mask,
+                                   int num_threads)
+    : interface::IModelExecutor(model_id, worker_id, device_flag,
+                                thread_affinity_mask, num_threads) {
+  AcquireThrottling();
+}
+
+SimModelExecutor::~SimModelExecutor() { ReleaseThrottling(); }
+
+absl::StatusOr<ModelSpec> SimModelExecutor::InvestigateModelSpec(
+    interface::IModel* model) {
+  if (model->GetBackendType() != BackendType::kSimulated ||
+      !model->IsInitialized()) {
+    return absl::InternalError("Not an initialized simulated model");
+  }
+  ModelSpec model_spec = CreateModelSpec(*static_cast<SimModel*>(model));
+  model_spec.path = model->GetPath();
+  return model_spec;
+}
+
+absl::Status SimModelExecutor::PrepareSubgraph(interface::IModel* model,
+                                               std::set<int> ops,
+                                               std::set<int> unit_indices) {
+  RETURN_IF_ERROR(DeclareSubgraph(model, ops, unit_indices));
+  return MaterializeSubgraph(SubgraphKey(model_id_, worker_id_, unit_indices));
+}
+
+absl::Status SimModelExecutor::DeclareSubgraph(interface::IModel* model,
+                                               std::set<int> ops,
+                                               std::set<int> unit_indices) {
+  if (model_id_ != model->GetId()) {
+    return absl::InternalError(
+        absl::StrFormat("Failed to prepare subgraph, given model id %d != "
+                        "predeclared executor's model id %d",
+                        model->GetId(), model_id_));
+  }
+  if (model->GetBackendType() != BackendType::kSimulated ||
+      !model->IsInitialized()) {
+    return absl::InternalError("Not an initialized simulated model");
+  }
+  SimModel* sim_model = static_cast<SimModel*>(model);
+  const SimModelDef& model_def = sim_model->GetModelDef();
+
+  if (tensors_.empty()) {
+    for (int i = 0; i < model_def.num_tensors; i++) {
+      tensors_.push_back(std::make_shared<SimTensorView>(
+          "tensor_" + std::to_string(i), DataType::kFloat32,
+          model_def.tensor_dims[i]));
+    }
+    auto throttling_it = model_def.throttling.find(device_flag_);
+    if (throttling_it != model_def.throttling.end()) {
+      throttling_ = throttling_it->second;
+    }
+    jitter_ = model_def.jitter;
+    busy_wait_ = model_def.busy_wait;
+    std::seed_seq seed{model_def.seed, static_cast<uint32_t>(model_id_),
+                       static_cast<uint32_t>(worker_id_)};
+    random_engine_.seed(seed);
+  }
+
+  if (ops.empty()) {
+    for (int op = 0; op < model_def.op_input_tensors.size(); op++) {
+      ops.insert(op);
+    }
+  }
+
+  definitions_[SubgraphKey(model_id_, worker_id_, unit_indices)] = {sim_model,
+                                                                    ops};
+  return absl::OkStatus();
+}
+
+bool SimModelExecutor::IsMaterialized(const SubgraphKey& key) const {
+  return subgraphs_.find(key) != subgraphs_.end();
+}
+
+absl::Status SimModelExecutor::MaterializeSubgraph(const SubgraphKey& key) {
+  auto definition_it = definitions_.find(key);
+  if (definition_it == definitions_.end()) {
+    return absl::NotFoundError(
+        absl::StrFormat("Cannot find subgraph %s", key.ToString()));
+  }
+  if (IsMaterialized(key)) {
+    return absl::OkStatus();
+  }
+  const SimModelDef& model_def = definition_it->second.model->GetModelDef();
+  const ModelSpec model_spec = CreateModelSpec(*definition_it->second.model);
+  const std::set<int>& ops = definition_it->second.ops;
+
+  Subgraph subgraph;
+  subgraph.ops = ops;
+  const std::set<int> inputs = model_spec.GetPureInputTensors(ops);
+  subgraph.inputs.assign(inputs.begin(), inputs.end());
+  // Outputs are the tensors that the rest of the model or the user reads
+  for (int tensor : model_spec.GetOutputTensors(ops)) {
+    bool is_output = model_def.output_tensors.count(tensor) > 0;
+    for (int op = 0; op < model_spec.num_ops && !is_output; op++) {
+      is_output = ops.find(op) == ops.end() &&
+                  model_def.op_input_tensors[op].count(tensor) > 0;
+    }
+    if (is_output) {
+      subgraph.outputs.push_back(tensor);
+    }
+  }
+
+  std::set<int> tensors;
+  for (int op : ops) {
+    tensors.insert(model_def.op_input_tensors[op].begin(),
+                   model_def.op_input_tensors[op].end());
+    tensors.insert(model_def.op_output_tensors[op].begin(),
+                   model_def.op_output_tensors[op].end());
+  }
+  subgraph.io_bytes = 0;
+  subgraph.intermediate_bytes = 0;
+  for (int tensor : tensors) {
+    const bool is_io =
+        std::find(subgraph.inputs.begin(), subgraph.inputs.end(), tensor) !=
+            subgraph.inputs.end() ||
+        std::find(subgraph.outputs.begin(), subgraph.outputs.end(), tensor) !=
+            subgraph.outputs.end();
+    (is_io ? subgraph.io_bytes : subgraph.intermediate_bytes) +=
+        tensors_[tensor]->GetBytes();
+  }
+
+  auto status_or_latency = GetLatency(model_def, key, ops);
+  if (!status_or_latency.ok()) {
+    return status_or_latency.status();
+  }
+  subgraph.latency_us = status_or_latency.value();
+  subgraphs_[key] = subgraph;
+  return absl::OkStatus();
+}
+
+absl::Status SimModelExecutor::EvictSubgraph(const SubgraphKey& key) {
+  if (subgraphs_.erase(key) == 0) {
+    return absl::NotFoundError(
+        absl::StrFormat("Subgraph %s is not materialized", key.ToString()));
+  }
+  return absl::OkStatus();
+}
+
+size_t SimModelExecutor::GetMemoryFootprint(const SubgraphKey& key) const {
+  auto it = subgraphs_.find(key);
+  return it != subgraphs_.end() ? it->second.io_bytes : 0;
+}
+
+size_t SimModelExecutor::GetSharedMemoryFootprint() const {
+  size_t bytes = 0;
+  for (const auto& it : subgraphs_) {
+    bytes = std::max(bytes, it.second.intermediate_bytes);
+  }
+  return bytes;
+}
+
+BackendType SimModelExecutor::GetBackendType() const {
+  return BackendType::kSimulated;
+}
+
+const std::vector<int>& SimModelExecutor::GetInputs(
+    const SubgraphKey& key) const {
+  return subgraphs_.at(key).inputs;
+}
+
+const std::vector<int>& SimModelExecutor::GetOutputs(
+    const SubgraphKey& key) const {
+  return subgraphs_.at(key).outputs;
+}
+
+const char* SimModelExecutor::GetInputName(const SubgraphKey& key,
+                                           int index) const {
+  return tensors_[GetInputs(key)[index]]->GetName();
+}
+
+const char* SimModelExecutor::GetOutputName(const SubgraphKey& key,
+                                            int index) const {
+  return tensors_[GetOutputs(key)[index]]->GetName();
+}
+
+size_t SimModelExecutor::GetNumTensors(const SubgraphKey& key) const {
+  return tensors_.size();
+}
+
+size_t SimModelExecutor::GetNumNodes(const SubgraphKey& key) const {
+  return subgraphs_.at(key).ops.size();
+}
+
+std::shared_ptr<interface::ITensorView> SimModelExecutor::GetTensorView(
+    const SubgraphKey& key, int index) {
+  return tensors_[index];
+}
+
+SubgraphKey SimModelExecutor::GetLargestSubgraphKey() const {
+  SubgraphKey largest_key;
+  size_t largest_num_ops = 0;
+
+  for (const auto& it : subgraphs_) {
+    if (largest_num_ops < it.second.ops.size()) {
+      largest_key = it.first;
+      largest_num_ops = it.second.ops.size();
+    }
+  }
+
+  return largest_key;
+}
+
+bool SimModelExecutor::HasSubgraph(const SubgraphKey& key) const {
+  return definitions_.find(key) != definitions_.end();
+}
+
+absl::Status SimModelExecutor::BindTensor(const SubgraphKey& key, int index,
+                                          char* data, size_t bytes) {
+  if (!HasSubgraph(key) || index < 0 ||
+      index >= static_cast<int>(tensors_.size())) {
+    return absl::InternalError(absl::StrFormat(
+        "Cannot find tensor %d of subgraph %s", index, key.ToString()));
+  }
+  if (bytes < tensors_[index]->GetBytes()) {
+    return absl::InternalError(absl::StrFormat(
+        "Bound memory for tensor %d is too small (%d < %d)", index, bytes,
+        tensors_[index]->GetBytes()));
+  }
+  tensors_[index]->SetExternalData(data);
+  return absl::OkStatus();
+}
+
+absl::Status SimModelExecutor::UnbindTensor(const SubgraphKey& key,
+                                            int index) {
+  if (!HasSubgraph(key) || index < 0 ||
+      index >= static_cast<int>(tensors_.size())) {
+    return absl::InternalError(absl::StrFormat(
+        "Cannot find tensor %d of subgraph %s", index, key.ToString()));
+  }
+  tensors_[index]->SetExternalData(nullptr);
+  return absl::OkStatus();
+}
+
+absl::Status SimModelExecutor::ExecuteSubgraph(const SubgraphKey& key) {
+  auto it = subgraphs_.find(key);
+  if (it == subgraphs_.end()) {
+    return absl::InternalError(absl::StrFormat(
+        "Cannot find materialized subgraph %s", key.ToString()));
+  }
+
+  const int64_t start_time = clock_->NowMicros();
+  if (start_time < throttled_until_->load(std::memory_order_acquire)) {
+    return absl::UnavailableError(absl::StrFormat(
+        "Simulated %s device is throttled", ToString(device_flag_)));
+  }
+
+  int64_t latency_us = it->second.latency_us;
+  {
+    std::lock_guard<std::mutex> lock(random_mtx_);
+    if (throttling_.probability > 0 &&
+        std::uniform_real_distribution<double>(0., 1.)(random_engine_) <
+            throttling_.probability) {
+      throttled_until_->store(start_time + throttling_.duration_us,
+                              std::memory_order_release);
+      return absl::UnavailableError(absl::StrFormat(
+          "Simulated %s device started throttling", ToString(device_flag_)));
+    }
+    if (jitter_ > 0) {
+      const double scale =
+          1. + jitter_ * std::normal_distribution<double>()(random_engine_);
+      latency_us = std::max<int64_t>(std::llround(latency_us * scale), 0);
+    }
+  }
+
+  if (busy_wait_ && !clock_->IsVirtual()) {
+    while (clock_->NowMicros() < start_time + latency_us) {
+    }
+  } else {
+    clock_->SleepUntil(start_time + latency_us);
+  }
+  return absl::OkStatus();
+}
+
+void SimModelExecutor::ForEachSubgraph(
+    std::function<void(const SubgraphKey&)> visitor) {
+  for (auto& definition : definitions_) {
+    visitor(definition.first);
+  }
+}
+
+ModelSpec SimModelExecutor::CreateModelSpec(const SimModel& model) {
+  const SimModelDef& model_def = model.GetModelDef();
+
+  std::map<DeviceFlag, std::set<int>> unsupported_ops;
+  std::set<DeviceFlag> unavailable_devices = model_def.unavailable_devices;
+  for (size_t flag = 0; flag < EnumLength<DeviceFlag>(); flag++) {
+    const DeviceFlag device_flag = static_cast<DeviceFlag>(flag);
+    auto it = model_def.unsupported_ops.find(device_flag);
+    unsupported_ops[device_flag] =
+        it != model_def.unsupported_ops.end() ? it->second : std::set<int>();
+    if (model_def.profile.isNull() &&
+        model_def.op_latency_us.find(device_flag) ==
+            model_def.op_latency_us.end()) {
+      unavailable_devices.insert(device_flag);
+    }
+  }
+
+  return ModelSpec(model_def.op_input_tensors.size(), model_def.num_tensors,
+                   std::vector<DataType>(model_def.num_tensors,
+                                         DataType::kFloat32),
+                   model_def.input_tensors, model_def.output_tensors,
+                   model_def.op_input_tensors, model_def.op_output_tensors,
+                   unsupported_ops, unavailable_devices);
+}
+
+absl::StatusOr<int64_t> SimModelExecutor::GetLatency(
+    const SimModelDef& model_def, const SubgraphKey& key,
+    const std::set<int>& ops) const {
+  // Profiled latencies are indexed by worker, as written by LatencyEstimator
+  const Json::Value& worker_latency =
+      model_def.profile[key.GetUnitIndicesString()];
+  if (worker_latency.isArray() && worker_id_ < worker_latency.size() &&
+      worker_latency[worker_id_].asInt64() > 0) {
+    return worker_latency[worker_id_].asInt64();
+  }
+
+  auto it = model_def.op_latency_us.find(device_flag_);
+  if (it == model_def.op_latency_us.end()) {
+    return absl::InternalError(absl::StrFormat(
+        "No simulated latency of subgraph %s on %s", key.ToString(),
+        ToString(device_flag_)));
+  }
+  int64_t latency_us = 0;
+  for (int op : ops) {
+    latency_us += it->second[op];
+  }
+  return latency_us;
+}
+
+void SimModelExecutor::SetClock(Clock* clock) {
+  ReleaseThrottling();
+  interface::IModelExecutor::SetClock(clock);
+  AcquireThrottling();
+}
+
+void SimModelExecutor::AcquireThrottling() {
+  std::lock_guard<std::mutex> lock(throttling_mtx);
+  DeviceThrottling& throttling = throttlings[clock_];
+  throttling.num_executors++;
+  throttled_until_ =
+      &throttling.throttled_until[static_cast<size_t>(device_flag_)];
+}
+
+void SimModelExecutor::ReleaseThrottling() {
+  std::lock_guard<std::mutex> lock(throttling_mtx);
+  auto it = throttlings.find(clock_);
+  // Events end with the clock, whose address may be reused
+  if (it != throttlings.end() && --it->second.num_executors == 0) {
+    throttlings.erase(it);
+  }
+}
+
+}  // namespace sim
+}  // namespace band
@@ -0,0 +1,123 @@
+/*
+ * Copyright 2023 Seoul National University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BAND_BACKEND_SIM_MODEL_EXECUTOR_H_
+#define BAND_BACKEND_SIM_MODEL_EXECUTOR_H_
+
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <unordered_map>
+
+#include "band/backend/sim/model.h"
+#include "band/backend/sim/tensor.h"
+#include "band/interface/model_executor.h"
+
+namespace band {
+namespace sim {
+/*
+  Model executor that only spends time.
+
+  Invoking a subgraph takes its profiled latency on the worker (or the sum of
+  its op latencies on the device), perturbed by the jitter of the model.
+  Throttling events reject invokes on the device for a while, across every
+  model that runs on it.
+*/
+class SimModelExecutor : public interface::IModelExecutor {
+ public:
+  SimModelExecutor(ModelId model_id, WorkerId worker_id,
+                   DeviceFlag device_flag, CpuSet thread_affinity_mask,
+                   int num_threads);
+  ~SimModelExecutor() override;
+
+  absl::StatusOr<ModelSpec> InvestigateModelSpec(
+      interface::IModel* model) override;
+  absl::Status PrepareSubgraph(interface::IModel* model, std::set<int> ops = {},
+                               std::set<int> unit_indices = {}) override;
+  absl::Status DeclareSubgraph(interface::IModel* model, std::set<int> ops = {},
+                               std::set<int> unit_indices = {}) override;
+  bool IsMaterialized(const SubgraphKey& key) const override;
+  absl::Status MaterializeSubgraph(const SubgraphKey& key) override;
+  absl::Status EvictSubgraph(const SubgraphKey& key) override;
+  // Bytes of the inputs and outputs of the subgraph. Like the TfLite
+  // backend, the other tensors that its ops use count towards an arena
+  // that is shared by the subgraphs of the executor.
+  size_t GetMemoryFootprint(const SubgraphKey& key) const override;
+  size_t GetSharedMemoryFootprint() const override;
+
+  BackendType GetBackendType() const override;
+  const std::vector<int>& GetInputs(const SubgraphKey& key) const override;
+  const std::vector<int>& GetOutputs(const SubgraphKey& key) const override;
+  const char* GetInputName(const SubgraphKey& key, int index) const override;
+  const char* GetOutputName(const SubgraphKey& key, int index) const override;
+  size_t GetNumTensors(const SubgraphKey& key) const override;
+  size_t GetNumNodes(const SubgraphKey& key) const override;
+
+  std::shared_ptr<interface::ITensorView> GetTensorView(const SubgraphKey& key,
+                                                        int index) override;
+  SubgraphKey GetLargestSubgraphKey() const override;
+  bool HasSubgraph(const SubgraphKey& key) const override;
+  // Tensors are shared by the subgraphs of the executor, so binding a tensor
+  // of one subgraph binds it for all of them.
+  absl::Status BindTensor(const SubgraphKey& key, int index, char* data,
+                          size_t bytes) override;
+  absl::Status UnbindTensor(const SubgraphKey& key, int index) override;
+
+  absl::Status ExecuteSubgraph(const SubgraphKey& key) override;
+  void ForEachSubgraph(
+      std::function<void(const SubgraphKey&)> visitor) override;
+  void SetClock(Clock* clock) override;
+
+ private:
+  struct Definition {
+    SimModel* model;
+    std::set<int> ops;
+  };
+  struct Subgraph {
+    std::set<int> ops;
+    std::vector<int> inputs;
+    std::vector<int> outputs;
+    int64_t latency_us;
+    size_t io_bytes;
+    size_t intermediate_bytes;
+  };
+
+  static ModelSpec CreateModelSpec(const SimModel& model);
+  absl::StatusOr<int64_t> GetLatency(const SimModelDef& model_def,
+                                     const SubgraphKey& key,
+                                     const std::set<int>& ops) const;
+  // Shares the throttling events of the device with the other executors on
+  // the clock.
+  void AcquireThrottling();
+  void ReleaseThrottling();
+
+  std::unordered_map<SubgraphKey, Definition, SubgraphHash> definitions_;
+  // Materialized subgraphs
+  std::unordered_map<SubgraphKey, Subgraph, SubgraphHash> subgraphs_;
+  std::vector<std::shared_ptr<SimTensorView>> tensors_;
+
+  SimThrottling throttling_;
+  // Time at which the throttling event of the device ends
+  std::atomic<int64_t>* throttled_until_ = nullptr;
+  double jitter_ = 0.;
+  bool busy_wait_ = false;
+  std::mutex random_mtx_;
+  std::mt19937 random_engine_;
+};
+}  // namespace sim
+}  // namespace band
+
+#endif  // BAND_BACKEND_SIM_MODEL_EXECUTOR_H_
@@ -0,0 +1,68 @@
+// Copyright 2023 Seoul National University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "band/backend/sim/tensor.h"
+
+namespace band {
+namespace sim {
+SimTensorView::SimTensorView(std::string name, DataType type,
+                             std::vector<int> dims)
+    : name_(name),
+      type_(type),
+      dims_(dims),
+      quantization_(QuantizationType::kNoQuantization, nullptr),
+      data_(GetBytes()) {}
+
+BackendType SimTensorView::GetBackendType() const {
+  return BackendType::kSimulated;
+}
+
+DataType SimTensorView::GetType() const { return type_; }
+
+void SimTensorView::SetType(DataType type) {
+  type_ = type;
+  data_.resize(GetBytes());
+}
+
+const char* SimTensorView::GetData() const {
+  return external_data_ ? external_data_ : data_.data();
+}
+
+char* SimTensorView::GetData() {
+  return external_data_ ? external_data_ : data_.data();
+}
+
+const int* SimTensorView::GetDims() const { return dims_.data(); }
+
+size_t SimTensorView::GetNumDims() const { return dims_.size(); }
+
+void SimTensorView::SetDims(const std::vector<int>& dims) {
+  dims_ = dims;
+  data_.resize(GetBytes());
+}
+
+const char* SimTensorView::GetName() const { return name_.c_str(); }
+
+Quantization SimTensorView::GetQuantization() const { return quantization_; }
+
+absl::Status SimTensorView::SetQuantization(Quantization quantization) {
+  quantization_ = quantization;
+  return absl::OkStatus();
+}
+
+void SimTensorView::SetExternalData(char* data) { external_data_ = data; }
+
+}  // namespace sim
+}  // namespace band
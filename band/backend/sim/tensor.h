@@ -0,0 +1,58 @@
+/*
+ * Copyright 2023 Seoul National University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BAND_BACKEND_SIM_TENSOR_H_
+#define BAND_BACKEND_SIM_TENSOR_H_
+
+#include <string>
+#include <vector>
+
+#include "band/interface/tensor_view.h"
+
+namespace band {
+namespace sim {
+// Tensor owned by a simulated model executor.
+class SimTensorView : public interface::ITensorView {
+ public:
+  SimTensorView(std::string name, DataType type, std::vector<int> dims);
+
+  BackendType GetBackendType() const override;
+  DataType GetType() const override;
+  void SetType(DataType type) override;
+  const char* GetData() const override;
+  char* GetData() override;
+  const int* GetDims() const override;
+  size_t GetNumDims() const override;
+  void SetDims(const std::vector<int>& dims) override;
+  const char* GetName() const override;
+  Quantization GetQuantization() const override;
+  absl::Status SetQuantization(Quantization quantization) override;
+  // Uses caller-owned `data` as the storage of the tensor, or the owned
+  // storage again if `data` is null.
+  void SetExternalData(char* data);
+
+ private:
+  std::string name_;
+  DataType type_;
+  std::vector<int> dims_;
+  Quantization quantization_;
+  std::vector<char> data_;
+  char* external_data_ = nullptr;
+};
+}  // namespace sim
+}  // namespace band
+
+#endif  // BAND_BACKEND_SIM_TENSOR_H_
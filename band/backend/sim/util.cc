@@ -0,0 +1,28 @@
+// Copyright 2023 Seoul National University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "band/backend/sim/util.h"
+
+namespace band {
+namespace sim {
+std::set<DeviceFlag> SimUtil::GetAvailableDevices() const {
+  std::set<DeviceFlag> devices;
+  for (size_t flag = 0; flag < EnumLength<DeviceFlag>(); flag++) {
+    devices.insert(static_cast<DeviceFlag>(flag));
+  }
+  return devices;
+}
+}  // namespace sim
+}  // namespace band
@@ -14,6 +14,9 @@
 
 #include "band/backend/tfl/model_executor.h"
 
+#include <algorithm>
+#include <cstdlib>
+
 #include "band/backend/tfl/model.h"
 #include "band/backend/tfl/tensor.h"
 #include "band/backend/tfl/util.h"
@@ -42,11 +45,16 @@ namespace tfl {
 
 std::map<DeviceFlag, tflite::Interpreter::TfLiteDelegatePtr>
     TfLiteModelExecutor::delegates_ = {};
+std::map<DeviceFlag, std::mutex> TfLiteModelExecutor::device_mtxs_;
+std::mutex TfLiteModelExecutor::delegates_mtx_;
 
 TfLiteModelExecutor::~TfLiteModelExecutor() {
   // explicitly remove interpreters first
   // since delegates own interpreter.
   interpreters_.clear();
+  unbound_tensors_.clear();
+  definitions_.clear();
+  shared_arena_.reset();
 }
 
 absl::StatusOr<ModelSpec> TfLiteModelExecutor::InvestigateModelSpec(
@@ -177,24 +185,240 @@ absl::StatusOr<ModelSpec> TfLiteModelExecutor::InvestigateModelSpec(
 absl::Status TfLiteModelExecutor::PrepareSubgraph(interface::IModel* model,
                                                   std::set<int> ops,
                                                   std::set<int> unit_indices) {
+  RETURN_IF_ERROR(DeclareSubgraph(model, ops, unit_indices));
+  return MaterializeSubgraph(
+      SubgraphKey(model->GetId(), worker_id_, unit_indices));
+}
+
+absl::Status TfLiteModelExecutor::DeclareSubgraph(interface::IModel* model,
+                                                  std::set<int> ops,
+                                                  std::set<int> unit_indices) {
   if (model_id_ != model->GetId()) {
     return absl::InternalError(
         absl::StrFormat("Failed to prepare subgraph, given model id %d != "
                         "predeclared interpreter's model id %d",
                         model->GetId(), model_id_));
   }
+  definitions_[SubgraphKey(model->GetId(), worker_id_, unit_indices)] = {
+      model, ops};
+  return absl::OkStatus();
+}
+
+bool TfLiteModelExecutor::IsMaterialized(const SubgraphKey& key) const {
+  return interpreters_.find(key) != interpreters_.end();
+}
 
-  std::unique_ptr<tflite::Interpreter> interpreter =
-      CreateTfLiteInterpreter(model, device_flag_, ops).value();
+absl::Status TfLiteModelExecutor::MaterializeSubgraph(const SubgraphKey& key) {
+  auto it = definitions_.find(key);
+  if (it == definitions_.end()) {
+    return absl::NotFoundError(
+        absl::StrFormat("Cannot find subgraph %s", key.ToString()));
+  }
+  if (IsMaterialized(key)) {
+    return absl::OkStatus();
+  }
 
-  if (!interpreter) {
+  RETURN_IF_ERROR(RebuildInterpreter(key));
+
+  // Delegates own the intermediate tensors of their partitions
+  if (device_flag_ == DeviceFlag::kCPU) {
+    auto status = ShareArena(key);
+    if (!status.ok()) {
+      BAND_LOG(LogSeverity::kWarning,
+               "Subgraph %s keeps its own activation arena: %s",
+               key.ToString().c_str(), status.ToString().c_str());
+      shared_tensors_.erase(key);
+      auto rebuild_status = RebuildInterpreter(key);
+      if (!rebuild_status.ok()) {
+        interpreters_.erase(key);
+        return rebuild_status;
+      }
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::Status TfLiteModelExecutor::RebuildInterpreter(const SubgraphKey& key) {
+  const auto& definition = definitions_.at(key);
+  auto status_or_interpreter = CreateTfLiteInterpreter(
+      definition.first, device_flag_, definition.second);
+  if (!status_or_interpreter.ok() || !status_or_interpreter.value()) {
     return absl::InternalError("Failed to create TFLite Interpreter");
   }
-  interpreters_[SubgraphKey(model->GetId(), worker_id_, unit_indices)] =
-      std::move(interpreter);
+
+  // Storage of unbound tensors belongs to the previous interpreter
+  const tflite::Interpreter* previous_interpreter = GetInterpreter(key);
+  for (auto tensor_it = unbound_tensors_.begin();
+       tensor_it != unbound_tensors_.end();) {
+    if (tensor_it->first.first == previous_interpreter) {
+      tensor_it = unbound_tensors_.erase(tensor_it);
+    } else {
+      ++tensor_it;
+    }
+  }
+  interpreters_[key] = std::move(status_or_interpreter.value());
+  return absl::OkStatus();
+}
+
+absl::Status TfLiteModelExecutor::ShareArena(const SubgraphKey& key) {
+  tflite::Interpreter* interpreter = GetInterpreter(key);
+  std::set<int> io_tensors(interpreter->inputs().begin(),
+                           interpreter->inputs().end());
+  io_tensors.insert(interpreter->outputs().begin(),
+                    interpreter->outputs().end());
+
+  auto is_shared = [&](size_t index) {
+    const TfLiteTensor* tensor = interpreter->tensor(index);
+    return tensor->allocation_type == kTfLiteArenaRw &&
+           tensor->data.raw != nullptr && tensor->bytes > 0 &&
+           io_tensors.find(index) == io_tensors.end();
+  };
+
+  // Offsets within the arena of the interpreter, which is one allocation
+  const char* base = nullptr;
+  for (size_t i = 0; i < interpreter->tensors_size(); i++) {
+    if (is_shared(i) && (base == nullptr || interpreter->tensor(i)->data.raw <
+                                                base)) {
+      base = interpreter->tensor(i)->data.raw;
+    }
+  }
+  if (base == nullptr) {
+    return absl::OkStatus();
+  }
+
+  const size_t alignment = 64;
+  std::vector<SharedTensor> tensors;
+  size_t arena_bytes = 0;
+  for (size_t i = 0; i < interpreter->tensors_size(); i++) {
+    if (!is_shared(i)) {
+      continue;
+    }
+    const TfLiteTensor* tensor = interpreter->tensor(i);
+    const size_t offset = tensor->data.raw - base;
+    if (offset % alignment != 0) {
+      return absl::InternalError(absl::StrFormat(
+          "Tensor %d of subgraph %s is not aligned in the arena", i,
+          key.ToString()));
+    }
+    tensors.push_back({static_cast<int>(i), offset, tensor->bytes});
+    arena_bytes = std::max(arena_bytes, offset + tensor->bytes);
+  }
+  shared_tensors_[key] = std::move(tensors);
+
+  // AllocateTensors() already committed the interpreter's own arena, which
+  // TfLite never shrinks. Release it, so that the next allocation only
+  // places the tensors that stay private.
+  if (interpreter->ReleaseNonPersistentMemory() != kTfLiteOk) {
+    return absl::InternalError(absl::StrFormat(
+        "Failed to release the arena of subgraph %s", key.ToString()));
+  }
+
+  if (arena_bytes <= shared_arena_bytes_) {
+    return ApplySharedArena(key);
+  }
+
+  // Grow the arena, and move the tensors of the other interpreters to it
+  arena_bytes = (arena_bytes + alignment - 1) / alignment * alignment;
+  std::unique_ptr<void, void (*)(void*)> arena(
+      aligned_alloc(alignment, arena_bytes), free);
+  if (arena == nullptr) {
+    return absl::InternalError(absl::StrFormat(
+        "Failed to allocate %d bytes for the shared arena", arena_bytes));
+  }
+  // `arena` keeps the previous arena alive until every interpreter moved
+  std::swap(shared_arena_, arena);
+  std::swap(shared_arena_bytes_, arena_bytes);
+
+  std::vector<SubgraphKey> moved_keys;
+  absl::Status status = ApplySharedArena(key);
+  if (status.ok()) {
+    for (const auto& it : shared_tensors_) {
+      if (it.first == key) {
+        continue;
+      }
+      moved_keys.push_back(it.first);
+      status = ApplySharedArena(it.first);
+      if (!status.ok()) {
+        break;
+      }
+    }
+  }
+  if (status.ok()) {
+    return absl::OkStatus();
+  }
+
+  // Move the other interpreters back to the previous arena, including the
+  // one that failed halfway. `key` is rebuilt by the caller.
+  std::swap(shared_arena_, arena);
+  std::swap(shared_arena_bytes_, arena_bytes);
+  for (const SubgraphKey& moved_key : moved_keys) {
+    auto restore_status = ApplySharedArena(moved_key);
+    if (!restore_status.ok()) {
+      BAND_LOG(LogSeverity::kError,
+               "Failed to move subgraph %s back to the previous arena: %s",
+               moved_key.ToString().c_str(),
+               restore_status.ToString().c_str());
+    }
+  }
+  return status;
+}
+
+absl::Status TfLiteModelExecutor::ApplySharedArena(const SubgraphKey& key) {
+  tflite::Interpreter* interpreter = GetInterpreter(key);
+  char* arena = static_cast<char*>(shared_arena_.get());
+  for (const SharedTensor& tensor : shared_tensors_.at(key)) {
+    TfLiteCustomAllocation allocation{arena + tensor.offset, tensor.bytes};
+    if (interpreter->SetCustomAllocationForTensor(tensor.index, allocation) !=
+        kTfLiteOk) {
+      return absl::InternalError(absl::StrFormat(
+          "Failed to share tensor %d of subgraph %s", tensor.index,
+          key.ToString()));
+    }
+  }
+  if (interpreter->AllocateTensors() != kTfLiteOk) {
+    return absl::InternalError(absl::StrFormat(
+        "Failed to allocate subgraph %s with the shared arena",
+        key.ToString()));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status TfLiteModelExecutor::EvictSubgraph(const SubgraphKey& key) {
+  auto it = interpreters_.find(key);
+  if (it == interpreters_.end()) {
+    return absl::NotFoundError(
+        absl::StrFormat("Subgraph %s is not materialized", key.ToString()));
+  }
+  const tflite::Interpreter* interpreter = it->second.get();
+  for (auto tensor_it = unbound_tensors_.begin();
+       tensor_it != unbound_tensors_.end();) {
+    if (tensor_it->first.first == interpreter) {
+      tensor_it = unbound_tensors_.erase(tensor_it);
+    } else {
+      ++tensor_it;
+    }
+  }
+  interpreters_.erase(it);
+  shared_tensors_.erase(key);
   return absl::OkStatus();
 }
 
+size_t TfLiteModelExecutor::GetMemoryFootprint(const SubgraphKey& key) const {
+  const tflite::Interpreter* interpreter = GetInterpreter(key);
+  if (!interpreter) {
+    return 0;
+  }
+  // Committed arenas rather than the tensor sizes, since an arena keeps its
+  // size after tensors move out of it
+  tflite::SubgraphAllocInfo alloc_info;
+  interpreter->primary_subgraph().GetMemoryAllocInfo(&alloc_info);
+  return alloc_info.arena_size + alloc_info.arena_persist_size;
+}
+
+size_t TfLiteModelExecutor::GetSharedMemoryFootprint() const {
+  return shared_arena_bytes_;
+}
+
 BackendType TfLiteModelExecutor::GetBackendType() const {
   return BackendType::kTfLite;
 }
@@ -247,12 +471,146 @@ SubgraphKey TfLiteModelExecutor::GetLargestSubgraphKey() const {
 }
 
 bool TfLiteModelExecutor::HasSubgraph(const SubgraphKey& key) const {
-  return interpreters_.find(key) != interpreters_.end();
+  return definitions_.find(key) != definitions_.end();
+}
+
+absl::Status TfLiteModelExecutor::BindTensor(const SubgraphKey& key,
+                                             int index, char* data,
+                                             size_t bytes) {
+  tflite::Interpreter* interpreter = GetInterpreter(key);
+  if (!interpreter || index < 0 || index >= interpreter->tensors_size()) {
+    return absl::InternalError(absl::StrFormat(
+        "Cannot find tensor %d of subgraph %s", index, key.ToString()));
+  }
+
+  // Checked here since AllocateTensors() only verifies the size after the
+  // tensor already points to the new memory.
+  if (bytes < interpreter->tensor(index)->bytes) {
+    return absl::InternalError(absl::StrFormat(
+        "Bound memory for tensor %d is too small (%d < %d)", index, bytes,
+        interpreter->tensor(index)->bytes));
+  }
+
+  // Fails for non-arena tensors (e.g., constants) and unaligned memory.
+  TfLiteCustomAllocation allocation{data, bytes};
+  if (interpreter->SetCustomAllocationForTensor(index, allocation) !=
+      kTfLiteOk) {
+    return absl::InternalError(absl::StrFormat(
+        "Failed to bind tensor %d of subgraph %s", index, key.ToString()));
+  }
+  if (interpreter->AllocateTensors() != kTfLiteOk) {
+    // The tensor already points to `data`, move it back to owned memory
+    auto status = UnbindTensor(key, index);
+    return absl::InternalError(absl::StrFormat(
+        "Failed to bind tensor %d of subgraph %s (rollback: %s)", index,
+        key.ToString(), status.ToString()));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status TfLiteModelExecutor::UnbindTensor(const SubgraphKey& key,
+                                               int index) {
+  tflite::Interpreter* interpreter = GetInterpreter(key);
+  if (!interpreter || index < 0 || index >= interpreter->tensors_size()) {
+    return absl::InternalError(absl::StrFormat(
+        "Cannot find tensor %d of subgraph %s", index, key.ToString()));
+  }
+
+  const TfLiteTensor* tensor = interpreter->tensor(index);
+  if (tensor->allocation_type != kTfLiteCustom) {
+    return absl::OkStatus();
+  }
+
+  auto it = unbound_tensors_.find({interpreter, index});
+  if (it == unbound_tensors_.end()) {
+    // aligned_alloc requires the size to be a multiple of the alignment
+    const size_t alignment = 64;
+    const size_t size =
+        std::max(alignment, (tensor->bytes + alignment - 1) / alignment *
+                                alignment);
+    void* storage = aligned_alloc(alignment, size);
+    if (storage == nullptr) {
+      return absl::InternalError(
+          absl::StrFormat("Failed to allocate %d bytes for tensor %d", size,
+                          index));
+    }
+    it = unbound_tensors_
+             .emplace(std::make_pair(interpreter, index),
+                      std::unique_ptr<void, void (*)(void*)>(storage, free))
+             .first;
+  }
+
+  TfLiteCustomAllocation allocation{it->second.get(), tensor->bytes};
+  if (interpreter->SetCustomAllocationForTensor(index, allocation) !=
+          kTfLiteOk ||
+      interpreter->AllocateTensors() != kTfLiteOk) {
+    return absl::InternalError(absl::StrFormat(
+        "Failed to unbind tensor %d of subgraph %s", index, key.ToString()));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status TfLiteModelExecutor::ResizeBatch(const SubgraphKey& key,
+                                              int batch_size) {
+  if (!GetInterpreter(key) || batch_size <= 0) {
+    return absl::InternalError(absl::StrFormat(
+        "Cannot resize subgraph %s to batch size %d", key.ToString(),
+        batch_size));
+  }
+
+  // Shared tensors are custom allocations sized for the current batch, which
+  // TfLite cannot hand back to the interpreter's arena. Resize a fresh
+  // interpreter instead, and share its arena again at the batched sizes.
+  const bool is_shared = shared_tensors_.erase(key) > 0;
+  if (is_shared) {
+    RETURN_IF_ERROR(RebuildInterpreter(key));
+  }
+  RETURN_IF_ERROR(ResizeInputs(key, batch_size));
+  if (!is_shared) {
+    return absl::OkStatus();
+  }
+
+  auto status = ShareArena(key);
+  if (!status.ok()) {
+    BAND_LOG(LogSeverity::kWarning,
+             "Subgraph %s keeps its own activation arena: %s",
+             key.ToString().c_str(), status.ToString().c_str());
+    shared_tensors_.erase(key);
+    RETURN_IF_ERROR(RebuildInterpreter(key));
+    return ResizeInputs(key, batch_size);
+  }
+  return absl::OkStatus();
+}
+
+absl::Status TfLiteModelExecutor::ResizeInputs(const SubgraphKey& key,
+                                               int batch_size) {
+  tflite::Interpreter* interpreter = GetInterpreter(key);
+  for (int input : interpreter->inputs()) {
+    const TfLiteIntArray* dims = interpreter->tensor(input)->dims;
+    if (dims->size == 0) {
+      return absl::InternalError(absl::StrFormat(
+          "Scalar input %d of subgraph %s cannot be batched", input,
+          key.ToString()));
+    }
+    std::vector<int> batched_dims(dims->data, dims->data + dims->size);
+    batched_dims[0] = batch_size;
+    if (interpreter->ResizeInputTensor(input, batched_dims) != kTfLiteOk) {
+      return absl::InternalError(absl::StrFormat(
+          "Failed to resize input %d of subgraph %s", input, key.ToString()));
+    }
+  }
+
+  if (interpreter->AllocateTensors() != kTfLiteOk) {
+    return absl::InternalError(absl::StrFormat(
+        "Failed to allocate subgraph %s with batch size %d", key.ToString(),
+        batch_size));
+  }
+  return absl::OkStatus();
 }
 
 absl::Status TfLiteModelExecutor::ExecuteSubgraph(const SubgraphKey& key) {
-  if (!HasSubgraph(key)) {
-    return absl::InternalError("Cannot find subgraph");
+  if (!IsMaterialized(key)) {
+    return absl::InternalError("Cannot find materialized subgraph");
   }
   absl::Status status = GetBandStatus(interpreters_[key]->Invoke());
   return status;
@@ -260,8 +618,8 @@ absl::Status TfLiteModelExecutor::ExecuteSubgraph(const SubgraphKey& key) {
 
 void TfLiteModelExecutor::ForEachSubgraph(
     std::function<void(const SubgraphKey&)> visitor) {
-  for (const auto& interpreter : interpreters_) {
-    visitor(interpreter.first);
+  for (const auto& definition : definitions_) {
+    visitor(definition.first);
   }
 }
 
@@ -349,7 +707,17 @@ TfLiteModelExecutor::CreateTfLiteInterpreter(interface::IModel* model,
   if (!status_or_delegate.ok()) {
     return status_or_delegate.status();
   }
+  std::mutex* device_mtx = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(delegates_mtx_);
+    device_mtx = &device_mtxs_[device];
+  }
+  // Interpreters without a delegate build independently
+  std::unique_lock<std::mutex> device_lock(*device_mtx, std::defer_lock);
   auto delegate = status_or_delegate.value();
+  if (delegate) {
+    device_lock.lock();
+  }
   if ((device != DeviceFlag::kCPU) && !delegate) {
     return absl::InternalError(absl::StrFormat(
         "Failed to create Tensorflow Lite delegate for %s", ToString(device)));
@@ -378,6 +746,7 @@ TfLiteModelExecutor::CreateTfLiteInterpreter(interface::IModel* model,
 
 absl::StatusOr<TfLiteDelegate*> TfLiteModelExecutor::GetDeviceDelegate(
     DeviceFlag device) {
+  std::lock_guard<std::mutex> lock(delegates_mtx_);
   auto delegate_it = delegates_.find(device);
   if (delegate_it != delegates_.end()) {
     return delegate_it->second.get();
@@ -17,6 +17,9 @@
 #ifndef BAND_BACKEND_TFL_MODEL_EXECUTOR_H_
 #define BAND_BACKEND_TFL_MODEL_EXECUTOR_H_
 
+#include <map>
+#include <mutex>
+
 #include "band/interface/model_executor.h"
 #include "tensorflow/lite/interpreter.h"
 
@@ -31,6 +34,14 @@ class TfLiteModelExecutor : public interface::IModelExecutor {
       interface::IModel* model) override;
   absl::Status PrepareSubgraph(interface::IModel* model, std::set<int> ops = {},
                                std::set<int> unit_indices = {}) override;
+  absl::Status DeclareSubgraph(interface::IModel* model, std::set<int> ops = {},
+                               std::set<int> unit_indices = {}) override;
+  bool IsMaterialized(const SubgraphKey& key) const override;
+  absl::Status MaterializeSubgraph(const SubgraphKey& key) override;
+  absl::Status EvictSubgraph(const SubgraphKey& key) override;
+  // Bytes of the arena tensors of the interpreter, without the shared arena
+  size_t GetMemoryFootprint(const SubgraphKey& key) const override;
+  size_t GetSharedMemoryFootprint() const override;
 
   BackendType GetBackendType() const override;
   const std::vector<int>& GetInputs(const SubgraphKey& key) const override;
@@ -45,6 +56,11 @@ class TfLiteModelExecutor : public interface::IModelExecutor {
   SubgraphKey GetLargestSubgraphKey() const override;
   bool HasSubgraph(const SubgraphKey& key) const override;
 
+  absl::Status BindTensor(const SubgraphKey& key, int index, char* data,
+                          size_t bytes) override;
+  absl::Status UnbindTensor(const SubgraphKey& key, int index) override;
+  absl::Status ResizeBatch(const SubgraphKey& key, int batch_size) override;
+
   absl::Status ExecuteSubgraph(const SubgraphKey& key) override;
   void ForEachSubgraph(
       std::function<void(const SubgraphKey&)> visitor) override;
@@ -59,12 +75,52 @@ class TfLiteModelExecutor : public interface::IModelExecutor {
       interface::IModel* model, DeviceFlag device,
       std::set<int> op_indices = {});
   static absl::StatusOr<TfLiteDelegate*> GetDeviceDelegate(DeviceFlag device);
+  // Replaces the interpreter of a declared subgraph with a fresh one.
+  absl::Status RebuildInterpreter(const SubgraphKey& key);
+  // Resizes dimension 0 of the inputs and reallocates the interpreter.
+  absl::Status ResizeInputs(const SubgraphKey& key, int batch_size);
 
+  // Moves the intermediate tensors of the interpreter to the shared arena,
+  // and releases the interpreter's own arena. If the shared arena has to
+  // grow, the other interpreters move to the new one, or all stay in the
+  // previous one if any of them fails to move.
+  absl::Status ShareArena(const SubgraphKey& key);
+  absl::Status ApplySharedArena(const SubgraphKey& key);
+
+  // Model and ops of every declared subgraph
+  std::unordered_map<SubgraphKey, std::pair<interface::IModel*, std::set<int>>,
+                     SubgraphHash>
+      definitions_;
+  // Interpreters of the materialized subgraphs
   std::unordered_map<SubgraphKey, std::unique_ptr<tflite::Interpreter>,
                      SubgraphHash>
       interpreters_;
+  // Storage for tensors released by UnbindTensor(), since TfLite cannot hand
+  // a custom-allocated tensor back to the interpreter's arena.
+  std::map<std::pair<const tflite::Interpreter*, int>,
+           std::unique_ptr<void, void (*)(void*)>>
+      unbound_tensors_;
+  // The worker runs one subgraph at a time, so the intermediate tensors of
+  // all interpreters (those that are neither inputs nor outputs of their
+  // subgraph) live in one arena, sized to the largest subgraph. Each
+  // interpreter keeps the offsets of its own arena plan.
+  struct SharedTensor {
+    int index;
+    size_t offset;
+    size_t bytes;
+  };
+  std::unordered_map<SubgraphKey, std::vector<SharedTensor>, SubgraphHash>
+      shared_tensors_;
+  std::unique_ptr<void, void (*)(void*)> shared_arena_{nullptr, free};
+  size_t shared_arena_bytes_ = 0;
+  // Delegates are shared by the executors of all models, which may be
+  // prepared concurrently (`Engine::RegisterModels`). `delegates_mtx_`
+  // guards both maps, and a device mutex serializes the builds of
+  // interpreters on a delegate.
   static std::map<DeviceFlag, tflite::Interpreter::TfLiteDelegatePtr>
       delegates_;
+  static std::map<DeviceFlag, std::mutex> device_mtxs_;
+  static std::mutex delegates_mtx_;
 };
 }  // namespace tfl
 }  // namespace band
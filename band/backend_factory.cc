@@ -29,6 +29,14 @@ __attribute__((weak)) extern bool TfLiteRegisterCreators() { return false; }
 #endif
 #endif
 
+#ifdef BAND_SIMULATED
+#ifdef _WIN32
+extern bool SimRegisterCreators();
+#else
+__attribute__((weak)) extern bool SimRegisterCreators() { return false; }
+#endif
+#endif
+
 // Expected process
 void RegisterBackendInternal() {
   static std::once_flag g_flag;
@@ -41,6 +49,13 @@ void RegisterBackendInternal() {
     }
 #else
     BAND_LOG(LogSeverity::kInfo, "TFL backend is disabled.");
+#endif
+#ifdef BAND_SIMULATED
+    if (SimRegisterCreators()) {
+      BAND_LOG(LogSeverity::kInfo, "Register simulated backend");
+    } else {
+      BAND_LOG(LogSeverity::kError, "Failed to register simulated backend");
+    }
 #endif
   });
 }
@@ -0,0 +1,173 @@
+// Copyright 2023 Seoul National University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "band/batcher.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace band {
+
+void Batcher::Init(int max_batch_size, int64_t batch_timeout_us) {
+  max_batch_size_ = max_batch_size;
+  batch_timeout_us_ = batch_timeout_us;
+}
+
+int64_t Batcher::Batch(size_t queue_index, JobQueue& jobs,
+                       int64_t current_time) {
+  if (held_jobs_.size() <= queue_index) {
+    held_jobs_.resize(queue_index + 1);
+  }
+  auto& held_jobs = held_jobs_[queue_index];
+
+  JobQueue passed_jobs;
+  for (const JobHandle& handle : jobs) {
+    const Job* job = handle.Get();
+    if (job != nullptr && IsBatchable(*job)) {
+      held_jobs[job->model_id].push_back(handle);
+    } else {
+      passed_jobs.push_back(handle);
+    }
+  }
+
+  JobQueue ready_jobs;
+  int64_t deadline = -1;
+  for (auto it = held_jobs.begin(); it != held_jobs.end();) {
+    std::vector<JobHandle>& model_jobs = it->second;
+    int64_t expected_latency = 0;
+    const std::vector<int> batch_sizes =
+        GetBatchSizes(it->first, &expected_latency);
+
+    if (!batch_sizes.empty()) {
+      while (model_jobs.size() >= batch_sizes.back()) {
+        ready_jobs.push_back(FormBatch(model_jobs, batch_sizes.back()));
+      }
+    }
+
+    // Release the rest once the oldest one waited long enough, or a request
+    // would miss its SLO even with a full batch
+    int64_t model_deadline = std::numeric_limits<int64_t>::max();
+    for (const JobHandle& handle : model_jobs) {
+      model_deadline = std::min(model_deadline,
+                                handle->enqueue_time + batch_timeout_us_);
+      if (handle->slo_us > 0) {
+        model_deadline =
+            std::min(model_deadline,
+                     handle->enqueue_time + handle->slo_us - expected_latency);
+      }
+    }
+
+    if (!model_jobs.empty() &&
+        (batch_sizes.empty() || current_time >= model_deadline)) {
+      for (auto size_it = batch_sizes.rbegin(); size_it != batch_sizes.rend();
+           ++size_it) {
+        while (model_jobs.size() >= *size_it) {
+          ready_jobs.push_back(FormBatch(model_jobs, *size_it));
+        }
+      }
+      while (!model_jobs.empty()) {
+        ready_jobs.push_back(FormBatch(model_jobs, 1));
+      }
+    }
+
+    if (model_jobs.empty()) {
+      it = held_jobs.erase(it);
+    } else {
+      deadline = deadline < 0 ? model_deadline
+                              : std::min(deadline, model_deadline);
+      ++it;
+    }
+  }
+
+  // Released jobs have waited the longest
+  ready_jobs.insert(ready_jobs.end(), passed_jobs.begin(), passed_jobs.end());
+  jobs = std::move(ready_jobs);
+  return deadline;
+}
+
+std::vector<JobHandle> Batcher::TakeMembers(JobId job_id) {
+  std::lock_guard<std::mutex> lock(members_mtx_);
+  auto it = members_.find(job_id);
+  if (it == members_.end()) {
+    return {};
+  }
+  std::vector<JobHandle> members = std::move(it->second);
+  members_.erase(it);
+  return members;
+}
+
+bool Batcher::IsBatchable(const Job& job) const {
+  // Only new requests for the whole model, which any worker may run
+  return job.batch_size == 1 && !job.io_bound &&
+         job.status == JobStatus::kQueued && job.target_worker_id == -1 &&
+         job.resolved_unit_subgraphs.none() &&
+         job.previous_subgraph_keys.empty();
+}
+
+std::vector<int> Batcher::GetBatchSizes(ModelId model_id,
+                                        int64_t* expected_latency) const {
+  std::vector<int> batch_sizes;
+  *expected_latency = std::numeric_limits<int64_t>::max();
+  for (WorkerId worker_id = 0; worker_id < engine_.GetNumWorkers();
+       worker_id++) {
+    const SubgraphKey key = engine_.GetLargestSubgraphKey(model_id, worker_id);
+    if (!key.IsValid()) {
+      continue;
+    }
+    // The engine keeps the batch sizes that all the workers support
+    batch_sizes = engine_.GetBatchSizes(key);
+    if (batch_sizes.empty()) {
+      break;
+    }
+    *expected_latency = std::min(*expected_latency,
+                                 engine_.GetExpected(key, batch_sizes.back()));
+  }
+  if (batch_sizes.empty()) {
+    *expected_latency = 0;
+  }
+  return batch_sizes;
+}
+
+JobHandle Batcher::FormBatch(std::vector<JobHandle>& model_jobs,
+                             int batch_size) {
+  JobHandle leader = model_jobs.front();
+  if (batch_size > 1) {
+    std::vector<JobHandle> members(model_jobs.begin() + 1,
+                                   model_jobs.begin() + batch_size);
+    leader->batch_size = batch_size;
+    leader->batch_input_handles = {leader->input_handle};
+    leader->batch_output_handles = {leader->output_handle};
+    // The batch must meet the tightest SLO of its requests
+    int64_t slo_deadline =
+        leader->slo_us > 0 ? leader->enqueue_time + leader->slo_us : -1;
+    for (const JobHandle& member : members) {
+      leader->batch_input_handles.push_back(member->input_handle);
+      leader->batch_output_handles.push_back(member->output_handle);
+      if (member->slo_us > 0) {
+        const int64_t member_deadline = member->enqueue_time + member->slo_us;
+        slo_deadline = slo_deadline < 0
+                           ? member_deadline
+                           : std::min(slo_deadline, member_deadline);
+      }
+    }
+    leader->batch_deadline_us = slo_deadline;
+
+    std::lock_guard<std::mutex> lock(members_mtx_);
+    members_[leader->job_id] = std::move(members);
+  }
+  model_jobs.erase(model_jobs.begin(), model_jobs.begin() + batch_size);
+  return leader;
+}
+
+}  // namespace band
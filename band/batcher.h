@@ -0,0 +1,78 @@
+/*
+ * Copyright 2023 Seoul National University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BAND_BATCHER_H_
+#define BAND_BATCHER_H_
+
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "band/common.h"
+#include "band/engine_interface.h"
+
+namespace band {
+
+/*
+  Coalesces queued requests for the same model into a single batched job.
+
+  The planner thread passes its local queues through `Batch` before
+  scheduling. Eligible requests are held back until enough of them arrive
+  for the largest batch size of the model, or until the oldest one waited
+  `batch_timeout_us` (or would otherwise miss its SLO). The oldest request
+  of a batch becomes its leader: it carries the input / output handles of
+  all the requests and is scheduled as usual, while the others wait in
+  `Batcher` until the leader finishes.
+*/
+class Batcher {
+ public:
+  explicit Batcher(IEngine& engine) : engine_(engine) {}
+
+  void Init(int max_batch_size, int64_t batch_timeout_us);
+  bool IsEnabled() const { return max_batch_size_ > 1; }
+
+  // Holds the batchable jobs of `jobs` and puts the batches (or single jobs)
+  // that are ready at the front. Returns the earliest time that one of the
+  // held jobs must be released, or -1 if none is held.
+  // Only called by the planner thread.
+  int64_t Batch(size_t queue_index, JobQueue& jobs, int64_t current_time);
+  // Returns the requests batched with the leader `job_id`, except the leader.
+  std::vector<JobHandle> TakeMembers(JobId job_id);
+
+ private:
+  bool IsBatchable(const Job& job) const;
+  // Common batch sizes of the workers, and the minimum expected latency of
+  // the largest one.
+  std::vector<int> GetBatchSizes(ModelId model_id,
+                                 int64_t* expected_latency) const;
+  // Releases the first `batch_size` jobs of `model_jobs` as a single job.
+  JobHandle FormBatch(std::vector<JobHandle>& model_jobs, int batch_size);
+
+  IEngine& engine_;
+  int max_batch_size_ = 1;
+  int64_t batch_timeout_us_ = 0;
+
+  // Held jobs per local queue, in enqueue order
+  std::vector<std::map<ModelId, std::vector<JobHandle>>> held_jobs_;
+
+  std::mutex members_mtx_;
+  std::unordered_map<JobId, std::vector<JobHandle>> members_;
+};
+
+}  // namespace band
+
+#endif  // BAND_BATCHER_H_
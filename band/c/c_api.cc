@@ -47,7 +47,8 @@ BandStatus ToBandStatus(absl::Status&& status) {
 }
 
 band::RequestOption ToRequestOption(BandRequestOption& option) {
-  band::RequestOption request_option;
+  band::RequestOption request_option =
+      band::RequestOption::GetDefaultOption();
   request_option.target_worker = option.target_worker;
   request_option.require_callback = option.require_callback;
   request_option.slo_scale = option.slo_scale;
@@ -369,6 +370,34 @@ BandStatus BandEngineRegisterModel(BandEngine* engine, BandModel* model) {
   return ToBandStatus(status);
 }
 
+BandStatus BandEngineRegisterModels(BandEngine* engine, BandModel** models,
+                                    size_t num_models) {
+  if (!engine || (!models && num_models > 0)) {
+    BAND_LOG(band::LogSeverity::kError,
+             "BandEngine (%d) or BandModels (%d) is "
+             "null",
+             engine, models);
+    return kBandErr;
+  }
+
+  std::vector<band::Model*> impls;
+  for (size_t i = 0; i < num_models; i++) {
+    if (!models[i]) {
+      BAND_LOG(band::LogSeverity::kError, "BandModel %d is null", i);
+      return kBandErr;
+    }
+    impls.push_back(models[i]->impl.get());
+  }
+
+  auto status = engine->impl->RegisterModels(impls);
+  if (status == absl::OkStatus()) {
+    for (size_t i = 0; i < num_models; i++) {
+      engine->models.push_back(models[i]->impl);
+    }
+  }
+  return ToBandStatus(status);
+}
+
 int BandEngineGetNumInputTensors(BandEngine* engine, BandModel* model) {
   if (!engine || !model) {
     BAND_LOG(band::LogSeverity::kError,
@@ -562,6 +591,53 @@ BandStatus BandEngineUnsetOnEndRequest(BandEngine* engine,
   return ToBandStatus(engine->impl->UnsetOnEndRequest(handle));
 }
 
+BandMetrics* BandEngineGetMetrics(BandEngine* engine) {
+  if (!engine) {
+    BAND_LOG(band::LogSeverity::kError, "BandEngine is null");
+    return nullptr;
+  }
+
+  return new BandMetrics(engine->impl->GetMetrics());
+}
+
+void BandMetricsDelete(BandMetrics* metrics) {
+  if (!metrics) {
+    BAND_LOG(band::LogSeverity::kError, "BandMetrics is null");
+    return;
+  }
+
+  delete metrics;
+}
+
+size_t BandMetricsGetNumValues(BandMetrics* metrics) {
+  if (!metrics) {
+    BAND_LOG(band::LogSeverity::kError, "BandMetrics is null");
+    return 0;
+  }
+
+  return metrics->values.size();
+}
+
+const char* BandMetricsGetName(BandMetrics* metrics, size_t index) {
+  if (!metrics || index >= metrics->values.size()) {
+    BAND_LOG(band::LogSeverity::kError,
+             "BandMetrics is null or index %zu is out of range", index);
+    return nullptr;
+  }
+
+  return metrics->values[index].first.c_str();
+}
+
+int64_t BandMetricsGetValue(BandMetrics* metrics, size_t index) {
+  if (!metrics || index >= metrics->values.size()) {
+    BAND_LOG(band::LogSeverity::kError,
+             "BandMetrics is null or index %zu is out of range", index);
+    return 0;
+  }
+
+  return metrics->values[index].second;
+}
+
 #ifdef __cplusplus
 }  // extern "C"
 #endif  // __cplusplus
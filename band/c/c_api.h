@@ -48,11 +48,13 @@ typedef struct BandConfig BandConfig;
 typedef struct BandModel BandModel;
 typedef struct BandTensor BandTensor;
 typedef struct BandEngine BandEngine;
+typedef struct BandMetrics BandMetrics;
 typedef int BandRequestHandle;
 typedef int BandCallbackHandle;
 
 /* logging */
 BAND_CAPI_EXPORT extern void BandSetLogSeverity(BandLogSeverity severity);
+/* The reporter is invoked with the formatted message on the logging thread */
 BAND_CAPI_EXPORT extern BandCallbackHandle BandSetLogReporter(
     void (*reporter)(BandLogSeverity severity, const char* msg));
 BAND_CAPI_EXPORT extern void BandUnsetLogReporter(BandCallbackHandle handle);
@@ -100,6 +102,10 @@ BAND_CAPI_EXPORT extern BandEngine* BandEngineCreate(BandConfig* config);
 BAND_CAPI_EXPORT extern void BandEngineDelete(BandEngine* engine);
 BAND_CAPI_EXPORT extern BandStatus BandEngineRegisterModel(BandEngine* engine,
                                                            BandModel* model);
+// Registers `num_models` models at once, analyzing them in parallel. On
+// failure, none of them is registered (see `Engine::RegisterModels`).
+BAND_CAPI_EXPORT extern BandStatus BandEngineRegisterModels(
+    BandEngine* engine, BandModel** models, size_t num_models);
 BAND_CAPI_EXPORT extern int BandEngineGetNumInputTensors(BandEngine* engine,
                                                          BandModel* model);
 BAND_CAPI_EXPORT extern int BandEngineGetNumOutputTensors(BandEngine* engine,
@@ -139,6 +145,17 @@ BAND_CAPI_EXPORT extern BandCallbackHandle BandEngineSetOnEndRequest(
 BAND_CAPI_EXPORT extern BandStatus BandEngineUnsetOnEndRequest(
     BandEngine* engine, BandCallbackHandle callback_handle);
 
+/* metrics */
+// Snapshot of the engine metrics as (name, value) pairs, sorted by name. See
+// `Engine::GetMetrics` for the names.
+BAND_CAPI_EXPORT extern BandMetrics* BandEngineGetMetrics(BandEngine* engine);
+BAND_CAPI_EXPORT extern void BandMetricsDelete(BandMetrics* metrics);
+BAND_CAPI_EXPORT extern size_t BandMetricsGetNumValues(BandMetrics* metrics);
+BAND_CAPI_EXPORT extern const char* BandMetricsGetName(BandMetrics* metrics,
+                                                       size_t index);
+BAND_CAPI_EXPORT extern int64_t BandMetricsGetValue(BandMetrics* metrics,
+                                                    size_t index);
+
 typedef BandConfigBuilder* (*PFN_BandConfigBuilderCreate)();
 typedef void (*PFN_BandAddConfig)(BandConfigBuilder*, int, int, ...);
 typedef void (*PFN_BandConfigBuilderDelete)(BandConfigBuilder*);
@@ -163,6 +180,8 @@ typedef BandEngine* (*PFN_BandEngineCreateWithDefaultConfig)();
 typedef BandEngine* (*PFN_BandEngineCreate)(BandConfig*);
 typedef void (*PFN_BandEngineDelete)(BandEngine*);
 typedef BandStatus (*PFN_BandEngineRegisterModel)(BandEngine*, BandModel*);
+typedef BandStatus (*PFN_BandEngineRegisterModels)(BandEngine*, BandModel**,
+                                                   size_t);
 typedef int (*PFN_BandEngineGetNumInputTensors)(BandEngine*, BandModel*);
 typedef int (*PFN_BandEngineGetNumOutputTensors)(BandEngine*, BandModel*);
 typedef int (*PFN_BandEngineGetNumWorkers)(BandEngine*);
@@ -187,6 +206,11 @@ typedef BandCallbackHandle (*PFN_BandEngineSetOnEndRequest)(
     BandEngine*, void (*)(void*, int, BandStatus), void*);
 typedef BandStatus (*PFN_BandEngineUnsetOnEndRequest)(BandEngine*,
                                                       BandCallbackHandle);
+typedef BandMetrics* (*PFN_BandEngineGetMetrics)(BandEngine*);
+typedef void (*PFN_BandMetricsDelete)(BandMetrics*);
+typedef size_t (*PFN_BandMetricsGetNumValues)(BandMetrics*);
+typedef const char* (*PFN_BandMetricsGetName)(BandMetrics*, size_t);
+typedef int64_t (*PFN_BandMetricsGetValue)(BandMetrics*, size_t);
 
 #ifdef __cplusplus
 }  // extern "C"
@@ -136,6 +136,8 @@ const char* BandBackendToString(BandBackendType flag) {
   switch (flag) {
     case kBandTfLite:
       return "Tensorflow Lite";
+    case kBandSimulated:
+      return "Simulated";
     default: {}
   }
   return "Unknown type";
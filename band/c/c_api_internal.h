@@ -19,6 +19,9 @@
 
 #include <list>
 #include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "band/buffer/buffer.h"
 #include "band/buffer/image_processor.h"
@@ -75,6 +78,11 @@ struct BandEngine {
   std::unique_ptr<band::Engine> impl;
 };
 
+struct BandMetrics {
+  BandMetrics(const band::Metrics& metrics) : values(metrics.Flatten()) {}
+  std::vector<std::pair<std::string, int64_t>> values;
+};
+
 const char* BandBackendToString(BandBackendType flag);
 const BandBackendType BandBackendGetType(const char* name);
 
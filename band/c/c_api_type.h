@@ -37,6 +37,7 @@ typedef enum BandLogSeverity {
 
 typedef enum BandBackendType {
   kBandTfLite = 0,
+  kBandSimulated,
   kBandNumBackendType
 } BandBackendType;
 
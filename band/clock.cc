@@ -0,0 +1,211 @@
+// Copyright 2023 Seoul National University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "band/clock.h"
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "band/time.h"
+
+namespace band {
+namespace {
+
+// The virtual clock that the calling thread is attached to
+thread_local const VirtualClock* attached_clock = nullptr;
+
+}  // anonymous namespace
+
+ClockCondition::ClockCondition(Clock* clock)
+    : clock_(clock ? clock : RealClock::Get()) {}
+
+bool ClockCondition::WaitOnce(std::unique_lock<std::mutex>& lock,
+                              int64_t deadline_us) {
+  return clock_->Wait(*this, lock, deadline_us);
+}
+
+void ClockCondition::NotifyAll() { clock_->Notify(*this); }
+
+RealClock* RealClock::Get() {
+  static RealClock clock;
+  return &clock;
+}
+
+int64_t RealClock::NowMicros() const { return time::NowMicros(); }
+
+void RealClock::SleepUntil(int64_t time_us) {
+  const int64_t now_us = NowMicros();
+  if (time_us > now_us) {
+    time::SleepForMicros(time_us - now_us);
+  }
+}
+
+bool RealClock::Wait(ClockCondition& condition,
+                     std::unique_lock<std::mutex>& lock, int64_t deadline_us) {
+  if (deadline_us < 0) {
+    condition.cv_.wait(lock);
+    return true;
+  }
+  const int64_t timeout_us = deadline_us - NowMicros();
+  return timeout_us > 0 &&
+         condition.cv_.wait_for(lock, std::chrono::microseconds(
+                                          timeout_us)) ==
+             std::cv_status::no_timeout;
+}
+
+void RealClock::Notify(ClockCondition& condition) {
+  condition.cv_.notify_all();
+}
+
+VirtualClock::VirtualClock(int64_t start_time_us) : now_us_(start_time_us) {}
+
+int64_t VirtualClock::NowMicros() const {
+  return now_us_.load(std::memory_order_acquire);
+}
+
+void VirtualClock::SleepUntil(int64_t time_us) {
+  std::unique_lock<std::mutex> clock_lock(mtx_);
+  if (time_us <= NowMicros()) {
+    return;
+  }
+  Waiter waiter;
+  waiter.deadline_us = time_us;
+  Block(waiter, clock_lock);
+}
+
+void VirtualClock::AttachThread() {
+  std::unique_lock<std::mutex> clock_lock(mtx_);
+  if (attached_clock == this) {
+    return;
+  }
+  attached_clock = this;
+  // Waits for the turn like a woken thread
+  Waiter waiter;
+  waiter.is_attached = true;
+  waiter.is_woken = true;
+  runnable_.push_back(&waiter);
+  Dispatch();
+  waiter.cv.wait(clock_lock, [&waiter]() { return waiter.has_turn; });
+}
+
+void VirtualClock::DetachThread() {
+  std::lock_guard<std::mutex> clock_lock(mtx_);
+  if (attached_clock != this) {
+    return;
+  }
+  attached_clock = nullptr;
+  is_running_ = false;
+  Dispatch();
+}
+
+bool VirtualClock::IsThreadAttached() const { return attached_clock == this; }
+
+bool VirtualClock::Wait(ClockCondition& condition,
+                        std::unique_lock<std::mutex>& lock,
+                        int64_t deadline_us) {
+  std::unique_lock<std::mutex> clock_lock(mtx_);
+  if (deadline_us >= 0 && deadline_us <= NowMicros()) {
+    return false;
+  }
+  Waiter waiter;
+  waiter.condition = &condition;
+  waiter.deadline_us = deadline_us;
+  condition_waiters_.emplace(&condition, &waiter);
+  // Notifiers update the predicate under `lock`, so they can only notify
+  // once the waiter is registered
+  lock.unlock();
+  Block(waiter, clock_lock);
+  clock_lock.unlock();
+
+  lock.lock();
+  return !waiter.is_timed_out;
+}
+
+void VirtualClock::Notify(ClockCondition& condition) {
+  std::lock_guard<std::mutex> clock_lock(mtx_);
+  auto range = condition_waiters_.equal_range(&condition);
+  std::vector<Waiter*> waiters;
+  for (auto it = range.first; it != range.second; ++it) {
+    waiters.push_back(it->second);
+  }
+  for (Waiter* waiter : waiters) {
+    Wake(*waiter, false);
+  }
+  Dispatch();
+}
+
+void VirtualClock::Block(Waiter& waiter,
+                         std::unique_lock<std::mutex>& clock_lock) {
+  waiter.is_attached = attached_clock == this;
+  if (waiter.deadline_us >= 0) {
+    waiter.timer_key = {waiter.deadline_us, num_timers_++};
+    timers_.emplace(waiter.timer_key, &waiter);
+  }
+  if (waiter.is_attached) {
+    is_running_ = false;
+  }
+  Dispatch();
+  waiter.cv.wait(clock_lock, [&waiter]() {
+    return waiter.is_woken && (!waiter.is_attached || waiter.has_turn);
+  });
+}
+
+void VirtualClock::Wake(Waiter& waiter, bool is_timed_out) {
+  if (waiter.is_woken) {
+    return;
+  }
+  waiter.is_woken = true;
+  waiter.is_timed_out = is_timed_out;
+  if (waiter.deadline_us >= 0) {
+    timers_.erase(waiter.timer_key);
+  }
+  if (waiter.condition) {
+    auto range = condition_waiters_.equal_range(waiter.condition);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (it->second == &waiter) {
+        condition_waiters_.erase(it);
+        break;
+      }
+    }
+  }
+
+  if (waiter.is_attached) {
+    runnable_.push_back(&waiter);
+  } else {
+    waiter.cv.notify_one();
+  }
+}
+
+void VirtualClock::Dispatch() {
+  if (!is_running_ && runnable_.empty() && !timers_.empty()) {
+    // Every attached thread is blocked, so the next event happens. A thread
+    // that is not attached runs on its own once woken up, and the time stays
+    // until the next call to the clock.
+    auto it = timers_.begin();
+    now_us_.store(std::max(NowMicros(), it->first.first),
+                  std::memory_order_release);
+    Wake(*it->second, true);
+  }
+
+  if (!is_running_ && !runnable_.empty()) {
+    Waiter* waiter = runnable_.front();
+    runnable_.pop_front();
+    waiter->has_turn = true;
+    is_running_ = true;
+    waiter->cv.notify_one();
+  }
+}
+
+}  // namespace band
@@ -0,0 +1,185 @@
+/*
+ * Copyright 2023 Seoul National University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BAND_CLOCK_H_
+#define BAND_CLOCK_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+
+namespace band {
+
+class Clock;
+
+// Condition variable that waits in the time of a `Clock`.
+// As with `std::condition_variable`, notifiers have to update the predicate
+// under the lock of the waiters, but may notify after releasing it.
+class ClockCondition {
+ public:
+  // Uses the real clock if `clock` is null.
+  explicit ClockCondition(Clock* clock = nullptr);
+  ClockCondition(const ClockCondition&) = delete;
+  ClockCondition& operator=(const ClockCondition&) = delete;
+
+  // Blocks until `pred` holds. Returns false if the clock reaches
+  // `deadline_us` first, or waits indefinitely if `deadline_us` is negative.
+  template <typename Predicate>
+  bool WaitUntil(std::unique_lock<std::mutex>& lock, int64_t deadline_us,
+                 Predicate pred) {
+    while (!pred()) {
+      if (!WaitOnce(lock, deadline_us)) {
+        return pred();
+      }
+    }
+    return true;
+  }
+  template <typename Predicate>
+  void Wait(std::unique_lock<std::mutex>& lock, Predicate pred) {
+    WaitUntil(lock, -1, pred);
+  }
+  void NotifyAll();
+
+  Clock* GetClock() const { return clock_; }
+
+ private:
+  friend class RealClock;
+  // Returns false on timeout.
+  bool WaitOnce(std::unique_lock<std::mutex>& lock, int64_t deadline_us);
+
+  Clock* const clock_;
+  std::condition_variable cv_;
+};
+
+// Source of time of an engine. Every timestamp of the engine (e.g., enqueue
+// and invoke time of jobs, SLOs, timeouts) is in microseconds of its clock.
+class Clock {
+ public:
+  virtual ~Clock() = default;
+
+  virtual int64_t NowMicros() const = 0;
+  virtual void SleepUntil(int64_t time_us) = 0;
+  void SleepForMicros(int64_t micros) { SleepUntil(NowMicros() + micros); }
+  virtual bool IsVirtual() const { return false; }
+
+  // Marks the calling thread as one that runs on the clock. A virtual clock
+  // only moves forward while all such threads are blocked on it.
+  // A thread that blocks on anything else (e.g., joins a thread that uses
+  // the clock) has to detach during it.
+  virtual void AttachThread() {}
+  virtual void DetachThread() {}
+  virtual bool IsThreadAttached() const { return false; }
+
+ protected:
+  friend class ClockCondition;
+  // Blocks until `condition` is notified (returns true) or the clock reaches
+  // `deadline_us` (returns false). Releases `lock` while blocked.
+  virtual bool Wait(ClockCondition& condition,
+                    std::unique_lock<std::mutex>& lock,
+                    int64_t deadline_us) = 0;
+  virtual void Notify(ClockCondition& condition) = 0;
+};
+
+// Monotonic wall-clock time (`time::NowMicros`).
+class RealClock : public Clock {
+ public:
+  static RealClock* Get();
+
+  int64_t NowMicros() const override;
+  void SleepUntil(int64_t time_us) override;
+
+ protected:
+  bool Wait(ClockCondition& condition, std::unique_lock<std::mutex>& lock,
+            int64_t deadline_us) override;
+  void Notify(ClockCondition& condition) override;
+};
+
+/*
+  Discrete-event clock for simulation.
+
+  Time only moves forward when every attached thread is blocked on the clock
+  (sleeping or waiting on a `ClockCondition`), and then jumps to the earliest
+  deadline. Paired with backends that sleep instead of computing (e.g., the
+  simulated backend), a workload runs as fast as the scheduling logic allows.
+
+  Attached threads run one at a time, in the order they were woken up, and
+  simultaneous deadlines fire one by one in the order they were set. Thus a
+  run only depends on its inputs, not on the OS scheduler. Threads that are
+  not attached (e.g., a client that submits requests) run freely, and the
+  clock does not wait for them before it moves forward.
+
+  Attached threads must not block on anything but the clock while they hold
+  a lock that another attached thread may take.
+*/
+class VirtualClock : public Clock {
+ public:
+  // Timestamps of 0 mean `unset` for jobs, so the time starts after it.
+  explicit VirtualClock(int64_t start_time_us = 1);
+
+  int64_t NowMicros() const override;
+  void SleepUntil(int64_t time_us) override;
+  bool IsVirtual() const override { return true; }
+
+  void AttachThread() override;
+  void DetachThread() override;
+  bool IsThreadAttached() const override;
+
+ protected:
+  bool Wait(ClockCondition& condition, std::unique_lock<std::mutex>& lock,
+            int64_t deadline_us) override;
+  void Notify(ClockCondition& condition) override;
+
+ private:
+  struct Waiter {
+    const ClockCondition* condition = nullptr;
+    int64_t deadline_us = -1;
+    // key in `timers_` if `deadline_us` >= 0
+    std::pair<int64_t, uint64_t> timer_key;
+    bool is_attached = false;
+    bool is_woken = false;
+    bool is_timed_out = false;
+    // An attached waiter continues once it takes the turn
+    bool has_turn = false;
+    std::condition_variable cv;
+  };
+
+  // Blocks the calling thread until `waiter` is woken up (and takes the turn
+  // if attached). Requires `mtx_`.
+  void Block(Waiter& waiter, std::unique_lock<std::mutex>& clock_lock);
+  // Requires `mtx_`.
+  void Wake(Waiter& waiter, bool is_timed_out);
+  // Passes the turn to the next runnable attached thread, or moves the time
+  // to the next deadline if there is none. Requires `mtx_`.
+  void Dispatch();
+
+  std::mutex mtx_;
+  std::atomic<int64_t> now_us_;
+  // Whether an attached thread holds the turn
+  bool is_running_ = false;
+  // Woken attached threads, in the order they take the turn
+  std::deque<Waiter*> runnable_;
+  // Waiters with a deadline, by (deadline, order of arrival)
+  std::map<std::pair<int64_t, uint64_t>, Waiter*> timers_;
+  uint64_t num_timers_ = 0;
+  std::multimap<const ClockCondition*, Waiter*> condition_waiters_;
+};
+
+}  // namespace band
+
+#endif  // BAND_CLOCK_H_
@@ -25,7 +25,7 @@ size_t EnumLength<LogSeverity>() {
 
 template <>
 size_t EnumLength<BackendType>() {
-  return static_cast<size_t>(BackendType::kTfLite) + 1;
+  return static_cast<size_t>(BackendType::kSimulated) + 1;
 }
 
 template <>
@@ -76,6 +76,9 @@ const char* ToString(BackendType backend_type) {
     case BackendType::kTfLite: {
       return "Tensorflow Lite";
     } break;
+    case BackendType::kSimulated: {
+      return "Simulated";
+    } break;
     default: {
       return "Unknown backend type";
     }
@@ -498,13 +501,25 @@ std::string Job::ToJson() const {
          ",\"expected_execution_time\":" +
          std::to_string(expected_execution_time) +
          ",\"expected_latency\":" + std::to_string(expected_latency) +
+         ",\"total_execution_time\":" +
+         std::to_string(total_execution_time) +
+         ",\"planner_time\":" + std::to_string(planner_time) +
+         ",\"worker_queue_time\":" + std::to_string(worker_queue_time) +
+         ",\"input_copy_time\":" + std::to_string(input_copy_time) +
+         ",\"output_copy_time\":" + std::to_string(output_copy_time) +
          ",\"slo_us\":" + std::to_string(slo_us) +
          ",\"model_id\":" + std::to_string(model_id) +
-         (model_fname != "" ? ",\"model_fname\":" + model_fname : "") +
          ",\"unit_indices\":" + subgraph_key.GetUnitIndicesString() +
          ",\"job_id\":" + std::to_string(job_id) + "}";
 }
 
+int64_t Job::GetDeadline() const {
+  if (batch_size > 1) {
+    return batch_deadline_us;
+  }
+  return slo_us > 0 ? enqueue_time + slo_us : -1;
+}
+
 std::size_t JobIdBitMaskHash::operator()(
     const std::pair<int, BitMask>& p) const {
   auto hash_func = std::hash<int>();
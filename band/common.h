@@ -20,13 +20,14 @@
 #include <bitset>
 #include <cassert>
 #include <iostream>
-#include <list>
 #include <map>
 #include <set>
 #include <string>
 #include <type_traits>
 #include <vector>
 
+#include "absl/container/inlined_vector.h"
+
 namespace band {
 typedef int WorkerId;
 typedef int ModelId;
@@ -71,6 +72,8 @@ enum class LogSeverity : size_t {
 
 enum class BackendType : size_t {
   kTfLite = 0,
+  // Replays latency profiles without running the model (band/backend/sim)
+  kSimulated,
 };
 
 enum class SchedulerType : size_t {
@@ -242,13 +245,18 @@ class Quantization {
 // Setting `slo_scale` will make the SLO =  slo_scale * profiled latency of
 // that model. `slo_scale` will be ignored if `slo_us` is given
 // (i.e., no reason to specify both options). [default : -1 (not specified)]
+// `use_bound_tensors`: read and write the I/O tensors bound to the model with
+// BindIOTensors instead of tensors passed with the request. [default: false]
 struct RequestOption {
   int target_worker;
   bool require_callback;
   int slo_us;
   float slo_scale;
+  bool use_bound_tensors;
 
-  static RequestOption GetDefaultOption() { return {-1, true, -1, -1.f}; }
+  static RequestOption GetDefaultOption() {
+    return {-1, true, -1, -1.f, false};
+  }
 };
 
 // data structure for identifying subgraphs within whole models
@@ -294,6 +302,9 @@ struct Job {
       : model_id(model_id), slo_us(slo) {}
 
   std::string ToJson() const;
+  // Time by which the job has to end to meet its SLO, or the tightest SLO
+  // of the requests it runs as a batch. -1 if there is none.
+  int64_t GetDeadline() const;
 
   // Constant variables (Valid after invoke)
   // TODO: better job life-cycle to change these to `const`
@@ -301,8 +312,10 @@ struct Job {
   int input_handle = -1;
   int output_handle = -1;
   JobId job_id = -1;
-  std::string model_fname;
   bool require_callback = true;
+  // Inputs / outputs live in the caller-owned tensors bound with
+  // `Engine::BindIOTensors` instead of the tensor ring buffers
+  bool io_bound = false;
 
   // For record (Valid after execution)
   int64_t enqueue_time = 0;
@@ -314,19 +327,53 @@ struct Job {
   int64_t expected_execution_time = 0;
   // Expected total latency
   int64_t expected_latency = 0;
+  // Sum of the invoke times of the subgraphs run so far
+  int64_t total_execution_time = 0;
   int64_t slo_us;
 
+  // Latency breakdown, accumulated over the subgraphs run so far
+  // When the current subgraph became ready to schedule: the enqueue time, or
+  // the end of the previous subgraph's output copy
+  int64_t ready_time = 0;
+  // When the current subgraph was sent to a worker
+  int64_t dispatch_time = 0;
+  // From `ready_time` to `dispatch_time`
+  int64_t planner_time = 0;
+  // From `dispatch_time` to the worker picking the subgraph up
+  int64_t worker_queue_time = 0;
+  int64_t input_copy_time = 0;
+  int64_t output_copy_time = 0;
+  // When the planner published the completion, right before the callbacks,
+  // and the time spent in the callbacks
+  int64_t completion_time = 0;
+  int64_t callback_time = 0;
+
   // Target worker id (only for fixed worker request)
   WorkerId target_worker_id = -1;
 
   // Current status for execution (Valid after planning)
   JobStatus status = JobStatus::kQueued;
   SubgraphKey subgraph_key;
-  std::vector<Job> following_jobs;
 
-  // Resolved unit subgraphs and executed subgraph keys
+  // Resolved unit subgraphs and executed subgraph keys. Inline up to
+  // `kNumInlineSubgraphKeys`, so that a chain of fallback subgraphs does not
+  // allocate unless it runs longer than that.
+  static constexpr size_t kNumInlineSubgraphKeys = 4;
   BitMask resolved_unit_subgraphs;
-  std::list<SubgraphKey> previous_subgraph_keys;
+  absl::InlinedVector<SubgraphKey, kNumInlineSubgraphKeys>
+      previous_subgraph_keys;
+
+  // Dynamic batching: the number of requests this job runs with a single
+  // invoke, and their input / output handles in the order of dimension 0
+  // (starting with this job's own). The handles are empty if not batched,
+  // and inline up to `kNumInlineBatchHandles` requests.
+  static constexpr size_t kNumInlineBatchHandles = 8;
+  int batch_size = 1;
+  absl::InlinedVector<int, kNumInlineBatchHandles> batch_input_handles;
+  absl::InlinedVector<int, kNumInlineBatchHandles> batch_output_handles;
+  // Tightest deadline among the requests of the batch (-1: none). The
+  // `slo_us` of the job stays its own.
+  int64_t batch_deadline_us = -1;
 };
 // hash function to use pair<int, BitMask> as map key in cache_
 // https://stackoverflow.com/a/32685618
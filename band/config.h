@@ -32,6 +32,9 @@ struct ProfileConfig {
   int num_runs = 1;
   std::string profile_data_path = "";
   float smoothing_factor = 0.1;
+  // Relative change of an expected latency that invalidates the cached
+  // scheduling decisions for its model
+  float latency_drift_threshold = 0.1;
 };
 
 struct PlannerConfig {
@@ -39,6 +42,13 @@ struct PlannerConfig {
   std::vector<SchedulerType> schedulers;
   CPUMaskFlag cpu_mask = CPUMaskFlag::kAll;
   std::string log_path = "";
+  // Dynamic batching of requests for the same model (disabled if 1)
+  int max_batch_size = 1;
+  int64_t batch_timeout_us = 1000;
+  // Maximum number of cached shortest latency plans (disabled if 0)
+  int latency_cache_size = 4096;
+  // Minimum time between two scheduling passes
+  int64_t min_planning_interval_us = 0;
 };
 
 struct WorkerConfig {
@@ -62,10 +72,23 @@ struct SubgraphConfig {
   int minimum_subgraph_size = 7;
   SubgraphPreparationType subgraph_preparation_type =
       SubgraphPreparationType::kMergeUnitSubgraph;
+  // Build the executable of a subgraph at its first use instead of at model
+  // registration
+  bool lazy_subgraphs = false;
+  // Bytes of materialized subgraphs per worker before the least recently
+  // used ones are evicted (0: unlimited). Requires `lazy_subgraphs`.
+  size_t subgraph_memory_budget = 0;
 };
 
 struct RuntimeConfig {
   CPUMaskFlag cpu_mask;
+  // Number of input / output tensor slots per model
+  int tensor_pool_size = 128;
+  // Block requests while the tensor slots of a model are exhausted,
+  // instead of failing them with ResourceExhausted
+  bool block_on_tensor_pool_full = false;
+  // Run the engine on a discrete-event clock instead of the real time
+  bool use_virtual_clock = false;
   SubgraphConfig subgraph_config;
   ProfileConfig profile_config;
   PlannerConfig planner_config;
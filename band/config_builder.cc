@@ -32,6 +32,7 @@ absl::Status ProfileConfigBuilder::IsValid() {
   REPORT_IF_FALSE(ProfileConfigBuilder, num_runs_ > 0);
   REPORT_IF_FALSE(ProfileConfigBuilder,
                   smoothing_factor_ >= .0f && smoothing_factor_ <= 1.0f);
+  REPORT_IF_FALSE(ProfileConfigBuilder, latency_drift_threshold_ >= .0f);
   if (online_ == false) {
     REPORT_IF_FALSE(ProfileConfigBuilder, profile_data_path_ != "");
   }
@@ -46,6 +47,10 @@ absl::Status PlannerConfigBuilder::IsValid() {
                                             cpu_mask_ == CPUMaskFlag::kLittle ||
                                             cpu_mask_ == CPUMaskFlag::kBig ||
                                             cpu_mask_ == CPUMaskFlag::kPrimary);
+  REPORT_IF_FALSE(PlannerConfigBuilder, max_batch_size_ > 0);
+  REPORT_IF_FALSE(PlannerConfigBuilder, batch_timeout_us_ >= 0);
+  REPORT_IF_FALSE(PlannerConfigBuilder, latency_cache_size_ >= 0);
+  REPORT_IF_FALSE(PlannerConfigBuilder, min_planning_interval_us_ >= 0);
   return absl::OkStatus();
 }
 
@@ -85,10 +90,13 @@ absl::Status RuntimeConfigBuilder::IsValid() {
                           SubgraphPreparationType::kUnitSubgraph ||
                       subgraph_preparation_type_ ==
                           SubgraphPreparationType::kMergeUnitSubgraph);
+  REPORT_IF_FALSE(RuntimeConfigBuilder,
+                  subgraph_memory_budget_ == 0 || lazy_subgraphs_);
   REPORT_IF_FALSE(RuntimeConfigBuilder, cpu_mask_ == CPUMaskFlag::kAll ||
                                             cpu_mask_ == CPUMaskFlag::kLittle ||
                                             cpu_mask_ == CPUMaskFlag::kBig ||
                                             cpu_mask_ == CPUMaskFlag::kPrimary);
+  REPORT_IF_FALSE(RuntimeConfigBuilder, tensor_pool_size_ > 0);
 
   // Independent validation
   RETURN_IF_ERROR(profile_config_builder_.IsValid());
@@ -106,6 +114,7 @@ absl::StatusOr<ProfileConfig> ProfileConfigBuilder::Build() {
   profile_config.num_warmups = num_warmups_;
   profile_config.num_runs = num_runs_;
   profile_config.smoothing_factor = smoothing_factor_;
+  profile_config.latency_drift_threshold = latency_drift_threshold_;
   profile_config.profile_data_path = profile_data_path_;
   return profile_config;
 }
@@ -118,6 +127,10 @@ absl::StatusOr<PlannerConfig> PlannerConfigBuilder::Build() {
   planner_config.schedule_window_size = schedule_window_size_;
   planner_config.schedulers = schedulers_;
   planner_config.cpu_mask = cpu_mask_;
+  planner_config.max_batch_size = max_batch_size_;
+  planner_config.batch_timeout_us = batch_timeout_us_;
+  planner_config.latency_cache_size = latency_cache_size_;
+  planner_config.min_planning_interval_us = min_planning_interval_us_;
   return planner_config;
 }
 
@@ -138,9 +151,13 @@ absl::StatusOr<RuntimeConfig> RuntimeConfigBuilder::Build() {
   RETURN_IF_ERROR(IsValid());
   RuntimeConfig runtime_config;
   runtime_config.subgraph_config = {minimum_subgraph_size_,
-                                    subgraph_preparation_type_};
+                                    subgraph_preparation_type_, lazy_subgraphs_,
+                                    subgraph_memory_budget_};
 
   runtime_config.cpu_mask = cpu_mask_;
+  runtime_config.tensor_pool_size = tensor_pool_size_;
+  runtime_config.block_on_tensor_pool_full = block_on_tensor_pool_full_;
+  runtime_config.use_virtual_clock = use_virtual_clock_;
   // No need to check the return value of Build() because it has been checked
   runtime_config.profile_config = profile_config_builder_.Build().value();
   runtime_config.planner_config = planner_config_builder_.Build().value();
@@ -54,6 +54,11 @@ class ProfileConfigBuilder {
     smoothing_factor_ = smoothing_factor;
     return *this;
   }
+  ProfileConfigBuilder& AddLatencyDriftThreshold(
+      float latency_drift_threshold) {
+    latency_drift_threshold_ = latency_drift_threshold;
+    return *this;
+  }
 
   absl::StatusOr<ProfileConfig> Build();
   absl::Status IsValid();
@@ -64,6 +69,7 @@ class ProfileConfigBuilder {
   int num_runs_ = 1;
   std::string profile_data_path_ = "";
   float smoothing_factor_ = 0.1;
+  float latency_drift_threshold_ = 0.1;
 };
 
 // Builder for creating PlannerConfig
@@ -89,6 +95,23 @@ class PlannerConfigBuilder {
     log_path_ = log_path;
     return *this;
   }
+  PlannerConfigBuilder& AddMaxBatchSize(int max_batch_size) {
+    max_batch_size_ = max_batch_size;
+    return *this;
+  }
+  PlannerConfigBuilder& AddBatchTimeoutUs(int64_t batch_timeout_us) {
+    batch_timeout_us_ = batch_timeout_us;
+    return *this;
+  }
+  PlannerConfigBuilder& AddLatencyCacheSize(int latency_cache_size) {
+    latency_cache_size_ = latency_cache_size;
+    return *this;
+  }
+  PlannerConfigBuilder& AddMinPlanningIntervalUs(
+      int64_t min_planning_interval_us) {
+    min_planning_interval_us_ = min_planning_interval_us;
+    return *this;
+  }
 
   absl::StatusOr<PlannerConfig> Build();
 
@@ -99,6 +122,10 @@ class PlannerConfigBuilder {
   std::vector<SchedulerType> schedulers_;
   CPUMaskFlag cpu_mask_ = CPUMaskFlag::kAll;
   std::string log_path_ = "";
+  int max_batch_size_ = 1;
+  int64_t batch_timeout_us_ = 1000;
+  int latency_cache_size_ = 4096;
+  int64_t min_planning_interval_us_ = 0;
 };
 
 // Builder for creating WorkerConfig.
@@ -173,6 +200,11 @@ class RuntimeConfigBuilder {
     profile_config_builder_.AddSmoothingFactor(smoothing_factor);
     return *this;
   }
+  RuntimeConfigBuilder& AddLatencyDriftThreshold(
+      float latency_drift_threshold) {
+    profile_config_builder_.AddLatencyDriftThreshold(latency_drift_threshold);
+    return *this;
+  }
   RuntimeConfigBuilder& AddProfileDataPath(std::string profile_log_path) {
     profile_config_builder_.AddProfileDataPath(profile_log_path);
     return *this;
@@ -195,6 +227,23 @@ class RuntimeConfigBuilder {
     planner_config_builder_.AddCPUMask(cpu_masks);
     return *this;
   }
+  RuntimeConfigBuilder& AddMaxBatchSize(int max_batch_size) {
+    planner_config_builder_.AddMaxBatchSize(max_batch_size);
+    return *this;
+  }
+  RuntimeConfigBuilder& AddBatchTimeoutUs(int64_t batch_timeout_us) {
+    planner_config_builder_.AddBatchTimeoutUs(batch_timeout_us);
+    return *this;
+  }
+  RuntimeConfigBuilder& AddLatencyCacheSize(int latency_cache_size) {
+    planner_config_builder_.AddLatencyCacheSize(latency_cache_size);
+    return *this;
+  }
+  RuntimeConfigBuilder& AddMinPlanningIntervalUs(
+      int64_t min_planning_interval_us) {
+    planner_config_builder_.AddMinPlanningIntervalUs(min_planning_interval_us);
+    return *this;
+  }
 
   // Add WorkerConfig
   RuntimeConfigBuilder& AddWorkers(std::vector<DeviceFlag> workers) {
@@ -228,10 +277,31 @@ class RuntimeConfigBuilder {
     subgraph_preparation_type_ = subgraph_preparation_type;
     return *this;
   }
+  RuntimeConfigBuilder& AddLazySubgraphs(bool lazy_subgraphs) {
+    lazy_subgraphs_ = lazy_subgraphs;
+    return *this;
+  }
+  RuntimeConfigBuilder& AddSubgraphMemoryBudget(size_t subgraph_memory_budget) {
+    subgraph_memory_budget_ = subgraph_memory_budget;
+    return *this;
+  }
   RuntimeConfigBuilder& AddCPUMask(CPUMaskFlag cpu_mask) {
     cpu_mask_ = cpu_mask;
     return *this;
   }
+  RuntimeConfigBuilder& AddTensorPoolSize(int tensor_pool_size) {
+    tensor_pool_size_ = tensor_pool_size;
+    return *this;
+  }
+  RuntimeConfigBuilder& AddBlockOnTensorPoolFull(
+      bool block_on_tensor_pool_full) {
+    block_on_tensor_pool_full_ = block_on_tensor_pool_full;
+    return *this;
+  }
+  RuntimeConfigBuilder& AddVirtualClock(bool use_virtual_clock) {
+    use_virtual_clock_ = use_virtual_clock;
+    return *this;
+  }
 
   absl::StatusOr<RuntimeConfig> Build();
   static RuntimeConfig GetDefaultConfig();
@@ -245,7 +315,12 @@ class RuntimeConfigBuilder {
   int minimum_subgraph_size_ = 7;
   SubgraphPreparationType subgraph_preparation_type_ =
       SubgraphPreparationType::kMergeUnitSubgraph;
+  bool lazy_subgraphs_ = false;
+  size_t subgraph_memory_budget_ = 0;
   CPUMaskFlag cpu_mask_ = CPUMaskFlag::kAll;
+  int tensor_pool_size_ = 128;
+  bool block_on_tensor_pool_full_ = false;
+  bool use_virtual_clock_ = false;
 };
 
 }  // namespace band
@@ -16,6 +16,7 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstring>
 
 #include "absl/strings/str_format.h"
 #include "band/backend_factory.h"
@@ -29,12 +30,17 @@
 #include "band/model_analyzer.h"
 #include "band/model_spec.h"
 #include "band/planner.h"
+#include "band/runtime_tracer.h"
 #include "band/tensor.h"
+#include "band/thread_pool.h"
 #include "band/worker.h"
 
 namespace band {
 
 Engine::~Engine() {
+  // The engine threads can only finish if the virtual time moves on
+  clock_->DetachThread();
+
   for (auto& model_executor : model_executors_) {
     model_executor.second.reset();
   }
@@ -55,212 +61,349 @@ std::unique_ptr<Engine> Engine::Create(const RuntimeConfig& config) {
   return engine_ptr->Init(config).ok() ? std::move(engine_ptr) : nullptr;
 }
 
-absl::Status Engine::RegisterModel(Model* model) {
-  if (!model) {
-    return absl::InternalError("Model is empty.");
+struct Engine::ModelAnalysis {
+  Model* model;
+  BackendType backend_type;
+  ModelSpec model_spec;
+  std::vector<SubgraphDef> subgraph_defs;
+};
+
+absl::Status Engine::RegisterModel(Model* model, int tensor_pool_size) {
+  return RegisterModels({model}, tensor_pool_size);
+}
+
+absl::Status Engine::RegisterModels(const std::vector<Model*>& models,
+                                    int tensor_pool_size) {
+  for (Model* model : models) {
+    if (!model) {
+      return absl::InternalError("Model is empty.");
+    }
+
+    if (model->GetSupportedBackends().size() == 0) {
+      return absl::InternalError("No supported backends.");
+    }
   }
 
-  if (model->GetSupportedBackends().size() == 0) {
-    return absl::InternalError("No supported backends.");
+  // Analyze models & generate subgraphs per backend type
+  std::vector<std::pair<Model*, BackendType>> targets;
+  for (Model* model : models) {
+    for (BackendType backend_type : model->GetSupportedBackends()) {
+      targets.push_back({model, backend_type});
+    }
+  }
+  std::vector<absl::StatusOr<std::unique_ptr<ModelAnalysis>>> analyses(
+      targets.size());
+  {
+    std::vector<std::function<void()>> tasks;
+    for (size_t i = 0; i < targets.size(); i++) {
+      tasks.push_back([this, &targets, &analyses, i]() {
+        analyses[i] = AnalyzeModel(targets[i].first, targets[i].second);
+      });
+    }
+    ThreadPool::RunAll(std::move(tasks));
+  }
+  for (const auto& status_or_analysis : analyses) {
+    if (!status_or_analysis.ok()) {
+      return status_or_analysis.status();
+    }
   }
 
+  // Preparing and profiling a model already run on all of its workers in
+  // parallel, and profiling pauses them, so models are prepared one after
+  // another
+  for (size_t i = 0; i < analyses.size(); i++) {
+    auto status = PrepareModel(*analyses[i].value(), tensor_pool_size);
+    if (!status.ok()) {
+      // Unregister the models prepared so far, including the failed one
+      std::set<Model*> prepared_models;
+      for (size_t j = 0; j <= i; j++) {
+        prepared_models.insert(targets[j].first);
+      }
+      for (Model* model : prepared_models) {
+        auto unregister_status = UnregisterModel(model);
+        if (!unregister_status.ok()) {
+          BAND_LOG(LogSeverity::kError, "Failed to unregister model %d: %s",
+                   model->GetId(), unregister_status.ToString().c_str());
+        }
+      }
+      return status;
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::unique_ptr<Engine::ModelAnalysis>> Engine::AnalyzeModel(
+    Model* model, BackendType backend_type) const {
+  ModelAnalyzer analyzer(*this, planner_->NeedFallbackSubgraphs(),
+                         subgraph_config_, model, backend_type);
+
+  auto status_or_result = analyzer.CreateSubgraphs();
+  if (!status_or_result.ok()) {
+    return status_or_result.status();
+  }
+
+  auto& result = status_or_result.value();
+  return std::unique_ptr<ModelAnalysis>(
+      new ModelAnalysis{model, backend_type, std::get<0>(result),
+                        std::move(std::get<1>(result))});
+}
+
+absl::Status Engine::PrepareModel(const ModelAnalysis& analysis,
+                                  int tensor_pool_size) {
+  Model* model = analysis.model;
+  const BackendType backend_type = analysis.backend_type;
+  const ModelSpec& model_spec = analysis.model_spec;
+  const std::vector<SubgraphDef>& subgraph_defs = analysis.subgraph_defs;
   const ModelId model_id = model->GetId();
 
-  for (BackendType backend_type : model->GetSupportedBackends()) {
-    // Analyze model & generate subgraphs per backend type
-    ModelAnalyzer analyzer(*this, planner_->NeedFallbackSubgraphs(),
-                           subgraph_config_, model, backend_type);
+  // Create internal model_executor per each supported backends
+  {
+    bool added_once = false;
+    for (WorkerId worker_id = 0; worker_id < workers_.size(); worker_id++) {
+      if (model_spec.unavailable_devices.find(GetWorkerDevice(worker_id)) ==
+          model_spec.unavailable_devices.end()) {
+        const Worker* worker = workers_[worker_id].get();
+        std::unique_ptr<interface::IModelExecutor> model_executor(
+            BackendFactory::CreateModelExecutor(
+                backend_type, model_id, worker_id, GetWorkerDevice(worker_id),
+                worker->GetWorkerThreadAffinity(), worker->GetNumThreads()));
+        if (model_executor) {
+          model_executor->SetClock(clock_);
+        }
+        model_executors_[{model_id, worker_id}] = std::move(model_executor);
+        added_once = true;
+        BAND_LOG(LogSeverity::kInternal,
+                 "Create model executor for model %d worker %s", model_id,
+                 ToString(GetWorkerDevice(worker_id)));
+      }
+    }
 
-    const auto status_or_result = analyzer.CreateSubgraphs();
-    if (!status_or_result.ok()) {
+    if (!added_once) {
       // TODO(BAND-49): unregister for specific backend
       auto status = UnregisterModel(model);
       if (!status.ok()) {
         BAND_LOG(LogSeverity::kError, "Failed to unregister model %d: %s",
                  model_id, status.ToString().c_str());
       }
-      return status_or_result.status();
-    }
-
-    const auto result = analyzer.CreateSubgraphs().value();
-    const ModelSpec model_spec = std::get<0>(result);
-    const std::vector<SubgraphDef> subgraph_defs = std::get<1>(result);
-
-    // Create internal model_executor per each supported backends
-    {
-      bool added_once = false;
-      for (WorkerId worker_id = 0; worker_id < workers_.size(); worker_id++) {
-        if (model_spec.unavailable_devices.find(GetWorkerDevice(worker_id)) ==
-            model_spec.unavailable_devices.end()) {
-          const Worker* worker = workers_[worker_id].get();
-          std::unique_ptr<interface::IModelExecutor> model_executor(
-              BackendFactory::CreateModelExecutor(
-                  backend_type, model_id, worker_id, GetWorkerDevice(worker_id),
-                  worker->GetWorkerThreadAffinity(), worker->GetNumThreads()));
-          model_executors_[{model_id, worker_id}] = std::move(model_executor);
-          added_once = true;
-          BAND_LOG(LogSeverity::kInternal,
-                   "Create model executor for model %d worker %s", model_id,
-                   ToString(GetWorkerDevice(worker_id)));
-        }
-      }
-
-      if (!added_once) {
-        // TODO(BAND-49): unregister for specific backend
-        auto status = UnregisterModel(model);
-        if (!status.ok()) {
-          BAND_LOG(LogSeverity::kError, "Failed to unregister model %d: %s",
-                   model_id, status.ToString().c_str());
-        }
-        return absl::InternalError(
-            "Failed to create model executor on all worker types");
-      }
+      return absl::InternalError(
+          "Failed to create model executor on all worker types");
     }
+  }
 
-    model_specs_.insert({model_id, model_spec});
+  model_specs_.insert({model_id, model_spec});
 
-    // Prepare execution of subgraph definitions per each model_executor
-    {
-      for (const SubgraphDef& subgraph_def : subgraph_defs) {
-        const std::pair<ModelId, WorkerId> model_executor_key = {
-            model_id, subgraph_def.worker_id};
-        const SubgraphKey key = {model_id, subgraph_def.worker_id,
-                                 subgraph_def.unit_subgraph_indices};
+  // Prepare execution of subgraph definitions per each model_executor
+  RETURN_IF_ERROR(PrepareSubgraphs(analysis));
 
-        if (model_executors_.find(model_executor_key) ==
-            model_executors_.end()) {
-          return absl::InternalError(
-              absl::StrFormat("Subgraph logic created a subgraph for worker %d "
-                              "that does not supports model %d",
-                              subgraph_def.worker_id, model_id));
-        } else {
-          auto& model_executor =
-              model_executors_[{model_id, subgraph_def.worker_id}];
-          absl::Status status = model_executor->PrepareSubgraph(
-              model->GetBackendModel(backend_type), subgraph_def.op_indices,
-              subgraph_def.unit_subgraph_indices);
-          if (status.ok()) {
-            // Verify generated subgraphs
-            if (model_executor->HasSubgraph(key) == false) {
-              return absl::InternalError(absl::StrFormat(
-                  "A subgraph for worker %d that does not exists",
-                  subgraph_def.worker_id));
-            }
-            const std::set<int> inputs =
-                model_spec.GetPureInputTensors(subgraph_def.op_indices);
-            const std::set<int> all_outputs =
-                model_spec.GetOutputTensors(subgraph_def.op_indices);
-
-            if (!std::equal(model_executor->GetInputs(key).begin(),
-                            model_executor->GetInputs(key).end(),
-                            inputs.begin())) {
-              return absl::InternalError(
-                  absl::StrFormat("Input format is not correct for worker %d",
-                                  subgraph_def.worker_id));
-            }
-            if (!std::includes(all_outputs.begin(), all_outputs.end(),
-                               model_executor->GetOutputs(key).begin(),
-                               model_executor->GetOutputs(key).end())) {
-              return absl::InternalError(
-                  absl::StrFormat("Output format is not correct for worker %d",
-                                  subgraph_def.worker_id));
-            }
-            unit_subgraphs_to_subgraph_keys_
-                [model_id][*subgraph_def.unit_subgraph_indices.begin()]
-                [*subgraph_def.unit_subgraph_indices.rbegin()]
-                    .push_back(key);
-          }
-        }
-      }
+  // Verify equality of all tensor pairs (of the prepared subgraphs)
+  for (const SubgraphDef& lhs : subgraph_defs) {
+    auto& lhs_model_executor = model_executors_[{model_id, lhs.worker_id}];
+    const SubgraphKey lhs_key = {model_id, lhs.worker_id,
+                                 lhs.unit_subgraph_indices};
+    if (subgraph_config_.lazy_subgraphs && !IsMaterialized(lhs_key)) {
+      continue;
+    }
 
-      // Verify equality of all tensor pairs
-      for (const SubgraphDef& lhs : subgraph_defs) {
-        auto& lhs_model_executor = model_executors_[{model_id, lhs.worker_id}];
-        const SubgraphKey lhs_key = {model_id, lhs.worker_id,
-                                     lhs.unit_subgraph_indices};
-
-        std::set<int> lhs_outputs{
-            lhs_model_executor->GetOutputs(lhs_key).begin(),
-            lhs_model_executor->GetOutputs(lhs_key).end()};
-
-        for (const SubgraphDef& rhs : subgraph_defs) {
-          auto& rhs_model_executor =
-              model_executors_[{model_id, rhs.worker_id}];
-          const SubgraphKey rhs_key = {model_id, rhs.worker_id,
-                                       rhs.unit_subgraph_indices};
-          if ((lhs.worker_id != rhs.worker_id) && (&lhs != &rhs)) {
-            std::set<int> rhs_inputs{
-                rhs_model_executor->GetInputs(rhs_key).begin(),
-                rhs_model_executor->GetInputs(rhs_key).end()};
-
-            std::set<int> common_tensors;
-            std::set_intersection(
-                lhs_outputs.begin(), lhs_outputs.end(), rhs_inputs.begin(),
-                rhs_inputs.end(),
-                std::inserter(common_tensors, common_tensors.end()));
-
-            for (int common_tensor_index : common_tensors) {
-              if (!(*lhs_model_executor->GetTensorView(lhs_key,
-                                                       common_tensor_index) ==
-                    *rhs_model_executor->GetTensorView(rhs_key,
-                                                       common_tensor_index))) {
-                return absl::InternalError(absl::StrFormat(
-                    "%s %s %d != %s %s %d",
-                    ToString(GetWorkerDevice(lhs.worker_id)),
-                    lhs.ToString().c_str(), common_tensor_index,
-                    ToString(GetWorkerDevice(rhs.worker_id)),
-                    rhs.ToString().c_str(), common_tensor_index));
-              }
-            }
+    std::set<int> lhs_outputs{lhs_model_executor->GetOutputs(lhs_key).begin(),
+                              lhs_model_executor->GetOutputs(lhs_key).end()};
+
+    for (const SubgraphDef& rhs : subgraph_defs) {
+      auto& rhs_model_executor = model_executors_[{model_id, rhs.worker_id}];
+      const SubgraphKey rhs_key = {model_id, rhs.worker_id,
+                                   rhs.unit_subgraph_indices};
+      if (subgraph_config_.lazy_subgraphs && !IsMaterialized(rhs_key)) {
+        continue;
+      }
+      if ((lhs.worker_id != rhs.worker_id) && (&lhs != &rhs)) {
+        std::set<int> rhs_inputs{
+            rhs_model_executor->GetInputs(rhs_key).begin(),
+            rhs_model_executor->GetInputs(rhs_key).end()};
+
+        std::set<int> common_tensors;
+        std::set_intersection(lhs_outputs.begin(), lhs_outputs.end(),
+                              rhs_inputs.begin(), rhs_inputs.end(),
+                              std::inserter(common_tensors,
+                                            common_tensors.end()));
+
+        for (int common_tensor_index : common_tensors) {
+          if (!(*lhs_model_executor->GetTensorView(lhs_key,
+                                                   common_tensor_index) ==
+                *rhs_model_executor->GetTensorView(rhs_key,
+                                                   common_tensor_index))) {
+            return absl::InternalError(absl::StrFormat(
+                "%s %s %d != %s %s %d",
+                ToString(GetWorkerDevice(lhs.worker_id)),
+                lhs.ToString().c_str(), common_tensor_index,
+                ToString(GetWorkerDevice(rhs.worker_id)),
+                rhs.ToString().c_str(), common_tensor_index));
           }
         }
       }
+    }
+  }
 
-      // todo: connect prev / next && unit indices
+  // todo: connect prev / next && unit indices
 
-      // Initialize tensor ring buffer
-      // Assumption: each backend model in band::Model has the same input /
-      // output tensor shapes
-      {
-        std::vector<std::shared_ptr<interface::ITensor>> input_tensors;
-        std::vector<std::shared_ptr<interface::ITensor>> output_tensors;
+  // Initialize tensor ring buffer
+  // Assumption: each backend model in band::Model has the same input /
+  // output tensor shapes
+  {
+    std::vector<std::shared_ptr<interface::ITensor>> input_tensors;
+    std::vector<std::shared_ptr<interface::ITensor>> output_tensors;
+
+    auto model_subgraph_key =
+        GetLargestSubgraphKey(model_id, GetDeviceWorkerId(DeviceFlag::kCPU));
+    interface::IModelExecutor* primary_model_executor =
+        GetModelExecutor(model_subgraph_key);
+    if (primary_model_executor == nullptr) {
+      return absl::InternalError(absl::StrFormat(
+          "Model %d has no subgraph on the CPU worker, which holds its I/O "
+          "tensors",
+          model_id));
+    }
 
-        auto model_subgraph_key = GetLargestSubgraphKey(
-            model_id, GetDeviceWorkerId(DeviceFlag::kCPU));
-        interface::IModelExecutor* primary_model_executor =
-            GetModelExecutor(model_subgraph_key);
+    for (int input_tensor : model_spec.input_tensors) {
+      input_tensors.push_back(primary_model_executor->GetTensorView(
+          model_subgraph_key, input_tensor));
+    }
 
-        for (int input_tensor : model_spec.input_tensors) {
-          input_tensors.push_back(primary_model_executor->GetTensorView(
-              model_subgraph_key, input_tensor));
-        }
+    for (int output_tensor : model_spec.output_tensors) {
+      output_tensors.push_back(primary_model_executor->GetTensorView(
+          model_subgraph_key, output_tensor));
+    }
 
-        for (int output_tensor : model_spec.output_tensors) {
-          output_tensors.push_back(primary_model_executor->GetTensorView(
-              model_subgraph_key, output_tensor));
+    const std::vector<int> input_indices{model_spec.input_tensors.begin(),
+                                         model_spec.input_tensors.end()};
+    const std::vector<int> output_indices{model_spec.output_tensors.begin(),
+                                          model_spec.output_tensors.end()};
+
+    const int pool_size =
+        tensor_pool_size > 0 ? tensor_pool_size : tensor_pool_size_;
+    model_input_buffer_.emplace(
+        model_id, std::make_unique<TensorRingBuffer>(
+                      input_tensors, input_indices, pool_size, clock_));
+    model_output_buffer_.emplace(
+        model_id, std::make_unique<TensorRingBuffer>(
+                      output_tensors, output_indices, pool_size, clock_));
+  }
+
+  {
+    std::shared_lock<std::shared_mutex> io_bindings_lock(io_bindings_mtx_);
+    RETURN_IF_ERROR(BuildSubgraphIOTables(model_id));
+  }
+  BuildSubgraphTable(model_id, subgraph_defs);
+  RETURN_IF_ERROR(PrepareBatchedSubgraphs(model, backend_type, subgraph_defs));
+  return latency_estimator_->ProfileModel(model_id);
+}
+
+absl::Status Engine::PrepareSubgraphs(const ModelAnalysis& analysis) {
+  const std::vector<SubgraphDef>& subgraph_defs = analysis.subgraph_defs;
+  const ModelId model_id = analysis.model->GetId();
+  interface::IModel* backend_model =
+      analysis.model->GetBackendModel(analysis.backend_type);
+
+  // Lazy subgraphs only build the largest subgraphs per worker here,
+  // and the other subgraphs at their first use
+  std::map<WorkerId, size_t> largest_num_ops;
+  // Indices of the subgraph definitions per worker
+  std::map<WorkerId, std::vector<size_t>> worker_subgraphs;
+  for (size_t i = 0; i < subgraph_defs.size(); i++) {
+    const SubgraphDef& subgraph_def = subgraph_defs[i];
+    if (model_executors_.find({model_id, subgraph_def.worker_id}) ==
+        model_executors_.end()) {
+      return absl::InternalError(
+          absl::StrFormat("Subgraph logic created a subgraph for worker %d "
+                          "that does not supports model %d",
+                          subgraph_def.worker_id, model_id));
+    }
+    size_t& num_ops = largest_num_ops[subgraph_def.worker_id];
+    num_ops = std::max(num_ops, subgraph_def.op_indices.size());
+    worker_subgraphs[subgraph_def.worker_id].push_back(i);
+  }
+
+  // Executors of different workers are independent, so the subgraphs of
+  // each worker are prepared in parallel. The engine state is updated after.
+  struct PreparedSubgraph {
+    // Subgraphs that fail to prepare are left out
+    absl::Status status;
+    bool is_primary = false;
+    bool is_lazy = false;
+    size_t bytes = 0;
+  };
+  std::vector<PreparedSubgraph> prepared(subgraph_defs.size());
+  std::vector<absl::Status> worker_statuses(worker_subgraphs.size());
+  std::vector<std::function<void()>> tasks;
+  for (const auto& it : worker_subgraphs) {
+    const WorkerId worker_id = it.first;
+    const std::vector<size_t>& indices = it.second;
+    absl::Status& worker_status = worker_statuses[tasks.size()];
+    interface::IModelExecutor* model_executor =
+        model_executors_.at({model_id, worker_id}).get();
+    tasks.push_back([&, worker_id, model_executor]() {
+      for (size_t i : indices) {
+        const SubgraphDef& subgraph_def = subgraph_defs[i];
+        const SubgraphKey key = {model_id, worker_id,
+                                 subgraph_def.unit_subgraph_indices};
+        PreparedSubgraph& result = prepared[i];
+        result.is_primary =
+            subgraph_def.op_indices.size() == largest_num_ops.at(worker_id);
+        result.is_lazy = subgraph_config_.lazy_subgraphs && !result.is_primary;
+        result.status = result.is_lazy
+                            ? model_executor->DeclareSubgraph(
+                                  backend_model, subgraph_def.op_indices,
+                                  subgraph_def.unit_subgraph_indices)
+                            : model_executor->PrepareSubgraph(
+                                  backend_model, subgraph_def.op_indices,
+                                  subgraph_def.unit_subgraph_indices);
+        if (!result.status.ok()) {
+          continue;
+        }
+        // Verify generated subgraphs
+        if (model_executor->HasSubgraph(key) == false) {
+          worker_status = absl::InternalError(
+              absl::StrFormat("A subgraph for worker %d that does not exists",
+                              worker_id));
+          return;
         }
+        if (!result.is_lazy) {
+          worker_status = VerifySubgraph(key, subgraph_def.op_indices);
+          if (!worker_status.ok()) {
+            return;
+          }
+          if (subgraph_config_.lazy_subgraphs) {
+            result.bytes = model_executor->GetMemoryFootprint(key);
+          }
+        }
+      }
+    });
+  }
+  ThreadPool::RunAll(std::move(tasks));
+  for (const absl::Status& worker_status : worker_statuses) {
+    RETURN_IF_ERROR(worker_status);
+  }
 
-        const std::vector<int> input_indices{model_spec.input_tensors.begin(),
-                                             model_spec.input_tensors.end()};
-        const std::vector<int> output_indices{model_spec.output_tensors.begin(),
-                                              model_spec.output_tensors.end()};
-
-        model_input_buffer_.emplace(
-            model->GetId(),
-            std::make_unique<TensorRingBuffer>(input_tensors, input_indices));
-        model_output_buffer_.emplace(
-            model_id,
-            std::make_unique<TensorRingBuffer>(output_tensors, output_indices));
+  if (subgraph_config_.lazy_subgraphs) {
+    for (size_t i = 0; i < subgraph_defs.size(); i++) {
+      const SubgraphDef& subgraph_def = subgraph_defs[i];
+      const PreparedSubgraph& result = prepared[i];
+      if (!result.status.ok()) {
+        continue;
       }
-    }
-    {
-      auto status = latency_estimator_->ProfileModel(model_id);
-      if (!status.ok()) {
-        return status;
+      const SubgraphKey key = {model_id, subgraph_def.worker_id,
+                               subgraph_def.unit_subgraph_indices};
+      auto residency = std::make_unique<SubgraphResidency>();
+      residency->op_indices = subgraph_def.op_indices;
+      residency->is_primary = result.is_primary;
+      residency->is_materialized = !result.is_lazy;
+      if (!result.is_lazy) {
+        residency->bytes = result.bytes;
+        // the first one is the largest subgraph of the executor
+        primary_subgraph_keys_.insert(
+            {{model_id, subgraph_def.worker_id}, key});
       }
+      subgraph_residency_[key] = std::move(residency);
     }
   }
-
   return absl::OkStatus();
 }
 
@@ -270,8 +413,8 @@ absl::Status Engine::UnregisterModel(Model* model) {
   }
 
   for (auto it = model_executors_.begin(); it != model_executors_.end();) {
-    (it->first.second == model->GetId()) ? model_executors_.erase(it++)
-                                         : (++it);
+    (it->first.first == model->GetId()) ? model_executors_.erase(it++)
+                                        : (++it);
   }
 
   for (auto it = model_specs_.begin(); it != model_specs_.end();) {
@@ -288,6 +431,37 @@ absl::Status Engine::UnregisterModel(Model* model) {
     (it->first == model->GetId()) ? model_output_buffer_.erase(it++) : (++it);
   }
 
+  {
+    std::unique_lock<std::shared_mutex> io_bindings_lock(io_bindings_mtx_);
+    model_io_bindings_.erase(model->GetId());
+  }
+  subgraph_tables_.erase(model->GetId());
+
+  for (auto it = subgraph_io_tables_.begin();
+       it != subgraph_io_tables_.end();) {
+    (it->first.GetModelId() == model->GetId()) ? subgraph_io_tables_.erase(it++)
+                                               : (++it);
+  }
+
+  for (auto it = batched_subgraphs_.begin(); it != batched_subgraphs_.end();) {
+    (std::get<0>(it->first) == model->GetId())
+        ? batched_subgraphs_.erase(it++)
+        : (++it);
+  }
+
+  for (auto it = subgraph_residency_.begin();
+       it != subgraph_residency_.end();) {
+    (it->first.GetModelId() == model->GetId())
+        ? subgraph_residency_.erase(it++)
+        : (++it);
+  }
+
+  for (auto it = primary_subgraph_keys_.begin();
+       it != primary_subgraph_keys_.end();) {
+    (it->first.first == model->GetId()) ? primary_subgraph_keys_.erase(it++)
+                                        : (++it);
+  }
+
   return absl::OkStatus();
 }
 
@@ -413,21 +587,57 @@ absl::StatusOr<std::vector<JobId>> Engine::RequestAsync(
       job.target_worker_id = options[i].target_worker;
     }
 
-    if (i < inputs.size()) {
-      int input_handle = model_input_buffer_[model_ids[i]]->Alloc();
+    auto release_allocated = [this, &jobs, &job]() {
+      jobs.push_back(job);
+      for (const Job& allocated_job : jobs) {
+        ReleaseInputHandle(allocated_job);
+        ReleaseOutputHandle(allocated_job.model_id,
+                            allocated_job.output_handle);
+      }
+    };
+
+    if (options[i].use_bound_tensors) {
+      if (i < inputs.size()) {
+        release_allocated();
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "Request for model %d passes input tensors but uses the bound "
+            "tensors",
+            model_ids[i]));
+      }
+      std::shared_lock<std::shared_mutex> io_bindings_lock(io_bindings_mtx_);
+      if (model_io_bindings_.find(model_ids[i]) == model_io_bindings_.end()) {
+        release_allocated();
+        return absl::FailedPreconditionError(absl::StrFormat(
+            "Model %d has no bound I/O tensors", model_ids[i]));
+      }
+      job.io_bound = true;
+    } else if (i < inputs.size()) {
+      auto status_or_input_handle =
+          model_input_buffer_[model_ids[i]]->Alloc(block_on_tensor_pool_full_);
+      if (!status_or_input_handle.ok()) {
+        release_allocated();
+        return status_or_input_handle.status();
+      }
+      job.input_handle = status_or_input_handle.value();
       if (!model_input_buffer_[model_ids[i]]
-               ->PutTensorsToHandle(inputs[i], input_handle)
+               ->PutTensorsToHandle(inputs[i], job.input_handle)
                .ok()) {
+        release_allocated();
         return absl::InternalError(
             absl::StrFormat("Input copy failure for model %d", model_ids[i]));
       }
-      job.input_handle = input_handle;
-      job.output_handle = model_output_buffer_[model_ids[i]]->Alloc();
+
+      auto status_or_output_handle = AllocOutputHandle(model_ids[i]);
+      if (!status_or_output_handle.ok()) {
+        release_allocated();
+        return status_or_output_handle.status();
+      }
+      job.output_handle = status_or_output_handle.value();
     }
 
-    jobs.push_back(job);
+    jobs.push_back(std::move(job));
   }
-  return EnqueueBatch(jobs);
+  return EnqueueBatch(std::move(jobs));
 }
 
 absl::Status Engine::Wait(JobId job_id, Tensors outputs) {
@@ -441,18 +651,52 @@ absl::Status Engine::Wait(JobId job_id, Tensors outputs) {
 absl::Status Engine::Wait(std::vector<JobId> job_ids,
                           std::vector<Tensors> outputs) {
   planner_->Wait(job_ids);
-  for (size_t i = 0; i < outputs.size(); i++) {
-    auto status = GetOutputTensors(job_ids[i], outputs[i]);
-    if (!status.ok()) {
-      return status;
+  absl::Status status = absl::OkStatus();
+  for (size_t i = 0; i < job_ids.size(); i++) {
+    if (i < outputs.size()) {
+      auto output_status = GetOutputTensors(job_ids[i], outputs[i]);
+      if (status.ok() && !output_status.ok()) {
+        status = output_status;
+      }
+    } else {
+      // Outputs not requested, return the slot to the pool
+      auto status_or_output_handle = planner_->TakeOutputHandle(job_ids[i]);
+      if (status_or_output_handle.ok()) {
+        ReleaseOutputHandle(planner_->GetFinishedJob(job_ids[i]).model_id,
+                            status_or_output_handle.value());
+      }
     }
   }
-  return absl::OkStatus();
+  return status;
+}
+
+absl::Status Engine::WaitFor(JobId job_id, int64_t timeout_us,
+                             Tensors outputs) {
+  if (!planner_->Wait({job_id}, timeout_us)) {
+    return absl::DeadlineExceededError(absl::StrFormat(
+        "Job %d is not finished within %lld us", job_id, timeout_us));
+  }
+  return Wait(job_id, outputs);
+}
+
+absl::StatusOr<JobId> Engine::WaitAny(const std::vector<JobId>& job_ids,
+                                      int64_t timeout_us) {
+  if (job_ids.empty()) {
+    return absl::InvalidArgumentError("No job to wait for.");
+  }
+  JobId job_id = planner_->WaitAny(job_ids, timeout_us);
+  if (job_id == -1) {
+    return absl::DeadlineExceededError(absl::StrFormat(
+        "None of %d jobs is finished within %lld us", job_ids.size(),
+        timeout_us));
+  }
+  return job_id;
 }
 
 void Engine::WaitAll() { planner_->WaitAll(); }
 
-absl::Status Engine::GetOutputTensors(JobId job_id, Tensors outputs) {
+absl::Status Engine::GetOutputTensors(JobId job_id, Tensors outputs,
+                                      RequestTimes* times) {
   Job job = planner_->GetFinishedJob(job_id);
 
   if (outputs.empty() || job_id == -1) {
@@ -466,7 +710,22 @@ absl::Status Engine::GetOutputTensors(JobId job_id, Tensors outputs) {
     return absl::InternalError("Invalid job id / not finished or invalidated.");
   }
 
-  if (job.output_handle == -1) {
+  if (times) {
+    *times = ToRequestTimes(job);
+  }
+  // Owns the slot from here, so that it is not reclaimed while it is read
+  auto status_or_output_handle = planner_->TakeOutputHandle(job_id);
+  if (!status_or_output_handle.ok()) {
+    return status_or_output_handle.status();
+  }
+  job.output_handle = status_or_output_handle.value();
+  auto status = ReadOutputTensors(job, outputs);
+  ReleaseOutputHandle(job.model_id, job.output_handle);
+  return status;
+}
+
+absl::Status Engine::ReadOutputTensors(const Job& job, Tensors& outputs) {
+  if (job.output_handle == -1 && !job.io_bound) {
     return absl::InternalError(
         absl::StrFormat("Invalid output handle : %d", job.output_handle));
   }
@@ -483,6 +742,25 @@ absl::Status Engine::GetOutputTensors(JobId job_id, Tensors outputs) {
         absl::StrFormat("Invalid model id : %d", job.model_id));
   }
 
+  if (job.io_bound) {
+    // Results are already in the bound tensors
+    std::shared_lock<std::shared_mutex> io_bindings_lock(io_bindings_mtx_);
+    auto binding_it = model_io_bindings_.find(job.model_id);
+    if (binding_it == model_io_bindings_.end() ||
+        binding_it->second.outputs.size() != outputs.size()) {
+      return absl::InternalError(absl::StrFormat(
+          "Invalid bound output tensors for model %d", job.model_id));
+    }
+    size_t i = 0;
+    for (const auto& bound_output : binding_it->second.outputs) {
+      if (outputs[i]->GetData() != bound_output.second->GetData()) {
+        RETURN_IF_ERROR(outputs[i]->CopyDataFrom(bound_output.second));
+      }
+      i++;
+    }
+    return absl::OkStatus();
+  }
+
   auto status = model_output_buffer_.at(job.model_id)
                     ->GetTensorsFromHandle(outputs, job.output_handle);
   if (!status.ok()) {
@@ -491,6 +769,137 @@ absl::Status Engine::GetOutputTensors(JobId job_id, Tensors outputs) {
   return absl::OkStatus();
 }
 
+absl::Status Engine::BindIOTensors(ModelId model_id, Tensors inputs,
+                                   Tensors outputs) {
+  auto model_spec_it = model_specs_.find(model_id);
+  if (model_spec_it == model_specs_.end()) {
+    return absl::InternalError(
+        absl::StrFormat("Invalid model id : %d", model_id));
+  }
+
+  std::unique_lock<std::shared_mutex> io_bindings_lock(io_bindings_mtx_);
+  if (model_io_bindings_.find(model_id) != model_io_bindings_.end()) {
+    return absl::InternalError(
+        absl::StrFormat("I/O tensors are already bound to model %d", model_id));
+  }
+
+  const ModelSpec& model_spec = model_spec_it->second;
+  if (inputs.size() != model_spec.input_tensors.size() ||
+      outputs.size() != model_spec.output_tensors.size()) {
+    return absl::InternalError(absl::StrFormat(
+        "# Bound tensors (%d, %d) != # I/O tensors of model %d (%d, %d)",
+        inputs.size(), outputs.size(), model_id,
+        model_spec.input_tensors.size(), model_spec.output_tensors.size()));
+  }
+
+  // Same order as the tensor ring buffers
+  IOBinding binding;
+  {
+    size_t i = 0;
+    for (int tensor_index : model_spec.input_tensors) {
+      binding.inputs[tensor_index] = inputs[i++];
+    }
+    i = 0;
+    for (int tensor_index : model_spec.output_tensors) {
+      binding.outputs[tensor_index] = outputs[i++];
+    }
+  }
+
+  const SubgraphKey model_subgraph_key =
+      GetLargestSubgraphKey(model_id, GetDeviceWorkerId(DeviceFlag::kCPU));
+  interface::IModelExecutor* primary_model_executor =
+      GetModelExecutor(model_subgraph_key);
+  if (primary_model_executor == nullptr) {
+    return absl::InternalError(absl::StrFormat(
+        "Failed to find model executor for model %d", model_id));
+  }
+
+  for (const auto* tensors : {&binding.inputs, &binding.outputs}) {
+    for (const auto& tensor : *tensors) {
+      if (tensor.second == nullptr ||
+          !(*tensor.second == *primary_model_executor->GetTensorView(
+                                  model_subgraph_key, tensor.first))) {
+        return absl::InternalError(absl::StrFormat(
+            "Bound tensor does not match tensor %d of model %d", tensor.first,
+            model_id));
+      }
+    }
+  }
+
+  // Lazy subgraphs are bound when they are materialized
+  std::lock_guard<std::mutex> residency_lock(residency_mtx_);
+  int num_bound = 0;
+  int num_fallback = 0;
+  absl::Status status = absl::OkStatus();
+  for (auto& it : model_executors_) {
+    if (it.first.first != model_id) {
+      continue;
+    }
+    interface::IModelExecutor* model_executor = it.second.get();
+    model_executor->ForEachSubgraph([&](const SubgraphKey& key) {
+      if (status.ok() && model_executor->IsMaterialized(key)) {
+        status = BindSubgraphTensors(model_executor, key, binding, num_bound,
+                                     num_fallback);
+      }
+    });
+  }
+
+  if (!status.ok()) {
+    // Leave no subgraph pointing to the caller memory
+    for (auto& it : model_executors_) {
+      if (it.first.first != model_id) {
+        continue;
+      }
+      interface::IModelExecutor* model_executor = it.second.get();
+      model_executor->ForEachSubgraph([&](const SubgraphKey& key) {
+        if (model_executor->IsMaterialized(key)) {
+          UnbindSubgraphTensors(model_executor, key, binding).IgnoreError();
+        }
+      });
+    }
+    return status;
+  }
+
+  BAND_LOG(LogSeverity::kInternal,
+           "Bound I/O tensors of model %d (%d bound, %d copied)", model_id,
+           num_bound, num_fallback);
+  model_io_bindings_.emplace(model_id, std::move(binding));
+  // Tensor data moved to the bound memory
+  return BuildSubgraphIOTables(model_id);
+}
+
+absl::Status Engine::UnbindIOTensors(ModelId model_id) {
+  std::unique_lock<std::shared_mutex> io_bindings_lock(io_bindings_mtx_);
+  auto binding_it = model_io_bindings_.find(model_id);
+  if (binding_it == model_io_bindings_.end()) {
+    return absl::InternalError(
+        absl::StrFormat("No I/O tensors are bound to model %d", model_id));
+  }
+  const IOBinding& binding = binding_it->second;
+
+  std::lock_guard<std::mutex> residency_lock(residency_mtx_);
+  absl::Status status = absl::OkStatus();
+  for (auto& it : model_executors_) {
+    if (it.first.first != model_id) {
+      continue;
+    }
+    interface::IModelExecutor* model_executor = it.second.get();
+    model_executor->ForEachSubgraph([&](const SubgraphKey& key) {
+      if (!model_executor->IsMaterialized(key)) {
+        return;
+      }
+      auto unbind_status = UnbindSubgraphTensors(model_executor, key, binding);
+      if (!unbind_status.ok()) {
+        status = unbind_status;
+      }
+    });
+  }
+
+  model_io_bindings_.erase(binding_it);
+  RETURN_IF_ERROR(BuildSubgraphIOTables(model_id));
+  return status;
+}
+
 CallbackId Engine::SetOnEndRequest(
     std::function<void(int, absl::Status)> on_end_request) {
   return planner_->SetOnEndRequest(on_end_request);
@@ -501,6 +910,11 @@ absl::Status Engine::UnsetOnEndRequest(CallbackId callback_id) {
 }
 
 absl::Status Engine::Init(const RuntimeConfig& config) {
+  if (config.use_virtual_clock) {
+    virtual_clock_ = std::make_unique<VirtualClock>();
+    clock_ = virtual_clock_.get();
+  }
+
   planner_ = std::make_unique<Planner>(*this);
   auto status = planner_->Init(config.planner_config);
   if (!status.ok()) {
@@ -509,6 +923,10 @@ absl::Status Engine::Init(const RuntimeConfig& config) {
 
   {
     subgraph_config_ = config.subgraph_config;
+    tensor_pool_size_ = config.tensor_pool_size;
+    block_on_tensor_pool_full_ = config.block_on_tensor_pool_full;
+    max_batch_size_ = config.planner_config.max_batch_size;
+    cache_capacity_ = config.planner_config.latency_cache_size;
 
     latency_estimator_ = std::make_unique<LatencyEstimator>(this);
     auto status = latency_estimator_->Init(config.profile_config);
@@ -545,14 +963,22 @@ absl::Status Engine::Init(const RuntimeConfig& config) {
   for (int i = 0; i < potential_workers.size(); i++) {
     DeviceFlag device_flag = potential_workers[i];
     if (valid_devices.find(device_flag) != valid_devices.end()) {
+      if (workers_.size() == kMaxNumWorkers) {
+        return absl::InternalError(absl::StrFormat(
+            "Engine supports up to %zu workers.", kMaxNumWorkers));
+      }
       std::unique_ptr<Worker> worker;
       if (planner_->GetWorkerType() ==
           static_cast<int>(WorkerType::kGlobalQueue)) {
         worker = std::make_unique<GlobalQueueWorker>(this, workers_.size(),
                                                      device_flag);
       } else {
-        worker = std::make_unique<DeviceQueueWorker>(this, workers_.size(),
-                                                     device_flag);
+        auto device_queue_worker = std::make_unique<DeviceQueueWorker>(
+            this, workers_.size(), device_flag);
+        if (config.worker_config.allow_worksteal) {
+          device_queue_worker->AllowWorkSteal();
+        }
+        worker = std::move(device_queue_worker);
       }
 
       if (!worker->Init(config.worker_config).ok()) {
@@ -566,6 +992,7 @@ absl::Status Engine::Init(const RuntimeConfig& config) {
       workers_.push_back(std::move(worker));
       workers_waiting_[i] = 0;
       BAND_TRACER_ADD_WORKER(device_flag, workers_.back()->GetId());
+      RuntimeTracer::Get().AddWorker(workers_.back()->GetId(), device_flag);
     } else {
       BAND_LOG(LogSeverity::kWarning, "%s worker is not created.",
                ToString(device_flag));
@@ -587,17 +1014,31 @@ WorkerWaitingTime Engine::GetWorkerWaitingTime() const {
 
 std::set<int> Engine::GetIdleWorkers() const {
   std::set<int> idle_workers;
-  auto waiting_time = GetWorkerWaitingTime();
-  for (auto worker_waiting : waiting_time) {
-    if (worker_waiting.second == 0) {
-      idle_workers.insert(worker_waiting.first);
+  const BitMask idle_mask(idle_workers_.load(std::memory_order_acquire));
+  for (WorkerId worker_id = 0; worker_id < workers_.size(); worker_id++) {
+    if (idle_mask.test(worker_id)) {
+      idle_workers.insert(worker_id);
     }
   }
   return idle_workers;
 }
 
+void Engine::SetWorkerIdle(WorkerId worker_id, bool is_idle) {
+  const uint64_t bit = uint64_t(1) << worker_id;
+  if (is_idle) {
+    idle_workers_.fetch_or(bit, std::memory_order_acq_rel);
+  } else {
+    idle_workers_.fetch_and(~bit, std::memory_order_acq_rel);
+  }
+}
+
 SubgraphKey Engine::GetLargestSubgraphKey(ModelId model_id,
                                           WorkerId worker_id) const {
+  // The executor may be materializing a lazy subgraph on its worker
+  if (subgraph_config_.lazy_subgraphs) {
+    auto it = primary_subgraph_keys_.find({model_id, worker_id});
+    return it != primary_subgraph_keys_.end() ? it->second : SubgraphKey();
+  }
   auto model_executor_it = model_executors_.find({model_id, worker_id});
   if (model_executor_it != model_executors_.end()) {
     return model_executor_it->second->GetLargestSubgraphKey();
@@ -649,6 +1090,15 @@ bool Engine::HasSubgraph(const SubgraphKey& key) const {
          model_executor_it->second->HasSubgraph(key);
 }
 
+bool Engine::IsMaterialized(const SubgraphKey& key) const {
+  if (!subgraph_config_.lazy_subgraphs) {
+    return HasSubgraph(key);
+  }
+  auto it = subgraph_residency_.find(key);
+  return it != subgraph_residency_.end() &&
+         it->second->is_materialized.load(std::memory_order_acquire);
+}
+
 void Engine::ForEachSubgraph(
     std::function<void(const SubgraphKey&)> visitor) const {
   for (auto& model_executor : model_executors_) {
@@ -656,20 +1106,191 @@ void Engine::ForEachSubgraph(
   }
 }
 
-absl::Status Engine::Invoke(const SubgraphKey& key) {
+absl::Status Engine::Invoke(const SubgraphKey& key, int batch_size) {
+  if (batch_size > 1) {
+    auto batched_it = batched_subgraphs_.find(
+        {key.GetModelId(), key.GetWorkerId(), batch_size});
+    if (batched_it == batched_subgraphs_.end() ||
+        batched_it->second.key != key) {
+      return absl::InternalError(absl::StrFormat(
+          "Failed to find a batched subgraph %s (batch size %d)",
+          key.ToString(), batch_size));
+    }
+    return batched_it->second.model_executor->ExecuteSubgraph(key);
+  }
+
   auto model_executor_it =
       model_executors_.find({key.GetModelId(), key.GetWorkerId()});
   if (model_executor_it == model_executors_.end()) {
     return absl::InternalError("Failed to find a subgraph key");
   }
+  if (subgraph_config_.lazy_subgraphs) {
+    RETURN_IF_ERROR(MaterializeSubgraph(key, true));
+  }
   return model_executor_it->second->ExecuteSubgraph(key);
 }
 
+LatencyCacheStats Engine::GetLatencyCacheStats() const {
+  LatencyCacheStats stats;
+  stats.hits = cache_hits_.load(std::memory_order_relaxed);
+  stats.misses = cache_misses_.load(std::memory_order_relaxed);
+  stats.invalidations = cache_invalidations_.load(std::memory_order_relaxed);
+  stats.evictions = cache_evictions_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+PlannerStats Engine::GetPlannerStats() const {
+  PlannerStats stats;
+  stats.wakeups = planner_->GetNumWakeups();
+  stats.scheduling_passes = planner_->GetNumSchedulingPasses();
+  return stats;
+}
+
+std::vector<WorkerStats> Engine::GetWorkerStats() const {
+  std::vector<WorkerStats> stats;
+  for (const auto& worker : workers_) {
+    WorkerStats worker_stats;
+    worker_stats.device_flag = worker->GetDeviceFlag();
+    worker_stats.num_invokes = worker->GetNumInvokes();
+    worker_stats.busy_time_us = worker->GetBusyTime();
+    stats.push_back(worker_stats);
+  }
+  return stats;
+}
+
+absl::StatusOr<RequestTimes> Engine::GetRequestTimes(JobId job_id) const {
+  Job job = planner_->GetFinishedJob(job_id);
+  // Not finished or recycled
+  if (job_id == -1 || job.job_id == -1) {
+    return absl::NotFoundError(
+        absl::StrFormat("Job %d is not finished or recycled", job_id));
+  }
+
+  return ToRequestTimes(job);
+}
+
+RequestTimes Engine::ToRequestTimes(const Job& job) {
+  RequestTimes times;
+  times.model_id = job.model_id;
+  times.enqueue_time = job.enqueue_time;
+  times.end_time = job.end_time;
+  times.completion_time = job.completion_time;
+  times.planner_time = job.planner_time;
+  times.worker_queue_time = job.worker_queue_time;
+  times.input_copy_time = job.input_copy_time;
+  times.execution_time = job.total_execution_time;
+  times.output_copy_time = job.output_copy_time;
+  times.callback_time = job.callback_time;
+  return times;
+}
+
+Metrics Engine::GetMetrics() const {
+  Metrics metrics;
+  planner_->CollectMetrics(metrics);
+
+  metrics.counters["engine.tensor_copy_bytes"] = tensor_copy_bytes_.Get();
+  const LatencyCacheStats cache_stats = GetLatencyCacheStats();
+  metrics.counters["engine.latency_cache.hits"] = cache_stats.hits;
+  metrics.counters["engine.latency_cache.misses"] = cache_stats.misses;
+  metrics.counters["engine.latency_cache.invalidations"] =
+      cache_stats.invalidations;
+  metrics.counters["engine.latency_cache.evictions"] = cache_stats.evictions;
+  metrics.counters["engine.subgraph_materializations"] =
+      subgraph_materializations_.Get();
+  metrics.counters["engine.subgraph_evictions"] = subgraph_evictions_.Get();
+
+  for (const auto& worker : workers_) {
+    const std::string prefix = absl::StrFormat("worker.%d.", worker->GetId());
+    metrics.counters[prefix + "invokes"] = worker->GetNumInvokes();
+    metrics.counters[prefix + "busy_time_us"] = worker->GetBusyTime();
+    metrics.gauges[prefix + "queue_depth"] = worker->GetNumQueuedJobs();
+  }
+
+  if (subgraph_config_.lazy_subgraphs) {
+    std::lock_guard<std::mutex> lock(residency_mtx_);
+    for (const auto& worker : workers_) {
+      const std::string prefix =
+          absl::StrFormat("worker.%d.", worker->GetId());
+      metrics.gauges[prefix + "materialized_subgraphs"] = 0;
+      metrics.gauges[prefix + "subgraph_bytes"] = 0;
+    }
+    for (const auto& it : subgraph_residency_) {
+      if (it.second->is_materialized.load(std::memory_order_relaxed)) {
+        const std::string prefix =
+            absl::StrFormat("worker.%d.", it.first.GetWorkerId());
+        metrics.gauges[prefix + "materialized_subgraphs"]++;
+        metrics.gauges[prefix + "subgraph_bytes"] += it.second->bytes;
+      }
+    }
+  }
+
+  {
+    // Lazy subgraphs are materialized and evicted under the lock
+    std::lock_guard<std::mutex> lock(residency_mtx_);
+    for (const auto& it : model_executors_) {
+      interface::IModelExecutor* model_executor = it.second.get();
+      int64_t& bytes = metrics.gauges[absl::StrFormat(
+          "model.%d.memory_bytes", it.first.first)];
+      bytes += model_executor->GetSharedMemoryFootprint();
+      model_executor->ForEachSubgraph([&](const SubgraphKey& key) {
+        if (model_executor->IsMaterialized(key)) {
+          bytes += model_executor->GetMemoryFootprint(key);
+        }
+      });
+    }
+  }
+
+  for (const auto& it : model_input_buffer_) {
+    metrics.gauges[absl::StrFormat("model.%d.input_slots_in_use", it.first)] =
+        it.second->GetSize() - it.second->GetNumFreeSlots();
+  }
+  for (const auto& it : model_output_buffer_) {
+    metrics.gauges[absl::StrFormat("model.%d.output_slots_in_use", it.first)] =
+        it.second->GetSize() - it.second->GetNumFreeSlots();
+  }
+  return metrics;
+}
+
+std::vector<int> Engine::GetBatchSizes(const SubgraphKey& key) const {
+  std::vector<int> batch_sizes;
+  for (auto it = batched_subgraphs_.lower_bound(
+           {key.GetModelId(), key.GetWorkerId(), 0});
+       it != batched_subgraphs_.end() &&
+       std::get<0>(it->first) == key.GetModelId() &&
+       std::get<1>(it->first) == key.GetWorkerId();
+       ++it) {
+    if (it->second.key == key) {
+      batch_sizes.push_back(std::get<2>(it->first));
+    }
+  }
+  return batch_sizes;
+}
+
 std::pair<SubgraphKey, int64_t> Engine::GetShortestLatency(
     ModelId model_id, BitMask resolved_unit_subgraphs, int64_t start_time,
     const std::map<WorkerId, int64_t>& worker_waiting) const {
+  auto table_it = subgraph_tables_.find(model_id);
+  if (table_it == subgraph_tables_.end()) {
+    return {{}, std::numeric_limits<int64_t>::max()};
+  }
+  const SubgraphTable& table = table_it->second;
+  auto state_it = table.state_indices.find(resolved_unit_subgraphs);
+  if (state_it == table.state_indices.end()) {
+    BAND_LOG(LogSeverity::kError,
+             "Unit subgraphs %s of model %d are not reachable",
+             resolved_unit_subgraphs.to_string().c_str(), model_id);
+    return {{}, std::numeric_limits<int64_t>::max()};
+  }
+  return GetShortestLatency(table, state_it->second, start_time,
+                            worker_waiting);
+}
+
+std::pair<SubgraphKey, int64_t> Engine::GetShortestLatency(
+    const SubgraphTable& table, int state, int64_t start_time,
+    const std::map<WorkerId, int64_t>& worker_waiting) const {
   // lookup key for cache
-  std::pair<ModelId, BitMask> cache_key = {model_id, resolved_unit_subgraphs};
+  std::pair<ModelId, BitMask> cache_key = {table.model_id,
+                                           table.state_masks[state]};
 
   // check if it is safe to lookup the cache:
   // are all waiting times < start_time ?
@@ -681,47 +1302,41 @@ std::pair<SubgraphKey, int64_t> Engine::GetShortestLatency(
     }
   }
 
-  if (wait_time_is_stale) {
+  const bool use_cache = wait_time_is_stale && cache_capacity_ > 0;
+  const uint32_t epoch =
+      latency_estimator_ ? latency_estimator_->GetEpoch(table.model_id) : 0;
+  if (use_cache) {
     auto it = cache_.find(cache_key);
     if (it != cache_.end()) {
-      auto& pair = it->second;
-      // the stored latency value assumes a start_time of 0,
-      // so we need to add our own start_time to the stored value to get the
-      // correct return value
-      return {pair.first, pair.second + start_time};
+      if (it->second.epoch == epoch) {
+        cache_hits_.fetch_add(1, std::memory_order_relaxed);
+        // the stored latency value assumes a start_time of 0,
+        // so we need to add our own start_time to the stored value to get
+        // the correct return value
+        return {it->second.key, it->second.latency + start_time};
+      }
+      cache_invalidations_.fetch_add(1, std::memory_order_relaxed);
     }
-  }
-
-  std::vector<SubgraphKey> candidates =
-      GetSubgraphCandidates(model_id, resolved_unit_subgraphs);
-
-  auto bit_mask_comparator = [](const BitMask& lhs, const BitMask& rhs) {
-    return lhs.to_ullong() < rhs.to_ullong();
-  };
-
-  std::map<BitMask, std::vector<SubgraphKey>, decltype(bit_mask_comparator)>
-      unit_indicies_subgraphs(bit_mask_comparator);
-  // group by unit indices
-  for (const SubgraphKey& key : candidates) {
-    unit_indicies_subgraphs[key.GetUnitIndices()].push_back(key);
+    cache_misses_.fetch_add(1, std::memory_order_relaxed);
   }
 
   std::pair<SubgraphKey, int64_t> subgraph_min_latency{
       {}, std::numeric_limits<int64_t>::max()};
-  for (const auto& it : unit_indicies_subgraphs) {
+  for (int i = table.group_offsets[state]; i < table.group_offsets[state + 1];
+       i++) {
+    const SubgraphTable::CandidateGroup& group = table.groups[i];
     // first, filter out the subgraphs that take longer than others with the
     // same start/end indices, since there's no reason to pick them
-    std::pair<SubgraphKey, int64_t> target_subgraph =
-        GetShortestSubgraphKey(it.second, start_time, worker_waiting);
+    std::pair<SubgraphKey, int64_t> target_subgraph = GetShortestSubgraphKey(
+        table.group_keys.begin() + group.keys_begin,
+        table.group_keys.begin() + group.keys_end, start_time, worker_waiting);
 
     std::pair<SubgraphKey, int64_t> local_min;
-    if (IsEnd(target_subgraph.first)) {
+    if (group.next_state < 0) {
       local_min = target_subgraph;
     } else {
-      local_min = GetShortestLatency(
-          model_id,
-          resolved_unit_subgraphs | target_subgraph.first.GetUnitIndices(),
-          target_subgraph.second, worker_waiting);
+      local_min = GetShortestLatency(table, group.next_state,
+                                     target_subgraph.second, worker_waiting);
     }
 
     // check if this subgraph is better than the best one
@@ -734,16 +1349,24 @@ std::pair<SubgraphKey, int64_t> Engine::GetShortestLatency(
     }
   }
 
-  if (wait_time_is_stale) {
-    // if we've reached this point, then there shouldn't be an entry
-    // for this key in the cache
-    assert(cache_.find(cache_key) == cache_.end());
+  if (use_cache) {
     // we are going to store the latency value for start_time == 0,
     // so do a sanity check for latency - start_time
     assert(subgraph_min_latency.second >= start_time);
 
-    cache_[cache_key] = {subgraph_min_latency.first,
-                         subgraph_min_latency.second - start_time};
+    // a stale entry is overwritten in place
+    auto it = cache_.find(cache_key);
+    if (it == cache_.end()) {
+      if (cache_.size() >= cache_capacity_) {
+        cache_.erase(cache_order_.front());
+        cache_order_.pop_front();
+        cache_evictions_.fetch_add(1, std::memory_order_relaxed);
+      }
+      it = cache_.emplace(cache_key, LatencyCacheEntry()).first;
+      cache_order_.push_back(cache_key);
+    }
+    it->second = {subgraph_min_latency.first,
+                  subgraph_min_latency.second - start_time, epoch};
   }
 
   return subgraph_min_latency;
@@ -753,76 +1376,85 @@ std::pair<std::vector<SubgraphKey>, int64_t>
 Engine::GetShortestLatencyWithUnitSubgraph(
     ModelId model_id, int start_unit_idx,
     const std::map<WorkerId, int64_t>& worker_waiting) const {
-  const ModelSpec* model_spec = GetModelSpec(model_id);
-  // vector for memoization during scheduling.
-  // Each element is a pair of subgraph indices list and shortest latency.
-  std::vector<std::pair<std::vector<SubgraphKey>, int64_t>> memo;
-  const size_t num_unit_subgraphs = model_spec->GetNumUnitSubgraphs();
-  memo.resize(num_unit_subgraphs);
+  auto table_it = subgraph_tables_.find(model_id);
+  if (table_it == subgraph_tables_.end()) {
+    return {{}, -1};
+  }
+  const SubgraphTable& table = table_it->second;
+  const int num_unit_subgraphs = table.num_unit_subgraphs;
 
   assert(start_unit_idx < num_unit_subgraphs);
 
-  // Initialize memo.
-  for (int i = 0; i < num_unit_subgraphs; ++i) {
-    memo[i] = std::make_pair<std::vector<SubgraphKey>, int64_t>(
-        {}, std::numeric_limits<int>::max());
-  }
-
   // `i` and `j` refer to an unit subgraph idx.
   // A subgraph(i, j) consists of the unit subgraphs in [i, j].
   // The goal of the algorithm is to find the minimum expected latency;
-  // `memo[k].second` is the minimum expected latency of the
-  // subgraph(start_unit_idx, k). `memo[k].first` is the list of subgraph
-  // indices of the best execution plan. So, the shortest expected latency of a
+  // `memo[k]` is the minimum expected latency of the subgraph(start_unit_idx,
+  // k), or -1 if no plan covers it. The best plan ends with `last_key[k]`,
+  // which starts from `last_start[k]`. So, the shortest expected latency of a
   // subgraph(start_unit_idx, num_unit_subgraphs - 1) is
-  // `memo[num_unit_subgraphs - 1].second`.
+  // `memo[num_unit_subgraphs - 1]`.
+  std::vector<int64_t> memo(num_unit_subgraphs, -1);
+  std::vector<SubgraphKey> last_key(num_unit_subgraphs);
+  std::vector<int> last_start(num_unit_subgraphs, -1);
   for (int j = start_unit_idx; j < num_unit_subgraphs; ++j) {
-    std::pair<std::vector<SubgraphKey>, int64_t> local_min =
-        std::make_pair<std::vector<SubgraphKey>, int64_t>({}, -1);
     for (int i = j; i >= start_unit_idx; --i) {
-      // Check if the subgraph(i, j) is valid.
-      if (unit_subgraphs_to_subgraph_keys_.find(model_id) ==
-          unit_subgraphs_to_subgraph_keys_.end()) {
-        continue;
-      }
-      if (unit_subgraphs_to_subgraph_keys_.at(model_id).find(i) ==
-          unit_subgraphs_to_subgraph_keys_.at(model_id).end()) {
-        continue;
-      }
-      if (unit_subgraphs_to_subgraph_keys_.at(model_id).at(i).find(j) ==
-          unit_subgraphs_to_subgraph_keys_.at(model_id).at(i).end()) {
+      const int range = i * num_unit_subgraphs + j;
+      const int keys_begin = table.range_offsets[range];
+      const int keys_end = table.range_offsets[range + 1];
+      // Check if the subgraph(i, j) is valid and follows a valid plan.
+      if (keys_begin == keys_end || (i > start_unit_idx && memo[i - 1] < 0)) {
         continue;
       }
 
-      // Search from the profile result of the unit subgraph.
-      const auto& subgraph_keys =
-          unit_subgraphs_to_subgraph_keys_.at(model_id).at(i).at(j);
-
-      int64_t start = i > start_unit_idx ? memo[i - 1].second : 0;
-      std::pair<SubgraphKey, int64_t> target_subgraph =
-          GetShortestSubgraphKey(subgraph_keys, start, worker_waiting);
-
-      if (local_min.second == -1 || target_subgraph.second < local_min.second) {
-        if (i > start_unit_idx) {
-          local_min.first = memo[i - 1].first;
-          local_min.first.push_back(target_subgraph.first);
-          local_min.second = target_subgraph.second;
-        } else {
-          local_min.first.clear();
-          local_min.first.push_back(target_subgraph.first);
-          local_min.second = target_subgraph.second;
-        }
+      int64_t start = i > start_unit_idx ? memo[i - 1] : 0;
+      std::pair<SubgraphKey, int64_t> target_subgraph = GetShortestSubgraphKey(
+          table.range_keys.begin() + keys_begin,
+          table.range_keys.begin() + keys_end, start, worker_waiting);
+
+      if (memo[j] == -1 || target_subgraph.second < memo[j]) {
+        memo[j] = target_subgraph.second;
+        last_key[j] = target_subgraph.first;
+        last_start[j] = i;
       }
     }
-    memo[j] = local_min;
   }
 
-  return memo[num_unit_subgraphs - 1];
+  std::pair<std::vector<SubgraphKey>, int64_t> shortest = {
+      {}, memo[num_unit_subgraphs - 1]};
+  if (shortest.second >= 0) {
+    for (int j = num_unit_subgraphs - 1; j >= start_unit_idx;
+         j = last_start[j] - 1) {
+      shortest.first.push_back(last_key[j]);
+    }
+    std::reverse(shortest.first.begin(), shortest.first.end());
+  }
+  return shortest;
 }
 
 std::pair<std::vector<SubgraphKey>, int64_t>
 Engine::GetSubgraphWithShortestLatency(
     const Job& job, const std::map<WorkerId, int64_t>& worker_waiting) const {
+  if (job.batch_size > 1) {
+    // A batch runs the whole model on a worker with a batched subgraph
+    std::pair<std::vector<SubgraphKey>, int64_t> shortest = {
+        {}, std::numeric_limits<int64_t>::max()};
+    for (const auto& it : batched_subgraphs_) {
+      if (std::get<0>(it.first) != job.model_id ||
+          std::get<2>(it.first) != job.batch_size) {
+        continue;
+      }
+      const SubgraphKey& key = it.second.key;
+      const int64_t total = worker_waiting.at(key.GetWorkerId()) +
+                            GetExpected(key, job.batch_size);
+      if (shortest.first.empty() || total < shortest.second) {
+        shortest = {{key}, total};
+      }
+    }
+    if (!shortest.first.empty()) {
+      return shortest;
+    }
+  }
+
   // TODO(dostos): figure out why we return a vector of keys?
   if (subgraph_config_.subgraph_preparation_type ==
       SubgraphPreparationType::kFallbackPerWorker) {
@@ -891,12 +1523,14 @@ std::vector<SubgraphKey> Engine::GetSubgraphCandidates(
 }
 
 std::pair<SubgraphKey, int64_t> Engine::GetShortestSubgraphKey(
-    const std::vector<SubgraphKey>& subgraph_keys, int64_t start_time,
+    std::vector<SubgraphKey>::const_iterator begin,
+    std::vector<SubgraphKey>::const_iterator end, int64_t start_time,
     const std::map<WorkerId, int64_t>& worker_waiting) const {
   int64_t min_latency = std::numeric_limits<int64_t>::max();
   SubgraphKey min_key = {};
 
-  for (const auto& key : subgraph_keys) {
+  for (auto it = begin; it != end; ++it) {
+    const SubgraphKey& key = *it;
     // TODO: safety check to avoid contention with profiler?
     int64_t waiting_time = worker_waiting.at(key.GetWorkerId());
     int64_t expected_latency = GetExpected(key);
@@ -911,16 +1545,20 @@ std::pair<SubgraphKey, int64_t> Engine::GetShortestSubgraphKey(
   return {min_key, min_latency};
 }
 
-void Engine::UpdateLatency(const SubgraphKey& key, int64_t latency) {
-  if (latency_estimator_) latency_estimator_->UpdateLatency(key, latency);
+void Engine::UpdateLatency(const SubgraphKey& key, int64_t latency,
+                           int batch_size) {
+  if (latency_estimator_)
+    latency_estimator_->UpdateLatency(key, latency, batch_size);
 }
 
-int64_t Engine::GetProfiled(const SubgraphKey& key) const {
-  return latency_estimator_ ? latency_estimator_->GetProfiled(key) : 0;
+int64_t Engine::GetProfiled(const SubgraphKey& key, int batch_size) const {
+  return latency_estimator_ ? latency_estimator_->GetProfiled(key, batch_size)
+                            : 0;
 }
 
-int64_t Engine::GetExpected(const SubgraphKey& key) const {
-  return latency_estimator_ ? latency_estimator_->GetExpected(key) : 0;
+int64_t Engine::GetExpected(const SubgraphKey& key, int batch_size) const {
+  return latency_estimator_ ? latency_estimator_->GetExpected(key, batch_size)
+                            : 0;
 }
 
 int64_t Engine::GetWorst(ModelId model_id) const {
@@ -931,24 +1569,52 @@ int64_t Engine::GetWorst(ModelId model_id) const {
 void Engine::Trigger() { planner_->Trigger(); }
 
 int Engine::EnqueueRequest(Job job, bool push_front) {
-  return planner_->EnqueueRequest(job, push_front);
+  return planner_->EnqueueRequest(std::move(job), push_front);
 }
 
 std::vector<int> Engine::EnqueueBatch(std::vector<Job> jobs, bool push_front) {
-  return planner_->EnqueueBatch(jobs, push_front);
+  return planner_->EnqueueBatch(std::move(jobs), push_front);
 }
 
 void Engine::PrepareReenqueue(Job& job) { planner_->PrepareReenqueue(job); }
 
-void Engine::EnqueueFinishedJob(Job& job) { planner_->EnqueueFinishedJob(job); }
+void Engine::ReenqueueBatch(const std::vector<JobHandle>& jobs) {
+  planner_->ReenqueueBatch(jobs);
+}
+
+void Engine::EnqueueFinishedJob(JobHandle job) {
+  // Model inputs are no longer needed once the request is finished
+  const Job* finished_job = job.Get();
+  const bool is_finished =
+      finished_job != nullptr && (IsEnd(finished_job->subgraph_key) ||
+                                  finished_job->status != JobStatus::kSuccess);
+  if (is_finished) {
+    ReleaseInputHandle(*finished_job);
+  }
+  // Following subgraphs of the request read the outputs of the subgraph
+  if (subgraph_config_.lazy_subgraphs && finished_job != nullptr) {
+    if (is_finished) {
+      for (const SubgraphKey& key : finished_job->previous_subgraph_keys) {
+        PinSubgraph(key, -1);
+      }
+    } else {
+      PinSubgraph(finished_job->subgraph_key, 1);
+    }
+  }
+  planner_->EnqueueFinishedJob(job);
+}
 
 bool Engine::EnqueueToWorker(const ScheduleAction& action) {
-  return EnqueueToWorkerBatch(std::vector<ScheduleAction>{action});
+  return planner_->EnqueueToWorker(action);
 }
 
 bool Engine::EnqueueToWorkerBatch(
     const std::vector<ScheduleAction>& schedule_action) {
-  return planner_->EnqueueToWorker(schedule_action);
+  bool success = true;
+  for (const ScheduleAction& action : schedule_action) {
+    success &= planner_->EnqueueToWorker(action);
+  }
+  return success;
 }
 
 const Worker* Engine::GetWorker(WorkerId id) const {
@@ -967,111 +1633,766 @@ Worker* Engine::GetWorker(WorkerId id) {
   }
 }
 
+std::shared_lock<std::shared_mutex> Engine::LockIOBindings() {
+  return std::shared_lock<std::shared_mutex>(io_bindings_mtx_);
+}
+
 absl::Status Engine::TryCopyInputTensors(const Job& job) {
+  if (job.batch_size > 1) {
+    return CopyBatchedInputTensors(job);
+  }
+
+  std::shared_lock<std::shared_mutex> io_tables_lock(io_tables_mtx_,
+                                                     std::defer_lock);
+  if (subgraph_config_.lazy_subgraphs) {
+    RETURN_IF_ERROR(MaterializeSubgraph(job.subgraph_key, true));
+    io_tables_lock.lock();
+  }
+
   // Skip all tensor communication for compute only case.
-  if (job.input_handle < 0) {
+  if (job.input_handle < 0 && !job.io_bound) {
     return absl::OkStatus();
   }
 
-  const SubgraphKey& key = job.subgraph_key;
-  auto model_executor = GetModelExecutor(job.subgraph_key);
-  std::set<int> unresolved_tensors(model_executor->GetInputs(key).begin(),
-                                   model_executor->GetInputs(key).end());
+  auto table_it = subgraph_io_tables_.find(job.subgraph_key);
+  if (table_it == subgraph_io_tables_.end()) {
+    return absl::InternalError(absl::StrFormat(
+        "Failed to find I/O table for %s", job.subgraph_key.ToString()));
+  }
+  const SubgraphIOTable& table = table_it->second;
 
   // Intermediate tensor communication
-  for (auto subgraph_it = job.previous_subgraph_keys.cbegin();
-       subgraph_it != job.previous_subgraph_keys.cend(); ++subgraph_it) {
-    SubgraphKey preceded_subgraph_key = *subgraph_it;
-    auto preceded_model_executor = GetModelExecutor(preceded_subgraph_key);
-
-    for (int tensor_index :
-         preceded_model_executor->GetOutputs(preceded_subgraph_key)) {
-      if (unresolved_tensors.find(tensor_index) != unresolved_tensors.end()) {
-        std::shared_ptr<interface::ITensorView> src =
-            preceded_model_executor->GetTensorView(preceded_subgraph_key,
-                                                   tensor_index);
-        std::shared_ptr<interface::ITensorView> dst =
-            model_executor->GetTensorView(key, tensor_index);
-
-        if (!dst->CopyDataFrom(src.get()).ok()) {
-          return absl::InternalError(
-              absl::StrFormat("Tensor data copy failure from %s to %s",
-                              src->GetName(), dst->GetName()));
+  size_t num_resolved_tensors = 0;
+  for (const SubgraphKey& preceded_subgraph_key : job.previous_subgraph_keys) {
+    auto copies_it = table.from_predecessors.find(preceded_subgraph_key);
+    if (copies_it == table.from_predecessors.end()) {
+      continue;
+    }
+    for (const TensorCopy& copy : copies_it->second) {
+      memcpy(copy.dst, copy.src, copy.bytes);
+      tensor_copy_bytes_.Increment(copy.bytes);
+    }
+    num_resolved_tensors += copies_it->second.size();
+  }
+
+  if (num_resolved_tensors != table.num_intermediate_inputs) {
+    return absl::InternalError("Some tensors fail to be resolved.");
+  }
+
+  // Copy model input
+  if (job.io_bound) {
+    if (model_io_bindings_.find(job.model_id) == model_io_bindings_.end()) {
+      return absl::InternalError(absl::StrFormat(
+          "Failed to find bound input tensors for model %d", job.model_id));
+    }
+    // Only subgraphs that could not be bound copy
+    for (const TensorCopy& copy : table.bound_inputs) {
+      memcpy(copy.dst, copy.src, copy.bytes);
+      tensor_copy_bytes_.Increment(copy.bytes);
+    }
+    return absl::OkStatus();
+  }
+
+  auto buffer_it = model_input_buffer_.find(job.model_id);
+  if (buffer_it == model_input_buffer_.end()) {
+    return absl::InternalError(absl::StrFormat(
+        "Failed to find input tensor ring buffer for model %d", job.model_id));
+  }
+
+  const TensorRingBuffer* input_buffer = buffer_it->second.get();
+  for (const SlotCopy& copy : table.model_inputs) {
+    const char* src =
+        input_buffer->GetTensorData(job.input_handle, copy.buffer_index);
+    if (src == nullptr) {
+      return absl::InternalError(absl::StrFormat(
+          "Failed to copy input tensor %d for model %d (handle %d)",
+          copy.buffer_index, job.model_id, job.input_handle));
+    }
+    memcpy(copy.tensor_data, src, copy.bytes);
+    tensor_copy_bytes_.Increment(copy.bytes);
+  }
+
+  return absl::OkStatus();
+}
+
+absl::Status Engine::TryCopyOutputTensors(const Job& job) {
+  if (job.batch_size > 1) {
+    return CopyBatchedOutputTensors(job);
+  }
+
+  // Compute only.
+  if (job.output_handle < 0 && !job.io_bound) {
+    return absl::OkStatus();
+  }
+
+  std::shared_lock<std::shared_mutex> io_tables_lock(io_tables_mtx_,
+                                                     std::defer_lock);
+  if (subgraph_config_.lazy_subgraphs) {
+    io_tables_lock.lock();
+  }
+
+  auto table_it = subgraph_io_tables_.find(job.subgraph_key);
+  if (table_it == subgraph_io_tables_.end()) {
+    return absl::InternalError(absl::StrFormat(
+        "Failed to find I/O table for %s", job.subgraph_key.ToString()));
+  }
+  const SubgraphIOTable& table = table_it->second;
+
+  if (job.io_bound) {
+    if (model_io_bindings_.find(job.model_id) == model_io_bindings_.end()) {
+      return absl::InternalError(absl::StrFormat(
+          "Failed to find bound output tensors for model %d", job.model_id));
+    }
+    // Only subgraphs that could not be bound copy
+    for (const TensorCopy& copy : table.bound_outputs) {
+      memcpy(copy.dst, copy.src, copy.bytes);
+      tensor_copy_bytes_.Increment(copy.bytes);
+    }
+    return absl::OkStatus();
+  }
+
+  auto buffer_it = model_output_buffer_.find(job.model_id);
+  if (buffer_it == model_output_buffer_.end()) {
+    return absl::InternalError(absl::StrFormat(
+        "Failed to find output tensor ring buffer for model %d", job.model_id));
+  }
+
+  const TensorRingBuffer* output_buffer = buffer_it->second.get();
+  for (const SlotCopy& copy : table.model_outputs) {
+    char* dst =
+        output_buffer->GetTensorData(job.output_handle, copy.buffer_index);
+    if (dst == nullptr) {
+      return absl::InternalError(absl::StrFormat(
+          "Failed to copy output tensor %d for model %d (handle %d)",
+          copy.buffer_index, job.model_id, job.output_handle));
+    }
+    memcpy(dst, copy.tensor_data, copy.bytes);
+    tensor_copy_bytes_.Increment(copy.bytes);
+  }
+
+  return absl::OkStatus();
+}
+
+absl::Status Engine::BuildSubgraphIOTables(ModelId model_id) {
+  auto input_buffer_it = model_input_buffer_.find(model_id);
+  auto output_buffer_it = model_output_buffer_.find(model_id);
+  if (input_buffer_it == model_input_buffer_.end() ||
+      output_buffer_it == model_output_buffer_.end()) {
+    return absl::InternalError(absl::StrFormat(
+        "Failed to find tensor ring buffers for model %d", model_id));
+  }
+  const TensorRingBuffer* input_buffer = input_buffer_it->second.get();
+  const TensorRingBuffer* output_buffer = output_buffer_it->second.get();
+  const IOBinding* binding = model_io_bindings_.find(model_id) !=
+                                     model_io_bindings_.end()
+                                 ? &model_io_bindings_.at(model_id)
+                                 : nullptr;
+
+  std::vector<std::pair<interface::IModelExecutor*, SubgraphKey>> subgraphs;
+  for (auto& it : model_executors_) {
+    if (it.first.first != model_id) {
+      continue;
+    }
+    interface::IModelExecutor* model_executor = it.second.get();
+    model_executor->ForEachSubgraph([&](const SubgraphKey& key) {
+      if (model_executor->IsMaterialized(key)) {
+        subgraphs.push_back({model_executor, key});
+      }
+    });
+  }
+
+  std::unordered_map<SubgraphKey, SubgraphIOTable, SubgraphHash> tables;
+  for (auto& subgraph : subgraphs) {
+    interface::IModelExecutor* model_executor = subgraph.first;
+    const SubgraphKey& key = subgraph.second;
+    SubgraphIOTable table;
+
+    for (int tensor_index : model_executor->GetInputs(key)) {
+      auto tensor = model_executor->GetTensorView(key, tensor_index);
+      const int buffer_index = input_buffer->GetBufferIndex(tensor_index);
+      if (buffer_index < 0) {
+        table.num_intermediate_inputs++;
+        continue;
+      }
+      table.model_inputs.push_back(
+          {buffer_index, tensor->GetData(), tensor->GetBytes()});
+      if (binding &&
+          tensor->GetData() != binding->inputs.at(tensor_index)->GetData()) {
+        table.bound_inputs.push_back(
+            {binding->inputs.at(tensor_index)->GetData(), tensor->GetData(),
+             tensor->GetBytes()});
+      }
+    }
+
+    for (int tensor_index : model_executor->GetOutputs(key)) {
+      auto tensor = model_executor->GetTensorView(key, tensor_index);
+      const int buffer_index = output_buffer->GetBufferIndex(tensor_index);
+      if (buffer_index < 0) {
+        continue;
+      }
+      table.model_outputs.push_back(
+          {buffer_index, tensor->GetData(), tensor->GetBytes()});
+      if (binding &&
+          tensor->GetData() != binding->outputs.at(tensor_index)->GetData()) {
+        table.bound_outputs.push_back(
+            {tensor->GetData(), binding->outputs.at(tensor_index)->GetData(),
+             tensor->GetBytes()});
+      }
+    }
+
+    // Any other subgraph of the model may have run before this one
+    const std::vector<int>& inputs = model_executor->GetInputs(key);
+    for (auto& predecessor : subgraphs) {
+      interface::IModelExecutor* preceded_model_executor = predecessor.first;
+      const SubgraphKey& preceded_key = predecessor.second;
+      if (preceded_key == key) {
+        continue;
+      }
+
+      std::vector<TensorCopy> copies;
+      for (int tensor_index :
+           preceded_model_executor->GetOutputs(preceded_key)) {
+        if (std::find(inputs.begin(), inputs.end(), tensor_index) ==
+                inputs.end() ||
+            input_buffer->GetBufferIndex(tensor_index) >= 0) {
+          continue;
+        }
+        auto src =
+            preceded_model_executor->GetTensorView(preceded_key, tensor_index);
+        auto dst = model_executor->GetTensorView(key, tensor_index);
+        if (src->GetBytes() != dst->GetBytes()) {
+          return absl::InternalError(absl::StrFormat(
+              "Tensor %d size mismatch between %s (%d) and %s (%d)",
+              tensor_index, preceded_key.ToString(), src->GetBytes(),
+              key.ToString(), dst->GetBytes()));
         }
+        copies.push_back({src->GetData(), dst->GetData(), dst->GetBytes()});
+      }
 
-        unresolved_tensors.erase(tensor_index);
+      if (!copies.empty()) {
+        table.from_predecessors[preceded_key] = std::move(copies);
       }
     }
+
+    tables[key] = std::move(table);
   }
 
-  if (model_input_buffer_.find(job.model_id) == model_input_buffer_.end()) {
+  std::unique_lock<std::shared_mutex> io_tables_lock(io_tables_mtx_,
+                                                     std::defer_lock);
+  if (subgraph_config_.lazy_subgraphs) {
+    io_tables_lock.lock();
+  }
+  // Drop the tables of evicted subgraphs
+  for (auto it = subgraph_io_tables_.begin();
+       it != subgraph_io_tables_.end();) {
+    (it->first.GetModelId() == model_id) ? subgraph_io_tables_.erase(it++)
+                                         : (++it);
+  }
+  for (auto& it : tables) {
+    subgraph_io_tables_[it.first] = std::move(it.second);
+  }
+  return absl::OkStatus();
+}
+
+absl::Status Engine::VerifySubgraph(const SubgraphKey& key,
+                                    const std::set<int>& op_indices) const {
+  const interface::IModelExecutor* model_executor = GetModelExecutor(key);
+  const ModelSpec& model_spec = model_specs_.at(key.GetModelId());
+  const std::set<int> inputs = model_spec.GetPureInputTensors(op_indices);
+  const std::set<int> all_outputs = model_spec.GetOutputTensors(op_indices);
+
+  if (!std::equal(model_executor->GetInputs(key).begin(),
+                  model_executor->GetInputs(key).end(), inputs.begin())) {
     return absl::InternalError(absl::StrFormat(
-        "Failed to find input tensor ring buffer for model %d", job.model_id));
+        "Input format is not correct for worker %d", key.GetWorkerId()));
+  }
+  if (!std::includes(all_outputs.begin(), all_outputs.end(),
+                     model_executor->GetOutputs(key).begin(),
+                     model_executor->GetOutputs(key).end())) {
+    return absl::InternalError(absl::StrFormat(
+        "Output format is not correct for worker %d", key.GetWorkerId()));
   }
+  return absl::OkStatus();
+}
 
-  auto input_buffer = model_input_buffer_[job.model_id].get();
+absl::Status Engine::BindSubgraphTensors(
+    interface::IModelExecutor* model_executor, const SubgraphKey& key,
+    const IOBinding& binding, int& num_bound, int& num_fallback) {
+  std::vector<int> bound_indices;
+  int num_tensors = 0;
+  bool bind_failed = false;
+  for (const std::vector<int>* indices :
+       {&model_executor->GetInputs(key), &model_executor->GetOutputs(key)}) {
+    for (int tensor_index : *indices) {
+      interface::ITensor* tensor = nullptr;
+      if (binding.inputs.find(tensor_index) != binding.inputs.end()) {
+        tensor = binding.inputs.at(tensor_index);
+      } else if (binding.outputs.find(tensor_index) != binding.outputs.end()) {
+        tensor = binding.outputs.at(tensor_index);
+      } else {
+        continue;
+      }
+      num_tensors++;
+      if (bind_failed) {
+        // The subgraph copies all of its tensors
+        continue;
+      }
 
-  // Copy model input
-  for (auto tensor_it = unresolved_tensors.begin();
-       tensor_it != unresolved_tensors.end();) {
-    int tensor_index = *tensor_it;
-    if (input_buffer->IsTensorIndexValid(tensor_index)) {
-      if (!input_buffer
-               ->GetTensorFromHandle(
-                   model_executor->GetTensorView(key, tensor_index).get(),
-                   tensor_index, job.input_handle)
-               .ok()) {
-        return absl::InternalError(
-            absl::StrFormat("Failed to copy input tensor %d for model %d",
-                            tensor_index, job.model_id));
+      auto status = model_executor->BindTensor(
+          key, tensor_index, tensor->GetData(), tensor->GetBytes());
+      if (status.ok()) {
+        bound_indices.push_back(tensor_index);
+      } else {
+        bind_failed = true;
+        BAND_LOG_DEBUG("Fallback to copy for tensor %d of %s: %s",
+                       tensor_index, key.ToString().c_str(),
+                       status.ToString().c_str());
       }
-      tensor_it = unresolved_tensors.erase(tensor_it);
-    } else {
-      ++tensor_it;
     }
   }
 
-  if (!unresolved_tensors.empty()) {
-    return absl::InternalError("Some tensors fail to be resolved.");
+  if (!bind_failed) {
+    num_bound += num_tensors;
+    return absl::OkStatus();
   }
 
+  // Roll back the tensors bound before the failure
+  num_fallback += num_tensors;
+  for (int tensor_index : bound_indices) {
+    auto status = model_executor->UnbindTensor(key, tensor_index);
+    if (!status.ok()) {
+      return absl::InternalError(absl::StrFormat(
+          "Failed to roll back the binding of tensor %d of %s: %s",
+          tensor_index, key.ToString(), status.ToString()));
+    }
+  }
   return absl::OkStatus();
 }
 
-absl::Status Engine::TryCopyOutputTensors(const Job& job) {
-  // TODO: Subgraph execution
+absl::Status Engine::UnbindSubgraphTensors(
+    interface::IModelExecutor* model_executor, const SubgraphKey& key,
+    const IOBinding& binding) {
+  absl::Status status = absl::OkStatus();
+  for (const auto* tensors : {&binding.inputs, &binding.outputs}) {
+    for (const auto& tensor : *tensors) {
+      // Only release tensors that actually point to the caller memory
+      if (model_executor->GetTensorView(key, tensor.first)->GetData() ==
+          tensor.second->GetData()) {
+        auto unbind_status = model_executor->UnbindTensor(key, tensor.first);
+        if (!unbind_status.ok()) {
+          status = unbind_status;
+        }
+      }
+    }
+  }
+  return status;
+}
 
-  // Compute only.
-  if (job.output_handle < 0) {
+absl::Status Engine::MaterializeSubgraph(const SubgraphKey& key,
+                                         bool allow_eviction) {
+  auto residency_it = subgraph_residency_.find(key);
+  if (residency_it == subgraph_residency_.end()) {
+    return absl::NotFoundError(
+        absl::StrFormat("Cannot find lazy subgraph %s", key.ToString()));
+  }
+  SubgraphResidency& residency = *residency_it->second;
+  residency.last_use.store(
+      residency_ticks_.fetch_add(1, std::memory_order_relaxed) + 1,
+      std::memory_order_relaxed);
+  if (residency.is_materialized.load(std::memory_order_acquire)) {
     return absl::OkStatus();
   }
 
-  const SubgraphKey& key = job.subgraph_key;
-  auto model_executor = GetModelExecutor(job.subgraph_key);
+  std::lock_guard<std::mutex> lock(residency_mtx_);
+  if (residency.is_materialized.load(std::memory_order_relaxed)) {
+    return absl::OkStatus();
+  }
 
-  if (model_output_buffer_.find(job.model_id) == model_output_buffer_.end()) {
+  interface::IModelExecutor* model_executor = GetModelExecutor(key);
+  RETURN_IF_ERROR(model_executor->MaterializeSubgraph(key));
+  {
+    auto status = VerifySubgraph(key, residency.op_indices);
+    if (!status.ok()) {
+      model_executor->EvictSubgraph(key).IgnoreError();
+      return status;
+    }
+  }
+  auto binding_it = model_io_bindings_.find(key.GetModelId());
+  if (binding_it != model_io_bindings_.end()) {
+    int num_bound = 0;
+    int num_fallback = 0;
+    auto status = BindSubgraphTensors(model_executor, key, binding_it->second,
+                                      num_bound, num_fallback);
+    if (!status.ok()) {
+      model_executor->EvictSubgraph(key).IgnoreError();
+      return status;
+    }
+  }
+  residency.bytes = model_executor->GetMemoryFootprint(key);
+  residency.is_materialized.store(true, std::memory_order_release);
+  subgraph_materializations_.Increment();
+  BAND_LOG(LogSeverity::kInternal, "Materialized subgraph %s (%d bytes)",
+           key.ToString().c_str(), residency.bytes);
+
+  // Models whose subgraphs changed
+  std::set<ModelId> models = {key.GetModelId()};
+  if (allow_eviction && subgraph_config_.subgraph_memory_budget > 0) {
+    size_t worker_bytes = 0;
+    for (const auto& it : subgraph_residency_) {
+      if (it.first.GetWorkerId() == key.GetWorkerId() &&
+          it.second->is_materialized.load(std::memory_order_relaxed)) {
+        worker_bytes += it.second->bytes;
+      }
+    }
+
+    while (worker_bytes > subgraph_config_.subgraph_memory_budget) {
+      // least recently used one that no request needs
+      std::pair<const SubgraphKey, std::unique_ptr<SubgraphResidency>>*
+          victim = nullptr;
+      for (auto& it : subgraph_residency_) {
+        const SubgraphResidency& candidate = *it.second;
+        if (it.first.GetWorkerId() != key.GetWorkerId() || it.first == key ||
+            candidate.is_primary ||
+            !candidate.is_materialized.load(std::memory_order_relaxed) ||
+            candidate.num_pins.load(std::memory_order_acquire) > 0) {
+          continue;
+        }
+        if (victim == nullptr ||
+            candidate.last_use.load(std::memory_order_relaxed) <
+                victim->second->last_use.load(std::memory_order_relaxed)) {
+          victim = &it;
+        }
+      }
+      if (victim == nullptr) {
+        break;
+      }
+
+      SubgraphResidency& evicted = *victim->second;
+      auto status =
+          GetModelExecutor(victim->first)->EvictSubgraph(victim->first);
+      if (!status.ok()) {
+        // e.g., the backend does not support eviction
+        BAND_LOG(LogSeverity::kWarning, "Failed to evict subgraph %s: %s",
+                 victim->first.ToString().c_str(), status.ToString().c_str());
+        break;
+      }
+      evicted.is_materialized.store(false, std::memory_order_release);
+      worker_bytes -= evicted.bytes;
+      evicted.bytes = 0;
+      subgraph_evictions_.Increment();
+      models.insert(victim->first.GetModelId());
+      BAND_LOG(LogSeverity::kInternal, "Evicted subgraph %s",
+               victim->first.ToString().c_str());
+    }
+  }
+
+  for (ModelId model_id : models) {
+    RETURN_IF_ERROR(BuildSubgraphIOTables(model_id));
+  }
+  return absl::OkStatus();
+}
+
+void Engine::PinSubgraph(const SubgraphKey& key, int delta) {
+  auto it = subgraph_residency_.find(key);
+  if (it != subgraph_residency_.end()) {
+    it->second->num_pins.fetch_add(delta, std::memory_order_acq_rel);
+  }
+}
+
+void Engine::ReleaseInputHandle(const Job& job) {
+  auto buffer_it = model_input_buffer_.find(job.model_id);
+  if (buffer_it == model_input_buffer_.end()) {
+    return;
+  }
+  auto release = [&buffer_it](int input_handle) {
+    if (input_handle >= 0) {
+      // Fails only for already released handles, which is safe to ignore
+      buffer_it->second->Release(input_handle).IgnoreError();
+    }
+  };
+  // A batched job holds the inputs of all of its requests
+  if (job.batch_size > 1) {
+    for (int input_handle : job.batch_input_handles) {
+      release(input_handle);
+    }
+  } else {
+    release(job.input_handle);
+  }
+}
+
+void Engine::BuildSubgraphTable(
+    ModelId model_id, const std::vector<SubgraphDef>& subgraph_defs) {
+  SubgraphTable table;
+  table.model_id = model_id;
+  const size_t num_unit_subgraphs =
+      model_specs_.at(model_id).GetNumUnitSubgraphs();
+  table.num_unit_subgraphs = num_unit_subgraphs;
+
+  // Subgraphs per (start, end) unit subgraph, in the order of definition
+  std::vector<std::vector<SubgraphKey>> ranges(num_unit_subgraphs *
+                                               num_unit_subgraphs);
+  for (const SubgraphDef& subgraph_def : subgraph_defs) {
+    const SubgraphKey key = {model_id, subgraph_def.worker_id,
+                             subgraph_def.unit_subgraph_indices};
+    if (subgraph_def.unit_subgraph_indices.empty() || !HasSubgraph(key)) {
+      continue;
+    }
+    ranges[*subgraph_def.unit_subgraph_indices.begin() * num_unit_subgraphs +
+           *subgraph_def.unit_subgraph_indices.rbegin()]
+        .push_back(key);
+  }
+  for (const std::vector<SubgraphKey>& range : ranges) {
+    table.range_offsets.push_back(table.range_keys.size());
+    table.range_keys.insert(table.range_keys.end(), range.begin(),
+                            range.end());
+  }
+  table.range_offsets.push_back(table.range_keys.size());
+
+  auto bit_mask_comparator = [](const BitMask& lhs, const BitMask& rhs) {
+    return lhs.to_ullong() < rhs.to_ullong();
+  };
+  // Visit the states reachable from the beginning of the model
+  table.state_indices[BitMask()] = 0;
+  table.state_masks.push_back(BitMask());
+  for (size_t state = 0; state < table.state_masks.size(); state++) {
+    const BitMask resolved_unit_subgraphs = table.state_masks[state];
+    table.group_offsets.push_back(table.groups.size());
+
+    // group by unit indices
+    std::map<BitMask, std::vector<SubgraphKey>, decltype(bit_mask_comparator)>
+        unit_indices_subgraphs(bit_mask_comparator);
+    for (const SubgraphKey& key :
+         GetSubgraphCandidates(model_id, resolved_unit_subgraphs)) {
+      unit_indices_subgraphs[key.GetUnitIndices()].push_back(key);
+    }
+
+    for (const auto& it : unit_indices_subgraphs) {
+      SubgraphTable::CandidateGroup group;
+      group.keys_begin = table.group_keys.size();
+      table.group_keys.insert(table.group_keys.end(), it.second.begin(),
+                              it.second.end());
+      group.keys_end = table.group_keys.size();
+      group.next_state = -1;
+      if (!IsEnd(it.second.front())) {
+        const BitMask next_mask = resolved_unit_subgraphs | it.first;
+        auto state_it = table.state_indices.find(next_mask);
+        if (state_it == table.state_indices.end()) {
+          state_it = table.state_indices
+                         .emplace(next_mask, table.state_masks.size())
+                         .first;
+          table.state_masks.push_back(next_mask);
+        }
+        group.next_state = state_it->second;
+      }
+      table.groups.push_back(group);
+    }
+  }
+  table.group_offsets.push_back(table.groups.size());
+
+  subgraph_tables_[model_id] = std::move(table);
+}
+
+absl::Status Engine::PrepareBatchedSubgraphs(
+    Model* model, BackendType backend_type,
+    const std::vector<SubgraphDef>& subgraph_defs) {
+  // A batch runs the whole model at once, which fallback schedulers split
+  if (max_batch_size_ <= 1 || planner_->NeedFallbackSubgraphs()) {
+    return absl::OkStatus();
+  }
+
+  // Powers of two up to the maximum, to bound the number of copies
+  const ModelId model_id = model->GetId();
+  std::vector<int> batch_sizes;
+  for (int batch_size = 2; batch_size < max_batch_size_; batch_size *= 2) {
+    batch_sizes.push_back(batch_size);
+  }
+  batch_sizes.push_back(max_batch_size_);
+
+  for (const SubgraphDef& subgraph_def : subgraph_defs) {
+    const SubgraphKey key = {model_id, subgraph_def.worker_id,
+                             subgraph_def.unit_subgraph_indices};
+    if (!IsBegin(key) || !IsEnd(key)) {
+      continue;
+    }
+    for (auto it = batch_sizes.begin(); it != batch_sizes.end();) {
+      auto status =
+          PrepareBatchedSubgraph(model, backend_type, subgraph_def, *it);
+      if (status.ok()) {
+        ++it;
+      } else {
+        BAND_LOG(LogSeverity::kWarning,
+                 "Requests for model %d are not batched by %d: %s", model_id,
+                 *it, status.ToString().c_str());
+        it = batch_sizes.erase(it);
+      }
+    }
+  }
+
+  // Schedulers may pick any worker for a batch, so only keep the batch sizes
+  // that all the workers of the model support
+  for (auto it = batched_subgraphs_.begin(); it != batched_subgraphs_.end();) {
+    (std::get<0>(it->first) == model_id &&
+     std::find(batch_sizes.begin(), batch_sizes.end(),
+               std::get<2>(it->first)) == batch_sizes.end())
+        ? batched_subgraphs_.erase(it++)
+        : (++it);
+  }
+  return absl::OkStatus();
+}
+
+absl::Status Engine::PrepareBatchedSubgraph(Model* model,
+                                            BackendType backend_type,
+                                            const SubgraphDef& subgraph_def,
+                                            int batch_size) {
+  const ModelId model_id = model->GetId();
+  const WorkerId worker_id = subgraph_def.worker_id;
+  const SubgraphKey key = {model_id, worker_id,
+                           subgraph_def.unit_subgraph_indices};
+  interface::IModelExecutor* model_executor = GetModelExecutor(key);
+  const Worker* worker = GetWorker(worker_id);
+  if (model_executor == nullptr || worker == nullptr) {
+    return absl::InternalError(
+        absl::StrFormat("Failed to find subgraph %s", key.ToString()));
+  }
+
+  BatchedSubgraph batched_subgraph;
+  batched_subgraph.key = key;
+  batched_subgraph.model_executor.reset(BackendFactory::CreateModelExecutor(
+      backend_type, model_id, worker_id, GetWorkerDevice(worker_id),
+      worker->GetWorkerThreadAffinity(), worker->GetNumThreads()));
+  interface::IModelExecutor* batched_model_executor =
+      batched_subgraph.model_executor.get();
+  if (batched_model_executor == nullptr) {
     return absl::InternalError(absl::StrFormat(
-        "Failed to find output tensor ring buffer for model %d", job.model_id));
+        "Failed to create model executor for %s", key.ToString()));
   }
+  batched_model_executor->SetClock(clock_);
+  RETURN_IF_ERROR(batched_model_executor->PrepareSubgraph(
+      model->GetBackendModel(backend_type), subgraph_def.op_indices,
+      subgraph_def.unit_subgraph_indices));
+  RETURN_IF_ERROR(batched_model_executor->ResizeBatch(key, batch_size));
+
+  // Each request must take an equal slice of a model input / output
+  auto add_slot_copies = [&](const std::vector<int>& tensor_indices,
+                             const TensorRingBuffer* buffer,
+                             std::vector<SlotCopy>& copies) -> absl::Status {
+    for (int tensor_index : tensor_indices) {
+      auto tensor = batched_model_executor->GetTensorView(key, tensor_index);
+      const size_t bytes =
+          model_executor->GetTensorView(key, tensor_index)->GetBytes();
+      const int buffer_index = buffer->GetBufferIndex(tensor_index);
+      if (buffer_index < 0 || tensor->GetBytes() != bytes * batch_size) {
+        return absl::InternalError(absl::StrFormat(
+            "Tensor %d of %s is not batched along dimension 0", tensor_index,
+            key.ToString()));
+      }
+      copies.push_back({buffer_index, tensor->GetData(), bytes});
+    }
+    return absl::OkStatus();
+  };
+  RETURN_IF_ERROR(add_slot_copies(batched_model_executor->GetInputs(key),
+                                  model_input_buffer_.at(model_id).get(),
+                                  batched_subgraph.model_inputs));
+  RETURN_IF_ERROR(add_slot_copies(batched_model_executor->GetOutputs(key),
+                                  model_output_buffer_.at(model_id).get(),
+                                  batched_subgraph.model_outputs));
+
+  batched_subgraphs_[{model_id, worker_id, batch_size}] =
+      std::move(batched_subgraph);
+  return absl::OkStatus();
+}
 
-  auto output_buffer = model_output_buffer_[job.model_id].get();
-  for (int tensor_index : model_executor->GetOutputs(key)) {
-    if (output_buffer->IsTensorIndexValid(tensor_index)) {
-      if (!output_buffer
-               ->PutTensorToHandle(
-                   model_executor->GetTensorView(key, tensor_index).get(),
-                   tensor_index, job.output_handle)
-               .ok()) {
-        return absl::InternalError(
-            absl::StrFormat("Failed to copy output tensor %d for model %d",
-                            tensor_index, job.model_id));
+absl::Status Engine::CopyBatchedInputTensors(const Job& job) {
+  auto batched_it = batched_subgraphs_.find(
+      {job.model_id, job.subgraph_key.GetWorkerId(), job.batch_size});
+  auto buffer_it = model_input_buffer_.find(job.model_id);
+  if (batched_it == batched_subgraphs_.end() ||
+      batched_it->second.key != job.subgraph_key ||
+      buffer_it == model_input_buffer_.end() ||
+      job.batch_input_handles.size() != job.batch_size) {
+    return absl::InternalError(absl::StrFormat(
+        "Failed to find batched subgraph %s (batch size %d)",
+        job.subgraph_key.ToString(), job.batch_size));
+  }
+
+  const TensorRingBuffer* input_buffer = buffer_it->second.get();
+  for (int i = 0; i < job.batch_size; i++) {
+    const int input_handle = job.batch_input_handles[i];
+    // Compute only
+    if (input_handle < 0) {
+      continue;
+    }
+    for (const SlotCopy& copy : batched_it->second.model_inputs) {
+      const char* src =
+          input_buffer->GetTensorData(input_handle, copy.buffer_index);
+      if (src == nullptr) {
+        return absl::InternalError(absl::StrFormat(
+            "Failed to copy input tensor %d for model %d (handle %d)",
+            copy.buffer_index, job.model_id, input_handle));
       }
+      memcpy(copy.tensor_data + i * copy.bytes, src, copy.bytes);
+      tensor_copy_bytes_.Increment(copy.bytes);
     }
   }
+  return absl::OkStatus();
+}
+
+absl::Status Engine::CopyBatchedOutputTensors(const Job& job) {
+  auto batched_it = batched_subgraphs_.find(
+      {job.model_id, job.subgraph_key.GetWorkerId(), job.batch_size});
+  auto buffer_it = model_output_buffer_.find(job.model_id);
+  if (batched_it == batched_subgraphs_.end() ||
+      batched_it->second.key != job.subgraph_key ||
+      buffer_it == model_output_buffer_.end() ||
+      job.batch_output_handles.size() != job.batch_size) {
+    return absl::InternalError(absl::StrFormat(
+        "Failed to find batched subgraph %s (batch size %d)",
+        job.subgraph_key.ToString(), job.batch_size));
+  }
 
+  const TensorRingBuffer* output_buffer = buffer_it->second.get();
+  for (int i = 0; i < job.batch_size; i++) {
+    const int output_handle = job.batch_output_handles[i];
+    // Compute only
+    if (output_handle < 0) {
+      continue;
+    }
+    for (const SlotCopy& copy : batched_it->second.model_outputs) {
+      char* dst =
+          output_buffer->GetTensorData(output_handle, copy.buffer_index);
+      if (dst == nullptr) {
+        return absl::InternalError(absl::StrFormat(
+            "Failed to copy output tensor %d for model %d (handle %d)",
+            copy.buffer_index, job.model_id, output_handle));
+      }
+      memcpy(dst, copy.tensor_data + i * copy.bytes, copy.bytes);
+      tensor_copy_bytes_.Increment(copy.bytes);
+    }
+  }
   return absl::OkStatus();
 }
 
+void Engine::ReleaseOutputHandle(ModelId model_id, int output_handle) {
+  auto buffer_it = model_output_buffer_.find(model_id);
+  if (output_handle >= 0 && buffer_it != model_output_buffer_.end()) {
+    // Fails only for already released handles, which is safe to ignore
+    buffer_it->second->Release(output_handle).IgnoreError();
+  }
+}
+
+absl::StatusOr<int> Engine::AllocOutputHandle(ModelId model_id) {
+  TensorRingBuffer* output_buffer = model_output_buffer_.at(model_id).get();
+  auto status_or_output_handle = output_buffer->Alloc();
+  while (!status_or_output_handle.ok() &&
+         planner_->ReclaimOutputHandle(model_id)) {
+    status_or_output_handle = output_buffer->Alloc();
+  }
+  if (!status_or_output_handle.ok() && block_on_tensor_pool_full_) {
+    status_or_output_handle = output_buffer->Alloc(true);
+  }
+  return status_or_output_handle;
+}
+
 WorkerId Engine::GetDeviceWorkerId(DeviceFlag flag) const {
   for (WorkerId worker_id = 0; worker_id < workers_.size(); worker_id++) {
     if (workers_[worker_id]->GetDeviceFlag() == flag) {
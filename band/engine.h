@@ -17,10 +17,15 @@
 #ifndef BAND_ENGINE_H_
 #define BAND_ENGINE_H_
 
+#include <atomic>
 #include <deque>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <set>
+#include <shared_mutex>
+#include <tuple>
+#include <unordered_map>
 #include <vector>
 
 #include "band/common.h"
@@ -28,6 +33,7 @@
 #include "band/engine_interface.h"
 #include "band/interface/model_executor.h"
 #include "band/interface/tensor.h"
+#include "band/metrics.h"
 #include "band/tensor_ring_buffer.h"
 
 namespace band {
@@ -35,9 +41,64 @@ namespace band {
 class Model;
 class ModelSpec;
 class LatencyEstimator;
+struct SubgraphDef;
 
 typedef std::vector<interface::ITensor*> Tensors;
 
+// Counters of the cache of shortest latency plans.
+struct LatencyCacheStats {
+  size_t hits = 0;
+  size_t misses = 0;
+  // Entries found stale since the expected latencies of their model drifted
+  size_t invalidations = 0;
+  size_t evictions = 0;
+};
+
+// Counters of the planner thread.
+struct PlannerStats {
+  size_t wakeups = 0;
+  // Wakeups that ran the schedulers
+  size_t scheduling_passes = 0;
+};
+
+// Counters of a worker since the engine started.
+struct WorkerStats {
+  DeviceFlag device_flag;
+  // Successful invokes (a batched invoke counts once) and their total time
+  size_t num_invokes = 0;
+  int64_t busy_time_us = 0;
+};
+
+// Timing of a finished request, in the time of the engine clock. Durations
+// of each stage are summed over the subgraphs of the request.
+struct RequestTimes {
+  ModelId model_id = -1;
+  int64_t enqueue_time = 0;
+  // End of the last invoke
+  int64_t end_time = 0;
+  // When the planner published the completion and started the callbacks
+  int64_t completion_time = 0;
+
+  // Waiting for the planner to send a subgraph to a worker
+  int64_t planner_time = 0;
+  // Waiting in the queue of a worker
+  int64_t worker_queue_time = 0;
+  int64_t input_copy_time = 0;
+  // Time spent in invokes
+  int64_t execution_time = 0;
+  int64_t output_copy_time = 0;
+  // Time spent in the `SetOnEndRequest` callbacks. Only available after they
+  // return, so always 0 when read from within a callback.
+  int64_t callback_time = 0;
+
+  int64_t GetLatency() const { return end_time - enqueue_time; }
+  // Time spent in the planner and worker queues and in tensor copies
+  int64_t GetQueueingTime() const { return GetLatency() - execution_time; }
+  // From the end of the last invoke to the completion, including the output
+  // copy of the last subgraph and the handover to the planner
+  int64_t GetCompletionTime() const { return completion_time - end_time; }
+};
+
 /**
  * @brief The main entry point of the `Band`.
  * Public methods define an interface for
@@ -68,7 +129,16 @@ class Engine : public IEngine {
   ~Engine() override;
   static std::unique_ptr<Engine> Create(const RuntimeConfig& config);
 
-  absl::Status RegisterModel(Model* model);
+  // `tensor_pool_size` overrides `RuntimeConfig::tensor_pool_size` for the
+  // input / output tensor slots of this model if positive.
+  absl::Status RegisterModel(Model* model, int tensor_pool_size = -1);
+  // Registers several models at once. The models are analyzed in parallel,
+  // then prepared and profiled one after another, each in parallel across
+  // the workers. Either all the models are registered, or none of them: if
+  // a model fails, the models of the batch prepared before it are
+  // unregistered again.
+  absl::Status RegisterModels(const std::vector<Model*>& models,
+                              int tensor_pool_size = -1);
   absl::Status UnregisterModel(Model* model);
 
   Tensor* CreateTensor(ModelId model_id, int tensor_index);
@@ -94,35 +164,103 @@ class Engine : public IEngine {
       std::vector<ModelId> model_ids, std::vector<RequestOption> options = {},
       std::vector<Tensors> inputs = {});
 
+  // A request holds an input / output tensor slot of its model until its
+  // outputs are read, either by `Wait` (with or without output tensors) or
+  // by `GetOutputTensors`. Outputs can be read only once; reading them again
+  // (also after a `Wait` without output tensors) fails. Outputs that are
+  // never read are released when a request finds the pool of the model full
+  // (oldest first, once the `SetOnEndRequest` callbacks of the request have
+  // returned), or when its completion record is reused by a newer request.
   absl::Status Wait(JobId job_id, Tensors outputs = {});
   absl::Status Wait(std::vector<JobId> job_ids,
                     std::vector<Tensors> outputs = {});
+  // Same as `Wait`, but returns DeadlineExceeded if the job is not finished
+  // within `timeout_us`. The outputs are not read on timeout.
+  absl::Status WaitFor(JobId job_id, int64_t timeout_us, Tensors outputs = {});
+  // Waits until any of the jobs is finished and returns its id, without
+  // reading its outputs. A negative `timeout_us` waits indefinitely.
+  absl::StatusOr<JobId> WaitAny(const std::vector<JobId>& job_ids,
+                                int64_t timeout_us = -1);
   void WaitAll();
-  absl::Status GetOutputTensors(JobId job_id, Tensors outputs = {});
+  // Also returns the timing of the request in `times`, if not null.
+  absl::Status GetOutputTensors(JobId job_id, Tensors outputs = {},
+                                RequestTimes* times = nullptr);
+
+  // Zero-copy I/O binding (opt-in). Registers caller-owned `inputs` and
+  // `outputs` as the I/O memory of the model and binds them directly to the
+  // backend tensors of its subgraphs. Requests for the model with
+  // `RequestOption::use_bound_tensors` then read the bound inputs and write
+  // the bound outputs, bypassing the tensor ring buffers. Subgraphs that cannot be bound (e.g.,
+  // unaligned memory) copy from / to the bound tensors instead.
+  // The caller keeps ownership of the tensors, must keep them alive until
+  // `UnbindIOTensors`, and must not overlap bound requests of the model.
+  absl::Status BindIOTensors(ModelId model_id, Tensors inputs,
+                             Tensors outputs);
+  absl::Status UnbindIOTensors(ModelId model_id);
 
   // Sets the callback function pointer to report the end of invoke.
   CallbackId SetOnEndRequest(
       std::function<void(int, absl::Status)> on_end_request);
   absl::Status UnsetOnEndRequest(CallbackId callback_id);
 
-  int64_t GetProfiled(const SubgraphKey& key) const override;
-  int64_t GetExpected(const SubgraphKey& key) const override;
+  LatencyCacheStats GetLatencyCacheStats() const;
+  PlannerStats GetPlannerStats() const;
+  std::vector<WorkerStats> GetWorkerStats() const;
+  // Timing of a finished request. Available until its record is recycled by
+  // later requests, even after its outputs are read.
+  absl::StatusOr<RequestTimes> GetRequestTimes(JobId job_id) const;
+  // Snapshot of the metrics of the engine. Updating them is lock-free, so
+  // they are always on. Counters since the engine started:
+  // - `planner.wakeups`, `planner.scheduling_passes`
+  // - `planner.scheduled_jobs.<scheduler>`: jobs sent to a worker
+  // - `planner.finished_requests`
+  // - `planner.slo_violations`: requests that finished after their SLO or
+  //   were dropped, and `planner.early_drops` for the latter only
+  // - `engine.tensor_copy_bytes`: copied by the workers, from / to the
+  //   model I/O and between subgraphs
+  // - `engine.latency_cache.{hits,misses,invalidations,evictions}`
+  // - `engine.subgraph_{materializations,evictions}`: of lazy subgraphs
+  // - `worker.<id>.invokes`, `worker.<id>.busy_time_us`
+  // Gauges:
+  // - `planner.request_queue_depth`: requests not seen by the planner yet
+  // - `planner.local_queue_depth`: requests waiting for the schedulers
+  // - `worker.<id>.queue_depth`: jobs enqueued to the worker
+  // - `worker.<id>.{materialized_subgraphs,subgraph_bytes}`: with lazy
+  //   subgraphs
+  // - `model.<id>.{input,output}_slots_in_use`: of the tensor ring buffers
+  // - `model.<id>.memory_bytes`: held by the subgraphs of the model on all
+  //   workers, with the arenas that they share per worker
+  // Histograms:
+  // - `planner.pass_duration_us`: time spent in the schedulers per pass
+  Metrics GetMetrics() const;
+
+  int64_t GetProfiled(const SubgraphKey& key,
+                      int batch_size = 1) const override;
+  int64_t GetExpected(const SubgraphKey& key,
+                      int batch_size = 1) const override;
   SubgraphKey GetLargestSubgraphKey(ModelId model_id,
                                     WorkerId worker_id) const override;
 
+  // Virtual if `RuntimeConfig::use_virtual_clock`. Client threads that
+  // should not fall behind the virtual time attach themselves to it.
+  Clock* GetClock() const override { return clock_; }
+
  private:
   /* engine */
   absl::Status Init(const RuntimeConfig& config) override;
   void UpdateWorkersWaiting() const override;
   WorkerWaitingTime GetWorkerWaitingTime() const override;
   std::set<WorkerId> GetIdleWorkers() const override;
+  void SetWorkerIdle(WorkerId worker_id, bool is_idle) override;
 
   bool IsBegin(const SubgraphKey& key) const override;
   bool IsEnd(const SubgraphKey& key) const override;
   bool HasSubgraph(const SubgraphKey& key) const override;
+  bool IsMaterialized(const SubgraphKey& key) const override;
   void ForEachSubgraph(
       std::function<void(const SubgraphKey&)> visitor) const override;
-  absl::Status Invoke(const SubgraphKey& key) override;
+  absl::Status Invoke(const SubgraphKey& key, int batch_size = 1) override;
+  std::vector<int> GetBatchSizes(const SubgraphKey& key) const override;
 
   const ModelSpec* GetModelSpec(ModelId model_id) const override;
   WorkerId GetModelWorker(ModelId model_id) const override;
@@ -149,11 +287,13 @@ class Engine : public IEngine {
       ModelId model_id, BitMask resolved_unit_subgraphs) const;
 
   std::pair<SubgraphKey, int64_t> GetShortestSubgraphKey(
-      const std::vector<SubgraphKey>& subgraph_keys, int64_t start_time,
+      std::vector<SubgraphKey>::const_iterator begin,
+      std::vector<SubgraphKey>::const_iterator end, int64_t start_time,
       const std::map<WorkerId, int64_t>& worker_waiting) const;
 
   /* latency estimator */
-  void UpdateLatency(const SubgraphKey& key, int64_t latency) override;
+  void UpdateLatency(const SubgraphKey& key, int64_t latency,
+                     int batch_size = 1) override;
   int64_t GetWorst(ModelId model_id) const;
 
   /* planner */
@@ -162,17 +302,85 @@ class Engine : public IEngine {
   std::vector<JobId> EnqueueBatch(std::vector<Job> jobs,
                                   bool push_front = false) override;
   void PrepareReenqueue(Job& job) override;
-  void EnqueueFinishedJob(Job& job) override;
+  void ReenqueueBatch(const std::vector<JobHandle>& jobs) override;
+  void EnqueueFinishedJob(JobHandle job) override;
   bool EnqueueToWorker(const ScheduleAction& schedule_action) override;
   bool EnqueueToWorkerBatch(
       const std::vector<ScheduleAction>& schedule_action) override;
   const Worker* GetWorker(WorkerId id) const override;
   Worker* GetWorker(WorkerId id) override;
   /* tensor communication */
+  std::shared_lock<std::shared_mutex> LockIOBindings() override;
   absl::Status TryCopyInputTensors(const Job& job) override;
   absl::Status TryCopyOutputTensors(const Job& job) override;
 
   /* helper functions */
+  // Subgraphs of a model for one of its backends
+  struct ModelAnalysis;
+  // Only reads the workers of the engine, so models can be analyzed
+  // concurrently.
+  absl::StatusOr<std::unique_ptr<ModelAnalysis>> AnalyzeModel(
+      Model* model, BackendType backend_type) const;
+  // Creates the executors of the analyzed model and prepares, verifies, and
+  // profiles its subgraphs.
+  absl::Status PrepareModel(const ModelAnalysis& analysis,
+                            int tensor_pool_size);
+  // Prepares (or declares, if lazy) the subgraphs of the model. Executors of
+  // different workers are independent, so the workers are prepared in
+  // parallel.
+  absl::Status PrepareSubgraphs(const ModelAnalysis& analysis);
+  // (Re)builds the I/O tables of all subgraphs of the model. Must be called
+  // whenever the tensor data of a subgraph moves (e.g., binding). The caller
+  // holds `io_bindings_mtx_`.
+  absl::Status BuildSubgraphIOTables(ModelId model_id);
+  // Builds the scheduling table of the prepared subgraphs of the model.
+  void BuildSubgraphTable(ModelId model_id,
+                          const std::vector<SubgraphDef>& subgraph_defs);
+  // Prepares batched copies of the whole-model subgraphs of the model for
+  // the batch sizes that every worker of the model can run.
+  absl::Status PrepareBatchedSubgraphs(
+      Model* model, BackendType backend_type,
+      const std::vector<SubgraphDef>& subgraph_defs);
+  absl::Status PrepareBatchedSubgraph(Model* model, BackendType backend_type,
+                                      const SubgraphDef& subgraph_def,
+                                      int batch_size);
+  // Checks the I/O tensors of a prepared subgraph against the model spec.
+  absl::Status VerifySubgraph(const SubgraphKey& key,
+                              const std::set<int>& op_indices) const;
+  struct IOBinding;
+  // Binds the I/O tensors of `binding` to the subgraph, or counts them as
+  // fallbacks if the subgraph cannot use all of them. A subgraph is either
+  // fully bound or fully copied: if a tensor fails to bind, the tensors that
+  // were already bound are unbound again. Returns an error only if that
+  // rollback fails.
+  absl::Status BindSubgraphTensors(interface::IModelExecutor* model_executor,
+                                   const SubgraphKey& key,
+                                   const IOBinding& binding, int& num_bound,
+                                   int& num_fallback);
+  // Unbinds the tensors of the subgraph that point to the memory of
+  // `binding`.
+  absl::Status UnbindSubgraphTensors(interface::IModelExecutor* model_executor,
+                                     const SubgraphKey& key,
+                                     const IOBinding& binding);
+  // Builds a lazy subgraph if it is not materialized. If `allow_eviction`,
+  // then evicts the least recently used subgraphs of the worker that no
+  // request uses, until the worker fits `subgraph_memory_budget` again.
+  // The caller holds `io_bindings_mtx_`.
+  absl::Status MaterializeSubgraph(const SubgraphKey& key,
+                                   bool allow_eviction);
+  // Keeps the subgraph (e.g., its outputs) alive while `delta` > 0 requests
+  // need it.
+  void PinSubgraph(const SubgraphKey& key, int delta);
+  absl::Status CopyBatchedInputTensors(const Job& job);
+  absl::Status CopyBatchedOutputTensors(const Job& job);
+  absl::Status ReadOutputTensors(const Job& job, Tensors& outputs);
+  static RequestTimes ToRequestTimes(const Job& job);
+  void ReleaseInputHandle(const Job& job);
+  void ReleaseOutputHandle(ModelId model_id, int output_handle) override;
+  // Output slot for a new request. If the pool of the model is full,
+  // reclaims the slots of finished requests whose outputs were not read,
+  // oldest first, before it fails or blocks.
+  absl::StatusOr<int> AllocOutputHandle(ModelId model_id);
   WorkerId GetDeviceWorkerId(DeviceFlag flag) const;
   interface::IModelExecutor* GetModelExecutor(const SubgraphKey& key);
   const interface::IModelExecutor* GetModelExecutor(
@@ -184,13 +392,23 @@ class Engine : public IEngine {
   Engine& operator=(const Engine&) = delete;
   Engine& operator=(const Engine&&) = delete;
 
+  // Declared first to outlive the members that use it
+  std::unique_ptr<VirtualClock> virtual_clock_;
+  Clock* clock_ = RealClock::Get();
+
   SubgraphConfig subgraph_config_;
+  int tensor_pool_size_ = 128;
+  bool block_on_tensor_pool_full_ = false;
+  int max_batch_size_ = 1;
 
   std::map<std::pair<ModelId, WorkerId>,
            std::unique_ptr<interface::IModelExecutor>>
       model_executors_;
   std::vector<std::unique_ptr<Worker>> workers_;
   mutable WorkerWaitingTime workers_waiting_;
+  // Bit i is set if worker i can take a job right away
+  std::atomic<uint64_t> idle_workers_{0};
+  static constexpr size_t kMaxNumWorkers = 64;
   std::unique_ptr<LatencyEstimator> latency_estimator_;
   std::unique_ptr<Planner> planner_;
 
@@ -200,18 +418,142 @@ class Engine : public IEngine {
   std::map<ModelId, ModelSpec> model_specs_;
   std::map<ModelId, std::unique_ptr<TensorRingBuffer>> model_input_buffer_;
   std::map<ModelId, std::unique_ptr<TensorRingBuffer>> model_output_buffer_;
+  // Caller-owned I/O tensors registered with BindIOTensors()
+  struct IOBinding {
+    std::map<int, interface::ITensor*> inputs;
+    std::map<int, interface::ITensor*> outputs;
+  };
+  std::map<ModelId, IOBinding> model_io_bindings_;
+  // Exclusive while tensors are bound or unbound, shared while the workers
+  // copy tensors. Taken before `residency_mtx_` and `io_tables_mtx_`.
+  mutable std::shared_mutex io_bindings_mtx_;
+
+  // Tensor copies of a subgraph, resolved to raw pointers at registration
+  // so that the worker hot path is a plain memcpy loop.
+  struct TensorCopy {
+    const char* src;
+    char* dst;
+    size_t bytes;
+  };
+  struct SlotCopy {
+    // position of the tensor within a ring buffer slot
+    int buffer_index;
+    char* tensor_data;
+    size_t bytes;
+  };
+  struct SubgraphIOTable {
+    // intermediate tensors, per subgraph that may have run before
+    std::unordered_map<SubgraphKey, std::vector<TensorCopy>, SubgraphHash>
+        from_predecessors;
+    size_t num_intermediate_inputs = 0;
+    // model inputs / outputs from / to the tensor ring buffers
+    std::vector<SlotCopy> model_inputs;
+    std::vector<SlotCopy> model_outputs;
+    // model inputs / outputs from / to bound tensors that could not be
+    // bound directly
+    std::vector<TensorCopy> bound_inputs;
+    std::vector<TensorCopy> bound_outputs;
+  };
+  std::unordered_map<SubgraphKey, SubgraphIOTable, SubgraphHash>
+      subgraph_io_tables_;
+  // Exclusive while the tables are rebuilt, e.g., when a lazy subgraph is
+  // materialized while the other workers copy tensors. Only taken with lazy
+  // subgraphs.
+  mutable std::shared_mutex io_tables_mtx_;
+
+  // Lazy subgraphs. The entries are created at registration, so that the
+  // workers only update the fields of an entry.
+  struct SubgraphResidency {
+    std::set<int> op_indices;
+    // Largest subgraph of the model on its worker. Built at registration
+    // and never evicted.
+    bool is_primary = false;
+    std::atomic<bool> is_materialized{false};
+    // Order of the last use, for the LRU eviction
+    std::atomic<uint64_t> last_use{0};
+    // Unfinished requests that ran the subgraph
+    std::atomic<int> num_pins{0};
+    // Guarded by `residency_mtx_`
+    size_t bytes = 0;
+  };
+  std::unordered_map<SubgraphKey, std::unique_ptr<SubgraphResidency>,
+                     SubgraphHash>
+      subgraph_residency_;
+  std::map<std::pair<ModelId, WorkerId>, SubgraphKey> primary_subgraph_keys_;
+  // Serializes the materializations and evictions, which may rebuild the
+  // I/O tables of subgraphs of any worker
+  mutable std::mutex residency_mtx_;
+  std::atomic<uint64_t> residency_ticks_{0};
+  Counter subgraph_materializations_;
+  Counter subgraph_evictions_;
+
+  // Copy of a whole-model subgraph with inputs resized to a batch size.
+  // Each request of a batch takes an equal slice of the model inputs /
+  // outputs along dimension 0, so a `SlotCopy` refers to the first slice.
+  struct BatchedSubgraph {
+    SubgraphKey key;
+    std::unique_ptr<interface::IModelExecutor> model_executor;
+    std::vector<SlotCopy> model_inputs;
+    std::vector<SlotCopy> model_outputs;
+  };
+  // (model id, worker id, batch size)
+  std::map<std::tuple<ModelId, WorkerId, int>, BatchedSubgraph>
+      batched_subgraphs_;
 
   // Scheduling
-  // cache for GetShortestLatency()
-  mutable std::unordered_map<std::pair<ModelId, BitMask>,
-                             std::pair<SubgraphKey, int64_t>, JobIdBitMaskHash>
+  // cache for GetShortestLatency(). An entry is valid while the latency
+  // estimator epoch of its model stays the same, and the oldest entry is
+  // evicted once the cache is full.
+  struct LatencyCacheEntry {
+    SubgraphKey key;
+    int64_t latency;
+    uint32_t epoch;
+  };
+  mutable std::unordered_map<std::pair<ModelId, BitMask>, LatencyCacheEntry,
+                             JobIdBitMaskHash>
       cache_;
-
-  // Find subgraph indices with the (model_id, start_unit_idx, end_unit_idx).
-  // NOTE: we assume every subgraph consists of unit subgraphs with the
-  // continuous unit subgraph indices.
-  std::map<int, std::map<int, std::map<int, std::vector<SubgraphKey>>>>
-      unit_subgraphs_to_subgraph_keys_;
+  // keys of `cache_` in insertion order
+  mutable std::deque<std::pair<ModelId, BitMask>> cache_order_;
+  size_t cache_capacity_ = 4096;
+  mutable std::atomic<size_t> cache_hits_{0};
+  mutable std::atomic<size_t> cache_misses_{0};
+  mutable std::atomic<size_t> cache_invalidations_{0};
+  mutable std::atomic<size_t> cache_evictions_{0};
+
+  Counter tensor_copy_bytes_;
+
+  // Subgraphs of a model laid out for the shortest latency searches, so that
+  // they run over flat arrays instead of walking the model executors.
+  struct SubgraphTable {
+    ModelId model_id = -1;
+    size_t num_unit_subgraphs = 0;
+    // Subgraphs that consist of the unit subgraphs [i, j] are
+    // `range_keys[range_offsets[i * n + j], range_offsets[i * n + j + 1])`.
+    // NOTE: we assume every subgraph consists of unit subgraphs with the
+    // continuous unit subgraph indices.
+    std::vector<int> range_offsets;
+    std::vector<SubgraphKey> range_keys;
+
+    // Subgraphs that can run next, grouped by their unit subgraphs
+    struct CandidateGroup {
+      int keys_begin;
+      int keys_end;
+      // state after running the group, or -1 if the group ends the model
+      int next_state;
+    };
+    // States are the sets of resolved unit subgraphs reachable from the
+    // beginning of the model (state 0). The candidates of state `s` are
+    // `groups[group_offsets[s], group_offsets[s + 1])`.
+    std::unordered_map<BitMask, int> state_indices;
+    std::vector<BitMask> state_masks;
+    std::vector<int> group_offsets;
+    std::vector<CandidateGroup> groups;
+    std::vector<SubgraphKey> group_keys;
+  };
+  std::pair<SubgraphKey, int64_t> GetShortestLatency(
+      const SubgraphTable& table, int state, int64_t start_time,
+      const std::map<WorkerId, int64_t>& worker_waiting) const;
+  std::unordered_map<ModelId, SubgraphTable> subgraph_tables_;
 };  // namespace band
 }  // namespace band
 
@@ -20,11 +20,14 @@
 #include <functional>
 #include <map>
 #include <queue>
+#include <shared_mutex>
 #include <unordered_map>
 
 #include "absl/status/status.h"
+#include "band/clock.h"
 #include "band/common.h"
 #include "band/config.h"
+#include "band/job_slab.h"
 #include "band/logger.h"
 
 namespace band {
@@ -43,10 +46,11 @@ class ModelSpec;
 using WorkerWaitingTime = std::map<WorkerId, int64_t>;
 
 // Decision from a scheduler. Run subgraph key for a specific job.
-using ScheduleAction = std::pair<Job, SubgraphKey>;
+using ScheduleAction = std::pair<JobHandle, SubgraphKey>;
 
-// Type definition of job queue.
-using JobQueue = std::deque<Job>;
+// Type definition of job queue. Jobs stay in the planner's `JobSlab` and
+// queues only move their handles.
+using JobQueue = std::deque<JobHandle>;
 
 // Minimal interfaces for Band framework
 class IEngine {
@@ -59,10 +63,15 @@ class IEngine {
     return absl::OkStatus();
   };
 
+  // Source of every timestamp of the engine.
+  virtual Clock* GetClock() const { return RealClock::Get(); }
+
   /* worker */
   virtual void UpdateWorkersWaiting() const = 0;
   virtual WorkerWaitingTime GetWorkerWaitingTime() const = 0;
   virtual std::set<WorkerId> GetIdleWorkers() const = 0;
+  // Called by a worker whenever it may have become idle or busy.
+  virtual void SetWorkerIdle(WorkerId worker_id, bool is_idle) = 0;
 
   /* subgraph */
   virtual SubgraphKey GetLargestSubgraphKey(ModelId model_id,
@@ -70,9 +79,19 @@ class IEngine {
   virtual bool IsBegin(const SubgraphKey& key) const = 0;
   virtual bool IsEnd(const SubgraphKey& key) const = 0;
   virtual bool HasSubgraph(const SubgraphKey& key) const = 0;
+  // False for a lazy subgraph that is not built yet, or was evicted. It is
+  // built when it is invoked.
+  virtual bool IsMaterialized(const SubgraphKey& key) const {
+    return HasSubgraph(key);
+  }
   virtual void ForEachSubgraph(
       std::function<void(const SubgraphKey&)> visitor) const = 0;
-  virtual absl::Status Invoke(const SubgraphKey& key) = 0;
+  // Runs `batch_size` requests at once if `batch_size` is one of
+  // `GetBatchSizes(key)`.
+  virtual absl::Status Invoke(const SubgraphKey& key, int batch_size = 1) = 0;
+  // Batch sizes (other than 1) that the subgraph can run with, in increasing
+  // order. Empty if requests for the subgraph are not batched.
+  virtual std::vector<int> GetBatchSizes(const SubgraphKey& key) const = 0;
 
   /* model */
   virtual const ModelSpec* GetModelSpec(ModelId model_id) const = 0;
@@ -106,9 +125,12 @@ class IEngine {
       const std::set<WorkerId>& idle_workers) const = 0;
 
   /* profiler */
-  virtual void UpdateLatency(const SubgraphKey& key, int64_t latency) = 0;
-  virtual int64_t GetProfiled(const SubgraphKey& key) const = 0;
-  virtual int64_t GetExpected(const SubgraphKey& key) const = 0;
+  virtual void UpdateLatency(const SubgraphKey& key, int64_t latency,
+                             int batch_size = 1) = 0;
+  virtual int64_t GetProfiled(const SubgraphKey& key,
+                              int batch_size = 1) const = 0;
+  virtual int64_t GetExpected(const SubgraphKey& key,
+                              int batch_size = 1) const = 0;
 
   /* planner */
   virtual void Trigger() = 0;
@@ -116,7 +138,9 @@ class IEngine {
   virtual std::vector<JobId> EnqueueBatch(std::vector<Job> jobs,
                                           bool push_front = false) = 0;
   virtual void PrepareReenqueue(Job& job) = 0;
-  virtual void EnqueueFinishedJob(Job& job) = 0;
+  // Puts already enqueued jobs back to the front of the request queue.
+  virtual void ReenqueueBatch(const std::vector<JobHandle>& jobs) = 0;
+  virtual void EnqueueFinishedJob(JobHandle job) = 0;
   virtual bool EnqueueToWorker(const ScheduleAction& schedule_action) = 0;
   virtual bool EnqueueToWorkerBatch(
       const std::vector<ScheduleAction>& schedule_action) = 0;
@@ -127,8 +151,14 @@ class IEngine {
   virtual size_t GetNumWorkers() const = 0;
 
   /* tensor communication */
+  // Keeps the bound I/O tensors of every model in place while held. A
+  // worker holds it from the input copy of a job to its output copy, and
+  // `Invoke`, `TryCopyInputTensors` and `TryCopyOutputTensors` require it.
+  virtual std::shared_lock<std::shared_mutex> LockIOBindings() { return {}; }
   virtual absl::Status TryCopyInputTensors(const Job& job) = 0;
   virtual absl::Status TryCopyOutputTensors(const Job& job) = 0;
+  // Returns an output slot of a finished job to the pool of its model.
+  virtual void ReleaseOutputHandle(ModelId model_id, int output_handle) {}
 };
 }  // namespace band
 
@@ -23,6 +23,7 @@
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "band/clock.h"
 #include "band/common.h"
 #include "band/device/cpu.h"
 #include "band/interface/backend.h"
@@ -54,6 +55,33 @@ class IModelExecutor : public IBackendSpecific {
   virtual absl::Status PrepareSubgraph(IModel* model, std::set<int> ops = {},
                                        std::set<int> unit_indices = {}) = 0;
 
+  // Lazy preparation: only records the subgraph, whose backend state is
+  // created by `MaterializeSubgraph` and released by `EvictSubgraph`. A
+  // declared subgraph is visible to `HasSubgraph` and `ForEachSubgraph`, but
+  // the other accessors are valid only while it is materialized. `model`
+  // must outlive the executor. Backends that cannot defer the preparation
+  // prepare the subgraph right away and never evict it.
+  virtual absl::Status DeclareSubgraph(IModel* model, std::set<int> ops = {},
+                                       std::set<int> unit_indices = {}) {
+    return PrepareSubgraph(model, ops, unit_indices);
+  }
+  virtual bool IsMaterialized(const SubgraphKey& key) const {
+    return HasSubgraph(key);
+  }
+  virtual absl::Status MaterializeSubgraph(const SubgraphKey& key) {
+    return HasSubgraph(key) ? absl::OkStatus()
+                            : absl::NotFoundError("Cannot find subgraph");
+  }
+  virtual absl::Status EvictSubgraph(const SubgraphKey& key) {
+    return absl::UnimplementedError("Subgraph eviction is not supported");
+  }
+  // Bytes that the materialized subgraph holds (e.g., its tensors), or 0 if
+  // unknown
+  virtual size_t GetMemoryFootprint(const SubgraphKey& key) const { return 0; }
+  // Bytes that all subgraphs of the executor share (e.g., an activation
+  // arena), on top of their own `GetMemoryFootprint`
+  virtual size_t GetSharedMemoryFootprint() const { return 0; }
+
   virtual const std::vector<int>& GetInputs(const SubgraphKey& key) const = 0;
   virtual const std::vector<int>& GetOutputs(const SubgraphKey& key) const = 0;
   virtual const char* GetInputName(const SubgraphKey& key, int index) const = 0;
@@ -68,16 +96,39 @@ class IModelExecutor : public IBackendSpecific {
   virtual bool HasSubgraph(const SubgraphKey& key) const = 0;
   virtual SubgraphKey GetLargestSubgraphKey() const = 0;
 
+  // Zero-copy I/O: use caller-owned `data` as the storage of tensor `index`
+  // of the subgraph. Backends that cannot bind external memory keep their
+  // own storage, and callers fall back to copying.
+  virtual absl::Status BindTensor(const SubgraphKey& key, int index,
+                                  char* data, size_t bytes) {
+    return absl::UnimplementedError("Tensor binding is not supported");
+  }
+  virtual absl::Status UnbindTensor(const SubgraphKey& key, int index) {
+    return absl::UnimplementedError("Tensor binding is not supported");
+  }
+
+  // Dynamic batching: resize dimension 0 of every input of the subgraph to
+  // `batch_size` and reallocate its tensors. Backends that cannot resize
+  // inputs (e.g., delegates with static shapes) do not batch requests.
+  virtual absl::Status ResizeBatch(const SubgraphKey& key, int batch_size) {
+    return absl::UnimplementedError("Batching is not supported");
+  }
+
   virtual absl::Status ExecuteSubgraph(const SubgraphKey& key) = 0;
   virtual void ForEachSubgraph(
       std::function<void(const SubgraphKey&)> visitor) = 0;
 
+  // Clock of the engine that runs the model. Backends that simulate the
+  // execution spend the time on it.
+  virtual void SetClock(Clock* clock) { clock_ = clock; }
+
  protected:
   const ModelId model_id_;
   const WorkerId worker_id_;
   const DeviceFlag device_flag_;
   const CpuSet thread_affinity_mask_;
   const int num_threads_;
+  Clock* clock_ = RealClock::Get();
 
  private:
   // Disable copy due to complexity
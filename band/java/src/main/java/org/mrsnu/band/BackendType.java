@@ -17,7 +17,8 @@
 package org.mrsnu.band;
 
 public enum BackendType {
-  TFLITE(0);
+  TFLITE(0),
+  SIMULATED(1);
 
   private final int value;
 
@@ -32,6 +33,8 @@ public enum BackendType {
   public static BackendType fromValue(int value) {
     if (value == 0) {
       return TFLITE;
+    } else if (value == 1) {
+      return SIMULATED;
     } else {
       return null;
     }
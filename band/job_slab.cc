@@ -0,0 +1,150 @@
+// Copyright 2023 Seoul National University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "band/job_slab.h"
+
+#include "band/logger.h"
+
+namespace band {
+
+Job* JobHandle::Get() const {
+  return slab_ == nullptr ? nullptr : slab_->Get(*this);
+}
+
+JobLink* JobHandle::GetLink() const {
+  return slab_ == nullptr ? nullptr : slab_->GetLink(*this);
+}
+
+JobSlab::JobSlab(size_t num_preallocated) {
+  for (auto& chunk : chunks_) {
+    chunk.store(nullptr, std::memory_order_relaxed);
+  }
+  std::lock_guard<std::mutex> lock(free_mtx_);
+  do {
+    if (!Grow()) {
+      break;
+    }
+  } while (GetCapacity() < num_preallocated);
+}
+
+JobSlab::~JobSlab() {
+  for (auto& chunk : chunks_) {
+    delete[] chunk.load(std::memory_order_relaxed);
+  }
+}
+
+JobHandle JobSlab::Alloc(Job&& job) {
+  uint32_t index;
+  {
+    std::lock_guard<std::mutex> lock(free_mtx_);
+    if (free_head_ == kNullRecord && !Grow()) {
+      BAND_LOG(LogSeverity::kError,
+               "Job slab is full (%zu records). Failed to allocate a job.",
+               GetCapacity());
+      return JobHandle();
+    }
+    index = free_head_;
+    free_head_ = GetRecord(index)->next_free;
+    num_allocated_++;
+  }
+
+  Record* record = GetRecord(index);
+  record->job = std::move(job);
+  return JobHandle(this, index,
+                   record->generation.load(std::memory_order_acquire));
+}
+
+bool JobSlab::Release(const JobHandle& handle) {
+  if (handle.slab_ != this) {
+    return false;
+  }
+  Record* record = GetRecord(handle.index_);
+  if (record == nullptr) {
+    return false;
+  }
+  // Only one of concurrent releases of the same handle succeeds
+  uint32_t generation = handle.generation_;
+  if (!record->generation.compare_exchange_strong(generation, generation + 1,
+                                                  std::memory_order_acq_rel)) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(free_mtx_);
+  record->next_free = free_head_;
+  free_head_ = handle.index_;
+  num_allocated_--;
+  return true;
+}
+
+Job* JobSlab::Get(const JobHandle& handle) const {
+  Record* record = GetLiveRecord(handle);
+  return record == nullptr ? nullptr : &record->job;
+}
+
+JobLink* JobSlab::GetLink(const JobHandle& handle) const {
+  Record* record = GetLiveRecord(handle);
+  return record == nullptr ? nullptr : &record->link;
+}
+
+size_t JobSlab::GetCapacity() const {
+  return num_chunks_.load(std::memory_order_acquire) * kChunkSize;
+}
+
+size_t JobSlab::GetNumAllocated() const {
+  std::lock_guard<std::mutex> lock(free_mtx_);
+  return num_allocated_;
+}
+
+JobSlab::Record* JobSlab::GetRecord(uint32_t index) const {
+  const size_t chunk_index = index / kChunkSize;
+  if (chunk_index >= num_chunks_.load(std::memory_order_acquire)) {
+    return nullptr;
+  }
+  return chunks_[chunk_index].load(std::memory_order_acquire) +
+         index % kChunkSize;
+}
+
+JobSlab::Record* JobSlab::GetLiveRecord(const JobHandle& handle) const {
+  if (handle.slab_ != this) {
+    return nullptr;
+  }
+  Record* record = GetRecord(handle.index_);
+  if (record == nullptr || record->generation.load(std::memory_order_acquire) !=
+                               handle.generation_) {
+    return nullptr;
+  }
+  return record;
+}
+
+bool JobSlab::Grow() {
+  const size_t chunk_index = num_chunks_.load(std::memory_order_relaxed);
+  if (chunk_index == kMaxNumChunks) {
+    return false;
+  }
+
+  Record* chunk = new Record[kChunkSize];
+  // Link the new records in index order, in front of the free list
+  const uint32_t first_index = chunk_index * kChunkSize;
+  for (size_t i = 0; i < kChunkSize; i++) {
+    chunk[i].next_free =
+        i + 1 < kChunkSize ? first_index + i + 1 : free_head_;
+  }
+  free_head_ = first_index;
+
+  chunks_[chunk_index].store(chunk, std::memory_order_release);
+  num_chunks_.store(chunk_index + 1, std::memory_order_release);
+  return true;
+}
+
+}  // namespace band
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2023 Seoul National University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BAND_JOB_SLAB_H_
+#define BAND_JOB_SLAB_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include "band/common.h"
+
+namespace band {
+
+class JobSlab;
+struct JobLink;
+
+// Small, copyable reference to a job record in a `JobSlab`.
+// A handle remembers the generation of the record it was issued for, and
+// resolves to nullptr once the record is released (and possibly reused).
+class JobHandle {
+ public:
+  JobHandle() = default;
+
+  Job* Get() const;
+  // Intrusive link of the record, or nullptr if the handle is stale.
+  JobLink* GetLink() const;
+  Job* operator->() const { return Get(); }
+  Job& operator*() const { return *Get(); }
+  bool IsValid() const { return Get() != nullptr; }
+
+  bool operator==(const JobHandle& rhs) const {
+    return slab_ == rhs.slab_ && index_ == rhs.index_ &&
+           generation_ == rhs.generation_;
+  }
+  bool operator!=(const JobHandle& rhs) const { return !(*this == rhs); }
+
+ private:
+  friend class JobSlab;
+  JobHandle(JobSlab* slab, uint32_t index, uint32_t generation)
+      : slab_(slab), index_(index), generation_(generation) {}
+
+  JobSlab* slab_ = nullptr;
+  uint32_t index_ = 0;
+  uint32_t generation_ = 0;
+};
+
+// Link embedded in every job record, so that lock-free queues of jobs
+// (e.g., `RequestQueue`) chain records instead of allocating nodes. A job
+// is linked into at most one such queue at a time.
+struct JobLink {
+  JobHandle job;
+  JobLink* next = nullptr;
+};
+
+/*
+  Preallocated storage of `Job` records.
+
+  Queues and tables pass `JobHandle`s around instead of copying jobs, and
+  records are recycled through a free list, so no heap allocation happens
+  once the slab is warmed up. The slab grows by a chunk when it runs out of
+  free records; records never move, so `Get` is lock-free.
+*/
+class JobSlab {
+ public:
+  explicit JobSlab(size_t num_preallocated = kChunkSize);
+  ~JobSlab();
+  JobSlab(const JobSlab&) = delete;
+  JobSlab& operator=(const JobSlab&) = delete;
+
+  // Moves `job` into a free record. Returns an invalid handle if the slab
+  // reached its maximum capacity.
+  JobHandle Alloc(Job&& job);
+  // Returns the record to the slab, invalidating every handle to it.
+  // Returns false if `handle` is stale or does not belong to this slab.
+  bool Release(const JobHandle& handle);
+  Job* Get(const JobHandle& handle) const;
+  JobLink* GetLink(const JobHandle& handle) const;
+
+  size_t GetCapacity() const;
+  size_t GetNumAllocated() const;
+
+  static constexpr size_t kChunkSize = 256;
+  static constexpr size_t kMaxNumChunks = 4096;
+
+ private:
+  static constexpr uint32_t kNullRecord = UINT32_MAX;
+
+  struct Record {
+    Job job;
+    // bumped on every release
+    std::atomic<uint32_t> generation{1};
+    // next record in the free list (guarded by `free_mtx_`)
+    uint32_t next_free = kNullRecord;
+    // owned by the queue the job is linked into
+    JobLink link;
+  };
+
+  Record* GetRecord(uint32_t index) const;
+  // Record of a live handle, or nullptr if the handle is stale.
+  Record* GetLiveRecord(const JobHandle& handle) const;
+  // Appends a chunk of records to the free list. Requires `free_mtx_`.
+  bool Grow();
+
+  std::atomic<Record*> chunks_[kMaxNumChunks];
+  std::atomic<size_t> num_chunks_{0};
+
+  mutable std::mutex free_mtx_;
+  uint32_t free_head_ = kNullRecord;
+  size_t num_allocated_ = 0;
+};
+
+}  // namespace band
+
+#endif  // BAND_JOB_SLAB_H_
@@ -29,10 +29,8 @@ std::string JobTracer::GetStreamName(size_t id) const {
 }
 
 std::string JobTracer::GetJobName(const Job& job) const {
-  std::string model_name =
-      "(Model " +
-      (job.model_fname == "" ? std::to_string(job.model_id) : job.model_fname);
-  return model_name + ", JobId " + std::to_string(job.job_id) + ")";
+  return "(Model " + std::to_string(job.model_id) + ", JobId " +
+         std::to_string(job.job_id) + ")";
 }
 
 JobTracer& JobTracer::Get() {
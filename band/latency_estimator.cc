@@ -14,15 +14,36 @@
 
 #include "band/latency_estimator.h"
 
+#include <cstdlib>
+
 #include "absl/strings/str_format.h"
 #include "band/engine_interface.h"
 #include "band/json_util.h"
 #include "band/logger.h"
 #include "band/model_spec.h"
 #include "band/profiler.h"
+#include "band/thread_pool.h"
 #include "band/worker.h"
 
 namespace band {
+namespace {
+
+std::set<int> StringToIndices(std::string index_string) {
+  std::set<int> node_indices;
+  std::stringstream ss(index_string);
+
+  for (int i; ss >> i;) {
+    node_indices.insert(i);
+    if (ss.peek() == ',') {
+      ss.ignore();
+    }
+  }
+
+  return node_indices;
+}
+
+}  // anonymous namespace
+
 LatencyEstimator::LatencyEstimator(IEngine* engine) : engine_(engine) {}
 
 absl::Status LatencyEstimator::Init(const ProfileConfig& config) {
@@ -39,88 +60,89 @@ absl::Status LatencyEstimator::Init(const ProfileConfig& config) {
   profile_num_warmups_ = config.num_warmups;
   profile_num_runs_ = config.num_runs;
   profile_smoothing_factor_ = config.smoothing_factor;
+  latency_drift_threshold_ = config.latency_drift_threshold;
 
   return absl::OkStatus();
 }
 
-void LatencyEstimator::UpdateLatency(const SubgraphKey& key, int64_t latency) {
-  auto it = profile_database_.find(key);
-  if (it != profile_database_.end()) {
-    int64_t prev_latency = it->second.moving_averaged;
-    profile_database_[key].moving_averaged =
-        profile_smoothing_factor_ * latency +
-        (1 - profile_smoothing_factor_) * prev_latency;
+void LatencyEstimator::UpdateLatency(const SubgraphKey& key, int64_t latency,
+                                     int batch_size) {
+  Latency* profile = nullptr;
+  if (batch_size > 1) {
+    auto it = batch_profile_database_.find(key);
+    if (it != batch_profile_database_.end() &&
+        it->second.find(batch_size) != it->second.end()) {
+      profile = &it->second[batch_size];
+    }
+  } else {
+    auto it = profile_database_.find(key);
+    if (it != profile_database_.end()) {
+      profile = &it->second;
+    }
+  }
+
+  if (profile != nullptr && profile->is_estimated) {
+    *profile = {latency, latency, latency};
+    BumpEpoch(key.GetModelId());
+  } else if (profile != nullptr) {
+    int64_t prev_latency = profile->moving_averaged;
+    profile->moving_averaged = profile_smoothing_factor_ * latency +
+                               (1 - profile_smoothing_factor_) * prev_latency;
+
+    // Only single requests are planned with the shortest latency searches
+    if (batch_size == 1) {
+      if (profile->epoch_latency == 0) {
+        profile->epoch_latency = prev_latency;
+      }
+      if (std::abs(profile->moving_averaged - profile->epoch_latency) >
+          latency_drift_threshold_ * profile->epoch_latency) {
+        profile->epoch_latency = profile->moving_averaged;
+        BumpEpoch(key.GetModelId());
+      }
+    }
   } else {
     BAND_LOG(LogSeverity::kWarning,
              "[LatencyEstimator::UpdateLatency] The given SubgraphKey %s "
-             "cannot be found.",
-             key.ToString().c_str());
+             "(batch size %d) cannot be found.",
+             key.ToString().c_str(), batch_size);
   }
 }
 
 absl::Status LatencyEstimator::ProfileModel(ModelId model_id) {
   if (profile_online_) {
-    for (WorkerId worker_id = 0; worker_id < engine_->GetNumWorkers();
-         worker_id++) {
-      Worker* worker = engine_->GetWorker(worker_id);
-      // pause worker for profiling, must resume before continue
-      worker->Pause();
-      // wait for workers to finish current job
-      worker->Wait();
-      // invoke target subgraph in an isolated thread
-      std::thread profile_thread([&]() {
-
-#if BAND_IS_MOBILE
-        if (worker->GetWorkerThreadAffinity().NumEnabled() > 0 &&
-            !SetCPUThreadAffinity(worker->GetWorkerThreadAffinity()).ok()) {
-          return absl::InternalError(absl::StrFormat(
-              "Failed to propagate thread affinity of worker id "
-              "%d to profile thread",
-              worker_id));
-        }
-#endif
-
-        engine_->ForEachSubgraph([&](const SubgraphKey& subgraph_key) -> void {
-          if (subgraph_key.GetWorkerId() == worker_id &&
-              subgraph_key.GetModelId() == model_id) {
-            Profiler average_profiler;
-            // TODO(#238): propagate affinity to CPU backend if necessary
-            // (L1143-,tensorflow_band/lite/model_executor.cc)
-
-            for (int i = 0; i < profile_num_warmups_; i++) {
-              if (!engine_->Invoke(subgraph_key).ok()) {
-                BAND_LOG(LogSeverity::kError,
-                         "Profiler failed to invoke largest subgraph of "
-                         "model %d in worker %d",
-                         model_id, worker_id);
-              }
-            }
-
-            for (int i = 0; i < profile_num_runs_; i++) {
-              const size_t event_id = average_profiler.BeginEvent();
-
-              if (!engine_->Invoke(subgraph_key).ok()) {
-                BAND_LOG(LogSeverity::kError,
-                         "Profiler failed to invoke largest subgraph of "
-                         "model %d in worker %d",
-                         model_id, worker_id);
-              }
-              average_profiler.EndEvent(event_id);
-            }
-
-            const int64_t latency =
-                average_profiler
-                    .GetAverageElapsedTime<std::chrono::microseconds>();
-            profile_database_[subgraph_key] = {latency, latency};
-          }
-        });
-        return absl::OkStatus();
+    const int num_workers = engine_->GetNumWorkers();
+    std::vector<WorkerProfile> worker_profiles(num_workers);
+    std::vector<std::function<void()>> tasks;
+    for (WorkerId worker_id = 0; worker_id < num_workers; worker_id++) {
+      tasks.push_back([this, model_id, worker_id, &worker_profiles]() {
+        worker_profiles[worker_id] = ProfileWorker(model_id, worker_id);
       });
+    }
 
-      profile_thread.join();
+    Clock* clock = engine_->GetClock();
+    if (clock->IsVirtual()) {
+      for (auto& task : tasks) {
+        task();
+      }
+    } else {
+      // Let the clock run the profile threads while this one is blocked
+      const bool is_attached = clock->IsThreadAttached();
+      if (is_attached) {
+        clock->DetachThread();
+      }
+      ThreadPool::RunAll(std::move(tasks));
+      if (is_attached) {
+        clock->AttachThread();
+      }
+    }
 
-      // resume worker
-      worker->Resume();
+    for (WorkerProfile& worker_profile : worker_profiles) {
+      for (auto& it : worker_profile.latencies) {
+        profile_database_[it.first] = it.second;
+      }
+      for (auto& it : worker_profile.batch_latencies) {
+        batch_profile_database_[it.first] = std::move(it.second);
+      }
     }
   } else {
     if (engine_ && engine_->GetModelSpec(model_id)) {
@@ -128,6 +150,9 @@ absl::Status LatencyEstimator::ProfileModel(ModelId model_id) {
       auto model_profile = JsonToModelProfile(model_name, model_id);
       if (model_profile.size() > 0) {
         profile_database_.insert(model_profile.begin(), model_profile.end());
+        auto batch_profile = JsonToBatchProfile(model_name, model_id);
+        batch_profile_database_.insert(batch_profile.begin(),
+                                       batch_profile.end());
         BAND_LOG_DEBUG(
             "Successfully found %d profile entries for model (%s, %d).",
             model_profile.size(), model_name.c_str(), model_id);
@@ -138,10 +163,144 @@ absl::Status LatencyEstimator::ProfileModel(ModelId model_id) {
       }
     }
   }
+  EstimateUnprofiled(model_id);
+  BumpEpoch(model_id);
   return absl::OkStatus();
 }
 
-int64_t LatencyEstimator::GetProfiled(const SubgraphKey& key) const {
+LatencyEstimator::WorkerProfile LatencyEstimator::ProfileWorker(
+    ModelId model_id, WorkerId worker_id) {
+  WorkerProfile worker_profile;
+  Worker* worker = engine_->GetWorker(worker_id);
+  // pause worker for profiling, must resume before continue
+  worker->Pause();
+  // wait for workers to finish current job
+  worker->Wait();
+  // invoke target subgraph in an isolated thread
+  std::thread profile_thread([&]() {
+
+#if BAND_IS_MOBILE
+    if (worker->GetWorkerThreadAffinity().NumEnabled() > 0 &&
+        !SetCPUThreadAffinity(worker->GetWorkerThreadAffinity()).ok()) {
+      return absl::InternalError(absl::StrFormat(
+          "Failed to propagate thread affinity of worker id "
+          "%d to profile thread",
+          worker_id));
+    }
+#endif
+
+    engine_->ForEachSubgraph([&](const SubgraphKey& subgraph_key) -> void {
+      // Lazy merged subgraphs are estimated instead of built here
+      if (!engine_->IsMaterialized(subgraph_key) &&
+          subgraph_key.GetUnitIndices().count() > 1) {
+        return;
+      }
+      if (subgraph_key.GetWorkerId() == worker_id &&
+          subgraph_key.GetModelId() == model_id) {
+        auto profile = [&](int batch_size) -> int64_t {
+          Profiler average_profiler;
+          average_profiler.SetClock(engine_->GetClock());
+          // TODO(#238): propagate affinity to CPU backend if necessary
+          // (L1143-,tensorflow_band/lite/model_executor.cc)
+
+          // Bound tensors stay in place while the subgraph is profiled
+          auto io_bindings_lock = engine_->LockIOBindings();
+          for (int i = 0; i < profile_num_warmups_; i++) {
+            if (!engine_->Invoke(subgraph_key, batch_size).ok()) {
+              BAND_LOG(LogSeverity::kError,
+                       "Profiler failed to invoke largest subgraph of "
+                       "model %d in worker %d (batch size %d)",
+                       model_id, worker_id, batch_size);
+            }
+          }
+
+          for (int i = 0; i < profile_num_runs_; i++) {
+            const size_t event_id = average_profiler.BeginEvent();
+
+            if (!engine_->Invoke(subgraph_key, batch_size).ok()) {
+              BAND_LOG(LogSeverity::kError,
+                       "Profiler failed to invoke largest subgraph of "
+                       "model %d in worker %d (batch size %d)",
+                       model_id, worker_id, batch_size);
+            }
+            average_profiler.EndEvent(event_id);
+          }
+
+          return average_profiler
+              .GetAverageElapsedTime<std::chrono::microseconds>();
+        };
+
+        const int64_t latency = profile(1);
+        worker_profile.latencies[subgraph_key] = {latency, latency};
+        for (int batch_size : engine_->GetBatchSizes(subgraph_key)) {
+          const int64_t batch_latency = profile(batch_size);
+          worker_profile.batch_latencies[subgraph_key][batch_size] = {
+              batch_latency, batch_latency};
+        }
+      }
+    });
+    return absl::OkStatus();
+  });
+
+  {
+    // Let the clock run the profile thread while this one is blocked
+    Clock* clock = engine_->GetClock();
+    const bool is_attached = clock->IsThreadAttached();
+    if (is_attached) {
+      clock->DetachThread();
+    }
+    profile_thread.join();
+    if (is_attached) {
+      clock->AttachThread();
+    }
+  }
+
+  // resume worker
+  worker->Resume();
+  return worker_profile;
+}
+
+void LatencyEstimator::EstimateUnprofiled(ModelId model_id) {
+  engine_->ForEachSubgraph([&](const SubgraphKey& key) {
+    if (key.GetModelId() != model_id || engine_->IsMaterialized(key) ||
+        profile_database_.find(key) != profile_database_.end()) {
+      return;
+    }
+    int64_t latency = 0;
+    for (int unit_index : key.GetUnitIndicesSet()) {
+      auto it = profile_database_.find(
+          SubgraphKey(model_id, key.GetWorkerId(), {unit_index}));
+      if (it == profile_database_.end()) {
+        return;
+      }
+      latency += it->second.moving_averaged;
+    }
+    Latency estimated = {latency, latency};
+    estimated.is_estimated = true;
+    profile_database_[key] = estimated;
+  });
+}
+
+uint32_t LatencyEstimator::GetEpoch(ModelId model_id) const {
+  return epochs_[model_id % kNumEpochs].load(std::memory_order_acquire);
+}
+
+void LatencyEstimator::BumpEpoch(ModelId model_id) {
+  epochs_[model_id % kNumEpochs].fetch_add(1, std::memory_order_acq_rel);
+}
+
+int64_t LatencyEstimator::GetProfiled(const SubgraphKey& key,
+                                      int batch_size) const {
+  if (batch_size > 1) {
+    auto it = batch_profile_database_.find(key);
+    if (it != batch_profile_database_.end() &&
+        it->second.find(batch_size) != it->second.end()) {
+      return it->second.at(batch_size).profiled;
+    }
+    const int64_t profiled = GetProfiled(key);
+    return profiled < 0 ? profiled : profiled * batch_size;
+  }
+
   auto it = profile_database_.find(key);
   if (it != profile_database_.end()) {
     return it->second.profiled;
@@ -153,7 +312,17 @@ int64_t LatencyEstimator::GetProfiled(const SubgraphKey& key) const {
   }
 }
 
-int64_t LatencyEstimator::GetExpected(const SubgraphKey& key) const {
+int64_t LatencyEstimator::GetExpected(const SubgraphKey& key,
+                                      int batch_size) const {
+  if (batch_size > 1) {
+    auto it = batch_profile_database_.find(key);
+    if (it != batch_profile_database_.end() &&
+        it->second.find(batch_size) != it->second.end()) {
+      return it->second.at(batch_size).moving_averaged;
+    }
+    return GetExpected(key) * batch_size;
+  }
+
   auto it = profile_database_.find(key);
   if (it != profile_database_.end()) {
     return it->second.moving_averaged;
@@ -195,20 +364,6 @@ size_t LatencyEstimator::GetProfileHash() const {
 std::map<SubgraphKey, LatencyEstimator::Latency>
 LatencyEstimator::JsonToModelProfile(const std::string& model_fname,
                                      const int model_id) {
-  auto string_to_indices = [](std::string index_string) {
-    std::set<int> node_indices;
-    std::stringstream ss(index_string);
-
-    for (int i; ss >> i;) {
-      node_indices.insert(i);
-      if (ss.peek() == ',') {
-        ss.ignore();
-      }
-    }
-
-    return node_indices;
-  };
-
   std::map<SubgraphKey, LatencyEstimator::Latency> id_profile;
   if (profile_database_json_["hash"].asUInt64() != GetProfileHash()) {
     BAND_LOG(
@@ -236,7 +391,7 @@ LatencyEstimator::JsonToModelProfile(const std::string& model_fname,
     for (auto idx_profile_it = idx_profile.begin();
          idx_profile_it != idx_profile.end(); ++idx_profile_it) {
       std::string unit_indices_string = idx_profile_it.key().asString();
-      std::set<int> unit_indices = string_to_indices(unit_indices_string);
+      std::set<int> unit_indices = StringToIndices(unit_indices_string);
 
       const Json::Value device_profile = *idx_profile_it;
       for (auto device_profile_it = device_profile.begin();
@@ -258,10 +413,56 @@ LatencyEstimator::JsonToModelProfile(const std::string& model_fname,
   return id_profile;
 }
 
+std::map<SubgraphKey, std::map<int, LatencyEstimator::Latency>>
+LatencyEstimator::JsonToBatchProfile(const std::string& model_fname,
+                                     const int model_id) {
+  std::map<SubgraphKey, std::map<int, LatencyEstimator::Latency>> id_profile;
+  // A mismatching hash is already reported by JsonToModelProfile()
+  if (profile_database_json_["hash"].asUInt64() != GetProfileHash() ||
+      !profile_database_json_["batch"].isMember(model_fname)) {
+    return id_profile;
+  }
+
+  // "batch": {model name: {unit indices: {batch size: [latency per worker]}}}
+  const Json::Value idx_profile = profile_database_json_["batch"][model_fname];
+  for (auto idx_profile_it = idx_profile.begin();
+       idx_profile_it != idx_profile.end(); ++idx_profile_it) {
+    std::set<int> unit_indices =
+        StringToIndices(idx_profile_it.key().asString());
+
+    const Json::Value batch_profile = *idx_profile_it;
+    for (auto batch_profile_it = batch_profile.begin();
+         batch_profile_it != batch_profile.end(); ++batch_profile_it) {
+      const int batch_size = std::atoi(batch_profile_it.key().asCString());
+      if (batch_size <= 1) {
+        continue;
+      }
+
+      const Json::Value device_profile = *batch_profile_it;
+      for (auto device_profile_it = device_profile.begin();
+           device_profile_it != device_profile.end(); ++device_profile_it) {
+        int worker_id = device_profile_it.key().asInt();
+        int64_t profiled_latency = (*device_profile_it).asInt64();
+
+        if (profiled_latency <= 0) {
+          continue;
+        }
+
+        SubgraphKey key(model_id, worker_id, unit_indices);
+        id_profile[key][batch_size] = {profiled_latency, profiled_latency};
+      }
+    }
+  }
+  return id_profile;
+}
+
 Json::Value LatencyEstimator::ProfileToJson() {
   Json::Value name_profile;
   name_profile["hash"] = GetProfileHash();
   for (auto& pair : profile_database_) {
+    if (pair.second.is_estimated) {
+      continue;
+    }
     SubgraphKey key = pair.first;
     const int model_id = key.GetModelId();
     const int64_t profiled_latency = pair.second.profiled;
@@ -280,6 +481,19 @@ Json::Value LatencyEstimator::ProfileToJson() {
       continue;
     }
   }
+  for (auto& pair : batch_profile_database_) {
+    const SubgraphKey& key = pair.first;
+    // models without a name are already reported above
+    auto model_spec = engine_->GetModelSpec(key.GetModelId());
+    if (!model_spec || model_spec->path.empty()) {
+      continue;
+    }
+    for (auto& batch_latency : pair.second) {
+      name_profile["batch"][model_spec->path][key.GetUnitIndicesString()]
+                  [std::to_string(batch_latency.first)][key.GetWorkerId()] =
+                      batch_latency.second.profiled;
+    }
+  }
   return name_profile;
 }
 
@@ -19,7 +19,10 @@
 
 #include <json/json.h>
 
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <map>
 #include <unordered_map>
 
 #include "absl/status/status.h"
@@ -32,12 +35,24 @@ class LatencyEstimator {
  public:
   explicit LatencyEstimator(IEngine* engine);
   absl::Status Init(const ProfileConfig& config);
-  void UpdateLatency(const SubgraphKey& key, int64_t latency);
-
+  // `batch_size` > 1 refers to the latency of a batched invoke (see
+  // `IEngine::GetBatchSizes`). Batch sizes without a profile are assumed to
+  // scale linearly with the latency of a single request.
+  void UpdateLatency(const SubgraphKey& key, int64_t latency,
+                     int batch_size = 1);
+
+  // Profiles the subgraphs of the model if profiling is online, pausing one
+  // worker at a time. Workers are profiled in parallel on the real clock,
+  // and one after another on a virtual clock to keep runs deterministic.
   absl::Status ProfileModel(ModelId model_id);
-  int64_t GetProfiled(const SubgraphKey& key) const;
-  int64_t GetExpected(const SubgraphKey& key) const;
+  int64_t GetProfiled(const SubgraphKey& key, int batch_size = 1) const;
+  int64_t GetExpected(const SubgraphKey& key, int batch_size = 1) const;
   int64_t GetWorst(ModelId model_id) const;
+  // Bumped whenever the model is profiled, or the expected latency of one of
+  // its subgraphs drifts by more than `latency_drift_threshold` since the
+  // last bump. Results derived from the expected latencies of the model are
+  // stale once its epoch changes.
+  uint32_t GetEpoch(ModelId model_id) const;
 
   absl::Status DumpProfile();
 
@@ -45,15 +60,37 @@ class LatencyEstimator {
   struct Latency {
     int64_t profiled;
     int64_t moving_averaged;
+    // `moving_averaged` at the last epoch bump (0 if not bumped yet)
+    int64_t epoch_latency = 0;
+    // Sum of the latencies of the unit subgraphs, for a lazy subgraph that
+    // has not run yet. Replaced by its first measurement.
+    bool is_estimated = false;
   };
 
  private:
+  // Profiled latencies of the subgraphs of a model on one worker
+  struct WorkerProfile {
+    std::unordered_map<SubgraphKey, Latency, SubgraphHash> latencies;
+    std::unordered_map<SubgraphKey, std::map<int, Latency>, SubgraphHash>
+        batch_latencies;
+  };
+  // Pauses the worker, invokes the subgraphs of the model on it from a
+  // thread with the affinity of the worker, and resumes it.
+  WorkerProfile ProfileWorker(ModelId model_id, WorkerId worker_id);
+
   size_t GetProfileHash() const;
+  void BumpEpoch(ModelId model_id);
+  // Estimates the subgraphs of the model that are not materialized and have
+  // no profile, from their unit subgraphs.
+  void EstimateUnprofiled(ModelId model_id);
 
   // Convert entries in the json value to ModelDeviceToLatency format,
   // for the given model name and target model id.
   std::map<SubgraphKey, Latency> JsonToModelProfile(
       const std::string& model_fname, const int model_id);
+  // Same as `JsonToModelProfile`, for the batched invokes of the model.
+  std::map<SubgraphKey, std::map<int, Latency>> JsonToBatchProfile(
+      const std::string& model_fname, const int model_id);
 
   // Convert model integer ids back to string-type names for model profiles,
   // and returns the json format identical to `profile_database_json_`.
@@ -71,7 +108,16 @@ class LatencyEstimator {
   Json::Value profile_database_json_;
 
   std::unordered_map<SubgraphKey, Latency, SubgraphHash> profile_database_;
+  // Latency of batched invokes, per batch size
+  std::unordered_map<SubgraphKey, std::map<int, Latency>, SubgraphHash>
+      batch_profile_database_;
   float profile_smoothing_factor_ = 0.05f;
+  float latency_drift_threshold_ = 0.1f;
+
+  // Epochs per model. Models whose ids collide share an epoch, which only
+  // invalidates more than needed.
+  static constexpr size_t kNumEpochs = 256;
+  std::array<std::atomic<uint32_t>, kNumEpochs> epochs_{};
 
   bool profile_online_;
   int profile_num_warmups_;
@@ -14,12 +14,15 @@
 
 #include "band/logger.h"
 
+#include <chrono>
 #include <cstdarg>
+#include <cstdint>
 #include <cstdio>
-#include <mutex>
+#include <cstdlib>
+#include <cstring>
 
 #include "absl/strings/str_format.h"
-
+#include "band/time.h"
 
 #ifdef __ANDROID__
 #include <android/log.h>
@@ -45,74 +48,232 @@ int LogSeverityToAndroid(band::LogSeverity severity) {
 
 namespace band {
 
+namespace {
+constexpr size_t kNumCallSites = 256;
+// Slots of the call site table probed before a format is not rate limited
+constexpr size_t kMaxProbes = 8;
+constexpr int64_t kRateLimitWindowUs = 1000000;
+}  // anonymous namespace
+
+struct Logger::Record {
+  // Equals the enqueue position that can claim the record, and that plus
+  // one once the message is written (bounded MPMC queue of D. Vyukov)
+  std::atomic<size_t> sequence{0};
+  LogSeverity severity = LogSeverity::kInfo;
+  char message[kMaxMessageLength];
+};
+
+struct Logger::CallSite {
+  std::atomic<const char*> format{nullptr};
+  std::atomic<int64_t> window_start{0};
+  std::atomic<int> count{0};
+  std::atomic<int> suppressed{0};
+};
+
+Logger::Logger()
+    : records_(new Record[kQueueSize]),
+      call_sites_(new CallSite[kNumCallSites]),
+      reporters_(std::make_shared<const Reporters>()) {
+  for (size_t i = 0; i < kQueueSize; i++) {
+    records_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+  dispatch_thread_ = std::thread([this]() { Dispatch(); });
+}
+
 Logger& Logger::Get() {
-  static Logger* logger = new Logger;
+  static Logger* logger = [] {
+    Logger* logger = new Logger;
+    // Writes out pending messages on a normal exit
+    std::atexit([] { Logger::Get().Flush(); });
+    return logger;
+  }();
   return *logger;
 }
 
 CallbackId Logger::SetReporter(
     std::function<void(LogSeverity, const char*)> reporter) {
+  std::lock_guard<std::mutex> lock(reporter_mtx_);
   CallbackId id = next_callback_id_++;
-  reporters_[id] = reporter;
+  auto reporters = std::make_shared<Reporters>(*reporters_);
+  (*reporters)[id] = reporter;
+  reporters_ = reporters;
   return id;
 }
 
 absl::Status Logger::RemoveReporter(CallbackId callback_id) {
-  if (reporters_.find(callback_id) == reporters_.end()) {
-    return absl::InvalidArgumentError(
-        absl::StrFormat("The given callback id does not exist. %d",
-                        static_cast<int>(callback_id)));
+  {
+    std::lock_guard<std::mutex> lock(reporter_mtx_);
+    if (reporters_->find(callback_id) == reporters_->end()) {
+      return absl::InvalidArgumentError(
+          absl::StrFormat("The given callback id does not exist. %d",
+                          static_cast<int>(callback_id)));
+    }
+    auto reporters = std::make_shared<Reporters>(*reporters_);
+    reporters->erase(callback_id);
+    reporters_ = reporters;
   }
-  reporters_.erase(callback_id);
+  // The logging thread may still hold the previous reporters
+  Flush();
   return absl::OkStatus();
 }
 
 std::pair<LogSeverity, std::string> Logger::GetLastLog() const {
+  Flush();
+  std::lock_guard<std::mutex> lock(reporter_mtx_);
   return last_message_;
 }
 
+void Logger::Flush() const {
+  if (std::this_thread::get_id() == dispatch_thread_.get_id()) {
+    return;
+  }
+  const size_t target = enqueue_pos_.load(std::memory_order_acquire);
+  std::unique_lock<std::mutex> lock(dispatch_mtx_);
+  while (dequeue_pos_.load(std::memory_order_acquire) < target) {
+    dispatch_cv_.notify_one();
+    // Producers and the logging thread notify without the lock, so that a
+    // wakeup can be missed
+    flush_cv_.wait_for(lock, std::chrono::milliseconds(1));
+  }
+}
+
 void Logger::DebugLog(const char* format, ...) {
-  static std::mutex log_mutex;
-  std::lock_guard<std::mutex> lock(log_mutex);
   va_list args;
   va_start(args, format);
-  LogFormatted(LogSeverity::kInfo, format, args);
+  Push(LogSeverity::kInfo, format, args);
   va_end(args);
 }
 
 void Logger::Log(LogSeverity severity, const char* format, ...) {
-  if (verbosity_ <= severity) {
-    static std::mutex log_mutex;
-    std::lock_guard<std::mutex> lock(log_mutex);
-    va_list args;
-    va_start(args, format);
-    LogFormatted(severity, format, args);
-    va_end(args);
-
-    for (const auto& reporter : reporters_) {
-      reporter.second(severity, format);
+  if (!IsEnabled(severity)) {
+    return;
+  }
+  va_list args;
+  va_start(args, format);
+  Push(severity, format, args);
+  va_end(args);
+}
+
+int Logger::Admit(const char* format) {
+  const int limit = rate_limit_.load(std::memory_order_relaxed);
+  if (limit <= 0) {
+    return 0;
+  }
+  const size_t hash =
+      (reinterpret_cast<uintptr_t>(format) * 0x9E3779B97F4A7C15ull) >> 32;
+  for (size_t probe = 0; probe < kMaxProbes; probe++) {
+    CallSite& site = call_sites_[(hash + probe) % kNumCallSites];
+    const char* site_format = site.format.load(std::memory_order_acquire);
+    if (site_format == nullptr &&
+        site.format.compare_exchange_strong(site_format, format,
+                                            std::memory_order_acq_rel)) {
+      site_format = format;
+    }
+    if (site_format != format) {
+      continue;
     }
 
-    last_message_ = std::make_pair(severity, format);
+    const int64_t now = static_cast<int64_t>(time::NowMicros());
+    int64_t window_start = site.window_start.load(std::memory_order_relaxed);
+    if (now - window_start >= kRateLimitWindowUs &&
+        site.window_start.compare_exchange_strong(
+            window_start, now, std::memory_order_relaxed)) {
+      site.count.store(1, std::memory_order_relaxed);
+      return site.suppressed.exchange(0, std::memory_order_relaxed);
+    }
+    if (site.count.fetch_add(1, std::memory_order_relaxed) < limit) {
+      return 0;
+    }
+    site.suppressed.fetch_add(1, std::memory_order_relaxed);
+    return -1;
   }
+  // The table is crowded, do not limit
+  return 0;
 }
 
-void Logger::LogFormatted(LogSeverity severity, const char* format,
-                          va_list args) {
-  static std::mutex log_mutex;
-  std::lock_guard<std::mutex> lock(log_mutex);
-  fprintf(stderr, "%s: ", ToString(severity));
+void Logger::Push(LogSeverity severity, const char* format, va_list args) {
+  const int num_suppressed = Admit(format);
+  if (num_suppressed < 0) {
+    return;
+  }
+
+  size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+  Record* record = nullptr;
+  while (true) {
+    record = &records_[pos % kQueueSize];
+    const size_t sequence = record->sequence.load(std::memory_order_acquire);
+    const intptr_t diff =
+        static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+    if (diff == 0) {
+      if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                             std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      // The logging thread did not release the record of the previous lap
+      num_dropped_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    } else {
+      pos = enqueue_pos_.load(std::memory_order_relaxed);
+    }
+  }
+
+  record->severity = severity;
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wformat-nonliteral"
-  vfprintf(stderr, format, args);
+  vsnprintf(record->message, kMaxMessageLength, format, args);
 #pragma clang diagnostic pop
-  fputc('\n', stderr);
+  if (num_suppressed > 0) {
+    const size_t length = strlen(record->message);
+    snprintf(record->message + length, kMaxMessageLength - length,
+             " (%d similar messages suppressed)", num_suppressed);
+  }
+  record->sequence.store(pos + 1, std::memory_order_release);
+  dispatch_cv_.notify_one();
+}
 
+void Logger::Dispatch() {
+  size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+  while (true) {
+    Record& record = records_[pos % kQueueSize];
+    auto is_ready = [&record, pos]() {
+      return record.sequence.load(std::memory_order_acquire) == pos + 1;
+    };
+    if (!is_ready()) {
+      std::unique_lock<std::mutex> lock(dispatch_mtx_);
+      dispatch_cv_.wait_for(lock, std::chrono::milliseconds(10), is_ready);
+      continue;
+    }
+
+    const LogSeverity severity = record.severity;
+    const char* message = record.message;
+    fprintf(stderr, "%s: %s\n", ToString(severity), message);
 #ifdef __ANDROID__
-  __android_log_vprint(LogSeverityToAndroid(severity), "BAND", format, args);
+    __android_log_write(LogSeverityToAndroid(severity), "BAND", message);
 #endif
+
+    std::shared_ptr<const Reporters> reporters;
+    {
+      std::lock_guard<std::mutex> lock(reporter_mtx_);
+      reporters = reporters_;
+      last_message_ = std::make_pair(severity, std::string(message));
+    }
+    for (const auto& reporter : *reporters) {
+      reporter.second(severity, message);
+    }
+
+    record.sequence.store(pos + kQueueSize, std::memory_order_release);
+    dequeue_pos_.store(++pos, std::memory_order_release);
+    flush_cv_.notify_all();
+  }
+}
+
+void Logger::SetVerbosity(LogSeverity severity) {
+  verbosity_.store(severity, std::memory_order_relaxed);
 }
 
-void Logger::SetVerbosity(LogSeverity severity) { verbosity_ = severity; }
+void Logger::SetRateLimit(int messages_per_second) {
+  rate_limit_.store(messages_per_second, std::memory_order_relaxed);
+}
 
-}  // namespace band
\ No newline at end of file
+}  // namespace band
@@ -17,10 +17,15 @@
 #ifndef BAND_LOGGER_H_
 #define BAND_LOGGER_H_
 
+#include <atomic>
+#include <condition_variable>
 #include <cstdarg>
 #include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 
 #include "absl/status/status.h"
 #include "band/common.h"
@@ -32,39 +37,91 @@ namespace band {
   sources.
 
   The logger can be configured to log at a certain verbosity level, e.g., only
-  warnings and errors if its verbosity is set to kWarning. The def
+  warnings and errors if its verbosity is set to kWarning. The BAND_LOG macros
+  check the verbosity before their arguments are evaluated. The def
   provides two additional ways to handle log messages. First, the logger can be
   configured to report log messages to user-defined reporter function. Second,
   the logger provides a way to retrieve the last log message via
   GetLastLog().
+
+  Logging does not block the calling thread. A message is formatted on the
+  calling thread into a fixed-size record of a bounded lock-free queue, and a
+  background thread writes it out and invokes the reporters. A message is
+  dropped if the queue is full, and a call site that logs more than the rate
+  limit per second is muted for the rest of that second. Flush() waits until
+  the messages logged so far are out.
 */
 
 class Logger {
  public:
+  // Longer messages are truncated
+  static constexpr size_t kMaxMessageLength = 512;
+  // Messages that can be pending at a time
+  static constexpr size_t kQueueSize = 256;
+  // Messages per second per call site
+  static constexpr int kDefaultRateLimit = 100;
+
   static Logger& Get();
 
   void SetVerbosity(LogSeverity severity);
+  bool IsEnabled(LogSeverity severity) const {
+    return verbosity_.load(std::memory_order_relaxed) <= severity;
+  }
+  // Messages per second per call site (format string), 0 to disable
+  void SetRateLimit(int messages_per_second);
+  // Reporters are invoked with the formatted message on the logging thread
   CallbackId SetReporter(
       std::function<void(LogSeverity, const char*)> reporter);
   absl::Status RemoveReporter(CallbackId callback_id);
   std::pair<LogSeverity, std::string> GetLastLog() const;
+  // Waits until all messages logged before the call are written and reported
+  void Flush() const;
+  // Messages dropped because the queue was full
+  size_t GetNumDropped() const {
+    return num_dropped_.load(std::memory_order_relaxed);
+  }
 
   // DebugLog is only enabled in debug mode.
   void DebugLog(const char* format, ...);
   void Log(LogSeverity severity, const char* format, ...);
 
  private:
-  void LogFormatted(LogSeverity severity, const char* format, va_list args);
-
-  Logger() = default;
+  struct Record;
+  struct CallSite;
+  using Reporters =
+      std::map<CallbackId, std::function<void(LogSeverity, const char*)>>;
+
+  // Returns the number of messages suppressed at the call site since its
+  // last logged message, or -1 if this message is suppressed
+  int Admit(const char* format);
+  void Push(LogSeverity severity, const char* format, va_list args);
+  void Dispatch();
+
+  Logger();
   Logger(const Logger&) = delete;
   Logger& operator=(const Logger&) = delete;
 
-  CallbackId next_callback_id_ = 0;
-  std::map<CallbackId, std::function<void(LogSeverity, const char*)>>
-      reporters_;
+  std::atomic<LogSeverity> verbosity_{LogSeverity::kInfo};
+  std::atomic<int> rate_limit_{kDefaultRateLimit};
+  std::atomic<size_t> num_dropped_{0};
 
-  LogSeverity verbosity_ = LogSeverity::kInfo;
+  std::unique_ptr<Record[]> records_;
+  std::unique_ptr<CallSite[]> call_sites_;
+  std::atomic<size_t> enqueue_pos_{0};
+  std::atomic<size_t> dequeue_pos_{0};
+
+  // The logging thread sleeps on `dispatch_cv_`, Flush() on `flush_cv_`
+  mutable std::mutex dispatch_mtx_;
+  mutable std::condition_variable dispatch_cv_;
+  mutable std::condition_variable flush_cv_;
+  std::thread dispatch_thread_;
+
+  // Guards the reporters and the last message, not the logging
+  mutable std::mutex reporter_mtx_;
+  CallbackId next_callback_id_ = 0;
+  // Replaced on change, so that the logging thread can invoke the reporters
+  // without holding the lock
+  std::shared_ptr<const Reporters> reporters_;
   std::pair<LogSeverity, std::string> last_message_;
 };
 }  // namespace band
@@ -78,8 +135,13 @@ class Logger {
   band::Logger::Get().DebugLog(format, ##__VA_ARGS__);
 #endif
 
-#define BAND_LOG(severity, format, ...) \
-  band::Logger::Get().Log(severity, format, ##__VA_ARGS__);
+// Arguments are evaluated only if `severity` is enabled
+#define BAND_LOG(severity, format, ...)                         \
+  do {                                                          \
+    if (band::Logger::Get().IsEnabled(severity)) {              \
+      band::Logger::Get().Log(severity, format, ##__VA_ARGS__); \
+    }                                                           \
+  } while (false);
 
 // Convenience macro for logging a statement *once* for a given process lifetime
 #define BAND_LOG_ONCE(severity, format, ...)    \
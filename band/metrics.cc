@@ -0,0 +1,88 @@
+// Copyright 2023 Seoul National University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "band/metrics.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "absl/numeric/bits.h"
+
+namespace band {
+
+double HistogramSnapshot::GetMean() const {
+  return count == 0 ? 0. : static_cast<double>(sum) / count;
+}
+
+int64_t HistogramSnapshot::GetPercentile(double percentile) const {
+  if (count == 0) {
+    return 0;
+  }
+  const size_t rank = std::max<size_t>(
+      1, static_cast<size_t>(std::ceil(percentile / 100. * count)));
+  size_t num_values = 0;
+  for (size_t i = 0; i < buckets.size(); i++) {
+    num_values += buckets[i];
+    if (num_values >= rank) {
+      const int64_t upper_bound = i == 0 ? 0 : (int64_t{1} << i) - 1;
+      return std::min(upper_bound, max);
+    }
+  }
+  return max;
+}
+
+void Histogram::Record(int64_t value) {
+  const size_t index =
+      value < 1 ? 0
+                : std::min<size_t>(
+                      absl::bit_width(static_cast<uint64_t>(value)),
+                      kNumBuckets - 1);
+  buckets_[index].fetch_add(1, std::memory_order_relaxed);
+  sum_.fetch_add(value, std::memory_order_relaxed);
+
+  int64_t max = max_.load(std::memory_order_relaxed);
+  while (value > max &&
+         !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+  }
+}
+
+HistogramSnapshot Histogram::GetSnapshot() const {
+  HistogramSnapshot snapshot;
+  snapshot.buckets.reserve(kNumBuckets);
+  // count from the buckets, so that percentiles stay consistent with it
+  for (const auto& bucket : buckets_) {
+    snapshot.buckets.push_back(bucket.load(std::memory_order_relaxed));
+    snapshot.count += snapshot.buckets.back();
+  }
+  snapshot.sum = sum_.load(std::memory_order_relaxed);
+  snapshot.max = max_.load(std::memory_order_relaxed);
+  return snapshot;
+}
+
+std::vector<std::pair<std::string, int64_t>> Metrics::Flatten() const {
+  std::map<std::string, int64_t> values(counters.begin(), counters.end());
+  values.insert(gauges.begin(), gauges.end());
+  for (const auto& it : histograms) {
+    const HistogramSnapshot& histogram = it.second;
+    values[it.first + ".count"] = histogram.count;
+    values[it.first + ".sum"] = histogram.sum;
+    values[it.first + ".max"] = histogram.max;
+    values[it.first + ".p50"] = histogram.GetPercentile(50);
+    values[it.first + ".p90"] = histogram.GetPercentile(90);
+    values[it.first + ".p99"] = histogram.GetPercentile(99);
+  }
+  return {values.begin(), values.end()};
+}
+
+}  // namespace band
@@ -0,0 +1,109 @@
+/*
+ * Copyright 2023 Seoul National University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BAND_METRICS_H_
+#define BAND_METRICS_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace band {
+
+/*
+  Always-on runtime metrics.
+
+  Components own their metrics as members and update them with relaxed
+  atomics only, so an update never takes a lock and costs a few
+  nanoseconds. `Engine::GetMetrics` reads all of them into a `Metrics`
+  snapshot by name.
+*/
+
+// A count that only goes up.
+class Counter {
+ public:
+  void Increment(int64_t delta = 1) {
+    value_.fetch_add(delta, std::memory_order_relaxed);
+  }
+  int64_t Get() const { return value_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<int64_t> value_{0};
+};
+
+// A value that goes up and down, e.g., the length of a queue.
+class Gauge {
+ public:
+  void Add(int64_t delta) {
+    value_.fetch_add(delta, std::memory_order_relaxed);
+  }
+  void Set(int64_t value) { value_.store(value, std::memory_order_relaxed); }
+  int64_t Get() const { return value_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<int64_t> value_{0};
+};
+
+struct HistogramSnapshot {
+  size_t count = 0;
+  int64_t sum = 0;
+  int64_t max = 0;
+  // `buckets[0]` counts the values below 1, and `buckets[i]` the values in
+  // [2^(i-1), 2^i)
+  std::vector<size_t> buckets;
+
+  double GetMean() const;
+  // Upper bound of the bucket of the `percentile`-th (0 to 100) value,
+  // capped by `max`. Within a factor of 2 of the exact value.
+  int64_t GetPercentile(double percentile) const;
+};
+
+// Distribution of non-negative values (e.g., durations in us) in
+// power-of-two buckets.
+class Histogram {
+ public:
+  // Values of 2^38 and above share the last bucket
+  static constexpr size_t kNumBuckets = 40;
+
+  void Record(int64_t value);
+  HistogramSnapshot GetSnapshot() const;
+
+ private:
+  std::array<std::atomic<size_t>, kNumBuckets> buckets_{};
+  std::atomic<int64_t> sum_{0};
+  std::atomic<int64_t> max_{0};
+};
+
+// Values of the engine metrics at one point in time, by name. Values of
+// different metrics are not read atomically with each other.
+struct Metrics {
+  std::map<std::string, int64_t> counters;
+  std::map<std::string, int64_t> gauges;
+  std::map<std::string, HistogramSnapshot> histograms;
+
+  // All values as (name, value) pairs in the order of their names.
+  // A histogram becomes `<name>.count`, `.sum`, `.max`, `.p50`, `.p90` and
+  // `.p99`.
+  std::vector<std::pair<std::string, int64_t>> Flatten() const;
+};
+
+}  // namespace band
+
+#endif  // BAND_METRICS_H_
@@ -14,29 +14,39 @@
 
 #include "band/planner.h"
 
+#include <algorithm>
 #include <fstream>
+#include <thread>
 
 #include "absl/strings/str_format.h"
 #include "band/engine_interface.h"
 #include "band/job_tracer.h"
 #include "band/logger.h"
 #include "band/model_spec.h"
+#include "band/runtime_tracer.h"
 #include "band/scheduler/fixed_worker_scheduler.h"
 #include "band/scheduler/heterogeneous_earliest_finish_time_scheduler.h"
 #include "band/scheduler/least_slack_first_scheduler.h"
 #include "band/scheduler/round_robin_scheduler.h"
 #include "band/scheduler/shortest_expected_latency_scheduler.h"
-#include "band/time.h"
 
 namespace band {
 
-Planner::Planner(IEngine& engine) : num_submitted_jobs_(0), engine_(engine) {
+Planner::Planner(IEngine& engine)
+    : planner_safe_bool_(engine.GetClock()),
+      batcher_(engine),
+      jobs_(NUM_FINISHED_RECORDS),
+      num_submitted_jobs_(0),
+      end_invoke_(engine.GetClock()),
+      engine_(engine) {
   planner_thread_ = std::thread([this] {
+    engine_.GetClock()->AttachThread();
     auto status = this->Plan();
     if (!status.ok()) {
       BAND_LOG(LogSeverity::kError, "Planner thread failed: %s",
                status.ToString().c_str());
     }
+    engine_.GetClock()->DetachThread();
   });
 }
 
@@ -51,6 +61,8 @@ Planner::~Planner() {
 absl::Status Planner::Init(const PlannerConfig& config) {
   schedule_window_size_ = config.schedule_window_size;
   log_path_ = config.log_path;
+  batcher_.Init(config.max_batch_size, config.batch_timeout_us);
+  min_planning_interval_us_ = config.min_planning_interval_us;
 
   auto& schedulers = config.schedulers;
   if (schedulers.size() == 0 || schedulers.size() > 2) {
@@ -85,6 +97,8 @@ absl::Status Planner::Init(const PlannerConfig& config) {
     } else {
       return absl::InternalError("[Planner] Unsupported scheduler type.");
     }
+    scheduler_names_.push_back(ToString(schedulers[i]));
+    num_scheduled_jobs_.emplace_back(new Counter);
 
     // Checks if all the schedulers have the same requirements for the
     // fallback subgraphs.
@@ -116,6 +130,9 @@ absl::Status Planner::Init(const PlannerConfig& config) {
 absl::Status Planner::AddScheduler(std::unique_ptr<IScheduler> scheduler) {
   schedulers_.emplace_back(std::move(scheduler));
   local_queues_.resize(schedulers_.size());
+  scheduler_names_.push_back(
+      absl::StrFormat("scheduler_%d", schedulers_.size() - 1));
+  num_scheduled_jobs_.emplace_back(new Counter);
   return GetWorkerType() == (static_cast<int>(WorkerType::kDeviceQueue) |
                              static_cast<int>(WorkerType::kGlobalQueue))
              ? absl::InternalError(
@@ -124,95 +141,272 @@ absl::Status Planner::AddScheduler(std::unique_ptr<IScheduler> scheduler) {
 }
 
 JobId Planner::EnqueueRequest(Job job, bool push_front) {
-  return EnqueueBatch({job}, push_front)[0];
+  JobId job_id = -1;
+  JobHandle handle =
+      AllocJob(std::move(job), engine_.GetClock()->NowMicros());
+  if (handle.IsValid()) {
+    job_id = handle->job_id;
+    requests_.Push(handle, push_front);
+  }
+  planner_safe_bool_.notify();
+  return job_id;
 }
 
 std::vector<JobId> Planner::EnqueueBatch(std::vector<Job> jobs,
                                          bool push_front) {
-  std::vector<JobId> job_ids(jobs.size());
-  {
-    std::unique_lock<std::mutex> request_lock(requests_.mtx);
-    auto enqueue_time = time::NowMicros();
-    for (int i = 0; i < jobs.size(); i++) {
-      Job& job = jobs[i];
-      if (job.enqueue_time == 0) {
-        // job.enqueue_time may already be set if this model contains a fallback
-        // op, in which case we do not overwrite the set value
-        job.enqueue_time = enqueue_time;
-      }
-      if (job.job_id == -1) {
-        job.job_id = num_submitted_jobs_++;
-      }
-      job_ids[i] = job.job_id;
+  std::vector<JobId> job_ids(jobs.size(), -1);
+  std::vector<JobHandle> handles;
+  handles.reserve(jobs.size());
+  auto enqueue_time = engine_.GetClock()->NowMicros();
+  for (int i = 0; i < jobs.size(); i++) {
+    JobHandle handle = AllocJob(std::move(jobs[i]), enqueue_time);
+    if (!handle.IsValid()) {
+      continue;
     }
-
-    auto insert_position =
-        push_front ? requests_.queue.begin() : requests_.queue.end();
-    requests_.queue.insert(insert_position, jobs.begin(), jobs.end());
+    job_ids[i] = handle->job_id;
+    handles.push_back(handle);
   }
+  requests_.PushBatch(handles, push_front);
   planner_safe_bool_.notify();
   return job_ids;
 }
 
-void Planner::Wait(std::vector<int> job_ids) {
-  if (job_ids.size() == 0) {
-    return;
+void Planner::ReenqueueBatch(const std::vector<JobHandle>& jobs) {
+  requests_.PushBatch(jobs, true);
+  planner_safe_bool_.notify();
+}
+
+JobHandle Planner::AllocJob(Job&& job, int64_t enqueue_time) {
+  if (job.enqueue_time == 0) {
+    // job.enqueue_time may already be set if this model contains a fallback
+    // op, in which case we do not overwrite the set value
+    job.enqueue_time = enqueue_time;
+  }
+  if (job.ready_time == 0) {
+    job.ready_time = job.enqueue_time;
   }
+  JobHandle handle = jobs_.Alloc(std::move(job));
+  if (handle.IsValid() && handle->job_id == -1) {
+    // Tracked from the moment the id exists, so that it never reads as
+    // finished before it is
+    std::lock_guard<std::mutex> lock(completions_mtx_);
+    handle->job_id = num_submitted_jobs_++;
+    completions_.emplace(handle->job_id, std::make_shared<Completion>(
+                                             handle->job_id, handle->model_id));
+  }
+  return handle;
+}
 
-  std::unique_lock<std::mutex> finished_lock(job_finished_mtx_);
-  end_invoke_.wait(finished_lock, [this, job_ids] {
-    for (int job_id : job_ids) {
-      if (!IsJobIdValid(job_id)) {
-        continue;
+template <typename Predicate>
+bool Planner::WaitUntil(const std::vector<JobId>& job_ids, int64_t timeout_us,
+                        Predicate is_done) {
+  // Resolved once, so that the jobs are not looked up again while waiting
+  std::vector<std::shared_ptr<Completion>> completions;
+  completions.reserve(job_ids.size());
+  for (JobId job_id : job_ids) {
+    completions.push_back(GetCompletion(job_id));
+  }
+  if (is_done(completions)) {
+    return true;
+  }
+
+  // Register before checking again, so that a completion in between is
+  // either seen by `is_done` or signals the waiter
+  Clock* clock = engine_.GetClock();
+  Waiter waiter(clock);
+  for (const auto& completion : completions) {
+    if (completion) {
+      std::lock_guard<std::mutex> lock(completion->waiters_mtx);
+      completion->waiters.push_back(&waiter);
+    }
+  }
+
+  const int64_t deadline_us =
+      timeout_us < 0 ? -1 : clock->NowMicros() + timeout_us;
+  bool done;
+  {
+    std::unique_lock<std::mutex> lock(waiter.mtx);
+    while (!(done = is_done(completions))) {
+      if (!waiter.cv.WaitUntil(lock, deadline_us,
+                               [&waiter]() { return waiter.signaled; })) {
+        break;
       }
-      if (jobs_finished_record_[GetJobRecordIndex(job_id)].job_id != job_id) {
-        return false;
+      waiter.signaled = false;
+    }
+  }
+
+  for (const auto& completion : completions) {
+    if (completion) {
+      std::lock_guard<std::mutex> lock(completion->waiters_mtx);
+      auto it = std::find(completion->waiters.begin(),
+                          completion->waiters.end(), &waiter);
+      if (it != completion->waiters.end()) {
+        completion->waiters.erase(it);
       }
     }
-    return true;
-  });
-  finished_lock.unlock();
+  }
+  return done;
+}
+
+bool Planner::Wait(const std::vector<JobId>& job_ids, int64_t timeout_us) {
+  return WaitUntil(
+      job_ids, timeout_us,
+      [](const std::vector<std::shared_ptr<Completion>>& completions) {
+        return std::all_of(completions.begin(), completions.end(),
+                           &Planner::IsFinished);
+      });
+}
+
+JobId Planner::WaitAny(const std::vector<JobId>& job_ids, int64_t timeout_us) {
+  JobId finished_job_id = -1;
+  WaitUntil(job_ids, timeout_us,
+            [&job_ids, &finished_job_id](
+                const std::vector<std::shared_ptr<Completion>>& completions) {
+              for (size_t i = 0; i < completions.size(); i++) {
+                if (IsFinished(completions[i])) {
+                  finished_job_id = job_ids[i];
+                  return true;
+                }
+              }
+              return false;
+            });
+  return finished_job_id;
+}
+
+bool Planner::IsJobFinished(JobId job_id) const {
+  return IsFinished(GetCompletion(job_id));
 }
 
 void Planner::WaitAll() {
   std::unique_lock<std::mutex> finished_lock(job_finished_mtx_);
-  end_invoke_.wait(finished_lock, [this]() {
+  end_invoke_.Wait(finished_lock, [this]() {
     return num_finished_jobs_ >= num_submitted_jobs_;
   });
 
   finished_lock.unlock();
 }
 
-void Planner::EnqueueFinishedJob(Job& job) {
-  std::unique_lock<std::mutex> finished_lock(job_finished_mtx_);
+void Planner::EnqueueFinishedJob(JobHandle handle) {
+  Job* job = handle.Get();
+  if (job == nullptr) {
+    BAND_LOG(LogSeverity::kError, "Finished job has a stale handle.");
+    return;
+  }
+
   const bool is_finished =
-      engine_.IsEnd(job.subgraph_key) || job.status != JobStatus::kSuccess;
+      engine_.IsEnd(job->subgraph_key) || job->status != JobStatus::kSuccess;
+  if (!is_finished) {
+    EnqueueFollowingJob(handle);
+    return;
+  }
+
+  if (job->batch_size > 1) {
+    // The other requests of the batch finish along with the leader
+    for (const JobHandle& member : batcher_.TakeMembers(job->job_id)) {
+      Job* member_job = member.Get();
+      if (member_job == nullptr) {
+        continue;
+      }
+      member_job->status = job->status;
+      member_job->subgraph_key = job->subgraph_key;
+      member_job->invoke_time = job->invoke_time;
+      member_job->end_time = job->end_time;
+      member_job->profiled_execution_time = job->profiled_execution_time;
+      member_job->expected_execution_time = job->expected_execution_time;
+      member_job->total_execution_time = job->total_execution_time;
+      member_job->planner_time = job->planner_time;
+      member_job->worker_queue_time = job->worker_queue_time;
+      member_job->input_copy_time = job->input_copy_time;
+      member_job->output_copy_time = job->output_copy_time;
+      member_job->resolved_unit_subgraphs = job->resolved_unit_subgraphs;
+      FinishJob(member);
+    }
+  }
+  FinishJob(handle);
+}
+
+void Planner::FinishJob(JobHandle handle) {
+  Job* job = handle.Get();
+  const JobId job_id = job->job_id;
+  const bool require_callback = job->require_callback;
+  const bool is_success = job->status == JobStatus::kSuccess;
+  num_finished_requests_.Increment();
+  if (job->slo_us > 0 && (job->status == JobStatus::kSLOViolation ||
+                          job->end_time - job->enqueue_time > job->slo_us)) {
+    num_slo_violations_.Increment();
+  }
   // record finished / failed job
-  if (is_finished) {
-    jobs_finished_record_[GetJobRecordIndex(job.job_id)] = job;
-    num_finished_jobs_++;
-    end_invoke_.notify_all();
+  Clock* clock = engine_.GetClock();
+  job->completion_time = clock->NowMicros();
+  RecordCompletion(*job);
+  jobs_.Release(handle);
+
+  std::unique_lock<std::mutex> finished_lock(job_finished_mtx_);
+  num_finished_jobs_++;
+  if (num_finished_jobs_ >= num_submitted_jobs_) {
+    end_invoke_.NotifyAll();
   }
   // make sure to unlock before calling callback to avoid
   // potential recursive locking from client code
   finished_lock.unlock();
 
   // report end invoke using callback
-  if (job.require_callback && is_finished) {
+  if (require_callback) {
     std::unique_lock<std::mutex> callback_lock(on_end_request_mtx_);
+    if (on_end_request_callbacks_.empty()) {
+      callback_lock.unlock();
+      RecordCallbackTime(job_id, 0);
+      return;
+    }
+    const int64_t callback_start_time = clock->NowMicros();
     for (auto& id_callback : on_end_request_callbacks_) {
-      id_callback.second(job.job_id, job.status == JobStatus::kSuccess
-                                         ? absl::OkStatus()
-                                         : absl::InternalError("Job failed."));
+      id_callback.second(job_id, is_success
+                                     ? absl::OkStatus()
+                                     : absl::InternalError("Job failed."));
     }
+    callback_lock.unlock();
+    RecordCallbackTime(job_id, clock->NowMicros() - callback_start_time);
   }
 }
 
+void Planner::EnqueueFollowingJob(JobHandle handle) {
+  // The remaining ops reuse the record of `job`: the request-wide state
+  // (id, handles, SLO, accumulated times) carries over and the per-subgraph
+  // state is reset as for a newly enqueued job. The inputs of `job` are
+  // already copied, so its key only has to be recorded.
+  Job& job = *handle;
+  job.previous_subgraph_keys.push_back(job.subgraph_key);
+  job.subgraph_key = SubgraphKey();
+  job.status = JobStatus::kQueued;
+  job.target_worker_id = -1;
+  job.invoke_time = 0;
+  job.end_time = 0;
+  job.dispatch_time = 0;
+  job.profiled_execution_time = 0;
+  job.expected_execution_time = 0;
+  job.completion_time = 0;
+  job.callback_time = 0;
+  job.batch_size = 1;
+  job.batch_input_handles.clear();
+  job.batch_output_handles.clear();
+  job.batch_deadline_us = -1;
+
+  requests_.Push(handle, true);
+  planner_safe_bool_.notify();
+}
+
+void Planner::Trigger() {
+  worker_event_.store(true, std::memory_order_release);
+  planner_safe_bool_.notify();
+}
+
 void Planner::PrepareReenqueue(Job& job) {
+  // the failed attempt is not accounted to any stage
+  job.ready_time = engine_.GetClock()->NowMicros();
+  job.dispatch_time = 0;
   job.invoke_time = 0;
   job.end_time = 0;
   job.resolved_unit_subgraphs = 0;
-  job.following_jobs.clear();
 }
 
 bool Planner::NeedFallbackSubgraphs() const {
@@ -226,14 +420,214 @@ void Planner::SetWindowSize(int schedule_window_size) {
   schedule_window_size_ = schedule_window_size;
 }
 
-Job Planner::GetFinishedJob(int job_id) {
-  std::lock_guard<std::mutex> request_lock(requests_.mtx);
-  if (IsJobIdValid(job_id) &&
-      jobs_finished_record_[GetJobRecordIndex(job_id)].job_id != -1) {
-    return jobs_finished_record_[GetJobRecordIndex(job_id)];
-  } else {
+void Planner::CollectMetrics(Metrics& metrics) const {
+  metrics.counters["planner.wakeups"] = GetNumWakeups();
+  metrics.counters["planner.scheduling_passes"] = GetNumSchedulingPasses();
+  metrics.counters["planner.finished_requests"] = num_finished_requests_.Get();
+  metrics.counters["planner.slo_violations"] = num_slo_violations_.Get();
+  metrics.counters["planner.early_drops"] = num_early_drops_.Get();
+  for (size_t i = 0; i < num_scheduled_jobs_.size(); ++i) {
+    metrics.counters["planner.scheduled_jobs." + scheduler_names_[i]] =
+        num_scheduled_jobs_[i]->Get();
+  }
+  metrics.gauges["planner.request_queue_depth"] = requests_.GetSize();
+  metrics.gauges["planner.local_queue_depth"] = local_queue_depth_.Get();
+  metrics.histograms["planner.pass_duration_us"] =
+      pass_duration_us_.GetSnapshot();
+}
+
+Job Planner::GetFinishedJob(int job_id) const {
+  std::shared_ptr<Completion> completion = GetCompletion(job_id);
+  if (!completion || !IsFinished(completion)) {
     return Job();
   }
+
+  Job job;
+  job.job_id = job_id;
+  job.model_id = completion->model_id;
+  uint32_t begin_sequence;
+  uint32_t end_sequence;
+  do {
+    begin_sequence = completion->sequence.load(std::memory_order_acquire);
+    job.status = completion->status.load(std::memory_order_relaxed);
+    job.output_handle =
+        completion->output_handle.load(std::memory_order_relaxed);
+    job.io_bound = completion->io_bound.load(std::memory_order_relaxed);
+    job.enqueue_time =
+        completion->enqueue_time.load(std::memory_order_relaxed);
+    job.end_time = completion->end_time.load(std::memory_order_relaxed);
+    job.total_execution_time =
+        completion->total_execution_time.load(std::memory_order_relaxed);
+    job.planner_time =
+        completion->planner_time.load(std::memory_order_relaxed);
+    job.worker_queue_time =
+        completion->worker_queue_time.load(std::memory_order_relaxed);
+    job.input_copy_time =
+        completion->input_copy_time.load(std::memory_order_relaxed);
+    job.output_copy_time =
+        completion->output_copy_time.load(std::memory_order_relaxed);
+    job.completion_time =
+        completion->completion_time.load(std::memory_order_relaxed);
+    job.callback_time =
+        completion->callback_time.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    end_sequence = completion->sequence.load(std::memory_order_relaxed);
+  } while ((begin_sequence & 1) || begin_sequence != end_sequence);
+  return job;
+}
+
+uint32_t Planner::BeginWrite(Completion& completion) {
+  // Take the completion from other writers by making the sequence odd
+  uint32_t sequence = completion.sequence.load(std::memory_order_relaxed);
+  while ((sequence & 1) ||
+         !completion.sequence.compare_exchange_weak(
+             sequence, sequence + 1, std::memory_order_acquire)) {
+    sequence = completion.sequence.load(std::memory_order_relaxed);
+  }
+  std::atomic_thread_fence(std::memory_order_release);
+  return sequence;
+}
+
+void Planner::EndWrite(Completion& completion, uint32_t sequence) {
+  completion.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+void Planner::RecordCompletion(const Job& job) {
+  std::shared_ptr<Completion> completion = GetCompletion(job.job_id);
+  if (!completion) {
+    BAND_LOG(LogSeverity::kError, "Finished job %d is not tracked.",
+             job.job_id);
+    engine_.ReleaseOutputHandle(job.model_id, job.output_handle);
+    return;
+  }
+
+  const uint32_t sequence = BeginWrite(*completion);
+  completion->status.store(job.status, std::memory_order_relaxed);
+  completion->output_handle.store(job.output_handle,
+                                  std::memory_order_relaxed);
+  completion->is_reported.store(!job.require_callback,
+                                std::memory_order_relaxed);
+  completion->io_bound.store(job.io_bound, std::memory_order_relaxed);
+  completion->enqueue_time.store(job.enqueue_time, std::memory_order_relaxed);
+  completion->end_time.store(job.end_time, std::memory_order_relaxed);
+  completion->total_execution_time.store(job.total_execution_time,
+                                         std::memory_order_relaxed);
+  completion->planner_time.store(job.planner_time, std::memory_order_relaxed);
+  completion->worker_queue_time.store(job.worker_queue_time,
+                                      std::memory_order_relaxed);
+  completion->input_copy_time.store(job.input_copy_time,
+                                    std::memory_order_relaxed);
+  completion->output_copy_time.store(job.output_copy_time,
+                                     std::memory_order_relaxed);
+  completion->completion_time.store(job.completion_time,
+                                    std::memory_order_relaxed);
+  completion->is_finished.store(true, std::memory_order_release);
+  EndWrite(*completion, sequence);
+
+  // Stop tracking the oldest finished job, whose outputs nobody can take
+  // anymore
+  std::shared_ptr<Completion> evicted;
+  {
+    std::lock_guard<std::mutex> lock(completions_mtx_);
+    finished_job_ids_.push_back(job.job_id);
+    if (finished_job_ids_.size() > NUM_FINISHED_RECORDS) {
+      auto it = completions_.find(finished_job_ids_.front());
+      evicted = std::move(it->second);
+      completions_.erase(it);
+      finished_job_ids_.pop_front();
+    }
+  }
+  if (evicted) {
+    const uint32_t evicted_sequence = BeginWrite(*evicted);
+    const int output_handle =
+        evicted->output_handle.load(std::memory_order_relaxed);
+    evicted->output_handle.store(-1, std::memory_order_relaxed);
+    evicted->is_output_taken.store(true, std::memory_order_relaxed);
+    EndWrite(*evicted, evicted_sequence);
+    if (output_handle >= 0) {
+      engine_.ReleaseOutputHandle(evicted->model_id, output_handle);
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(completion->waiters_mtx);
+  for (Waiter* waiter : completion->waiters) {
+    std::lock_guard<std::mutex> waiter_lock(waiter->mtx);
+    waiter->signaled = true;
+    waiter->cv.NotifyAll();
+  }
+}
+
+void Planner::RecordCallbackTime(JobId job_id, int64_t callback_time) {
+  std::shared_ptr<Completion> completion = GetCompletion(job_id);
+  if (!completion) {
+    return;
+  }
+  const uint32_t sequence = BeginWrite(*completion);
+  completion->callback_time.store(callback_time, std::memory_order_relaxed);
+  completion->is_reported.store(true, std::memory_order_relaxed);
+  EndWrite(*completion, sequence);
+}
+
+absl::StatusOr<int> Planner::TakeOutputHandle(JobId job_id) {
+  std::shared_ptr<Completion> completion = GetCompletion(job_id);
+  if (!completion || !IsFinished(completion)) {
+    return absl::InternalError("Invalid job id / not finished or invalidated.");
+  }
+  absl::StatusOr<int> output_handle = -1;
+  const uint32_t sequence = BeginWrite(*completion);
+  if (completion->is_output_taken.load(std::memory_order_relaxed)) {
+    output_handle = absl::FailedPreconditionError(absl::StrFormat(
+        "Outputs of job %d are already released (read, or reclaimed for "
+        "newer requests)",
+        job_id));
+  } else {
+    output_handle = completion->output_handle.load(std::memory_order_relaxed);
+    if (output_handle.value() >= 0) {
+      completion->output_handle.store(-1, std::memory_order_relaxed);
+      completion->is_output_taken.store(true, std::memory_order_relaxed);
+    }
+  }
+  EndWrite(*completion, sequence);
+  return output_handle;
+}
+
+bool Planner::ReclaimOutputHandle(ModelId model_id) {
+  while (true) {
+    // Oldest candidate, read without taking the completions
+    std::shared_ptr<Completion> oldest;
+    {
+      std::lock_guard<std::mutex> lock(completions_mtx_);
+      for (JobId job_id : finished_job_ids_) {
+        const std::shared_ptr<Completion>& completion =
+            completions_.at(job_id);
+        if (completion->model_id == model_id &&
+            completion->output_handle.load(std::memory_order_relaxed) >= 0 &&
+            completion->is_reported.load(std::memory_order_relaxed)) {
+          oldest = completion;
+          break;
+        }
+      }
+    }
+    if (!oldest) {
+      return false;
+    }
+
+    int output_handle = -1;
+    const uint32_t sequence = BeginWrite(*oldest);
+    if (oldest->is_reported.load(std::memory_order_relaxed)) {
+      output_handle = oldest->output_handle.load(std::memory_order_relaxed);
+      if (output_handle >= 0) {
+        oldest->output_handle.store(-1, std::memory_order_relaxed);
+        oldest->is_output_taken.store(true, std::memory_order_relaxed);
+      }
+    }
+    EndWrite(*oldest, sequence);
+    if (output_handle >= 0) {
+      engine_.ReleaseOutputHandle(model_id, output_handle);
+      return true;
+    }
+    // Taken in the meantime, look for the next one
+  }
 }
 
 CallbackId Planner::SetOnEndRequest(
@@ -265,10 +659,22 @@ int Planner::GetWorkerType() const {
 }
 
 absl::Status Planner::Plan() {
+  // Earliest time to release the jobs held by `batcher_`
+  int64_t batch_deadline = -1;
+  int64_t last_planning_time = 0;
+  bool need_reschedule = false;
+  Clock* clock = engine_.GetClock();
   while (true) {
-    if (planner_safe_bool_.wait()) {
+    const bool exit = planner_safe_bool_.wait_until(batch_deadline);
+    if (exit) {
       break;
     }
+    num_wakeups_.fetch_add(1, std::memory_order_relaxed);
+
+    // Notifications until the interval passes are coalesced into this pass
+    if (min_planning_interval_us_ > 0 && last_planning_time > 0) {
+      clock->SleepUntil(last_planning_time + min_planning_interval_us_);
+    }
     if (need_cpu_update_) {
       {
         auto status = SetCPUThreadAffinity(cpu_set_);
@@ -278,10 +684,51 @@ absl::Status Planner::Plan() {
       }
       need_cpu_update_ = false;
     }
-    CopyToLocalQueues();
-    bool need_reschedule = false;
+    const bool worker_event =
+        worker_event_.exchange(false, std::memory_order_acq_rel);
+    bool has_new_jobs = CopyToLocalQueues() > 0;
+    if (batcher_.IsEnabled()) {
+      const int64_t current_time = clock->NowMicros();
+      // held jobs are released once the deadline passes
+      has_new_jobs |= batch_deadline >= 0 && current_time >= batch_deadline;
+      batch_deadline = -1;
+      for (size_t i = 0; i < local_queues_.size(); ++i) {
+        const int64_t deadline =
+            batcher_.Batch(i, local_queues_[i], current_time);
+        if (deadline >= 0 &&
+            (batch_deadline < 0 || deadline < batch_deadline)) {
+          batch_deadline = deadline;
+        }
+      }
+    }
+
+    // Decisions only change with new jobs, or once a worker may take more
+    size_t num_local_jobs = 0;
+    for (const JobQueue& jobs : local_queues_) {
+      num_local_jobs += jobs.size();
+    }
+    local_queue_depth_.Set(num_local_jobs);
+    if (num_local_jobs == 0 ||
+        !(has_new_jobs || worker_event || need_reschedule)) {
+      continue;
+    }
+    last_planning_time = clock->NowMicros();
+    num_scheduling_passes_.fetch_add(1, std::memory_order_relaxed);
+
+    need_reschedule = false;
+    const size_t num_pass_jobs = num_local_jobs;
+    num_local_jobs = 0;
     for (size_t i = 0; i < local_queues_.size(); ++i) {
+      current_scheduler_ = i;
       need_reschedule |= !schedulers_[i]->Schedule(local_queues_[i]);
+      num_local_jobs += local_queues_[i].size();
+    }
+    local_queue_depth_.Set(num_local_jobs);
+    const int64_t pass_end_time = clock->NowMicros();
+    pass_duration_us_.Record(pass_end_time - last_planning_time);
+    if (RuntimeTracer::Get().IsSampled(
+            num_scheduling_passes_.load(std::memory_order_relaxed))) {
+      TracePass(last_planning_time, pass_end_time, num_pass_jobs);
     }
 
     if (need_reschedule) {
@@ -291,72 +738,110 @@ absl::Status Planner::Plan() {
   return absl::OkStatus();
 }
 
-void Planner::CopyToLocalQueues() {
-  std::unique_lock<std::mutex> request_lock(GetRequestsMtx());
-  JobQueue& requests = GetRequests();
-  if (!requests.empty()) {
-    if (schedulers_.size() == 1) {
-      // Gets jobs from requests and removes those jobs from the requests.
-      auto& local_jobs = local_queues_[0];
-      local_jobs.insert(local_jobs.end(),
-                        std::make_move_iterator(requests.begin()),
-                        std::make_move_iterator(requests.end()));
-    } else if (schedulers_.size() == 2) {
-      // TODO: general method for assigning SLO/non-SLO requests
-      for (Job& job : requests) {
-        if (job.slo_us > 0) {
-          local_queues_[0].push_back(std::move(job));
-        } else {
-          local_queues_[1].push_back(std::move(job));
-        }
-      }
-    }  // other else cases should have been caught in Init()
-
-    requests.clear();
+void Planner::TracePass(int64_t start_time, int64_t end_time,
+                        size_t num_jobs) const {
+  RuntimeTracer& tracer = RuntimeTracer::Get();
+  TraceEvent pass;
+  pass.type = TraceEventType::kPlannerPass;
+  pass.time = start_time;
+  pass.value = end_time - start_time;
+  pass.count = std::min<size_t>(num_jobs, UINT16_MAX);
+  tracer.Record(pass);
+
+  tracer.RecordCounter(TraceEventType::kRequestQueueDepth, -1, end_time,
+                       requests_.GetSize());
+  tracer.RecordCounter(TraceEventType::kLocalQueueDepth, -1, end_time,
+                       local_queue_depth_.Get());
+  for (WorkerId worker_id = 0; worker_id < engine_.GetNumWorkers();
+       worker_id++) {
+    const Worker* worker = engine_.GetWorker(worker_id);
+    if (worker) {
+      tracer.RecordCounter(TraceEventType::kWorkerQueueDepth, worker_id,
+                           end_time, worker->GetNumQueuedJobs());
+    }
   }
-  request_lock.unlock();
 }
 
-bool Planner::EnqueueToWorker(const std::vector<ScheduleAction>& actions) {
+size_t Planner::CopyToLocalQueues() {
+  JobQueue requests;
+  if (schedulers_.size() == 1) {
+    // Gets jobs from requests and removes those jobs from the requests.
+    const size_t num_local_jobs = local_queues_[0].size();
+    requests_.Drain(local_queues_[0]);
+    return local_queues_[0].size() - num_local_jobs;
+  } else if (schedulers_.size() == 2) {
+    requests_.Drain(requests);
+    // TODO: general method for assigning SLO/non-SLO requests
+    for (const JobHandle& job : requests) {
+      if (job->slo_us > 0) {
+        local_queues_[0].push_back(job);
+      } else {
+        local_queues_[1].push_back(job);
+      }
+    }
+  }  // other else cases should have been caught in Init()
+  return requests.size();
+}
+
+bool Planner::EnqueueToWorker(const ScheduleAction& action) {
   bool success = true;
-  for (auto& action : actions) {
-    Job job;
-    SubgraphKey target_key;
-
-    std::tie(job, target_key) = action;
-
-    Worker* worker = engine_.GetWorker(target_key.GetWorkerId());
-    if (worker == nullptr) {
-      BAND_LOG(LogSeverity::kError,
-               "EnqueueToWorker failed. Requests scheduled to null worker "
-               "id %d",
-               target_key.GetWorkerId());
-      job.status = JobStatus::kEnqueueFailed;
-      EnqueueFinishedJob(job);
-    } else if (IsSLOViolated(job)) {
-      // no point in running this job anymore
-      job.status = JobStatus::kSLOViolation;
-      // mark this as -1 to differentiate it from the default value, 0
-      job.invoke_time = -1;
-      // mark the time of this decision (of early-dropping this job)
-      job.end_time = time::NowMicros();
-      // Set reschedule flag.
-      success = false;
-      EnqueueFinishedJob(job);
-    } else {
-      std::lock_guard<std::mutex> lock(worker->GetDeviceMtx());
-
-      if (worker->IsEnqueueReady()) {
-        UpdateJobScheduleStatus(job, target_key);
-        if (!worker->EnqueueJob(job)) {
-          BAND_LOG(LogSeverity::kError,
-                   "EnqueueToWorker failed. Requests scheduled to "
-                   "unavailable worker id %d",
-                   target_key.GetWorkerId());
-        }
+  JobHandle handle;
+  SubgraphKey target_key;
+
+  std::tie(handle, target_key) = action;
+  Job* job = handle.Get();
+  if (job == nullptr) {
+    BAND_LOG(LogSeverity::kError,
+             "EnqueueToWorker failed. Requests scheduled with a stale job");
+    return success;
+  }
+  if (current_scheduler_ < num_scheduled_jobs_.size()) {
+    num_scheduled_jobs_[current_scheduler_]->Increment();
+  }
+
+  Worker* worker = engine_.GetWorker(target_key.GetWorkerId());
+  if (worker == nullptr) {
+    BAND_LOG(LogSeverity::kError,
+             "EnqueueToWorker failed. Requests scheduled to null worker "
+             "id %d",
+             target_key.GetWorkerId());
+    job->status = JobStatus::kEnqueueFailed;
+    engine_.EnqueueFinishedJob(handle);
+  } else if (IsSLOViolated(*job)) {
+    num_early_drops_.Increment();
+    // no point in running this job anymore
+    job->status = JobStatus::kSLOViolation;
+    // mark this as -1 to differentiate it from the default value, 0
+    job->invoke_time = -1;
+    // mark the time of this decision (of early-dropping this job)
+    job->end_time = engine_.GetClock()->NowMicros();
+    // Set reschedule flag.
+    success = false;
+    engine_.EnqueueFinishedJob(handle);
+  } else {
+    std::unique_lock<std::mutex> lock(worker->GetDeviceMtx());
+
+    if (worker->IsEnqueueReady()) {
+      UpdateJobScheduleStatus(*job, target_key);
+      const int64_t now = engine_.GetClock()->NowMicros();
+      job->planner_time += now - job->ready_time;
+      job->dispatch_time = now;
+      if (!worker->EnqueueJob(handle)) {
+        BAND_LOG(LogSeverity::kError,
+                 "EnqueueToWorker failed. Requests scheduled to "
+                 "unavailable worker id %d",
+                 target_key.GetWorkerId());
+        lock.unlock();
+        job->status = JobStatus::kEnqueueFailed;
+        engine_.EnqueueFinishedJob(handle);
       } else {
-        EnqueueRequest(job, true);
+        lock.unlock();
+        worker->NotifyBacklog();
       }
+    } else {
+      lock.unlock();
+      requests_.Push(handle, true);
+      planner_safe_bool_.notify();
     }
   }
   return success;
@@ -367,12 +852,13 @@ bool Planner::IsSLOViolated(Job& job) {
     return true;
   }
   // this job has an SLO; check if it's not too late already
-  if (job.slo_us > 0) {
+  const int64_t deadline = job.GetDeadline();
+  if (deadline >= 0) {
     WorkerWaitingTime workers_waiting = engine_.GetWorkerWaitingTime();
-    int64_t current_time = time::NowMicros();
+    int64_t current_time = engine_.GetClock()->NowMicros();
     int64_t expected_latency = workers_waiting[job.subgraph_key.GetWorkerId()] +
                                job.expected_execution_time;
-    int64_t remaining_time = job.slo_us - (current_time - job.enqueue_time);
+    int64_t remaining_time = deadline - current_time;
     if (expected_latency > remaining_time) {
       return true;
     }
@@ -382,35 +868,20 @@ bool Planner::IsSLOViolated(Job& job) {
 
 void Planner::UpdateJobScheduleStatus(Job& job, const SubgraphKey& target_key) {
   job.subgraph_key = target_key;
-  job.profiled_execution_time = engine_.GetProfiled(target_key);
-  job.expected_execution_time = engine_.GetExpected(target_key);
+  job.profiled_execution_time = engine_.GetProfiled(target_key, job.batch_size);
+  job.expected_execution_time = engine_.GetExpected(target_key, job.batch_size);
   job.resolved_unit_subgraphs |= target_key.GetUnitIndices();
-
-  if (!engine_.IsEnd(target_key)) {
-    Job remaining_ops(job.model_id);
-    remaining_ops.model_fname = job.model_fname;
-    remaining_ops.slo_us = job.slo_us;
-    remaining_ops.enqueue_time = job.enqueue_time;
-    remaining_ops.following_jobs = job.following_jobs;
-    remaining_ops.expected_latency = job.expected_latency;
-    remaining_ops.job_id = job.job_id;
-    remaining_ops.input_handle = job.input_handle;
-    remaining_ops.output_handle = job.output_handle;
-    remaining_ops.resolved_unit_subgraphs = job.resolved_unit_subgraphs;
-    remaining_ops.previous_subgraph_keys = job.previous_subgraph_keys;
-    remaining_ops.previous_subgraph_keys.emplace_back(job.subgraph_key);
-
-    job.following_jobs.clear();
-    job.following_jobs.push_back(remaining_ops);
-  }
 }
 
-bool Planner::IsJobIdValid(int job_id) {
-  return num_submitted_jobs_ - job_id <= NUM_FINISHED_RECORDS;
+std::shared_ptr<Planner::Completion> Planner::GetCompletion(
+    JobId job_id) const {
+  std::lock_guard<std::mutex> lock(completions_mtx_);
+  auto it = completions_.find(job_id);
+  return it != completions_.end() ? it->second : nullptr;
 }
 
-int Planner::GetJobRecordIndex(int job_id) const {
-  return job_id % NUM_FINISHED_RECORDS;
+bool Planner::IsFinished(const std::shared_ptr<Completion>& completion) {
+  return !completion || completion->is_finished.load(std::memory_order_acquire);
 }
 
 }  // namespace band
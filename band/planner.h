@@ -17,30 +17,32 @@
 #ifndef BAND_PLANNER_H_
 #define BAND_PLANNER_H_
 
-#include <array>
 #include <atomic>
+#include <deque>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "band/batcher.h"
+#include "band/clock.h"
 #include "band/config.h"
+#include "band/metrics.h"
+#include "band/request_queue.h"
 #include "band/safe_bool.h"
 #include "band/scheduler/scheduler.h"
 #include "band/worker.h"
 
 namespace band {
 
-// The maximum number of available job outputs at one time.
+// The maximum number of finished jobs whose outputs are kept at one time.
+// Jobs in flight are always tracked, and a finished job is tracked until
+// `NUM_FINISHED_RECORDS` later jobs finish.
 #define NUM_FINISHED_RECORDS 1000
 
-// The job queue which can be shared by multiple threads.
-struct ConcurrentJobQueue {
-  JobQueue queue;
-  std::mutex mtx;
-};
-
 class Planner {
  public:
   explicit Planner(IEngine& engine);
@@ -55,18 +57,29 @@ class Planner {
   // Assigns new job id for non-continuous job.
   std::vector<JobId> EnqueueBatch(std::vector<Job> jobs,
                                   bool push_front = false);
-  // Waits until the jobs are done.
-  // The interpreter calls the method.
-  void Wait(std::vector<int> job_ids);
+  // Puts already enqueued jobs back to the front of the request queue,
+  // preserving their order.
+  void ReenqueueBatch(const std::vector<JobHandle>& jobs);
+  // Waits until all the jobs are done, or until `timeout_us` passes if it is
+  // non-negative. Returns false on timeout.
+  // A finished job only wakes up the threads that wait for it.
+  bool Wait(const std::vector<JobId>& job_ids, int64_t timeout_us = -1);
+  // Waits until any of the jobs is done and returns its id. Returns -1 if
+  // `timeout_us` (non-negative) passes first.
+  JobId WaitAny(const std::vector<JobId>& job_ids, int64_t timeout_us = -1);
   void WaitAll();
+  // Jobs that are no longer tracked count as finished. A job in flight never
+  // does, however many jobs were submitted after it.
+  bool IsJobFinished(JobId job_id) const;
   // Enqueues a finised job to the queue.
   // A worker calls the method.
-  void EnqueueFinishedJob(Job& job);
+  void EnqueueFinishedJob(JobHandle job);
   void PrepareReenqueue(Job& job);
   // Enqueue the request to the worker.
   // Returns true if the request is successfully enqueued.
-  bool EnqueueToWorker(const std::vector<ScheduleAction>& action);
-  void Trigger() { planner_safe_bool_.notify(); }
+  bool EnqueueToWorker(const ScheduleAction& action);
+  // Notifies the planner that a worker may take more jobs.
+  void Trigger();
 
   // Checks if the schedulers can handle fallback subgraphs.
   // Returns true if any of the scheduler can handle fallback subgraphs.
@@ -74,10 +87,16 @@ class Planner {
   // may lead to unexpected results.
   bool NeedFallbackSubgraphs() const;
 
-  std::mutex& GetRequestsMtx() { return requests_.mtx; }
-  JobQueue& GetRequests() { return requests_.queue; }
   int GetWindowSize() const { return schedule_window_size_; }
+  size_t GetNumWakeups() const {
+    return num_wakeups_.load(std::memory_order_relaxed);
+  }
+  size_t GetNumSchedulingPasses() const {
+    return num_scheduling_passes_.load(std::memory_order_relaxed);
+  }
   void SetWindowSize(int schedule_window_size);
+  // Adds the planner metrics to `metrics`, see `Engine::GetMetrics`.
+  void CollectMetrics(Metrics& metrics) const;
   const std::map<int, int>& GetModelExecutionCounts() const {
     return model_execution_count_;
   }
@@ -86,8 +105,19 @@ class Planner {
       std::function<void(int, absl::Status)> on_end_request);
   absl::Status UnsetOnEndRequest(CallbackId callback_id);
 
-  // Get the Job instance with the `job_id`.
-  Job GetFinishedJob(int job_id);
+  // Get the outcome (id, model, status and output handle) of the finished
+  // job with the `job_id`. The returned job has id -1 if the job is not
+  // finished or no longer tracked.
+  Job GetFinishedJob(int job_id) const;
+  // Hands the output slot of the finished job over to the caller, who has to
+  // release it. The slot of a finished job is held until it is taken, until
+  // the job is no longer tracked, or until `ReclaimOutputHandle` takes it. Returns -1 for a job without an output
+  // slot, and FailedPrecondition if the slot was already taken.
+  absl::StatusOr<int> TakeOutputHandle(JobId job_id);
+  // Releases the output slot of the oldest finished job of the model whose
+  // callbacks have returned, for a request that finds the pool of the model
+  // full. Returns false if there is no such job.
+  bool ReclaimOutputHandle(ModelId model_id);
   // Get which worker types the schedulers require.
   int GetWorkerType() const;
   std::map<ModelId, WorkerId>& GetModelWorkerMap() { return model_worker_map_; }
@@ -97,9 +127,21 @@ class Planner {
   absl::Status Plan();
   // Write job logs and delete the job from the finished queue.
   void FlushFinishedJobs();
-  // Copy the Job instances from the `requests_` to the local queue.
-  // Note that this function is to minimize the hold time for the queue lock.
-  void CopyToLocalQueues();
+  // Moves the jobs in `requests_` to the local queues. Returns the number of
+  // moved jobs.
+  size_t CopyToLocalQueues();
+  // Records a scheduling pass and the queue depths after it to the
+  // `RuntimeTracer`
+  void TracePass(int64_t start_time, int64_t end_time, size_t num_jobs) const;
+  // Assigns the job id / enqueue time of a new job and moves it into the
+  // slab.
+  JobHandle AllocJob(Job&& job, int64_t enqueue_time);
+  // Enqueues the remaining subgraphs of a model after `job` and releases
+  // the record of `job`.
+  void EnqueueFollowingJob(JobHandle job);
+  // Records the completion of `job`, releases it and reports the end of the
+  // request.
+  void FinishJob(JobHandle job);
   // Check if the job violated the specified SLO.
   // This func assumes that workers_waiting_, job.profiled_time,
   // job.device_id, and job.enqueue_time are all up to date.
@@ -108,13 +150,87 @@ class Planner {
   void UpdateJobScheduleStatus(Job& job, const SubgraphKey& target_key);
   // Update `model_worker_map_`.
   void TryUpdateModelWorkerMapping();
-  bool IsJobIdValid(int job_id);
-  int GetJobRecordIndex(int job_id) const;
+
+  // A thread blocked in `Wait` / `WaitAny`.
+  struct Waiter {
+    explicit Waiter(Clock* clock) : cv(clock) {}
+    std::mutex mtx;
+    ClockCondition cv;
+    bool signaled = false;
+  };
+  // Completion of a job, shared by the planner and the threads that wait for
+  // the job. Readers never lock; a writer makes `sequence` odd while it
+  // updates the fields.
+  struct Completion {
+    Completion(JobId job_id, ModelId model_id)
+        : job_id(job_id), model_id(model_id) {}
+    const JobId job_id;
+    const ModelId model_id;
+    std::atomic<uint32_t> sequence{0};
+    std::atomic<bool> is_finished{false};
+    std::atomic<JobStatus> status{JobStatus::kQueued};
+    std::atomic<int> output_handle{-1};
+    // The output slot was taken (read, or reclaimed)
+    std::atomic<bool> is_output_taken{false};
+    // The callbacks of the job have returned, so its output slot may be
+    // reclaimed
+    std::atomic<bool> is_reported{false};
+    std::atomic<bool> io_bound{false};
+    std::atomic<int64_t> enqueue_time{0};
+    std::atomic<int64_t> end_time{0};
+    std::atomic<int64_t> total_execution_time{0};
+    std::atomic<int64_t> planner_time{0};
+    std::atomic<int64_t> worker_queue_time{0};
+    std::atomic<int64_t> input_copy_time{0};
+    std::atomic<int64_t> output_copy_time{0};
+    std::atomic<int64_t> completion_time{0};
+    std::atomic<int64_t> callback_time{0};
+    // threads waiting for the job
+    std::mutex waiters_mtx;
+    std::vector<Waiter*> waiters;
+  };
+  // Completion of the job, or nullptr if the job is not tracked.
+  std::shared_ptr<Completion> GetCompletion(JobId job_id) const;
+  static bool IsFinished(const std::shared_ptr<Completion>& completion);
+  // Publishes the completion of `job` and wakes up its waiters. Stops
+  // tracking the oldest finished job beyond `NUM_FINISHED_RECORDS`, and
+  // releases its output slot if not taken.
+  void RecordCompletion(const Job& job);
+  // Adds the time spent in the callbacks to a published completion, unless
+  // the job is no longer tracked, and marks it as reported.
+  void RecordCallbackTime(JobId job_id, int64_t callback_time);
+  // Seqlock of a completion for writers. `BeginWrite` returns the sequence
+  // to pass to `EndWrite`.
+  static uint32_t BeginWrite(Completion& completion);
+  static void EndWrite(Completion& completion, uint32_t sequence);
+  // Blocks until `is_done` holds for the completions of `job_ids`,
+  // re-evaluating it whenever one of them finishes. Returns false on
+  // timeout.
+  template <typename Predicate>
+  bool WaitUntil(const std::vector<JobId>& job_ids, int64_t timeout_us,
+                 Predicate is_done);
 
   CpuSet cpu_set_;
   bool need_cpu_update_ = false;
 
   SafeBool planner_safe_bool_;
+  // Set by `Trigger` until the next scheduling pass
+  std::atomic<bool> worker_event_{false};
+  int64_t min_planning_interval_us_ = 0;
+  std::atomic<size_t> num_wakeups_{0};
+  std::atomic<size_t> num_scheduling_passes_{0};
+
+  // Metrics
+  Histogram pass_duration_us_;
+  Gauge local_queue_depth_;
+  Counter num_early_drops_;
+  Counter num_slo_violations_;
+  Counter num_finished_requests_;
+  // Jobs sent to a worker by each scheduler, and the scheduler of the
+  // current pass (planner thread only)
+  std::vector<std::string> scheduler_names_;
+  std::vector<std::unique_ptr<Counter>> num_scheduled_jobs_;
+  size_t current_scheduler_ = 0;
 
   // Jobs Finished
   std::map<int, int> model_execution_count_;
@@ -125,19 +241,30 @@ class Planner {
   CallbackId next_callback_id_ = 0;
 
   // Request Queue
-  ConcurrentJobQueue requests_;
+  RequestQueue requests_;
 
   // Multi-level Local Queue.
   // The closer the index is to 0, the higher the priority.
   std::vector<JobQueue> local_queues_;
   std::vector<std::unique_ptr<IScheduler>> schedulers_;
+  // Coalesces local queue requests for the same model
+  Batcher batcher_;
 
-  std::mutex job_finished_mtx_;
-  std::array<Job, NUM_FINISHED_RECORDS> jobs_finished_record_;
+  // Storage of the jobs in flight
+  JobSlab jobs_;
+
+  // Completions of the jobs in flight and of the last `NUM_FINISHED_RECORDS`
+  // finished jobs. The lock only guards the lookup.
+  mutable std::mutex completions_mtx_;
+  std::unordered_map<JobId, std::shared_ptr<Completion>> completions_;
+  // Finished jobs in `completions_`, in the order they finished
+  std::deque<JobId> finished_job_ids_;
   std::atomic<int> num_submitted_jobs_;
+  // Guards `num_finished_jobs_` for `WaitAll`
+  std::mutex job_finished_mtx_;
   int num_finished_jobs_ = 0;
 
-  std::condition_variable end_invoke_;
+  ClockCondition end_invoke_;
   std::string log_path_;
 
   int schedule_window_size_ = std::numeric_limits<int>::max();
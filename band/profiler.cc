@@ -14,19 +14,29 @@
 
 #include "band/profiler.h"
 
+#include <algorithm>
+
 #include "band/logger.h"
 
 namespace band {
 
 size_t Profiler::BeginEvent() {
-  timeline_vector_.push_back({std::chrono::system_clock::now(), {}});
+  timeline_vector_.push_back(
+      {std::chrono::microseconds(clock_->NowMicros()), {}});
   return timeline_vector_.size();
 }
 
 void Profiler::EndEvent(size_t event_handle) {
   if (event_handle && (event_handle - 1 < timeline_vector_.size())) {
-    timeline_vector_[event_handle - 1].second =
-        std::chrono::system_clock::now();
+    auto& event = timeline_vector_[event_handle - 1];
+    auto elapsed_time = [&event]() {
+      return std::max(event.second - event.first,
+                      std::chrono::microseconds(0));
+    };
+    // an event may end more than once, and only its last end counts
+    total_elapsed_time_ -= elapsed_time();
+    event.second = std::chrono::microseconds(clock_->NowMicros());
+    total_elapsed_time_ += elapsed_time();
   } else {
     BAND_LOG(LogSeverity::kError,
                       "Profiler end event with an invalid handle %d",
@@ -17,13 +17,19 @@
 #ifndef BAND_PROFILER_H_
 #define BAND_PROFILER_H_
 
+#include <algorithm>
 #include <chrono>
 #include <vector>
 
+#include "band/clock.h"
+
 namespace band {
 
 class Profiler {
  public:
+  // Events are timed with `clock` (the real clock by default).
+  void SetClock(const Clock* clock) { clock_ = clock; }
+
   size_t BeginEvent();
   void EndEvent(size_t event_handle);
   size_t GetNumEvents() const;
@@ -42,21 +48,18 @@ class Profiler {
       return 0;
   }
 
+  // Events that have not ended count as 0.
   template <typename T>
   double GetAverageElapsedTime() const {
     static_assert(is_chrono_duration<T>::value,
                   "T must be a std::chrono::duration");
-
-    double accumulated_time = 0;
-    for (size_t i = 0; i < timeline_vector_.size(); i++) {
-      accumulated_time += GetElapsedTimeAt<T>(i);
-    }
-
     if (timeline_vector_.size() == 0) {
       return 0;
     }
-
-    return accumulated_time / timeline_vector_.size();
+    return std::chrono::duration<double, typename T::period>(
+               total_elapsed_time_)
+               .count() /
+           timeline_vector_.size();
   }
 
  private:
@@ -70,9 +73,12 @@ class Profiler {
     static constexpr bool value = true;
   };
 
-  std::vector<std::pair<std::chrono::system_clock::time_point,
-                        std::chrono::system_clock::time_point>>
+  const Clock* clock_ = RealClock::Get();
+  // (begin, end) in the time of `clock_`
+  std::vector<std::pair<std::chrono::microseconds, std::chrono::microseconds>>
       timeline_vector_;
+  // Sum of the elapsed time of the ended events, kept on `EndEvent`
+  std::chrono::microseconds total_elapsed_time_{0};
 };
 }  // namespace band
 #endif
\ No newline at end of file
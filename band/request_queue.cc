@@ -0,0 +1,100 @@
+// Copyright 2023 Seoul National University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "band/request_queue.h"
+
+namespace band {
+
+void RequestQueue::Push(const JobHandle& job, bool priority) {
+  JobLink* link = job.GetLink();
+  if (link == nullptr) {
+    return;
+  }
+  link->job = job;
+  size_.fetch_add(1, std::memory_order_relaxed);
+  Link(priority ? priority_head_ : normal_head_, link, link);
+}
+
+void RequestQueue::PushBatch(const std::vector<JobHandle>& jobs,
+                             bool priority) {
+  // The priority lane is read from the top, and the normal lane from the
+  // bottom, so the chain is linked in the order each lane is read
+  JobLink* first = nullptr;
+  JobLink* last = nullptr;
+  size_t num_linked = 0;
+  for (size_t i = 0; i < jobs.size(); i++) {
+    const JobHandle& job = jobs[priority ? jobs.size() - 1 - i : i];
+    JobLink* link = job.GetLink();
+    if (link == nullptr) {
+      continue;
+    }
+    link->job = job;
+    link->next = first;
+    if (last == nullptr) {
+      last = link;
+    }
+    first = link;
+    num_linked++;
+  }
+  if (num_linked == 0) {
+    return;
+  }
+  size_.fetch_add(num_linked, std::memory_order_relaxed);
+  Link(priority ? priority_head_ : normal_head_, first, last);
+}
+
+void RequestQueue::Drain(JobQueue& jobs) {
+  const size_t num_jobs = jobs.size();
+  // Each link is read before its job is handed out, since the job may be
+  // pushed again right after
+  JobLink* priority =
+      priority_head_.exchange(nullptr, std::memory_order_acquire);
+  while (priority != nullptr) {
+    JobLink* next = priority->next;
+    jobs.push_back(priority->job);
+    priority = next;
+  }
+
+  // Reverse the normal lane into the enqueue order
+  JobLink* normal = normal_head_.exchange(nullptr, std::memory_order_acquire);
+  JobLink* reversed = nullptr;
+  while (normal != nullptr) {
+    JobLink* next = normal->next;
+    normal->next = reversed;
+    reversed = normal;
+    normal = next;
+  }
+  while (reversed != nullptr) {
+    JobLink* next = reversed->next;
+    jobs.push_back(reversed->job);
+    reversed = next;
+  }
+  size_.fetch_sub(jobs.size() - num_jobs, std::memory_order_relaxed);
+}
+
+bool RequestQueue::IsEmpty() const {
+  return normal_head_.load(std::memory_order_acquire) == nullptr &&
+         priority_head_.load(std::memory_order_acquire) == nullptr;
+}
+
+void RequestQueue::Link(std::atomic<JobLink*>& head, JobLink* first,
+                        JobLink* last) {
+  JobLink* top = head.load(std::memory_order_relaxed);
+  do {
+    last->next = top;
+  } while (!head.compare_exchange_weak(top, first, std::memory_order_release,
+                                       std::memory_order_relaxed));
+}
+
+}  // namespace band
@@ -0,0 +1,70 @@
+/*
+ * Copyright 2023 Seoul National University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BAND_REQUEST_QUEUE_H_
+#define BAND_REQUEST_QUEUE_H_
+
+#include <atomic>
+#include <vector>
+
+#include "band/engine_interface.h"
+#include "band/job_slab.h"
+
+namespace band {
+
+/*
+  Lock-free multi-producer, single-consumer queue of requests.
+
+  Producers link their jobs into one of two lanes with a single CAS:
+  - the normal lane keeps the enqueue order,
+  - the priority lane puts the latest pushes first, like `push_front`. It
+    is meant for jobs that must run before any new request, e.g., the
+    remaining subgraphs of a request or jobs put back by the scheduler.
+  The consumer takes both lanes at once with one atomic exchange each.
+
+  The lanes chain the `JobLink`s embedded in the job records, so pushing
+  and draining never allocate. Stale handles are not queued.
+*/
+class RequestQueue {
+ public:
+  RequestQueue() = default;
+  RequestQueue(const RequestQueue&) = delete;
+  RequestQueue& operator=(const RequestQueue&) = delete;
+
+  void Push(const JobHandle& job, bool priority = false);
+  // Pushes all the jobs at once, keeping their order within the lane.
+  void PushBatch(const std::vector<JobHandle>& jobs, bool priority = false);
+  // Appends all the queued jobs to `jobs`, the priority lane first.
+  // Only one thread may drain the queue.
+  void Drain(JobQueue& jobs);
+  bool IsEmpty() const;
+  // Number of queued jobs. Pushes in progress may already be counted.
+  size_t GetSize() const { return size_.load(std::memory_order_relaxed); }
+
+ private:
+  // Links the chain [first, last] in front of the lane.
+  void Link(std::atomic<JobLink*>& head, JobLink* first, JobLink* last);
+
+  // Both lanes are stacks with the latest push on top
+  std::atomic<JobLink*> normal_head_{nullptr};
+  std::atomic<JobLink*> priority_head_{nullptr};
+  // Counted before linking, so that a drain never takes uncounted jobs
+  std::atomic<size_t> size_{0};
+};
+
+}  // namespace band
+
+#endif  // BAND_REQUEST_QUEUE_H_
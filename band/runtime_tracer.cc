@@ -0,0 +1,335 @@
+// Copyright 2023 Seoul National University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "band/runtime_tracer.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <functional>
+
+#include "absl/strings/str_format.h"
+
+namespace band {
+
+namespace {
+
+constexpr size_t kNumEventWords = sizeof(TraceEvent) / sizeof(uint64_t);
+
+// Chrome trace threads: the planner, then an execution and a copy track per
+// worker
+int GetChromeThreadId(const TraceEvent& event) {
+  if (event.worker_id < 0) {
+    return 0;
+  }
+  const bool is_copy = event.type == TraceEventType::kInputCopy ||
+                       event.type == TraceEventType::kOutputCopy;
+  return 1 + 2 * event.worker_id + (is_copy ? 1 : 0);
+}
+
+const char* GetEventName(TraceEventType type) {
+  switch (type) {
+    case TraceEventType::kSubgraph:
+      return "subgraph";
+    case TraceEventType::kInputCopy:
+      return "input_copy";
+    case TraceEventType::kOutputCopy:
+      return "output_copy";
+    case TraceEventType::kPlannerPass:
+      return "planner_pass";
+    case TraceEventType::kRequestQueueDepth:
+      return "request_queue_depth";
+    case TraceEventType::kLocalQueueDepth:
+      return "local_queue_depth";
+    case TraceEventType::kWorkerQueueDepth:
+      return "worker_queue_depth";
+  }
+  return "unknown";
+}
+
+bool IsCounter(TraceEventType type) {
+  return type == TraceEventType::kRequestQueueDepth ||
+         type == TraceEventType::kLocalQueueDepth ||
+         type == TraceEventType::kWorkerQueueDepth;
+}
+
+}  // anonymous namespace
+
+constexpr char RuntimeTracer::kBinaryTraceMagic[8];
+
+// Ring buffer with a single writer, the thread that owns it. The writer
+// publishes an event by advancing `end` with a release store; a reader
+// detects the events that the writer overwrote while they were read by
+// loading `end` again. One more slot than `size` is allocated for the event
+// being written.
+struct RuntimeTracer::ThreadBuffer {
+  explicit ThreadBuffer(size_t size)
+      : size(size),
+        slots(new std::atomic<uint64_t>[(size + 1) * kNumEventWords]()) {}
+
+  void Write(const TraceEvent& event) {
+    uint64_t words[kNumEventWords];
+    std::memcpy(words, &event, sizeof(TraceEvent));
+    const uint64_t index = end.load(std::memory_order_relaxed);
+    // a reader that sees any word of this event also sees `end` == `index`
+    std::atomic_thread_fence(std::memory_order_release);
+    std::atomic<uint64_t>* slot =
+        &slots[(index % (size + 1)) * kNumEventWords];
+    for (size_t i = 0; i < kNumEventWords; i++) {
+      slot[i].store(words[i], std::memory_order_relaxed);
+    }
+    end.store(index + 1, std::memory_order_release);
+  }
+
+  void Read(std::vector<TraceEvent>& events) const {
+    const uint64_t read_end = end.load(std::memory_order_acquire);
+    const uint64_t read_begin =
+        std::max(begin, read_end > size ? read_end - size : 0);
+    std::vector<std::array<uint64_t, kNumEventWords>> words(read_end -
+                                                            read_begin);
+    for (uint64_t index = read_begin; index < read_end; index++) {
+      const std::atomic<uint64_t>* slot =
+          &slots[(index % (size + 1)) * kNumEventWords];
+      for (size_t i = 0; i < kNumEventWords; i++) {
+        words[index - read_begin][i] = slot[i].load(std::memory_order_relaxed);
+      }
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // the event at `end` may be half-written in the slot of the event at
+    // `end - size - 1`
+    const uint64_t write_end = end.load(std::memory_order_relaxed);
+    const uint64_t valid_begin = write_end > size ? write_end - size : 0;
+    for (uint64_t index = std::max(read_begin, valid_begin); index < read_end;
+         index++) {
+      TraceEvent event;
+      std::memcpy(&event, words[index - read_begin].data(), sizeof(TraceEvent));
+      events.push_back(event);
+    }
+  }
+
+  const size_t size;
+  std::unique_ptr<std::atomic<uint64_t>[]> slots;
+  std::atomic<uint64_t> end{0};
+  // Events before `begin` are dropped by `Start` (guarded by `mtx_`)
+  uint64_t begin = 0;
+  // Owned by a running thread (guarded by `mtx_`)
+  bool in_use = true;
+};
+
+namespace {
+
+// Buffer of the current thread, returned to the tracer for reuse when the
+// thread exits
+struct BufferLease {
+  ~BufferLease() {
+    if (release) {
+      release();
+    }
+  }
+  void* buffer = nullptr;
+  std::function<void()> release;
+};
+
+thread_local BufferLease buffer_lease;
+
+}  // anonymous namespace
+
+RuntimeTracer& RuntimeTracer::Get() {
+  static RuntimeTracer* tracer = new RuntimeTracer;
+  return *tracer;
+}
+
+void RuntimeTracer::Start(Options options) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  for (auto& buffer : buffers_) {
+    buffer->begin = buffer->end.load(std::memory_order_acquire);
+  }
+  buffer_size_.store(std::max<size_t>(options.buffer_size, 1),
+                     std::memory_order_relaxed);
+  sampling_period_.store(std::max(options.sampling_period, 1),
+                         std::memory_order_relaxed);
+  enabled_.store(true, std::memory_order_release);
+}
+
+void RuntimeTracer::Stop() { enabled_.store(false, std::memory_order_release); }
+
+void RuntimeTracer::AddWorker(WorkerId worker_id, DeviceFlag device_flag) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  workers_[worker_id] = device_flag;
+}
+
+RuntimeTracer::ThreadBuffer* RuntimeTracer::GetThreadBuffer() {
+  if (buffer_lease.buffer) {
+    return static_cast<ThreadBuffer*>(buffer_lease.buffer);
+  }
+
+  std::lock_guard<std::mutex> lock(mtx_);
+  const size_t buffer_size = buffer_size_.load(std::memory_order_relaxed);
+  ThreadBuffer* buffer = nullptr;
+  for (auto& free_buffer : buffers_) {
+    if (!free_buffer->in_use && free_buffer->size == buffer_size) {
+      buffer = free_buffer.get();
+      break;
+    }
+  }
+  if (!buffer) {
+    buffers_.emplace_back(new ThreadBuffer(buffer_size));
+    buffer = buffers_.back().get();
+  }
+  buffer->in_use = true;
+  buffer_lease.buffer = buffer;
+  buffer_lease.release = [this, buffer]() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    buffer->in_use = false;
+  };
+  return buffer;
+}
+
+void RuntimeTracer::Record(const TraceEvent& event) {
+  GetThreadBuffer()->Write(event);
+}
+
+void RuntimeTracer::RecordSubgraph(const Job& job) {
+  TraceEvent event;
+  event.type = TraceEventType::kSubgraph;
+  event.time = job.invoke_time;
+  event.value = job.end_time - job.invoke_time;
+  event.job_id = job.job_id;
+  event.model_id = job.model_id;
+  event.worker_id = job.subgraph_key.GetWorkerId();
+  event.count = job.batch_size;
+  Record(event);
+}
+
+void RuntimeTracer::RecordCopy(TraceEventType type, const Job& job,
+                               int64_t start_time, int64_t end_time) {
+  TraceEvent event;
+  event.type = type;
+  event.time = start_time;
+  event.value = end_time - start_time;
+  event.job_id = job.job_id;
+  event.model_id = job.model_id;
+  event.worker_id = job.subgraph_key.GetWorkerId();
+  event.count = job.batch_size;
+  Record(event);
+}
+
+void RuntimeTracer::RecordCounter(TraceEventType type, WorkerId worker_id,
+                                  int64_t time, int64_t value) {
+  TraceEvent event;
+  event.type = type;
+  event.time = time;
+  event.value = value;
+  event.worker_id = worker_id;
+  Record(event);
+}
+
+std::vector<TraceEvent> RuntimeTracer::Collect() const {
+  std::vector<TraceEvent> events;
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (const auto& buffer : buffers_) {
+      buffer->Read(events);
+    }
+  }
+  std::stable_sort(events.begin(), events.end(),
+                   [](const TraceEvent& lhs, const TraceEvent& rhs) {
+                     return lhs.time < rhs.time;
+                   });
+  return events;
+}
+
+absl::Status RuntimeTracer::DumpChromeTrace(const std::string& path) const {
+  std::ofstream out(path, std::ios::out);
+  if (!out.is_open()) {
+    return absl::InternalError(
+        absl::StrFormat("Cannot write the trace to %s", path));
+  }
+
+  std::map<WorkerId, DeviceFlag> workers;
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    workers = workers_;
+  }
+  const std::vector<TraceEvent> events = Collect();
+
+  out << "{\"traceEvents\":[\n";
+  out << absl::StrFormat(
+      "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,"
+      "\"args\":{\"name\":\"Planner\"}}");
+  for (const auto& worker : workers) {
+    const char* device = ToString(worker.second);
+    out << absl::StrFormat(
+        ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,"
+        "\"args\":{\"name\":\"%s Worker %d\"}}",
+        1 + 2 * worker.first, device, worker.first);
+    out << absl::StrFormat(
+        ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,"
+        "\"args\":{\"name\":\"%s Worker %d copies\"}}",
+        2 + 2 * worker.first, device, worker.first);
+  }
+
+  for (const TraceEvent& event : events) {
+    if (IsCounter(event.type)) {
+      // a counter track per worker for the worker queue depth
+      const std::string name =
+          event.worker_id < 0
+              ? GetEventName(event.type)
+              : absl::StrFormat("%s.%d", GetEventName(event.type),
+                                event.worker_id);
+      out << absl::StrFormat(
+          ",\n{\"name\":\"%s\",\"ph\":\"C\",\"pid\":0,\"ts\":%d,"
+          "\"args\":{\"value\":%d}}",
+          name, event.time, event.value);
+    } else if (event.type == TraceEventType::kPlannerPass) {
+      out << absl::StrFormat(
+          ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":%d,"
+          "\"dur\":%d,\"args\":{\"num_jobs\":%d}}",
+          GetEventName(event.type), event.time, event.value, event.count);
+    } else {
+      out << absl::StrFormat(
+          ",\n{\"name\":\"%s (model %d, job %d)\",\"cat\":\"%s\",\"ph\":\"X\","
+          "\"pid\":0,\"tid\":%d,\"ts\":%d,\"dur\":%d,"
+          "\"args\":{\"job_id\":%d,\"model_id\":%d,\"batch_size\":%d}}",
+          GetEventName(event.type), event.model_id, event.job_id,
+          GetEventName(event.type), GetChromeThreadId(event), event.time,
+          event.value, event.job_id, event.model_id, event.count);
+    }
+  }
+  out << "\n]}\n";
+  return out.good() ? absl::OkStatus()
+                    : absl::InternalError(absl::StrFormat(
+                          "Failed to write the trace to %s", path));
+}
+
+absl::Status RuntimeTracer::DumpBinary(const std::string& path) const {
+  std::ofstream out(path, std::ios::out | std::ios::binary);
+  if (!out.is_open()) {
+    return absl::InternalError(
+        absl::StrFormat("Cannot write the trace to %s", path));
+  }
+
+  const std::vector<TraceEvent> events = Collect();
+  const uint64_t num_events = events.size();
+  out.write(kBinaryTraceMagic, sizeof(kBinaryTraceMagic));
+  out.write(reinterpret_cast<const char*>(&num_events), sizeof(num_events));
+  out.write(reinterpret_cast<const char*>(events.data()),
+            events.size() * sizeof(TraceEvent));
+  return out.good() ? absl::OkStatus()
+                    : absl::InternalError(absl::StrFormat(
+                          "Failed to write the trace to %s", path));
+}
+
+}  // namespace band
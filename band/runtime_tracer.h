@@ -0,0 +1,149 @@
+/*
+ * Copyright 2023 Seoul National University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BAND_RUNTIME_TRACER_H_
+#define BAND_RUNTIME_TRACER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "band/common.h"
+
+namespace band {
+
+enum class TraceEventType : uint16_t {
+  // Durations
+  kSubgraph = 0,
+  kInputCopy = 1,
+  kOutputCopy = 2,
+  kPlannerPass = 3,
+  // Counters
+  kRequestQueueDepth = 4,
+  kLocalQueueDepth = 5,
+  kWorkerQueueDepth = 6,
+};
+
+// Fixed-size binary record of a trace. This is also the layout of the
+// events in the binary dump.
+struct TraceEvent {
+  // Start of a duration or time of a counter sample, in the engine clock (us)
+  int64_t time = 0;
+  // Length of a duration (us) or value of a counter
+  int64_t value = 0;
+  JobId job_id = -1;
+  ModelId model_id = -1;
+  // Worker of the event, or -1 for the planner and engine-wide counters
+  int32_t worker_id = -1;
+  TraceEventType type = TraceEventType::kSubgraph;
+  // Number of jobs of a planner pass, or the batch size of a subgraph
+  uint16_t count = 0;
+};
+static_assert(sizeof(TraceEvent) == 32, "TraceEvent must stay 32 bytes");
+
+/*
+  Tracer cheap enough to leave on in production.
+
+  Every thread that records an event gets its own ring buffer of
+  `TraceEvent`s, so recording takes no lock and allocates nothing once the
+  buffer of the thread exists: a few relaxed stores and a release store of
+  the write index. When a buffer is full, the oldest events are overwritten.
+  Jobs are sampled by id, so that all subgraphs of a sampled request are
+  kept, and planner passes (with the queue depths at the pass) by their
+  index.
+
+  `Collect` and the dumps read a snapshot of the buffers while threads keep
+  recording; events that are overwritten during the read are dropped.
+  `JobTracer` (`BAND_TRACE`) remains the detailed debugging tracer.
+*/
+class RuntimeTracer {
+ public:
+  static constexpr size_t kDefaultBufferSize = 1 << 14;
+
+  struct Options {
+    // Events per thread
+    size_t buffer_size = kDefaultBufferSize;
+    // Records 1 in `sampling_period` jobs and planner passes
+    int sampling_period = 1;
+  };
+
+  static RuntimeTracer& Get();
+
+  // Starts recording, dropping the events recorded so far. Buffers of
+  // running threads keep their size.
+  void Start(Options options);
+  void Start() { Start(Options()); }
+  void Stop();
+  bool IsEnabled() const { return enabled_.load(std::memory_order_relaxed); }
+  // Whether the job, or the planner pass, with `id` is traced
+  bool IsSampled(int64_t id) const {
+    if (!IsEnabled()) {
+      return false;
+    }
+    const int period = sampling_period_.load(std::memory_order_relaxed);
+    return period <= 1 || id % period == 0;
+  }
+
+  // Names the tracks of a worker in the Chrome trace
+  void AddWorker(WorkerId worker_id, DeviceFlag device_flag);
+
+  void Record(const TraceEvent& event);
+  // The invoke of the current subgraph of `job`, from its invoke time to
+  // its end time
+  void RecordSubgraph(const Job& job);
+  void RecordCopy(TraceEventType type, const Job& job, int64_t start_time,
+                  int64_t end_time);
+  void RecordCounter(TraceEventType type, WorkerId worker_id, int64_t time,
+                     int64_t value);
+
+  // Events of all threads in the order of their time
+  std::vector<TraceEvent> Collect() const;
+  // Chrome trace JSON (chrome://tracing, Perfetto) of `Collect`
+  absl::Status DumpChromeTrace(const std::string& path) const;
+  // `kBinaryTraceMagic`, the number of events (uint64) and the raw
+  // `TraceEvent`s of `Collect`, in the byte order of the host
+  absl::Status DumpBinary(const std::string& path) const;
+
+  static constexpr char kBinaryTraceMagic[8] = {'B', 'A', 'N', 'D',
+                                                'T', 'R', 'C', '1'};
+
+ private:
+  struct ThreadBuffer;
+
+  RuntimeTracer() = default;
+  RuntimeTracer(const RuntimeTracer&) = delete;
+  RuntimeTracer& operator=(const RuntimeTracer&) = delete;
+
+  ThreadBuffer* GetThreadBuffer();
+
+  std::atomic<bool> enabled_{false};
+  std::atomic<int> sampling_period_{1};
+  std::atomic<size_t> buffer_size_{kDefaultBufferSize};
+
+  // Guards the list of buffers and the worker names, not the recording
+  mutable std::mutex mtx_;
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+  std::map<WorkerId, DeviceFlag> workers_;
+};
+
+}  // namespace band
+
+#endif  // BAND_RUNTIME_TRACER_H_
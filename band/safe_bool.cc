@@ -16,23 +16,29 @@
 
 namespace band {
 void SafeBool::notify() {
+  if (flag.exchange(true, std::memory_order_acq_rel)) {
+    // a wakeup is already pending
+    return;
+  }
+  // lock to not miss a waiter that is about to sleep
   std::lock_guard<std::mutex> lock(m);
-  flag = true;
-  c.notify_one();
+  c.NotifyAll();
 }
 
-bool SafeBool::wait() {
+bool SafeBool::wait() { return wait_until(-1); }
+
+bool SafeBool::wait_until(int64_t deadline_us) {
   std::unique_lock<std::mutex> lock(m);
-  while (!exit && !flag) {
-    c.wait(lock);
-  }
-  flag = false;
+  c.WaitUntil(lock, deadline_us, [this]() {
+    return exit || flag.load(std::memory_order_acquire);
+  });
+  flag.exchange(false, std::memory_order_acq_rel);
   return exit;
 }
 
 void SafeBool::terminate() {
   std::lock_guard<std::mutex> lock(m);
   exit = true;
-  c.notify_all();
+  c.NotifyAll();
 }
 }  // namespace band
\ No newline at end of file
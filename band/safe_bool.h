@@ -17,23 +17,31 @@
 #ifndef BAND_SAFE_BOOL_H_
 #define BAND_SAFE_BOOL_H_
 
-#include <condition_variable>
+#include <atomic>
+#include <cstdint>
 #include <mutex>
+
+#include "band/clock.h"
+
 namespace band {
+// Notifications that arrive before the waiter wakes up are coalesced into a
+// single wakeup, and only the first of them takes the lock.
 class SafeBool {
  public:
-  SafeBool() = default;
+  explicit SafeBool(Clock* clock = nullptr) : c(clock) {}
   ~SafeBool() = default;
 
   void notify();
   bool wait();
+  // Same as `wait`, but also returns once the clock reaches `deadline_us`.
+  bool wait_until(int64_t deadline_us);
   void terminate();
 
  private:
   mutable std::mutex m;
-  bool flag = false;
+  std::atomic<bool> flag{false};
   bool exit = false;
-  std::condition_variable c;
+  ClockCondition c;
 };
 
 }  // namespace band
@@ -50,7 +50,7 @@ bool HEFTScheduler::Schedule(JobQueue& requests) {
           searched_jobs;
       for (auto it = requests.begin(); it != requests.begin() + window_size;
            ++it) {
-        Job job = *it;
+        const Job& job = **it;
 
         if (jobs_to_yield.find(job.job_id) != jobs_to_yield.end()) {
           continue;
@@ -99,10 +99,10 @@ bool HEFTScheduler::Schedule(JobQueue& requests) {
       // even if this job is the "most urgent" one
       const int worker_id = target_subgraph_key.GetWorkerId();
       if (idle_workers.find(worker_id) == idle_workers.end()) {
-        waiting_time[worker_id] += engine_.GetExpected(target_subgraph_key);
         auto requests_it = requests.begin() + target_job_index;
-        Job job = *requests_it;
-        jobs_to_yield.insert(job.job_id);
+        waiting_time[worker_id] += engine_.GetExpected(
+            target_subgraph_key, (*requests_it)->batch_size);
+        jobs_to_yield.insert((*requests_it)->job_id);
         continue;
       } else {
         break;
@@ -110,7 +110,7 @@ bool HEFTScheduler::Schedule(JobQueue& requests) {
     } while (true);
 
     auto requests_it = requests.begin() + target_job_index;
-    Job job = *requests_it;
+    JobHandle job = *requests_it;
 
     // erase the job from requests and decrement window_size
     requests.erase(requests_it);
@@ -120,17 +120,18 @@ bool HEFTScheduler::Schedule(JobQueue& requests) {
     // Common status will be updated by `EnqueueAction`.
     if (engine_.IsBegin(target_subgraph_key)) {
       // only set these fields if this is the first subgraph of this model
-      job.expected_latency = largest_shortest_latency;
+      job->expected_latency = largest_shortest_latency;
     }
+    const JobId job_id = job->job_id;
 
     success &= engine_.EnqueueToWorker({job, target_subgraph_key});
 
     if (reserve_) {
       // add next job to reserved_, if one exists
       if (target_subgraph_key_next != SubgraphKey()) {
-        reserved_[job.job_id] = target_subgraph_key_next;
+        reserved_[job_id] = target_subgraph_key_next;
       } else {
-        reserved_.erase(job.job_id);
+        reserved_.erase(job_id);
       }
     }
   }
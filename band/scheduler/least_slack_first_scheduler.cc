@@ -16,8 +16,6 @@
 
 #include <algorithm>
 
-#include "band/time.h"
-
 namespace band {
 LeastSlackFirstScheduler::LeastSlackFirstScheduler(IEngine& engine,
                                                    int window_size)
@@ -38,12 +36,13 @@ bool LeastSlackFirstScheduler::Schedule(JobQueue& requests) {
 
   WorkerWaitingTime waiting_time = engine_.GetWorkerWaitingTime();
 
-  int64_t current_time = time::NowMicros();
+  int64_t current_time = engine_.GetClock()->NowMicros();
   SortBySlackTime(requests, window_size, current_time);
 
   std::set<int> job_indices_to_erase;
   for (auto it = requests.begin(); it != requests.begin() + window_size; ++it) {
-    Job job = *it;
+    JobHandle job_handle = *it;
+    Job& job = *job_handle;
 
     // Get current job's fastest subgraph execution plan + latency
     std::pair<std::vector<SubgraphKey>, int> best_exec_plan =
@@ -52,10 +51,10 @@ bool LeastSlackFirstScheduler::Schedule(JobQueue& requests) {
     SubgraphKey target_subgraph_key = best_exec_plan.first.front();
 
     // Change job status and schedule if the execution plan already exceeded SLO
-    if (job.slo_us > 0 &&
-        current_time + best_exec_plan.second > job.enqueue_time + job.slo_us) {
+    const int64_t deadline = job.GetDeadline();
+    if (deadline >= 0 && current_time + best_exec_plan.second > deadline) {
       job.status = JobStatus::kSLOViolation;
-      success &= engine_.EnqueueToWorker({job, target_subgraph_key});
+      success &= engine_.EnqueueToWorker({job_handle, target_subgraph_key});
       job_indices_to_erase.insert(it - requests.begin());
       continue;
     }
@@ -64,8 +63,9 @@ bool LeastSlackFirstScheduler::Schedule(JobQueue& requests) {
     int worker_id = target_subgraph_key.GetWorkerId();
     if (idle_workers.find(worker_id) != idle_workers.end()) {
       // Update worker's waiting time as if it will execute the job
-      waiting_time[worker_id] += engine_.GetExpected(target_subgraph_key);
-      success &= engine_.EnqueueToWorker({job, target_subgraph_key});
+      waiting_time[worker_id] +=
+          engine_.GetExpected(target_subgraph_key, job.batch_size);
+      success &= engine_.EnqueueToWorker({job_handle, target_subgraph_key});
       job_indices_to_erase.insert(it - requests.begin());
       continue;
     }
@@ -81,8 +81,8 @@ bool LeastSlackFirstScheduler::Schedule(JobQueue& requests) {
 
 int64_t LeastSlackFirstScheduler::GetSlackTime(int64_t current_time,
                                                const Job& job) {
-  if (job.slo_us > 0) {
-    int64_t deadline = job.enqueue_time + job.slo_us;
+  const int64_t deadline = job.GetDeadline();
+  if (deadline >= 0) {
     int64_t remaining_execution_time = job.expected_latency;
     return deadline - current_time - remaining_execution_time;
   } else {
@@ -95,19 +95,19 @@ void LeastSlackFirstScheduler::SortBySlackTime(JobQueue& requests,
                                                int64_t current_time) {
   UpdateExpectedLatency(requests, window_size);
   std::sort(requests.begin(), requests.begin() + window_size,
-            [&](const Job& first, const Job& second) -> bool {
-              return GetSlackTime(current_time, first) <
-                     GetSlackTime(current_time, second);
+            [&](const JobHandle& first, const JobHandle& second) -> bool {
+              return GetSlackTime(current_time, *first) <
+                     GetSlackTime(current_time, *second);
             });
 }
 
 void LeastSlackFirstScheduler::UpdateExpectedLatency(JobQueue& requests,
                                                      int window_size) {
   for (auto it = requests.begin(); it != requests.begin() + window_size; ++it) {
-    it->expected_latency = engine_
-                               .GetSubgraphWithShortestLatency(
-                                   *it, engine_.GetWorkerWaitingTime())
-                               .second;
+    (*it)->expected_latency = engine_
+                                  .GetSubgraphWithShortestLatency(
+                                      **it, engine_.GetWorkerWaitingTime())
+                                  .second;
   }
 }
 
@@ -55,7 +55,7 @@ bool ShortestExpectedLatencyScheduler::Schedule(JobQueue& requests) {
 
     std::unordered_set<std::pair<int, BitMask>, JobIdBitMaskHash> searched_jobs;
     for (auto it = local_jobs.begin(); it != local_jobs.end(); ++it) {
-      Job& next_job = *it;
+      Job& next_job = **it;
 
       std::pair<int, BitMask> job_to_search =
           std::make_pair(next_job.model_id, next_job.resolved_unit_subgraphs);
@@ -79,16 +79,14 @@ bool ShortestExpectedLatencyScheduler::Schedule(JobQueue& requests) {
       continue;
     }
 
-    // for some reason, this Job must NOT be a reference (&), otherwise
-    // we get a segfault at push_back() below
-    Job most_urgent_job = local_jobs[target_job_idx];
+    JobHandle most_urgent_job = local_jobs[target_job_idx];
 
     // remove the job from the queue so that we don't meet it in the next loop
     local_jobs.erase(local_jobs.begin() + target_job_idx);
 
-    if (engine_.IsBegin(most_urgent_job.subgraph_key)) {
+    if (engine_.IsBegin(most_urgent_job->subgraph_key)) {
       // only set these fields if this is the first subgraph of this model
-      most_urgent_job.expected_latency = largest_shortest_latency;
+      most_urgent_job->expected_latency = largest_shortest_latency;
     }
     success &= engine_.EnqueueToWorker({most_urgent_job, target_subgraph_key});
   }
@@ -14,6 +14,8 @@
 
 #include "band/tensor.h"
 
+#include <algorithm>
+#include <stdlib.h>
 #include <string.h>
 
 #include "band/logger.h"
@@ -24,7 +26,10 @@ Tensor::Tensor(ITensor* tensor_view, bool copy_data)
       quantization_({QuantizationType::kNoQuantization, nullptr}),
       dims_(tensor_view->GetDims(),
             tensor_view->GetDims() + tensor_view->GetNumDims()),
-      data_(new char[tensor_view->GetBytes()]),
+      data_(static_cast<char*>(aligned_alloc(
+          kAlignment, std::max(kAlignment, (tensor_view->GetBytes() +
+                                            kAlignment - 1) /
+                                               kAlignment * kAlignment)))),
       name_(tensor_view->GetName()) {
   auto status = SetQuantization(tensor_view->GetQuantization());
   if (!status.ok()) {
@@ -37,7 +42,7 @@ Tensor::Tensor(ITensor* tensor_view, bool copy_data)
 }
 
 Tensor::~Tensor() {
-  delete[] data_;
+  free(data_);
   if (quantization_.GetParams() != nullptr) {
     free(quantization_.GetParams());
   }
@@ -28,6 +28,11 @@ namespace band {
 */
 class Tensor : public interface::ITensor {
  public:
+  // Alignment of the data buffer. Matches the default tensor alignment of
+  // TfLite so that band tensors can be bound to a backend without a copy
+  // (see Engine::BindIOTensors).
+  static constexpr size_t kAlignment = 64;
+
   explicit Tensor(interface::ITensor* tensor_view, bool copy_data = false);
   ~Tensor();
 
@@ -16,6 +16,7 @@
 
 #include <cassert>
 #include <cstring>  // memcpy
+#include <limits>
 #include <mutex>
 
 #include "absl/strings/str_format.h"
@@ -24,10 +25,25 @@
 #include "band/tensor.h"
 
 namespace band {
+namespace {
+constexpr uint32_t kNullSlot = 0xFFFFFFFF;
+
+uint64_t MakeState(uint32_t generation, uint32_t ref_count) {
+  return (static_cast<uint64_t>(generation) << 32) | ref_count;
+}
+uint32_t GetStateGeneration(uint64_t state) { return state >> 32; }
+uint32_t GetStateRefCount(uint64_t state) { return state & 0xFFFFFFFF; }
+}  // anonymous namespace
+
 TensorRingBuffer::TensorRingBuffer(
     std::vector<std::shared_ptr<interface::ITensor>> tensors,
-    std::vector<int> tensor_indices, int size)
-    : tensors_(new std::vector<interface::ITensor*>[size]), size_(size) {
+    std::vector<int> tensor_indices, int size, Clock* clock)
+    : tensors_(new std::vector<interface::ITensor*>[size]),
+      size_(size),
+      num_generations_(std::numeric_limits<int>::max() / size),
+      slots_(new Slot[size]),
+      num_free_slots_(size),
+      released_cv_(clock) {
   assert(size_ > 0);
   for (size_t i = 0; i < size_; i++) {
     tensors_[i].resize(tensors.size());
@@ -39,6 +55,13 @@ TensorRingBuffer::TensorRingBuffer(
   for (int i = 0; i < tensor_indices.size(); i++) {
     tensor_to_buffer_[tensor_indices[i]] = i;
   }
+
+  // Chain all slots in the free list
+  for (int i = 0; i < size_; i++) {
+    slots_[i].next.store(i + 1 < size_ ? i + 1 : kNullSlot,
+                         std::memory_order_relaxed);
+  }
+  free_head_.store(0);
 }
 
 TensorRingBuffer::~TensorRingBuffer() {
@@ -55,17 +78,112 @@ const int TensorRingBuffer::GetTensorsLength() const {
   return tensors_[0].size();
 }
 
-int TensorRingBuffer::Alloc() {
-  std::lock_guard<std::mutex> lock(head_mtx_);
-  return head_++;
+int TensorRingBuffer::GetNumFreeSlots() const { return num_free_slots_; }
+
+absl::StatusOr<int> TensorRingBuffer::Alloc(bool blocking) {
+  int index = PopFreeSlot();
+  if (index < 0 && blocking) {
+    std::unique_lock<std::mutex> lock(wait_mtx_);
+    num_waiters_++;
+    // Re-check after registering as a waiter, since a release in between
+    // would not have notified us.
+    released_cv_.Wait(lock, [this, &index]() {
+      index = PopFreeSlot();
+      return index >= 0;
+    });
+    num_waiters_--;
+  }
+
+  if (index < 0) {
+    return absl::ResourceExhaustedError(absl::StrFormat(
+        "Alloc: All %d tensor slots are in use.", size_));
+  }
+
+  // Exclusively owned after the pop, so a plain store is enough
+  Slot& slot = slots_[index];
+  const uint32_t generation =
+      GetStateGeneration(slot.state.load(std::memory_order_acquire));
+  slot.state.store(MakeState(generation, 1), std::memory_order_release);
+  return generation * size_ + index;
+}
+
+absl::Status TensorRingBuffer::Retain(int handle) {
+  if (handle < 0) {
+    return absl::InternalError(
+        absl::StrFormat("Retain: Invalid memory handle: %d.", handle));
+  }
+  Slot& slot = slots_[GetIndex(handle)];
+  uint64_t state = slot.state.load(std::memory_order_acquire);
+  do {
+    if (GetStateGeneration(state) != GetGeneration(handle) ||
+        GetStateRefCount(state) == 0) {
+      return absl::InternalError(
+          absl::StrFormat("Retain: Invalid memory handle: %d.", handle));
+    }
+  } while (!slot.state.compare_exchange_weak(state, state + 1,
+                                             std::memory_order_acq_rel,
+                                             std::memory_order_acquire));
+  return absl::OkStatus();
+}
+
+absl::Status TensorRingBuffer::Release(int handle) {
+  if (handle < 0) {
+    return absl::InternalError(
+        absl::StrFormat("Release: Invalid memory handle: %d.", handle));
+  }
+  Slot& slot = slots_[GetIndex(handle)];
+  const uint32_t generation = GetGeneration(handle);
+  uint64_t state = slot.state.load(std::memory_order_acquire);
+  uint64_t new_state;
+  do {
+    if (GetStateGeneration(state) != generation ||
+        GetStateRefCount(state) == 0) {
+      return absl::InternalError(
+          absl::StrFormat("Release: Invalid memory handle: %d.", handle));
+    }
+    // Bump the generation with the last reference to invalidate the handle
+    new_state = GetStateRefCount(state) > 1
+                    ? state - 1
+                    : MakeState((generation + 1) % num_generations_, 0);
+  } while (!slot.state.compare_exchange_weak(state, new_state,
+                                             std::memory_order_acq_rel,
+                                             std::memory_order_acquire));
+
+  if (GetStateRefCount(new_state) == 0) {
+    PushFreeSlot(GetIndex(handle));
+    if (num_waiters_ > 0) {
+      std::lock_guard<std::mutex> lock(wait_mtx_);
+      released_cv_.NotifyAll();
+    }
+  }
+  return absl::OkStatus();
 }
 
 bool TensorRingBuffer::IsTensorIndexValid(int tensor_index) const {
   return tensor_to_buffer_.find(tensor_index) != tensor_to_buffer_.end();
 }
 
+int TensorRingBuffer::GetBufferIndex(int tensor_index) const {
+  auto it = tensor_to_buffer_.find(tensor_index);
+  return it != tensor_to_buffer_.end() ? it->second : -1;
+}
+
+char* TensorRingBuffer::GetTensorData(int handle, int buffer_index) const {
+  if (!IsHandleValid(handle) || buffer_index < 0 ||
+      buffer_index >= GetTensorsLength()) {
+    return nullptr;
+  }
+  return tensors_[GetIndex(handle)][buffer_index]->GetData();
+}
+
 bool TensorRingBuffer::IsHandleValid(int handle) const {
-  return (handle >= 0) && (head_ - size_ <= handle) && (handle < head_);
+  if (handle < 0) {
+    return false;
+  }
+  const uint64_t state =
+      slots_[GetIndex(handle)].state.load(std::memory_order_acquire);
+  return GetStateGeneration(state) == GetGeneration(handle) &&
+         GetStateRefCount(state) > 0;
 }
 
 absl::Status TensorRingBuffer::GetTensorFromHandle(interface::ITensor* dst,
@@ -76,11 +194,9 @@ absl::Status TensorRingBuffer::GetTensorFromHandle(interface::ITensor* dst,
         "GetTensorFromHandle: Invalid tensor index: %d.", tensor_index));
   }
 
-  std::lock_guard<std::mutex> lock(head_mtx_);
   if (!IsHandleValid(handle)) {
     return absl::InternalError(absl::StrFormat(
-        "GetTensorFromHandle: Invalid memory handle: %d head: %d.", handle,
-        head_));
+        "GetTensorFromHandle: Invalid memory handle: %d.", handle));
   }
 
   return CopyTensor(
@@ -94,11 +210,9 @@ absl::Status TensorRingBuffer::PutTensorToHandle(const interface::ITensor* src,
         "PutTensorToHandle: Invalid tensor index: %d.", tensor_index));
   }
 
-  std::lock_guard<std::mutex> lock(head_mtx_);
   if (!IsHandleValid(handle)) {
     return absl::InternalError(absl::StrFormat(
-        "PutTensorToHandle: Invalid memory handle: %d head: %d.", handle,
-        head_));
+        "PutTensorToHandle: Invalid memory handle: %d.", handle));
   }
 
   return CopyTensor(
@@ -107,22 +221,18 @@ absl::Status TensorRingBuffer::PutTensorToHandle(const interface::ITensor* src,
 
 absl::Status TensorRingBuffer::GetTensorsFromHandle(
     std::vector<interface::ITensor*>& dst_tensors, int handle) const {
-  std::lock_guard<std::mutex> lock(head_mtx_);
   if (!IsHandleValid(handle)) {
     return absl::InternalError(absl::StrFormat(
-        "GetTensorsFromHandle: Invalid memory handle: %d head: %d.", handle,
-        head_));
+        "GetTensorsFromHandle: Invalid memory handle: %d.", handle));
   }
   return CopyTensors(tensors_[GetIndex(handle)], dst_tensors);
 }
 
 absl::Status TensorRingBuffer::PutTensorsToHandle(
     const std::vector<interface::ITensor*>& src_tensors, int handle) {
-  std::lock_guard<std::mutex> lock(head_mtx_);
   if (!IsHandleValid(handle)) {
     return absl::InternalError(absl::StrFormat(
-        "PutTensorsToHandle: Invalid memory handle: %d head: %d.", handle,
-        head_));
+        "PutTensorsToHandle: Invalid memory handle: %d.", handle));
   }
 
   return CopyTensors(src_tensors, tensors_[GetIndex(handle)]);
@@ -159,4 +269,35 @@ absl::Status TensorRingBuffer::CopyTensor(const interface::ITensor* src,
 }
 
 int TensorRingBuffer::GetIndex(int handle) const { return handle % size_; }
+
+uint32_t TensorRingBuffer::GetGeneration(int handle) const {
+  return handle / size_;
+}
+
+int TensorRingBuffer::PopFreeSlot() {
+  uint64_t head = free_head_.load();
+  while (true) {
+    const uint32_t index = head & 0xFFFFFFFF;
+    if (index == kNullSlot) {
+      return -1;
+    }
+    // The tag makes a concurrent pop-push of the same slot fail the exchange
+    const uint64_t new_head =
+        (((head >> 32) + 1) << 32) | slots_[index].next.load();
+    if (free_head_.compare_exchange_weak(head, new_head)) {
+      num_free_slots_--;
+      return index;
+    }
+  }
+}
+
+void TensorRingBuffer::PushFreeSlot(int index) {
+  uint64_t head = free_head_.load();
+  uint64_t new_head;
+  do {
+    slots_[index].next.store(head & 0xFFFFFFFF);
+    new_head = (((head >> 32) + 1) << 32) | static_cast<uint32_t>(index);
+  } while (!free_head_.compare_exchange_weak(head, new_head));
+  num_free_slots_++;
+}
 }  // namespace band
@@ -18,12 +18,15 @@
 #define BAND_TENSOR_RING_BUFFER_H_
 
 #include <array>
+#include <atomic>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <vector>
 
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "band/clock.h"
 #include "band/interface/tensor.h"
 #include "band/interface/tensor_view.h"
 
@@ -31,16 +34,40 @@ namespace band {
 
 class Tensor;
 
+/*
+  Pool of preallocated tensor slots for model inputs / outputs.
+
+  A slot is reserved with `Alloc` and stays valid until its last reference
+  is dropped with `Release`, so a queued job can never observe its slot
+  being reused. Handles carry the generation of their slot, and handles of
+  released slots are rejected. Alloc / Retain / Release are lock-free; only
+  a blocking `Alloc` on an exhausted pool waits for a release.
+*/
 class TensorRingBuffer {
  public:
+  // A blocking `Alloc` waits in the time of `clock` (real time if null).
   TensorRingBuffer(std::vector<std::shared_ptr<interface::ITensor>> tensors,
-                   std::vector<int> tensor_indices, int size = 128);
+                   std::vector<int> tensor_indices, int size = 128,
+                   Clock* clock = nullptr);
   ~TensorRingBuffer();
 
   const int GetTensorsLength() const;
-  int Alloc();
+  int GetSize() const { return size_; }
+  int GetNumFreeSlots() const;
+
+  // Reserves a slot with a single reference. If all slots are in use,
+  // returns ResourceExhausted or waits for a release if `blocking`.
+  absl::StatusOr<int> Alloc(bool blocking = false);
+  absl::Status Retain(int handle);
+  absl::Status Release(int handle);
+
   bool IsTensorIndexValid(int tensor_index) const;
   bool IsHandleValid(int handle) const;
+  // Position of a model tensor within a slot, or -1 if not in the buffer.
+  int GetBufferIndex(int tensor_index) const;
+  // Raw data of a tensor in the slot of `handle`, or nullptr if the handle
+  // is invalid. `buffer_index` comes from `GetBufferIndex`.
+  char* GetTensorData(int handle, int buffer_index) const;
   absl::Status GetTensorFromHandle(interface::ITensor* dst, int tensor_index,
                                    int handle) const;
   absl::Status PutTensorToHandle(const interface::ITensor* src,
@@ -51,15 +78,35 @@ class TensorRingBuffer {
       const std::vector<interface::ITensor*>& src_tensors, int handle);
 
  private:
+  struct Slot {
+    // generation (upper 32 bits) | reference count (lower 32 bits)
+    std::atomic<uint64_t> state{0};
+    // next free slot while in the free list
+    std::atomic<uint32_t> next{0};
+  };
+
   int GetIndex(int handle) const;
+  uint32_t GetGeneration(int handle) const;
+  int PopFreeSlot();
+  void PushFreeSlot(int index);
   absl::Status CopyTensors(const std::vector<interface::ITensor*>& src_tensors,
                            std::vector<interface::ITensor*>& dst_tensors) const;
   absl::Status CopyTensor(const interface::ITensor* src,
                           interface::ITensor* dst) const;
 
-  mutable std::mutex head_mtx_;
-  int head_ = 0;
   const int size_;
+  // generations wrap around so that handles fit in an int
+  const uint32_t num_generations_;
+  std::unique_ptr<Slot[]> slots_;
+  // ABA tag (upper 32 bits) | index of the first free slot (lower 32 bits)
+  std::atomic<uint64_t> free_head_;
+  std::atomic<int> num_free_slots_;
+
+  // Slow path for blocking allocation
+  std::atomic<int> num_waiters_{0};
+  std::mutex wait_mtx_;
+  ClockCondition released_cv_;
+
   std::vector<interface::ITensor*>* tensors_;
   // Model's tensor index to ring buffer's index
   std::map<int, int> tensor_to_buffer_;
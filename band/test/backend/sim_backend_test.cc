@@ -0,0 +1,675 @@
+// Copyright 2023 Seoul National University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/strings/str_format.h"
+#include "band/backend/sim/model.h"
+#include "band/backend/sim/model_executor.h"
+#include "band/backend_factory.h"
+#include "band/config_builder.h"
+#include "band/engine.h"
+#include "band/model.h"
+#include "band/runtime_tracer.h"
+#include "band/tensor.h"
+#include "band/time.h"
+
+namespace band {
+namespace test {
+
+// 4 ops in a chain, the third one runs only on CPU
+const char* kSimModel = R"({
+  "num_ops": 4,
+  "tensor_shape": [1, 8],
+  "op_latency_us": {"CPU": 1000, "GPU": [200, 200, 200, 200]},
+  "unsupported_ops": {"GPU": [2]}
+})";
+
+std::unique_ptr<interface::IModelExecutor> CreateExecutor(
+    ModelId model_id, WorkerId worker_id, DeviceFlag device_flag) {
+  return std::unique_ptr<interface::IModelExecutor>(
+      BackendFactory::CreateModelExecutor(BackendType::kSimulated, model_id,
+                                          worker_id, device_flag));
+}
+
+TEST(SimBackendTest, ModelSpec) {
+  Model model;
+  EXPECT_TRUE(model
+                  .FromBuffer(BackendType::kSimulated, kSimModel,
+                              strlen(kSimModel))
+                  .ok());
+  auto executor = CreateExecutor(model.GetId(), 0, DeviceFlag::kCPU);
+  ASSERT_TRUE(executor);
+
+  auto model_spec = executor->InvestigateModelSpec(
+      model.GetBackendModel(BackendType::kSimulated));
+  ASSERT_TRUE(model_spec.ok());
+  EXPECT_EQ(model_spec->num_ops, 4);
+  EXPECT_EQ(model_spec->num_tensors, 5);
+  EXPECT_EQ(model_spec->input_tensors, std::set<int>({0}));
+  EXPECT_EQ(model_spec->output_tensors, std::set<int>({4}));
+  EXPECT_EQ(model_spec->unsupported_ops.at(DeviceFlag::kGPU),
+            std::set<int>({2}));
+  // Devices without a latency profile
+  EXPECT_EQ(model_spec->unavailable_devices,
+            std::set<DeviceFlag>({DeviceFlag::kDSP, DeviceFlag::kNPU}));
+
+  EXPECT_TRUE(executor
+                  ->PrepareSubgraph(
+                      model.GetBackendModel(BackendType::kSimulated), {1, 2},
+                      {1})
+                  .ok());
+  const SubgraphKey key(model.GetId(), 0, {1});
+  EXPECT_EQ(executor->GetInputs(key), std::vector<int>({1}));
+  EXPECT_EQ(executor->GetOutputs(key), std::vector<int>({3}));
+
+  const int64_t start_time = time::NowMicros();
+  EXPECT_TRUE(executor->ExecuteSubgraph(key).ok());
+  EXPECT_GE(time::NowMicros() - start_time, 2000);
+}
+
+TEST(SimBackendTest, Throttling) {
+  const char* throttling_model = R"({
+    "num_ops": 1,
+    "op_latency_us": {"CPU": 10, "GPU": 10},
+    "throttling": {"GPU": {"probability": 1.0, "duration_us": 10000}}
+  })";
+  Model model;
+  EXPECT_TRUE(model
+                  .FromBuffer(BackendType::kSimulated, throttling_model,
+                              strlen(throttling_model))
+                  .ok());
+  Model other_model;
+  EXPECT_TRUE(other_model
+                  .FromBuffer(BackendType::kSimulated, kSimModel,
+                              strlen(kSimModel))
+                  .ok());
+
+  auto gpu = CreateExecutor(model.GetId(), 1, DeviceFlag::kGPU);
+  auto other_gpu = CreateExecutor(other_model.GetId(), 1, DeviceFlag::kGPU);
+  auto cpu = CreateExecutor(model.GetId(), 0, DeviceFlag::kCPU);
+  EXPECT_TRUE(
+      gpu->PrepareSubgraph(model.GetBackendModel(BackendType::kSimulated))
+          .ok());
+  EXPECT_TRUE(other_gpu
+                  ->PrepareSubgraph(
+                      other_model.GetBackendModel(BackendType::kSimulated),
+                      {0}, {0})
+                  .ok());
+  EXPECT_TRUE(
+      cpu->PrepareSubgraph(model.GetBackendModel(BackendType::kSimulated))
+          .ok());
+
+  EXPECT_TRUE(absl::IsUnavailable(
+      gpu->ExecuteSubgraph(SubgraphKey(model.GetId(), 1))));
+  // The whole device is throttled
+  EXPECT_TRUE(absl::IsUnavailable(
+      other_gpu->ExecuteSubgraph(SubgraphKey(other_model.GetId(), 1, {0}))));
+  EXPECT_TRUE(cpu->ExecuteSubgraph(SubgraphKey(model.GetId(), 0)).ok());
+
+  // The device recovers once the throttling event is over
+  time::SleepForMicros(10000);
+  EXPECT_TRUE(
+      other_gpu->ExecuteSubgraph(SubgraphKey(other_model.GetId(), 1, {0}))
+          .ok());
+}
+
+TEST(SimBackendTest, LazySubgraph) {
+  Model model;
+  EXPECT_TRUE(model
+                  .FromBuffer(BackendType::kSimulated, kSimModel,
+                              strlen(kSimModel))
+                  .ok());
+  auto executor = CreateExecutor(model.GetId(), 0, DeviceFlag::kCPU);
+  ASSERT_TRUE(executor);
+
+  EXPECT_TRUE(executor
+                  ->DeclareSubgraph(
+                      model.GetBackendModel(BackendType::kSimulated), {1, 2},
+                      {1})
+                  .ok());
+  const SubgraphKey key(model.GetId(), 0, {1});
+  EXPECT_TRUE(executor->HasSubgraph(key));
+  EXPECT_FALSE(executor->IsMaterialized(key));
+  EXPECT_FALSE(executor->ExecuteSubgraph(key).ok());
+
+  EXPECT_TRUE(executor->MaterializeSubgraph(key).ok());
+  EXPECT_TRUE(executor->IsMaterialized(key));
+  EXPECT_EQ(executor->GetInputs(key), std::vector<int>({1}));
+  // input 1 and output 3 of 8 floats, and the intermediate tensor 2 in the
+  // shared arena
+  EXPECT_EQ(executor->GetMemoryFootprint(key), 2 * 8 * sizeof(float));
+  EXPECT_EQ(executor->GetSharedMemoryFootprint(), 8 * sizeof(float));
+  EXPECT_TRUE(executor->ExecuteSubgraph(key).ok());
+
+  EXPECT_TRUE(executor->EvictSubgraph(key).ok());
+  EXPECT_FALSE(executor->IsMaterialized(key));
+  EXPECT_TRUE(executor->HasSubgraph(key));
+  EXPECT_EQ(executor->GetMemoryFootprint(key), 0);
+  EXPECT_EQ(executor->GetSharedMemoryFootprint(), 0);
+  EXPECT_TRUE(executor->MaterializeSubgraph(key).ok());
+  EXPECT_TRUE(executor->ExecuteSubgraph(key).ok());
+}
+
+TEST(SimBackendTest, ReplayProfile) {
+  const std::string profile_path = "sim_backend_test_profile.json";
+  {
+    // {model: {unit indices: [latency per worker]}}
+    std::ofstream profile(profile_path);
+    profile << R"({"hash": 0, "model.tflite": {"0": [null, 20000]}})";
+  }
+  const std::string replay_model =
+      R"({"num_ops": 2, "op_latency_us": {"CPU": 10, "GPU": 10},
+          "profile": {"path": ")" +
+      profile_path + R"(", "model": "model.tflite"}})";
+  Model model;
+  EXPECT_TRUE(model
+                  .FromBuffer(BackendType::kSimulated, replay_model.c_str(),
+                              replay_model.size())
+                  .ok());
+  std::remove(profile_path.c_str());
+
+  auto gpu = CreateExecutor(model.GetId(), 1, DeviceFlag::kGPU);
+  interface::IModel* backend_model =
+      model.GetBackendModel(BackendType::kSimulated);
+  EXPECT_TRUE(gpu->PrepareSubgraph(backend_model, {0}, {0}).ok());
+  EXPECT_TRUE(gpu->PrepareSubgraph(backend_model, {1}, {1}).ok());
+
+  // Profiled unit subgraph 0, and op latencies for the rest
+  int64_t start_time = time::NowMicros();
+  EXPECT_TRUE(gpu->ExecuteSubgraph(SubgraphKey(model.GetId(), 1, {0})).ok());
+  EXPECT_GE(time::NowMicros() - start_time, 20000);
+  start_time = time::NowMicros();
+  EXPECT_TRUE(gpu->ExecuteSubgraph(SubgraphKey(model.GetId(), 1, {1})).ok());
+  EXPECT_LT(time::NowMicros() - start_time, 20000);
+}
+
+TEST(SimBackendTest, Engine) {
+  RuntimeConfigBuilder b;
+  RuntimeConfig config =
+      b.AddSchedulers({SchedulerType::kHeterogeneousEarliestFinishTime})
+          .AddSubgraphPreparationType(
+              SubgraphPreparationType::kMergeUnitSubgraph)
+          .AddMinimumSubgraphSize(1)
+          .AddWorkers({DeviceFlag::kCPU, DeviceFlag::kGPU})
+          .AddWorkerNumThreads({1, 1})
+          .AddWorkerCPUMasks({CPUMaskFlag::kAll, CPUMaskFlag::kAll})
+          .AddOnline(true)
+          .AddNumWarmups(1)
+          .AddNumRuns(1)
+          .Build()
+          .value();
+  auto engine = Engine::Create(config);
+  ASSERT_TRUE(engine);
+
+  Model model;
+  EXPECT_TRUE(model
+                  .FromBuffer(BackendType::kSimulated, kSimModel,
+                              strlen(kSimModel))
+                  .ok());
+  EXPECT_EQ(engine->RegisterModel(&model), absl::OkStatus());
+
+  Tensor* input_tensor = engine->CreateTensor(
+      model.GetId(), engine->GetInputTensorIndices(model.GetId())[0]);
+  Tensor* output_tensor = engine->CreateTensor(
+      model.GetId(), engine->GetOutputTensorIndices(model.GetId())[0]);
+  ASSERT_TRUE(input_tensor && output_tensor);
+
+  // The op that GPU does not support falls back to CPU
+  const int64_t start_time = time::NowMicros();
+  EXPECT_TRUE(engine
+                  ->RequestSync(model.GetId(),
+                                RequestOption::GetDefaultOption(),
+                                {input_tensor}, {output_tensor})
+                  .ok());
+  EXPECT_GE(time::NowMicros() - start_time, 1000 + 3 * 200);
+
+  // Unit subgraphs on both workers, with the input and output copies
+  Metrics metrics = engine->GetMetrics();
+  EXPECT_EQ(metrics.counters["planner.finished_requests"], 1);
+  EXPECT_EQ(metrics.counters["planner.slo_violations"], 0);
+  EXPECT_GE(metrics.counters["planner.scheduled_jobs."
+                             "heterogeneous_earliest_finish_time"],
+            2);
+  EXPECT_GT(metrics.counters["engine.tensor_copy_bytes"], 0);
+  EXPECT_GE(metrics.counters["worker.0.invokes"], 1);
+  EXPECT_GE(metrics.counters["worker.1.invokes"], 1);
+  EXPECT_EQ(metrics.gauges["planner.request_queue_depth"], 0);
+  EXPECT_EQ(metrics.gauges[absl::StrFormat("model.%d.input_slots_in_use",
+                                           model.GetId())],
+            0);
+  // I/O tensors of the subgraphs, and one arena per worker for the
+  // intermediate tensors
+  EXPECT_GT(metrics.gauges[absl::StrFormat("model.%d.memory_bytes",
+                                           model.GetId())],
+            0);
+  EXPECT_GE(metrics.histograms["planner.pass_duration_us"].count, 1);
+
+  // Stages of the latency, summed over the three subgraphs
+  auto job_id = engine->RequestAsync(
+      model.GetId(), RequestOption::GetDefaultOption(), {input_tensor});
+  ASSERT_TRUE(job_id.ok());
+  EXPECT_EQ(engine->WaitAny({job_id.value()}).value(), job_id.value());
+  RequestTimes times;
+  EXPECT_TRUE(
+      engine->GetOutputTensors(job_id.value(), {output_tensor}, &times).ok());
+  EXPECT_EQ(times.model_id, model.GetId());
+  EXPECT_GE(times.execution_time, 1000 + 3 * 200);
+  EXPECT_GE(times.GetLatency(), times.execution_time);
+  EXPECT_GE(times.completion_time, times.end_time);
+  EXPECT_LE(times.planner_time + times.worker_queue_time +
+                times.input_copy_time + times.execution_time +
+                times.output_copy_time,
+            times.completion_time - times.enqueue_time);
+
+  delete input_tensor;
+  delete output_tensor;
+}
+
+TEST(SimBackendTest, UnreadOutputs) {
+  const int tensor_pool_size = 4;
+  RuntimeConfigBuilder b;
+  RuntimeConfig config =
+      b.AddSchedulers({SchedulerType::kHeterogeneousEarliestFinishTime})
+          .AddSubgraphPreparationType(
+              SubgraphPreparationType::kMergeUnitSubgraph)
+          .AddMinimumSubgraphSize(1)
+          .AddWorkers({DeviceFlag::kCPU, DeviceFlag::kGPU})
+          .AddWorkerNumThreads({1, 1})
+          .AddWorkerCPUMasks({CPUMaskFlag::kAll, CPUMaskFlag::kAll})
+          .AddOnline(true)
+          .AddNumWarmups(1)
+          .AddNumRuns(1)
+          .AddTensorPoolSize(tensor_pool_size)
+          .Build()
+          .value();
+  auto engine = Engine::Create(config);
+  ASSERT_TRUE(engine);
+
+  Model model;
+  EXPECT_TRUE(model
+                  .FromBuffer(BackendType::kSimulated, kSimModel,
+                              strlen(kSimModel))
+                  .ok());
+  EXPECT_EQ(engine->RegisterModel(&model), absl::OkStatus());
+  Tensor* input_tensor = engine->CreateTensor(
+      model.GetId(), engine->GetInputTensorIndices(model.GetId())[0]);
+  Tensor* output_tensor = engine->CreateTensor(
+      model.GetId(), engine->GetOutputTensorIndices(model.GetId())[0]);
+  ASSERT_TRUE(input_tensor && output_tensor);
+
+  // Requests that only report through the callback never read their
+  // outputs, and their slots are reclaimed for the later requests
+  std::atomic<int> num_callbacks{0};
+  engine->SetOnEndRequest(
+      [&num_callbacks](int, absl::Status) { num_callbacks++; });
+  const int num_requests = 3 * tensor_pool_size;
+  for (int i = 0; i < num_requests; i++) {
+    auto job_id = engine->RequestAsync(
+        model.GetId(), RequestOption::GetDefaultOption(), {input_tensor});
+    ASSERT_TRUE(job_id.ok()) << job_id.status();
+    engine->WaitAll();
+    while (num_callbacks < i + 1) {
+      std::this_thread::yield();
+    }
+  }
+  EXPECT_EQ(num_callbacks, num_requests);
+
+  // Outputs can only be read once, also after a `Wait` without outputs
+  auto job_id = engine->RequestAsync(
+      model.GetId(), RequestOption::GetDefaultOption(), {input_tensor});
+  ASSERT_TRUE(job_id.ok());
+  EXPECT_TRUE(engine->Wait(job_id.value()).ok());
+  EXPECT_EQ(engine->GetOutputTensors(job_id.value(), {output_tensor}).code(),
+            absl::StatusCode::kFailedPrecondition);
+
+  job_id = engine->RequestAsync(
+      model.GetId(), RequestOption::GetDefaultOption(), {input_tensor});
+  ASSERT_TRUE(job_id.ok());
+  EXPECT_TRUE(engine->Wait(job_id.value(), {output_tensor}).ok());
+  EXPECT_EQ(engine->GetOutputTensors(job_id.value(), {output_tensor}).code(),
+            absl::StatusCode::kFailedPrecondition);
+
+  delete input_tensor;
+  delete output_tensor;
+}
+
+TEST(SimBackendTest, BindIOTensors) {
+  RuntimeConfigBuilder b;
+  RuntimeConfig config =
+      b.AddSchedulers({SchedulerType::kHeterogeneousEarliestFinishTime})
+          .AddSubgraphPreparationType(
+              SubgraphPreparationType::kMergeUnitSubgraph)
+          .AddMinimumSubgraphSize(1)
+          .AddWorkers({DeviceFlag::kCPU, DeviceFlag::kGPU})
+          .AddWorkerNumThreads({1, 1})
+          .AddWorkerCPUMasks({CPUMaskFlag::kAll, CPUMaskFlag::kAll})
+          .AddOnline(true)
+          .AddNumWarmups(1)
+          .AddNumRuns(1)
+          .Build()
+          .value();
+  auto engine = Engine::Create(config);
+  ASSERT_TRUE(engine);
+
+  Model model;
+  EXPECT_TRUE(model
+                  .FromBuffer(BackendType::kSimulated, kSimModel,
+                              strlen(kSimModel))
+                  .ok());
+  EXPECT_EQ(engine->RegisterModel(&model), absl::OkStatus());
+  Tensor* input_tensor = engine->CreateTensor(
+      model.GetId(), engine->GetInputTensorIndices(model.GetId())[0]);
+  Tensor* output_tensor = engine->CreateTensor(
+      model.GetId(), engine->GetOutputTensorIndices(model.GetId())[0]);
+  ASSERT_TRUE(input_tensor && output_tensor);
+
+  RequestOption bound_option = RequestOption::GetDefaultOption();
+  bound_option.use_bound_tensors = true;
+  EXPECT_FALSE(engine->RequestSync(model.GetId(), bound_option).ok());
+
+  EXPECT_EQ(
+      engine->BindIOTensors(model.GetId(), {input_tensor}, {output_tensor}),
+      absl::OkStatus());
+  EXPECT_TRUE(engine
+                  ->RequestSync(model.GetId(), bound_option, {},
+                                {output_tensor})
+                  .ok());
+  // Requests only use the bound tensors when asked to
+  EXPECT_FALSE(engine
+                   ->RequestSync(model.GetId(), bound_option, {input_tensor},
+                                 {output_tensor})
+                   .ok());
+  EXPECT_FALSE(engine
+                   ->RequestSync(model.GetId(),
+                                 RequestOption::GetDefaultOption(), {},
+                                 {output_tensor})
+                   .ok());
+  EXPECT_TRUE(engine->RequestSync(model.GetId()).ok());
+  EXPECT_EQ(engine->UnbindIOTensors(model.GetId()), absl::OkStatus());
+
+  // Binding re-plans the tensors of the executors while requests that copy
+  // their own tensors are in flight
+  Tensor* request_input = engine->CreateTensor(
+      model.GetId(), engine->GetInputTensorIndices(model.GetId())[0]);
+  Tensor* request_output = engine->CreateTensor(
+      model.GetId(), engine->GetOutputTensorIndices(model.GetId())[0]);
+  ASSERT_TRUE(request_input && request_output);
+  std::atomic<bool> done{false};
+  std::thread binder([&]() {
+    while (!done) {
+      EXPECT_EQ(engine->BindIOTensors(model.GetId(), {input_tensor},
+                                      {output_tensor}),
+                absl::OkStatus());
+      EXPECT_EQ(engine->UnbindIOTensors(model.GetId()), absl::OkStatus());
+    }
+  });
+  for (int i = 0; i < 20; i++) {
+    EXPECT_TRUE(engine
+                    ->RequestSync(model.GetId(),
+                                  RequestOption::GetDefaultOption(),
+                                  {request_input}, {request_output})
+                    .ok());
+  }
+  done = true;
+  binder.join();
+
+  delete request_input;
+  delete request_output;
+  delete input_tensor;
+  delete output_tensor;
+}
+
+TEST(SimBackendTest, RegisterModels) {
+  RuntimeConfigBuilder b;
+  RuntimeConfig config =
+      b.AddSchedulers({SchedulerType::kHeterogeneousEarliestFinishTime})
+          .AddSubgraphPreparationType(
+              SubgraphPreparationType::kMergeUnitSubgraph)
+          .AddMinimumSubgraphSize(1)
+          .AddWorkers({DeviceFlag::kCPU, DeviceFlag::kGPU})
+          .AddWorkerNumThreads({1, 1})
+          .AddWorkerCPUMasks({CPUMaskFlag::kAll, CPUMaskFlag::kAll})
+          .AddOnline(true)
+          .AddNumWarmups(1)
+          .AddNumRuns(1)
+          .Build()
+          .value();
+  auto engine = Engine::Create(config);
+  ASSERT_TRUE(engine);
+
+  std::vector<Model> models(3);
+  for (Model& model : models) {
+    EXPECT_TRUE(model
+                    .FromBuffer(BackendType::kSimulated, kSimModel,
+                                strlen(kSimModel))
+                    .ok());
+  }
+  // Nothing is registered if one of the models is invalid
+  EXPECT_FALSE(engine->RegisterModels({&models[0], nullptr}).ok());
+  EXPECT_TRUE(engine->GetInputTensorIndices(models[0].GetId()).empty());
+
+  // ... or if one fails to be prepared, here without the CPU worker that
+  // holds the I/O tensors
+  const char* kGpuOnlyModel = R"({
+    "num_ops": 2,
+    "tensor_shape": [1, 8],
+    "op_latency_us": {"GPU": 200},
+    "unavailable_devices": ["CPU"]
+  })";
+  Model gpu_only_model;
+  EXPECT_TRUE(gpu_only_model
+                  .FromBuffer(BackendType::kSimulated, kGpuOnlyModel,
+                              strlen(kGpuOnlyModel))
+                  .ok());
+  EXPECT_FALSE(
+      engine->RegisterModels({&models[0], &models[1], &gpu_only_model}).ok());
+  for (Model* model : {&models[0], &models[1], &gpu_only_model}) {
+    EXPECT_TRUE(engine->GetInputTensorIndices(model->GetId()).empty());
+  }
+
+  EXPECT_EQ(engine->RegisterModels({&models[0], &models[1], &models[2]}),
+            absl::OkStatus());
+  for (Model& model : models) {
+    Tensor* input_tensor = engine->CreateTensor(
+        model.GetId(), engine->GetInputTensorIndices(model.GetId())[0]);
+    Tensor* output_tensor = engine->CreateTensor(
+        model.GetId(), engine->GetOutputTensorIndices(model.GetId())[0]);
+    ASSERT_TRUE(input_tensor && output_tensor);
+    // The whole model on the CPU worker is profiled
+    EXPECT_GT(engine->GetProfiled({model.GetId(), 0, {0, 1, 2}}), 0);
+    EXPECT_TRUE(engine
+                    ->RequestSync(model.GetId(),
+                                  RequestOption::GetDefaultOption(),
+                                  {input_tensor}, {output_tensor})
+                    .ok());
+    delete input_tensor;
+    delete output_tensor;
+  }
+  EXPECT_EQ(engine->GetMetrics().counters["planner.finished_requests"], 3);
+}
+
+TEST(SimBackendTest, LazySubgraphs) {
+  // Unlimited, and a budget that only fits the largest subgraphs
+  for (size_t memory_budget : {0, 1}) {
+    RuntimeConfigBuilder b;
+    RuntimeConfig config =
+        b.AddSchedulers({SchedulerType::kHeterogeneousEarliestFinishTime})
+            .AddSubgraphPreparationType(
+                SubgraphPreparationType::kMergeUnitSubgraph)
+            .AddMinimumSubgraphSize(1)
+            .AddLazySubgraphs(true)
+            .AddSubgraphMemoryBudget(memory_budget)
+            .AddWorkers({DeviceFlag::kCPU, DeviceFlag::kGPU})
+            .AddWorkerNumThreads({1, 1})
+            .AddWorkerCPUMasks({CPUMaskFlag::kAll, CPUMaskFlag::kAll})
+            .AddOnline(true)
+            .AddNumWarmups(1)
+            .AddNumRuns(1)
+            .Build()
+            .value();
+    auto engine = Engine::Create(config);
+    ASSERT_TRUE(engine);
+
+    Model model;
+    EXPECT_TRUE(model
+                    .FromBuffer(BackendType::kSimulated, kSimModel,
+                                strlen(kSimModel))
+                    .ok());
+    EXPECT_EQ(engine->RegisterModel(&model), absl::OkStatus());
+
+    // The CPU worker has the whole model, its three unit subgraphs (built
+    // to profile them), and two merged subgraphs that are only estimated
+    Metrics metrics = engine->GetMetrics();
+    if (memory_budget == 0) {
+      EXPECT_EQ(metrics.gauges["worker.0.materialized_subgraphs"], 4);
+      EXPECT_EQ(metrics.counters["engine.subgraph_evictions"], 0);
+    } else {
+      EXPECT_LT(metrics.gauges["worker.0.materialized_subgraphs"], 4);
+      EXPECT_GT(metrics.counters["engine.subgraph_evictions"], 0);
+    }
+    EXPECT_GT(metrics.gauges["worker.0.subgraph_bytes"], 0);
+    EXPECT_GT(metrics.counters["engine.subgraph_materializations"], 0);
+
+    Tensor* input_tensor = engine->CreateTensor(
+        model.GetId(), engine->GetInputTensorIndices(model.GetId())[0]);
+    Tensor* output_tensor = engine->CreateTensor(
+        model.GetId(), engine->GetOutputTensorIndices(model.GetId())[0]);
+    ASSERT_TRUE(input_tensor && output_tensor);
+    for (int i = 0; i < 3; i++) {
+      EXPECT_TRUE(engine
+                      ->RequestSync(model.GetId(),
+                                    RequestOption::GetDefaultOption(),
+                                    {input_tensor}, {output_tensor})
+                      .ok());
+    }
+    EXPECT_EQ(engine->GetMetrics().counters["planner.finished_requests"], 3);
+
+    delete input_tensor;
+    delete output_tensor;
+  }
+}
+
+TEST(SimBackendTest, RuntimeTracer) {
+  RuntimeConfigBuilder b;
+  RuntimeConfig config =
+      b.AddSchedulers({SchedulerType::kHeterogeneousEarliestFinishTime})
+          .AddSubgraphPreparationType(
+              SubgraphPreparationType::kMergeUnitSubgraph)
+          .AddMinimumSubgraphSize(1)
+          .AddWorkers({DeviceFlag::kCPU, DeviceFlag::kGPU})
+          .AddWorkerNumThreads({1, 1})
+          .AddWorkerCPUMasks({CPUMaskFlag::kAll, CPUMaskFlag::kAll})
+          .AddOnline(true)
+          .AddNumWarmups(1)
+          .AddNumRuns(1)
+          .Build()
+          .value();
+  auto engine = Engine::Create(config);
+  ASSERT_TRUE(engine);
+
+  Model model;
+  EXPECT_TRUE(model
+                  .FromBuffer(BackendType::kSimulated, kSimModel,
+                              strlen(kSimModel))
+                  .ok());
+  EXPECT_EQ(engine->RegisterModel(&model), absl::OkStatus());
+
+  RuntimeTracer& tracer = RuntimeTracer::Get();
+  tracer.Start();
+  EXPECT_TRUE(engine->RequestSync(model.GetId()).ok());
+  tracer.Stop();
+
+  // The subgraphs with their copies, and the planner passes with the queue
+  // depths
+  std::map<TraceEventType, int> num_events;
+  for (const TraceEvent& event : tracer.Collect()) {
+    num_events[event.type]++;
+  }
+  EXPECT_GE(num_events[TraceEventType::kSubgraph], 1);
+  EXPECT_EQ(num_events[TraceEventType::kInputCopy],
+            num_events[TraceEventType::kSubgraph]);
+  EXPECT_EQ(num_events[TraceEventType::kOutputCopy],
+            num_events[TraceEventType::kSubgraph]);
+  EXPECT_GE(num_events[TraceEventType::kPlannerPass], 1);
+  EXPECT_EQ(num_events[TraceEventType::kRequestQueueDepth],
+            num_events[TraceEventType::kPlannerPass]);
+  EXPECT_EQ(num_events[TraceEventType::kWorkerQueueDepth],
+            2 * num_events[TraceEventType::kPlannerPass]);
+}
+
+TEST(SimBackendTest, VirtualClock) {
+  RuntimeConfigBuilder b;
+  RuntimeConfig config =
+      b.AddSchedulers({SchedulerType::kHeterogeneousEarliestFinishTime})
+          .AddSubgraphPreparationType(
+              SubgraphPreparationType::kMergeUnitSubgraph)
+          .AddMinimumSubgraphSize(1)
+          .AddWorkers({DeviceFlag::kCPU, DeviceFlag::kGPU})
+          .AddWorkerNumThreads({1, 1})
+          .AddWorkerCPUMasks({CPUMaskFlag::kAll, CPUMaskFlag::kAll})
+          .AddOnline(true)
+          .AddNumWarmups(1)
+          .AddNumRuns(1)
+          .AddVirtualClock(true)
+          .Build()
+          .value();
+  auto engine = Engine::Create(config);
+  ASSERT_TRUE(engine);
+  Clock* clock = engine->GetClock();
+  ASSERT_TRUE(clock->IsVirtual());
+  clock->AttachThread();
+
+  const char* slow_model = R"({
+    "num_ops": 4,
+    "op_latency_us": {"CPU": 1000000, "GPU": [200000, 200000, 200000, 200000]},
+    "unsupported_ops": {"GPU": [2]}
+  })";
+  Model model;
+  EXPECT_TRUE(model
+                  .FromBuffer(BackendType::kSimulated, slow_model,
+                              strlen(slow_model))
+                  .ok());
+  EXPECT_EQ(engine->RegisterModel(&model), absl::OkStatus());
+
+  // Seconds of simulated latency, without waiting for them. Scheduling and
+  // copies take no virtual time, so the latency is exact.
+  const int64_t real_start_time = time::NowMicros();
+  for (int i = 0; i < 3; i++) {
+    const int64_t start_time = clock->NowMicros();
+    EXPECT_TRUE(engine->RequestSync(model.GetId()).ok());
+    EXPECT_EQ(clock->NowMicros() - start_time, 1000000 + 3 * 200000);
+  }
+  EXPECT_LT(time::NowMicros() - real_start_time, 1000000);
+
+  clock->DetachThread();
+}
+
+}  // namespace test
+}  // namespace band
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
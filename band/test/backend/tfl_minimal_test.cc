@@ -35,6 +35,9 @@
 #include "band/model.h"
 #include "band/tensor.h"
 #include "band/test/image_util.h"
+#include "tensorflow/lite/core/subgraph.h"
+#include "tensorflow/lite/interpreter_builder.h"
+#include "tensorflow/lite/kernels/register.h"
 
 namespace band {
 namespace test {
@@ -66,6 +69,69 @@ TEST(TFLiteBackend, ModelSpec) {
   EXPECT_EQ(model_spec.output_tensors.size(), 1);
 }
 
+TEST(TFLiteBackend, SharedArena) {
+  tfl::TfLiteModel bin_model(0);
+  EXPECT_EQ(bin_model.FromPath("band/test/data/add.tflite"), absl::OkStatus());
+
+  // Arena of a plain interpreter, which also holds the intermediate tensor
+  std::unique_ptr<tflite::Interpreter> interpreter;
+  tflite::ops::builtin::BuiltinOpResolver resolver;
+  ASSERT_EQ(tflite::InterpreterBuilder(*bin_model.GetFlatBufferModel(),
+                                       resolver)(&interpreter),
+            kTfLiteOk);
+  ASSERT_EQ(interpreter->AllocateTensors(), kTfLiteOk);
+  tflite::SubgraphAllocInfo alloc_info;
+  interpreter->primary_subgraph().GetMemoryAllocInfo(&alloc_info);
+
+  tfl::TfLiteModelExecutor model_executor(0, 0, DeviceFlag::kCPU);
+  EXPECT_EQ(model_executor.PrepareSubgraph(&bin_model), absl::OkStatus());
+  SubgraphKey key = model_executor.GetLargestSubgraphKey();
+#ifndef TFLITE_BUILD_WITH_XNNPACK_DELEGATE
+  // The intermediate tensor moved to the shared arena, and the arena of the
+  // interpreter shrank to the I/O tensors
+  EXPECT_GT(model_executor.GetSharedMemoryFootprint(), 0);
+  EXPECT_LT(model_executor.GetMemoryFootprint(key),
+            alloc_info.arena_size + alloc_info.arena_persist_size);
+#endif
+
+  std::array<float, 2> input = {1.f, 3.f};
+  memcpy(model_executor.GetTensorView(key, model_executor.GetInputs(key)[0])
+             ->GetData(),
+         input.data(), input.size() * sizeof(float));
+  EXPECT_EQ(model_executor.ExecuteSubgraph(key), absl::OkStatus());
+  auto output_tensor =
+      model_executor.GetTensorView(key, model_executor.GetOutputs(key)[0]);
+  EXPECT_EQ(reinterpret_cast<float*>(output_tensor->GetData())[0], 3.f);
+  EXPECT_EQ(reinterpret_cast<float*>(output_tensor->GetData())[1], 9.f);
+}
+
+TEST(TFLiteBackend, SharedArenaBatch) {
+  tfl::TfLiteModel bin_model(0);
+  EXPECT_EQ(bin_model.FromPath("band/test/data/add.tflite"), absl::OkStatus());
+
+  tfl::TfLiteModelExecutor model_executor(0, 0, DeviceFlag::kCPU);
+  EXPECT_EQ(model_executor.PrepareSubgraph(&bin_model), absl::OkStatus());
+  SubgraphKey key = model_executor.GetLargestSubgraphKey();
+  // The intermediate tensors are shared again at the batched sizes
+  ASSERT_EQ(model_executor.ResizeBatch(key, 2), absl::OkStatus());
+#ifndef TFLITE_BUILD_WITH_XNNPACK_DELEGATE
+  EXPECT_GT(model_executor.GetSharedMemoryFootprint(), 0);
+#endif
+
+  auto input_tensor =
+      model_executor.GetTensorView(key, model_executor.GetInputs(key)[0]);
+  std::array<float, 4> input = {1.f, 3.f, 5.f, 7.f};
+  ASSERT_EQ(input_tensor->GetBytes(), input.size() * sizeof(float));
+  memcpy(input_tensor->GetData(), input.data(), input.size() * sizeof(float));
+  EXPECT_EQ(model_executor.ExecuteSubgraph(key), absl::OkStatus());
+  auto output_tensor =
+      model_executor.GetTensorView(key, model_executor.GetOutputs(key)[0]);
+  for (size_t i = 0; i < input.size(); i++) {
+    EXPECT_EQ(reinterpret_cast<float*>(output_tensor->GetData())[i],
+              3.f * input[i]);
+  }
+}
+
 TEST(TFLiteBackend, Registration) {
   auto backends = BackendFactory::GetAvailableBackends();
   int expected_num_backends = 0;
@@ -261,6 +327,72 @@ TEST(TFLiteBackend, SimpleEngineInvokeAsync) {
   delete output_tensor;
 }  // namespace
 
+TEST(TFLiteBackend, SimpleEngineInvokeBoundIO) {
+  RuntimeConfigBuilder b;
+  RuntimeConfig config =
+      b.AddPlannerLogPath("band/test/data/log.json")
+          .AddSchedulers({SchedulerType::kShortestExpectedLatency})
+          .AddMinimumSubgraphSize(7)
+          .AddSubgraphPreparationType(
+              SubgraphPreparationType::kMergeUnitSubgraph)
+          .AddCPUMask(CPUMaskFlag::kAll)
+          .AddPlannerCPUMask(CPUMaskFlag::kPrimary)
+          .AddWorkers({DeviceFlag::kCPU})
+          .AddWorkerNumThreads({1})
+          .AddWorkerCPUMasks({CPUMaskFlag::kAll})
+          .AddSmoothingFactor(0.1)
+          .AddProfileDataPath("band/test/data/profile.json")
+          .AddOnline(true)
+          .AddNumWarmups(1)
+          .AddNumRuns(1)
+          .AddAvailabilityCheckIntervalMs(30000)
+          .AddScheduleWindowSize(10)
+          .Build()
+          .value();
+
+  auto engine = Engine::Create(config);
+  EXPECT_TRUE(engine);
+
+  Model model;
+  EXPECT_TRUE(
+      model.FromPath(BackendType::kTfLite, "band/test/data/add.tflite").ok());
+  EXPECT_EQ(engine->RegisterModel(&model), absl::OkStatus());
+
+  Tensor* input_tensor = engine->CreateTensor(
+      model.GetId(), engine->GetInputTensorIndices(model.GetId())[0]);
+  Tensor* output_tensor = engine->CreateTensor(
+      model.GetId(), engine->GetOutputTensorIndices(model.GetId())[0]);
+
+  EXPECT_TRUE(input_tensor && output_tensor);
+  EXPECT_EQ(engine->BindIOTensors(model.GetId(), {input_tensor},
+                                  {output_tensor}),
+            absl::OkStatus());
+  EXPECT_FALSE(
+      engine->BindIOTensors(model.GetId(), {input_tensor}, {output_tensor})
+          .ok());
+
+  RequestOption bound_option = RequestOption::GetDefaultOption();
+  bound_option.use_bound_tensors = true;
+  for (float offset : {0.f, 1.f}) {
+    std::array<float, 2> input = {1.f + offset, 3.f + offset};
+    memcpy(input_tensor->GetData(), input.data(),
+           input.size() * sizeof(float));
+
+    EXPECT_EQ(engine->RequestSync(model.GetId(), bound_option),
+              absl::OkStatus());
+    EXPECT_EQ(reinterpret_cast<float*>(output_tensor->GetData())[0],
+              3.f * input[0]);
+    EXPECT_EQ(reinterpret_cast<float*>(output_tensor->GetData())[1],
+              3.f * input[1]);
+  }
+
+  EXPECT_EQ(engine->UnbindIOTensors(model.GetId()), absl::OkStatus());
+  EXPECT_FALSE(engine->UnbindIOTensors(model.GetId()).ok());
+
+  delete input_tensor;
+  delete output_tensor;
+}
+
 TEST(TFLiteBackend, SimpleEngineInvokeSyncOnWorker) {
   RuntimeConfigBuilder b;
   RuntimeConfig config =
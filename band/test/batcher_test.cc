@@ -0,0 +1,155 @@
+// Copyright 2023 Seoul National University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "band/batcher.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "band/job_slab.h"
+#include "band/test/test_util.h"
+
+namespace band {
+namespace test {
+
+// Model 0 runs with batch sizes 2 and 4 on both workers, model 1 is not
+// batched.
+struct MockEngine : public MockEngineBase {
+  size_t GetNumWorkers() const override { return 2; }
+
+  SubgraphKey GetLargestSubgraphKey(ModelId model_id,
+                                    WorkerId worker_id) const override {
+    return SubgraphKey(model_id, worker_id, {0});
+  }
+
+  std::vector<int> GetBatchSizes(const SubgraphKey& key) const override {
+    return key.GetModelId() == 0 ? std::vector<int>{2, 4} : std::vector<int>{};
+  }
+
+  int64_t GetExpected(const SubgraphKey& key, int batch_size) const override {
+    return 100 * batch_size;
+  }
+};
+
+JobHandle AllocJob(JobSlab& slab, JobId job_id, ModelId model_id,
+                   int64_t enqueue_time, int64_t slo_us = 0) {
+  Job job(model_id, slo_us);
+  job.job_id = job_id;
+  job.input_handle = job_id;
+  job.output_handle = job_id;
+  job.enqueue_time = enqueue_time;
+  return slab.Alloc(std::move(job));
+}
+
+TEST(BatcherTest, FullBatch) {
+  MockEngine engine;
+  Batcher batcher(engine);
+  batcher.Init(4, 1000);
+  JobSlab slab;
+
+  JobQueue jobs;
+  for (int i = 0; i < 5; i++) {
+    jobs.push_back(AllocJob(slab, i, 0, 0));
+  }
+  jobs.push_back(AllocJob(slab, 5, 1, 0));
+
+  // A batch of the first four, the unbatched model, and the held job
+  EXPECT_EQ(batcher.Batch(0, jobs, 10), 1000);
+  ASSERT_EQ(jobs.size(), 2);
+  EXPECT_EQ(jobs[0]->job_id, 0);
+  EXPECT_EQ(jobs[0]->batch_size, 4);
+  EXPECT_THAT(jobs[0]->batch_input_handles, testing::ElementsAre(0, 1, 2, 3));
+  EXPECT_THAT(jobs[0]->batch_output_handles,
+              testing::ElementsAre(0, 1, 2, 3));
+  EXPECT_EQ(jobs[1]->job_id, 5);
+  EXPECT_EQ(jobs[1]->batch_size, 1);
+
+  std::vector<JobHandle> members = batcher.TakeMembers(0);
+  ASSERT_EQ(members.size(), 3);
+  EXPECT_EQ(members[0]->job_id, 1);
+  EXPECT_TRUE(batcher.TakeMembers(0).empty());
+}
+
+TEST(BatcherTest, Timeout) {
+  MockEngine engine;
+  Batcher batcher(engine);
+  batcher.Init(4, 1000);
+  JobSlab slab;
+
+  JobQueue jobs;
+  for (int i = 0; i < 3; i++) {
+    jobs.push_back(AllocJob(slab, i, 0, i * 100));
+  }
+  EXPECT_EQ(batcher.Batch(0, jobs, 300), 1000);
+  EXPECT_TRUE(jobs.empty());
+
+  // The largest batch that fits, then the rest one by one
+  EXPECT_EQ(batcher.Batch(0, jobs, 1000), -1);
+  ASSERT_EQ(jobs.size(), 2);
+  EXPECT_EQ(jobs[0]->batch_size, 2);
+  EXPECT_EQ(jobs[0]->job_id, 0);
+  EXPECT_EQ(jobs[1]->batch_size, 1);
+  EXPECT_EQ(jobs[1]->job_id, 2);
+}
+
+TEST(BatcherTest, SLO) {
+  MockEngine engine;
+  Batcher batcher(engine);
+  batcher.Init(4, 1000);
+  JobSlab slab;
+
+  // Released in time for the full batch (400us) to meet the SLO
+  JobQueue jobs;
+  jobs.push_back(AllocJob(slab, 0, 0, 0));
+  jobs.push_back(AllocJob(slab, 1, 0, 100, 800));
+  EXPECT_EQ(batcher.Batch(0, jobs, 100), 500);
+
+  EXPECT_EQ(batcher.Batch(0, jobs, 500), -1);
+  ASSERT_EQ(jobs.size(), 1);
+  EXPECT_EQ(jobs[0]->batch_size, 2);
+  // The batch inherits the tightest deadline, and the leader keeps its SLO
+  EXPECT_EQ(jobs[0]->batch_deadline_us, 900);
+  EXPECT_EQ(jobs[0]->GetDeadline(), 900);
+  EXPECT_EQ(jobs[0]->slo_us, 0);
+}
+
+TEST(BatcherTest, NotBatchable) {
+  MockEngine engine;
+  Batcher batcher(engine);
+  batcher.Init(4, 1000);
+  JobSlab slab;
+
+  JobQueue jobs;
+  for (int i = 0; i < 4; i++) {
+    jobs.push_back(AllocJob(slab, i, 0, 0));
+  }
+  jobs[0]->target_worker_id = 0;
+  jobs[1]->io_bound = true;
+  jobs[2]->resolved_unit_subgraphs.set(0);
+
+  EXPECT_EQ(batcher.Batch(0, jobs, 0), 1000);
+  ASSERT_EQ(jobs.size(), 3);
+  for (int i = 0; i < 3; i++) {
+    EXPECT_EQ(jobs[i]->job_id, i);
+    EXPECT_EQ(jobs[i]->batch_size, 1);
+  }
+}
+
+}  // namespace test
+}  // namespace band
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -19,6 +19,7 @@
 #include <stdint.h>
 
 #include <array>
+#include <cstring>
 #include <fstream>
 #include <vector>
 
@@ -124,6 +125,21 @@ TEST(CApi, EngineSimpleSyncInvoke) {
   EXPECT_EQ(BandTensorGetDims(output_tensor)[2], 8);
   EXPECT_EQ(BandTensorGetDims(output_tensor)[3], 3);
 
+  BandMetrics* metrics = BandEngineGetMetrics(engine);
+  ASSERT_NE(metrics, nullptr);
+  bool has_finished_requests = false;
+  for (size_t i = 0; i < BandMetricsGetNumValues(metrics); i++) {
+    if (strcmp(BandMetricsGetName(metrics, i), "planner.finished_requests") ==
+        0) {
+      EXPECT_EQ(BandMetricsGetValue(metrics, i), 1);
+      has_finished_requests = true;
+    }
+  }
+  EXPECT_TRUE(has_finished_requests);
+  EXPECT_EQ(BandMetricsGetName(metrics, BandMetricsGetNumValues(metrics)),
+            nullptr);
+  BandMetricsDelete(metrics);
+
   BandTensorDelete(input_tensor);
   BandTensorDelete(output_tensor);
 #endif  // BAND_TFLITE
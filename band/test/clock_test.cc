@@ -0,0 +1,166 @@
+// Copyright 2023 Seoul National University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "band/clock.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "band/time.h"
+
+namespace band {
+namespace test {
+
+// Attaches the calling thread and blocks until `num_threads` threads did, so
+// that the time cannot move on before all of them are attached.
+struct AttachBarrier {
+  AttachBarrier(VirtualClock& clock, int num_threads)
+      : clock(clock), cv(&clock), num_threads(num_threads) {}
+
+  void AttachAndWait() {
+    clock.AttachThread();
+    std::unique_lock<std::mutex> lock(mtx);
+    num_attached++;
+    cv.NotifyAll();
+    cv.Wait(lock, [this]() { return num_attached == num_threads; });
+  }
+
+  VirtualClock& clock;
+  ClockCondition cv;
+  std::mutex mtx;
+  int num_attached = 0;
+  const int num_threads;
+};
+
+TEST(ClockTest, RealClock) {
+  Clock* clock = RealClock::Get();
+  EXPECT_FALSE(clock->IsVirtual());
+  const int64_t now0 = clock->NowMicros();
+  clock->SleepForMicros(50);
+  EXPECT_GE(clock->NowMicros(), now0 + 50);
+
+  ClockCondition cv(clock);
+  std::mutex mtx;
+  std::unique_lock<std::mutex> lock(mtx);
+  EXPECT_FALSE(
+      cv.WaitUntil(lock, clock->NowMicros() + 50, []() { return false; }));
+}
+
+TEST(ClockTest, VirtualSleep) {
+  VirtualClock clock;
+  EXPECT_TRUE(clock.IsVirtual());
+  EXPECT_EQ(clock.NowMicros(), 1);
+
+  // An hour passes without waiting for it
+  const int64_t real_start = time::NowMicros();
+  clock.SleepForMicros(3600 * 1000 * 1000LL);
+  EXPECT_EQ(clock.NowMicros(), 1 + 3600 * 1000 * 1000LL);
+  EXPECT_LT(time::NowMicros() - real_start, 1000 * 1000);
+
+  // The time never goes backward
+  clock.SleepUntil(10);
+  EXPECT_EQ(clock.NowMicros(), 1 + 3600 * 1000 * 1000LL);
+}
+
+TEST(ClockTest, VirtualConditionTimeout) {
+  VirtualClock clock;
+  ClockCondition cv(&clock);
+  std::mutex mtx;
+  std::unique_lock<std::mutex> lock(mtx);
+  EXPECT_FALSE(cv.WaitUntil(lock, 1000, []() { return false; }));
+  EXPECT_EQ(clock.NowMicros(), 1000);
+  // Past deadlines time out right away
+  EXPECT_FALSE(cv.WaitUntil(lock, 500, []() { return false; }));
+  EXPECT_EQ(clock.NowMicros(), 1000);
+}
+
+TEST(ClockTest, VirtualDeterministicOrder) {
+  VirtualClock clock;
+  AttachBarrier barrier(clock, 2);
+  std::mutex log_mtx;
+  std::vector<std::pair<std::string, int64_t>> log;
+  auto record = [&](const std::string& name) {
+    std::lock_guard<std::mutex> lock(log_mtx);
+    log.push_back({name, clock.NowMicros()});
+  };
+
+  std::thread a([&]() {
+    barrier.AttachAndWait();
+    clock.SleepForMicros(300);
+    record("a");
+    clock.SleepForMicros(300);
+    record("a");
+    clock.DetachThread();
+  });
+  std::thread b([&]() {
+    barrier.AttachAndWait();
+    clock.SleepForMicros(500);
+    record("b");
+    clock.DetachThread();
+  });
+  a.join();
+  b.join();
+
+  const std::vector<std::pair<std::string, int64_t>> expected = {
+      {"a", 301}, {"b", 501}, {"a", 601}};
+  EXPECT_EQ(log, expected);
+}
+
+TEST(ClockTest, VirtualNotify) {
+  VirtualClock clock;
+  AttachBarrier barrier(clock, 2);
+  ClockCondition cv(&clock);
+  std::mutex mtx;
+  bool signaled = false;
+  bool waiter_result = false;
+  int64_t waiter_time = 0;
+
+  std::thread waiter([&]() {
+    barrier.AttachAndWait();
+    std::unique_lock<std::mutex> lock(mtx);
+    waiter_result = cv.WaitUntil(lock, clock.NowMicros() + 1000,
+                                 [&]() { return signaled; });
+    waiter_time = clock.NowMicros();
+    lock.unlock();
+    clock.DetachThread();
+  });
+  std::thread notifier([&]() {
+    barrier.AttachAndWait();
+    clock.SleepForMicros(100);
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      signaled = true;
+    }
+    cv.NotifyAll();
+    clock.DetachThread();
+  });
+  waiter.join();
+  notifier.join();
+
+  // Woken up before the deadline, at the time of the notification
+  EXPECT_TRUE(waiter_result);
+  EXPECT_EQ(waiter_time, 101);
+}
+
+}  // namespace test
+}  // namespace band
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -98,6 +98,10 @@ TEST(ConfigBuilderTest, RuntimeConfigBuilderTest) {
                     .AddAllowWorkSteal(true)
                     .AddAvailabilityCheckIntervalMs(100)
                     .AddCPUMask(CPUMaskFlag::kPrimary)
+                    .AddTensorPoolSize(16)
+                    .AddBlockOnTensorPoolFull(true)
+                    .AddLazySubgraphs(true)
+                    .AddSubgraphMemoryBudget(1 << 20)
                     .Build();
   EXPECT_EQ(config.status(), absl::OkStatus());
   RuntimeConfig config_ok = config.value();
@@ -110,7 +114,11 @@ TEST(ConfigBuilderTest, RuntimeConfigBuilderTest) {
   EXPECT_EQ(config_ok.subgraph_config.minimum_subgraph_size, 5);
   EXPECT_EQ(config_ok.subgraph_config.subgraph_preparation_type,
             SubgraphPreparationType::kMergeUnitSubgraph);
+  EXPECT_EQ(config_ok.subgraph_config.lazy_subgraphs, true);
+  EXPECT_EQ(config_ok.subgraph_config.subgraph_memory_budget, 1 << 20);
   EXPECT_EQ(config_ok.cpu_mask, CPUMaskFlag::kPrimary);
+  EXPECT_EQ(config_ok.tensor_pool_size, 16);
+  EXPECT_EQ(config_ok.block_on_tensor_pool_full, true);
   EXPECT_EQ(config_ok.planner_config.log_path, "band/test/data/config.json");
   EXPECT_EQ(config_ok.planner_config.schedule_window_size, 1);
   EXPECT_EQ(config_ok.planner_config.schedulers[0],
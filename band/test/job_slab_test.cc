@@ -0,0 +1,109 @@
+// Copyright 2023 Seoul National University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "band/job_slab.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+namespace band {
+namespace test {
+
+TEST(JobSlabTest, AllocGet) {
+  JobSlab slab;
+  Job job(3);
+  job.job_id = 7;
+  JobHandle handle = slab.Alloc(std::move(job));
+  ASSERT_TRUE(handle.IsValid());
+  EXPECT_EQ(handle->model_id, 3);
+  EXPECT_EQ(handle->job_id, 7);
+  EXPECT_EQ(slab.GetNumAllocated(), 1);
+
+  // Handles share the record
+  JobHandle copy = handle;
+  copy->status = JobStatus::kSuccess;
+  EXPECT_EQ(handle->status, JobStatus::kSuccess);
+  EXPECT_EQ(copy, handle);
+  EXPECT_FALSE(JobHandle().IsValid());
+}
+
+TEST(JobSlabTest, StaleHandle) {
+  JobSlab slab;
+  JobHandle handle = slab.Alloc(Job(0));
+  EXPECT_TRUE(slab.Release(handle));
+  EXPECT_EQ(handle.Get(), nullptr);
+  // Double release is rejected
+  EXPECT_FALSE(slab.Release(handle));
+
+  // The same record is reused with a different handle
+  JobHandle new_handle = slab.Alloc(Job(1));
+  EXPECT_NE(handle, new_handle);
+  EXPECT_EQ(handle.Get(), nullptr);
+  EXPECT_FALSE(slab.Release(handle));
+  EXPECT_EQ(new_handle->model_id, 1);
+
+  // Handles of another slab are rejected
+  JobSlab other_slab;
+  EXPECT_EQ(other_slab.Get(new_handle), nullptr);
+  EXPECT_FALSE(other_slab.Release(new_handle));
+}
+
+TEST(JobSlabTest, Grow) {
+  JobSlab slab(JobSlab::kChunkSize);
+  EXPECT_EQ(slab.GetCapacity(), JobSlab::kChunkSize);
+
+  std::vector<JobHandle> handles;
+  for (int i = 0; i < JobSlab::kChunkSize + 1; i++) {
+    handles.push_back(slab.Alloc(Job(i)));
+  }
+  EXPECT_EQ(slab.GetCapacity(), 2 * JobSlab::kChunkSize);
+  // Records do not move when the slab grows
+  for (int i = 0; i < handles.size(); i++) {
+    EXPECT_EQ(handles[i]->model_id, i);
+  }
+
+  for (const JobHandle& handle : handles) {
+    EXPECT_TRUE(slab.Release(handle));
+  }
+  EXPECT_EQ(slab.GetNumAllocated(), 0);
+}
+
+TEST(JobSlabTest, ConcurrentAllocRelease) {
+  JobSlab slab;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&slab, t]() {
+      for (int i = 0; i < 10000; i++) {
+        JobHandle handle = slab.Alloc(Job(t));
+        EXPECT_EQ(handle->model_id, t);
+        EXPECT_TRUE(slab.Release(handle));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(slab.GetNumAllocated(), 0);
+  EXPECT_EQ(slab.GetCapacity(), JobSlab::kChunkSize);
+}
+
+}  // namespace test
+}  // namespace band
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -50,7 +50,8 @@ struct CustomInvokeMockEngine : public CustomWorkerMockEngine {
       : invoke_lambda(invoke_lambda) {}
 
   std::function<absl::Status(const SubgraphKey&)> invoke_lambda;
-  absl::Status Invoke(const band::SubgraphKey& subgraph_key) override {
+  absl::Status Invoke(const band::SubgraphKey& subgraph_key,
+                      int batch_size) override {
     return invoke_lambda(subgraph_key);
   }
 };
@@ -154,6 +155,46 @@ TEST(LatencyEstimatorSuite, OnlineLatencyProfile) {
   worker.End();
 }
 
+TEST(LatencyEstimatorSuite, EpochOnLatencyDrift) {
+  CustomInvokeMockEngine engine([](const band::SubgraphKey& subgraph_key) {
+    std::this_thread::sleep_for(std::chrono::microseconds(1000));
+    return absl::OkStatus();
+  });
+
+  ProfileConfigBuilder b;
+  ProfileConfig config = b.AddOnline(true)
+                             .AddSmoothingFactor(0.5)
+                             .AddLatencyDriftThreshold(0.1)
+                             .Build()
+                             .value();
+
+  DeviceQueueWorker worker(&engine, 0, DeviceFlag::kCPU);
+  engine.worker = &worker;
+  worker.Start();
+  SubgraphKey key(0, 0);
+
+  LatencyEstimator latency_estimator(&engine);
+  EXPECT_EQ(latency_estimator.Init(config), absl::OkStatus());
+  EXPECT_EQ(latency_estimator.ProfileModel(0), absl::OkStatus());
+  const uint32_t epoch = latency_estimator.GetEpoch(0);
+  EXPECT_EQ(epoch, 1);
+
+  // Small changes keep the epoch
+  const int64_t expected = latency_estimator.GetExpected(key);
+  latency_estimator.UpdateLatency(key, expected * 1.1);
+  EXPECT_EQ(latency_estimator.GetEpoch(0), epoch);
+
+  // The moving average drifts by more than 10% of the last epoch
+  latency_estimator.UpdateLatency(key, expected * 2);
+  EXPECT_EQ(latency_estimator.GetEpoch(0), epoch + 1);
+  latency_estimator.UpdateLatency(key, latency_estimator.GetExpected(key));
+  EXPECT_EQ(latency_estimator.GetEpoch(0), epoch + 1);
+  // Other models are not affected
+  EXPECT_EQ(latency_estimator.GetEpoch(1), 0);
+
+  worker.End();
+}
+
 TEST(LatencyEstimatorSuite, OfflineSaveLoadSuccess) {
   CustomInvokeMockEngine engine([](const band::SubgraphKey& subgraph_key) {
     std::this_thread::sleep_for(std::chrono::microseconds(5000));
@@ -0,0 +1,142 @@
+// Copyright 2023 Seoul National University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "band/logger.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace band {
+namespace test {
+
+class LoggerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    Logger::Get().SetVerbosity(LogSeverity::kInfo);
+    Logger::Get().SetRateLimit(0);
+    reporter_id_ =
+        Logger::Get().SetReporter([this](LogSeverity, const char* message) {
+          std::lock_guard<std::mutex> lock(mtx_);
+          messages_.push_back(message);
+        });
+  }
+
+  void TearDown() override {
+    EXPECT_TRUE(Logger::Get().RemoveReporter(reporter_id_).ok());
+    Logger::Get().SetRateLimit(Logger::kDefaultRateLimit);
+  }
+
+  std::vector<std::string> GetMessages() {
+    Logger::Get().Flush();
+    std::lock_guard<std::mutex> lock(mtx_);
+    return messages_;
+  }
+
+  CallbackId reporter_id_;
+  std::mutex mtx_;
+  std::vector<std::string> messages_;
+};
+
+TEST_F(LoggerTest, ReportFormatted) {
+  BAND_LOG(LogSeverity::kInfo, "job %d of model %s", 3, "mobilenet");
+  std::vector<std::string> messages = GetMessages();
+  ASSERT_EQ(messages.size(), 1);
+  EXPECT_EQ(messages[0], "job 3 of model mobilenet");
+
+  auto last_log = Logger::Get().GetLastLog();
+  EXPECT_EQ(last_log.first, LogSeverity::kInfo);
+  EXPECT_EQ(last_log.second, "job 3 of model mobilenet");
+}
+
+TEST_F(LoggerTest, FilterBeforeEvaluation) {
+  Logger::Get().SetVerbosity(LogSeverity::kWarning);
+  int num_evaluations = 0;
+  auto evaluate = [&num_evaluations]() { return ++num_evaluations; };
+  BAND_LOG(LogSeverity::kInfo, "%d", evaluate());
+  EXPECT_EQ(num_evaluations, 0);
+  BAND_LOG(LogSeverity::kError, "%d", evaluate());
+  EXPECT_EQ(num_evaluations, 1);
+
+  std::vector<std::string> messages = GetMessages();
+  ASSERT_EQ(messages.size(), 1);
+  EXPECT_EQ(messages[0], "1");
+}
+
+TEST_F(LoggerTest, Truncate) {
+  const std::string long_message(2 * Logger::kMaxMessageLength, 'a');
+  BAND_LOG(LogSeverity::kInfo, "%s", long_message.c_str());
+  std::vector<std::string> messages = GetMessages();
+  ASSERT_EQ(messages.size(), 1);
+  EXPECT_EQ(messages[0].size(), Logger::kMaxMessageLength - 1);
+}
+
+TEST_F(LoggerTest, RateLimit) {
+  Logger::Get().SetRateLimit(5);
+  for (int i = 0; i < 20; i++) {
+    BAND_LOG(LogSeverity::kInfo, "repeated %d", i);
+  }
+  EXPECT_EQ(GetMessages().size(), 5);
+
+  // the next message after the window tells how many were suppressed
+  std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+  for (int i = 0; i < 2; i++) {
+    BAND_LOG(LogSeverity::kInfo, "repeated %d", i);
+  }
+  std::vector<std::string> messages = GetMessages();
+  ASSERT_EQ(messages.size(), 7);
+  EXPECT_EQ(messages[5], "repeated 0 (15 similar messages suppressed)");
+  EXPECT_EQ(messages[6], "repeated 1");
+}
+
+TEST_F(LoggerTest, ConcurrentLog) {
+  const int num_threads = 4;
+  const int num_messages = 50;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([t]() {
+      for (int i = 0; i < num_messages; i++) {
+        BAND_LOG(LogSeverity::kInfo, "thread %d message %d", t, i);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  std::vector<std::string> messages = GetMessages();
+  EXPECT_EQ(messages.size() + Logger::Get().GetNumDropped(),
+            num_threads * num_messages);
+  // messages of a thread stay in order
+  std::vector<int> next(num_threads, 0);
+  for (const std::string& message : messages) {
+    int t = -1;
+    int i = -1;
+    ASSERT_EQ(sscanf(message.c_str(), "thread %d message %d", &t, &i), 2);
+    EXPECT_GE(i, next[t]);
+    next[t] = i + 1;
+  }
+}
+
+}  // namespace test
+}  // namespace band
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
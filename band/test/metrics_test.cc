@@ -0,0 +1,104 @@
+// Copyright 2023 Seoul National University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "band/metrics.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+namespace band {
+namespace test {
+
+TEST(MetricsTest, CounterAndGauge) {
+  Counter counter;
+  counter.Increment();
+  counter.Increment(10);
+  EXPECT_EQ(counter.Get(), 11);
+
+  Gauge gauge;
+  gauge.Add(3);
+  gauge.Add(-1);
+  EXPECT_EQ(gauge.Get(), 2);
+  gauge.Set(0);
+  EXPECT_EQ(gauge.Get(), 0);
+}
+
+TEST(MetricsTest, ConcurrentCounter) {
+  Counter counter;
+  const int num_threads = 4;
+  const int num_increments = 10000;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&counter]() {
+      for (int i = 0; i < num_increments; i++) {
+        counter.Increment();
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(counter.Get(), num_threads * num_increments);
+}
+
+TEST(MetricsTest, Histogram) {
+  Histogram histogram;
+  EXPECT_EQ(histogram.GetSnapshot().count, 0);
+  EXPECT_EQ(histogram.GetSnapshot().GetPercentile(50), 0);
+
+  // 1 to 100
+  for (int value = 1; value <= 100; value++) {
+    histogram.Record(value);
+  }
+  HistogramSnapshot snapshot = histogram.GetSnapshot();
+  EXPECT_EQ(snapshot.count, 100);
+  EXPECT_EQ(snapshot.sum, 5050);
+  EXPECT_EQ(snapshot.max, 100);
+  EXPECT_DOUBLE_EQ(snapshot.GetMean(), 50.5);
+  // 50 is in [32, 64), 90 and 99 in [64, 128) capped by the max
+  EXPECT_EQ(snapshot.GetPercentile(50), 63);
+  EXPECT_EQ(snapshot.GetPercentile(90), 100);
+  EXPECT_EQ(snapshot.GetPercentile(99), 100);
+  EXPECT_EQ(snapshot.GetPercentile(1), 1);
+
+  // Values below 1 share the first bucket
+  histogram.Record(0);
+  histogram.Record(-5);
+  EXPECT_EQ(histogram.GetSnapshot().buckets[0], 2);
+}
+
+TEST(MetricsTest, Flatten) {
+  Metrics metrics;
+  metrics.counters["b"] = 1;
+  metrics.gauges["a"] = 2;
+  Histogram histogram;
+  histogram.Record(4);
+  metrics.histograms["c"] = histogram.GetSnapshot();
+
+  std::vector<std::pair<std::string, int64_t>> values = metrics.Flatten();
+  std::vector<std::pair<std::string, int64_t>> expected = {
+      {"a", 2},       {"b", 1},       {"c.count", 1}, {"c.max", 4},
+      {"c.p50", 4},   {"c.p90", 4},   {"c.p99", 4},   {"c.sum", 4}};
+  EXPECT_EQ(values, expected);
+}
+
+}  // namespace test
+}  // namespace band
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
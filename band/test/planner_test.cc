@@ -17,6 +17,8 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <thread>
+
 #include "band/scheduler/scheduler.h"
 #include "band/test/test_util.h"
 #include "band/time.h"
@@ -27,16 +29,20 @@ namespace test {
 
 struct MockEngine : public MockEngineBase {
   void PrepareReenqueue(Job&) override{};
-  void UpdateLatency(const SubgraphKey&, int64_t) override{};
-  void EnqueueFinishedJob(Job& job) override { finished.insert(job.job_id); }
+  void UpdateLatency(const SubgraphKey&, int64_t, int) override{};
+  void EnqueueFinishedJob(JobHandle job) override {
+    finished.insert(job->job_id);
+  }
   void Trigger() override {}
+  bool IsEnd(const SubgraphKey&) const override { return is_end; }
 
-  absl::Status Invoke(const SubgraphKey& key) override {
+  absl::Status Invoke(const SubgraphKey& key, int batch_size) override {
     time::SleepForMicros(50);
     return absl::OkStatus();
   }
 
   std::set<int> finished;
+  bool is_end = true;
 };
 
 class MockScheduler : public IScheduler {
@@ -48,6 +54,46 @@ class MockScheduler : public IScheduler {
   WorkerType GetWorkerType() { return WorkerType::kDeviceQueue; }
 };
 
+// Keeps the scheduled jobs so that a test can finish them
+class HoldingScheduler : public IScheduler {
+ public:
+  using IScheduler::IScheduler;
+
+  bool Schedule(JobQueue& requests) override {
+    std::lock_guard<std::mutex> lock(mtx_);
+    jobs_.insert(jobs_.end(), requests.begin(), requests.end());
+    requests.clear();
+    return true;
+  }
+  bool NeedFallbackSubgraphs() override { return false; }
+  WorkerType GetWorkerType() override { return WorkerType::kDeviceQueue; }
+
+  // Waits until the job with `job_id` was scheduled `num_times` times
+  JobHandle WaitForJob(JobId job_id, size_t num_times = 1) {
+    while (true) {
+      {
+        std::lock_guard<std::mutex> lock(mtx_);
+        size_t count = 0;
+        for (const JobHandle& job : jobs_) {
+          if (job->job_id == job_id && ++count == num_times) {
+            return job;
+          }
+        }
+      }
+      std::this_thread::yield();
+    }
+  }
+
+ private:
+  std::mutex mtx_;
+  JobQueue jobs_;
+};
+
+void Finish(Planner& planner, JobHandle job, JobStatus status) {
+  job->status = status;
+  planner.EnqueueFinishedJob(job);
+}
+
 /*
 
 Job cycle
@@ -65,6 +111,151 @@ TEST(PlannerSuite, SingleQueue) {
   EXPECT_TRUE(true);
 }
 
+TEST(PlannerSuite, WaitForCompletion) {
+  MockEngine engine;
+  Planner planner(engine);
+  auto scheduler = std::make_unique<HoldingScheduler>(engine);
+  HoldingScheduler* holding_scheduler = scheduler.get();
+  EXPECT_TRUE(planner.AddScheduler(std::move(scheduler)).ok());
+
+  JobId job_id = planner.EnqueueRequest(Job(0));
+  JobHandle job = holding_scheduler->WaitForJob(job_id);
+  EXPECT_FALSE(planner.IsJobFinished(job_id));
+  EXPECT_FALSE(planner.Wait({job_id}, /*timeout_us=*/1000));
+  EXPECT_EQ(planner.GetFinishedJob(job_id).job_id, -1);
+
+  std::thread waiter([&planner, job_id]() {
+    EXPECT_TRUE(planner.Wait({job_id}));
+  });
+  Finish(planner, job, JobStatus::kSuccess);
+  waiter.join();
+
+  EXPECT_TRUE(planner.IsJobFinished(job_id));
+  Job finished_job = planner.GetFinishedJob(job_id);
+  EXPECT_EQ(finished_job.job_id, job_id);
+  EXPECT_EQ(finished_job.model_id, 0);
+  EXPECT_EQ(finished_job.status, JobStatus::kSuccess);
+  // The record goes back to the slab once the job is finished
+  EXPECT_FALSE(job.IsValid());
+}
+
+TEST(PlannerSuite, WaitAny) {
+  MockEngine engine;
+  Planner planner(engine);
+  auto scheduler = std::make_unique<HoldingScheduler>(engine);
+  HoldingScheduler* holding_scheduler = scheduler.get();
+  EXPECT_TRUE(planner.AddScheduler(std::move(scheduler)).ok());
+
+  std::vector<JobId> job_ids = planner.EnqueueBatch({Job(0), Job(1)});
+  JobHandle first = holding_scheduler->WaitForJob(job_ids[0]);
+  JobHandle second = holding_scheduler->WaitForJob(job_ids[1]);
+  EXPECT_EQ(planner.WaitAny(job_ids, /*timeout_us=*/1000), -1);
+
+  Finish(planner, second, JobStatus::kInvokeFailure);
+  EXPECT_EQ(planner.WaitAny(job_ids), job_ids[1]);
+  EXPECT_EQ(planner.GetFinishedJob(job_ids[1]).status,
+            JobStatus::kInvokeFailure);
+  EXPECT_FALSE(planner.Wait(job_ids, /*timeout_us=*/1000));
+
+  Finish(planner, first, JobStatus::kSuccess);
+  EXPECT_TRUE(planner.Wait(job_ids));
+  planner.WaitAll();
+}
+
+TEST(PlannerSuite, TrackOutstandingJobs) {
+  MockEngine engine;
+  Planner planner(engine);
+  auto scheduler = std::make_unique<HoldingScheduler>(engine);
+  HoldingScheduler* holding_scheduler = scheduler.get();
+  EXPECT_TRUE(planner.AddScheduler(std::move(scheduler)).ok());
+
+  // More jobs in flight than finished jobs are kept
+  std::vector<JobId> job_ids = planner.EnqueueBatch(
+      std::vector<Job>(NUM_FINISHED_RECORDS + 10, Job(0)));
+  std::vector<JobHandle> jobs;
+  for (JobId job_id : job_ids) {
+    jobs.push_back(holding_scheduler->WaitForJob(job_id));
+  }
+  EXPECT_FALSE(planner.IsJobFinished(job_ids.front()));
+  EXPECT_FALSE(planner.Wait({job_ids.front()}, /*timeout_us=*/1000));
+
+  // The oldest job stays unfinished while all the newer ones finish
+  for (size_t i = 1; i < jobs.size(); i++) {
+    Finish(planner, jobs[i], JobStatus::kSuccess);
+  }
+  EXPECT_FALSE(planner.IsJobFinished(job_ids.front()));
+  EXPECT_EQ(planner.WaitAny({job_ids.front()}, /*timeout_us=*/1000), -1);
+  EXPECT_EQ(planner.GetFinishedJob(job_ids.front()).job_id, -1);
+  EXPECT_EQ(planner.GetFinishedJob(job_ids.back()).job_id, job_ids.back());
+
+  Finish(planner, jobs.front(), JobStatus::kInvokeFailure);
+  EXPECT_TRUE(planner.Wait({job_ids.front()}));
+  EXPECT_EQ(planner.GetFinishedJob(job_ids.front()).status,
+            JobStatus::kInvokeFailure);
+  // ... and the finished jobs beyond the limit are no longer tracked
+  EXPECT_EQ(planner.GetFinishedJob(job_ids[1]).job_id, -1);
+  EXPECT_TRUE(planner.IsJobFinished(job_ids[1]));
+  planner.WaitAll();
+}
+
+TEST(PlannerSuite, FollowingSubgraphReusesRecord) {
+  MockEngine engine;
+  engine.is_end = false;
+  Planner planner(engine);
+  auto scheduler = std::make_unique<HoldingScheduler>(engine);
+  HoldingScheduler* holding_scheduler = scheduler.get();
+  EXPECT_TRUE(planner.AddScheduler(std::move(scheduler)).ok());
+
+  JobId job_id = planner.EnqueueRequest(Job(0));
+  JobHandle job = holding_scheduler->WaitForJob(job_id);
+  const SubgraphKey key(0, 1, {0});
+  job->subgraph_key = key;
+  job->target_worker_id = 1;
+  job->invoke_time = 10;
+  job->end_time = 20;
+  Finish(planner, job, JobStatus::kSuccess);
+
+  // The remaining ops are scheduled with the same record and job id
+  EXPECT_EQ(holding_scheduler->WaitForJob(job_id, 2), job);
+  EXPECT_TRUE(job.IsValid());
+  EXPECT_FALSE(planner.IsJobFinished(job_id));
+  EXPECT_EQ(job->status, JobStatus::kQueued);
+  EXPECT_EQ(job->subgraph_key, SubgraphKey());
+  EXPECT_EQ(job->target_worker_id, -1);
+  EXPECT_EQ(job->invoke_time, 0);
+  EXPECT_EQ(job->end_time, 0);
+  ASSERT_EQ(job->previous_subgraph_keys.size(), 1);
+  EXPECT_EQ(job->previous_subgraph_keys[0], key);
+
+  engine.is_end = true;
+  Finish(planner, job, JobStatus::kSuccess);
+  EXPECT_TRUE(planner.Wait({job_id}));
+  planner.WaitAll();
+}
+
+TEST(PlannerSuite, SkipIdleSchedulingPass) {
+  MockEngine engine;
+  Planner planner(engine);
+  auto scheduler = std::make_unique<HoldingScheduler>(engine);
+  HoldingScheduler* holding_scheduler = scheduler.get();
+  EXPECT_TRUE(planner.AddScheduler(std::move(scheduler)).ok());
+
+  JobId job_id = planner.EnqueueRequest(Job(0));
+  JobHandle job = holding_scheduler->WaitForJob(job_id);
+  EXPECT_EQ(planner.GetNumSchedulingPasses(), 1);
+
+  // A worker event without pending requests does not run the schedulers
+  const size_t num_wakeups = planner.GetNumWakeups();
+  planner.Trigger();
+  while (planner.GetNumWakeups() == num_wakeups) {
+    std::this_thread::yield();
+  }
+  EXPECT_EQ(planner.GetNumSchedulingPasses(), 1);
+
+  Finish(planner, job, JobStatus::kSuccess);
+  planner.WaitAll();
+}
+
 }  // namespace test
 }  // namespace band
 
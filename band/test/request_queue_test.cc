@@ -0,0 +1,132 @@
+// Copyright 2023 Seoul National University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "band/request_queue.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+namespace band {
+namespace test {
+
+std::vector<ModelId> GetModelIds(const JobQueue& jobs) {
+  std::vector<ModelId> model_ids;
+  for (const JobHandle& job : jobs) {
+    model_ids.push_back(job->model_id);
+  }
+  return model_ids;
+}
+
+TEST(RequestQueueTest, Order) {
+  JobSlab slab;
+  RequestQueue queue;
+  EXPECT_TRUE(queue.IsEmpty());
+
+  queue.Push(slab.Alloc(Job(0)));
+  queue.PushBatch({slab.Alloc(Job(1)), slab.Alloc(Job(2))});
+  queue.Push(slab.Alloc(Job(3)), true);
+  queue.PushBatch({slab.Alloc(Job(4)), slab.Alloc(Job(5))}, true);
+  queue.Push(slab.Alloc(Job(6)));
+  EXPECT_FALSE(queue.IsEmpty());
+  EXPECT_EQ(queue.GetSize(), 7);
+
+  // The latest priority pushes first, then the rest in order
+  JobQueue jobs;
+  queue.Drain(jobs);
+  EXPECT_EQ(GetModelIds(jobs), std::vector<ModelId>({4, 5, 3, 0, 1, 2, 6}));
+  EXPECT_TRUE(queue.IsEmpty());
+  EXPECT_EQ(queue.GetSize(), 0);
+
+  // Drain appends
+  queue.Push(slab.Alloc(Job(7)));
+  queue.Drain(jobs);
+  EXPECT_EQ(jobs.size(), 8);
+  EXPECT_EQ(jobs.back()->model_id, 7);
+}
+
+TEST(RequestQueueTest, ReuseLinks) {
+  JobSlab slab;
+  RequestQueue queue;
+
+  // Released jobs are not queued
+  JobHandle released = slab.Alloc(Job(0));
+  EXPECT_TRUE(slab.Release(released));
+  queue.Push(released);
+  queue.PushBatch({released, JobHandle()});
+  EXPECT_TRUE(queue.IsEmpty());
+  EXPECT_EQ(queue.GetSize(), 0);
+
+  // A drained job can be pushed again, e.g., put back by the planner
+  JobHandle job = slab.Alloc(Job(1));
+  JobQueue jobs;
+  for (int i = 0; i < 3; i++) {
+    queue.PushBatch({job, slab.Alloc(Job(2))}, i % 2);
+    queue.Drain(jobs);
+  }
+  EXPECT_EQ(GetModelIds(jobs), std::vector<ModelId>({1, 2, 1, 2, 1, 2}));
+  EXPECT_EQ(queue.GetSize(), 0);
+}
+
+TEST(RequestQueueTest, ConcurrentPush) {
+  JobSlab slab;
+  RequestQueue queue;
+  const int num_threads = 4;
+  const int num_jobs = 10000;
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&slab, &queue, t]() {
+      for (int i = 0; i < num_jobs; i++) {
+        Job job(t);
+        job.job_id = i;
+        queue.Push(slab.Alloc(std::move(job)), t % 2);
+      }
+    });
+  }
+
+  // Drain while the producers push
+  JobQueue jobs;
+  while (jobs.size() < num_threads * num_jobs) {
+    queue.Drain(jobs);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_TRUE(queue.IsEmpty());
+  EXPECT_EQ(queue.GetSize(), 0);
+
+  // Jobs of a producer in the normal lane keep their order
+  std::vector<int> counts(num_threads, 0);
+  std::vector<JobId> last_job_ids(num_threads, -1);
+  for (const JobHandle& job : jobs) {
+    counts[job->model_id]++;
+    if (job->model_id % 2 == 0) {
+      EXPECT_GT(job->job_id, last_job_ids[job->model_id]);
+      last_job_ids[job->model_id] = job->job_id;
+    }
+  }
+  for (int count : counts) {
+    EXPECT_EQ(count, num_jobs);
+  }
+}
+
+}  // namespace test
+}  // namespace band
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,163 @@
+// Copyright 2023 Seoul National University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "band/runtime_tracer.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#include "band/json_util.h"
+
+namespace band {
+namespace test {
+
+TraceEvent MakeEvent(int64_t time, JobId job_id) {
+  TraceEvent event;
+  event.time = time;
+  event.value = 10;
+  event.job_id = job_id;
+  event.model_id = 0;
+  event.worker_id = 0;
+  return event;
+}
+
+TEST(RuntimeTracerTest, Disabled) {
+  RuntimeTracer& tracer = RuntimeTracer::Get();
+  tracer.Stop();
+  EXPECT_FALSE(tracer.IsEnabled());
+  EXPECT_FALSE(tracer.IsSampled(0));
+}
+
+TEST(RuntimeTracerTest, ConcurrentRecord) {
+  RuntimeTracer& tracer = RuntimeTracer::Get();
+  tracer.Start();
+  const int num_threads = 4;
+  const int num_events = 1000;
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&tracer, t]() {
+      for (int i = 0; i < num_events; i++) {
+        tracer.Record(MakeEvent(i * num_threads + t, t));
+      }
+    });
+  }
+  // Collect while the threads record
+  tracer.Collect();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  tracer.Stop();
+
+  std::vector<TraceEvent> events = tracer.Collect();
+  ASSERT_EQ(events.size(), num_threads * num_events);
+  for (size_t i = 0; i < events.size(); i++) {
+    EXPECT_EQ(events[i].time, i);
+    EXPECT_EQ(events[i].job_id, i % num_threads);
+  }
+
+  // Start drops the events so far
+  tracer.Start();
+  EXPECT_TRUE(tracer.Collect().empty());
+  tracer.Stop();
+}
+
+TEST(RuntimeTracerTest, Overwrite) {
+  RuntimeTracer& tracer = RuntimeTracer::Get();
+  RuntimeTracer::Options options;
+  options.buffer_size = 16;
+  tracer.Start(options);
+  // a new thread gets a buffer of the new size
+  std::thread([&tracer]() {
+    for (int i = 0; i < 100; i++) {
+      tracer.Record(MakeEvent(i, i));
+    }
+  }).join();
+  tracer.Stop();
+
+  // only the newest events remain
+  std::vector<TraceEvent> events = tracer.Collect();
+  ASSERT_EQ(events.size(), 16);
+  EXPECT_EQ(events.front().time, 84);
+  EXPECT_EQ(events.back().time, 99);
+}
+
+TEST(RuntimeTracerTest, Sampling) {
+  RuntimeTracer& tracer = RuntimeTracer::Get();
+  RuntimeTracer::Options options;
+  options.sampling_period = 4;
+  tracer.Start(options);
+  EXPECT_TRUE(tracer.IsSampled(0));
+  EXPECT_FALSE(tracer.IsSampled(1));
+  EXPECT_FALSE(tracer.IsSampled(3));
+  EXPECT_TRUE(tracer.IsSampled(8));
+  tracer.Stop();
+}
+
+TEST(RuntimeTracerTest, Dump) {
+  RuntimeTracer& tracer = RuntimeTracer::Get();
+  tracer.Start();
+  tracer.AddWorker(0, DeviceFlag::kCPU);
+  Job job(0);
+  job.job_id = 3;
+  job.invoke_time = 100;
+  job.end_time = 150;
+  tracer.RecordSubgraph(job);
+  tracer.RecordCopy(TraceEventType::kInputCopy, job, 90, 100);
+  tracer.RecordCounter(TraceEventType::kRequestQueueDepth, -1, 120, 7);
+  tracer.Stop();
+
+  const std::string json_path = "runtime_tracer_test.json";
+  ASSERT_TRUE(tracer.DumpChromeTrace(json_path).ok());
+  Json::Value trace = json::LoadFromFile(json_path);
+  std::remove(json_path.c_str());
+  // thread names of the planner and the two tracks of worker 0, and events
+  ASSERT_EQ(trace["traceEvents"].size(), 3 + 3);
+  const Json::Value& copy = trace["traceEvents"][3];
+  EXPECT_EQ(copy["ph"].asString(), "X");
+  EXPECT_EQ(copy["ts"].asInt64(), 90);
+  EXPECT_EQ(copy["dur"].asInt64(), 10);
+  const Json::Value& counter = trace["traceEvents"][5];
+  EXPECT_EQ(counter["ph"].asString(), "C");
+  EXPECT_EQ(counter["args"]["value"].asInt64(), 7);
+
+  const std::string binary_path = "runtime_tracer_test.bin";
+  ASSERT_TRUE(tracer.DumpBinary(binary_path).ok());
+  std::ifstream binary(binary_path, std::ios::binary);
+  char magic[8];
+  uint64_t num_events = 0;
+  binary.read(magic, sizeof(magic));
+  binary.read(reinterpret_cast<char*>(&num_events), sizeof(num_events));
+  EXPECT_EQ(std::memcmp(magic, RuntimeTracer::kBinaryTraceMagic, 8), 0);
+  ASSERT_EQ(num_events, 3);
+  TraceEvent event;
+  binary.read(reinterpret_cast<char*>(&event), sizeof(event));
+  EXPECT_EQ(event.type, TraceEventType::kInputCopy);
+  EXPECT_EQ(event.job_id, 3);
+  binary.close();
+  std::remove(binary_path.c_str());
+}
+
+}  // namespace test
+}  // namespace band
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -86,11 +86,13 @@ struct MockEngine : public MockEngineBase {
       map[worker_id] = 0;
     }
     for (auto action: action_){
-      map[action.second.GetWorkerId()] += action.first.expected_latency;
+      map[action.second.GetWorkerId()] += action.first->expected_latency;
     }
   }
 
-  int64_t GetExpected(const SubgraphKey& key) const override { return 10; }
+  int64_t GetExpected(const SubgraphKey& key, int batch_size) const override {
+    return 10;
+  }
   bool EnqueueToWorker(const ScheduleAction& action) override {
     action_.push_back(action);
     return true;
@@ -136,9 +138,10 @@ TEST_P(LSTTestsFixture, LSTTest) {
 
   assert(request_models.size() == request_slos.size());
 
-  std::deque<Job> requests;
+  JobSlab jobs;
+  JobQueue requests;
   for (int i = 0; i < request_models.size(); i++) {
-    requests.emplace_back(Job(request_models[i], request_slos[i]));
+    requests.emplace_back(jobs.Alloc(Job(request_models[i], request_slos[i])));
   }
   const int count_requests = requests.size();
 
@@ -167,9 +170,10 @@ TEST_P(ModelLevelTestsFixture, RoundRobinTest) {
   std::deque<int> request_models = std::get<0>(GetParam());
   std::set<int> available_workers = std::get<1>(GetParam());
 
-  std::deque<Job> requests;
+  JobSlab jobs;
+  JobQueue requests;
   for (auto it = request_models.begin(); it != request_models.end(); it++) {
-    requests.emplace_back(Job(*it));
+    requests.emplace_back(jobs.Alloc(Job(*it)));
   }
   const int count_requests = requests.size();
 
@@ -192,9 +196,10 @@ TEST_P(ConfigLevelTestsFixture, FixedDeviceFixedWorkerTest) {
   std::deque<int> request_models = std::get<0>(GetParam());
   std::set<int> available_workers = std::get<1>(GetParam());
 
-  std::deque<Job> requests;
+  JobSlab jobs;
+  JobQueue requests;
   for (auto it = request_models.begin(); it != request_models.end(); it++) {
-    requests.emplace_back(Job(*it));
+    requests.emplace_back(jobs.Alloc(Job(*it)));
   }
   const int count_requests = requests.size();
 
@@ -230,11 +235,12 @@ TEST_P(ConfigLevelTestsFixture, FixedDeviceFixedWorkerEngineRequestTest) {
   std::set<int> available_workers = std::get<1>(GetParam());
   const int target_worker = 0;
 
-  std::deque<Job> requests;
+  JobSlab jobs;
+  JobQueue requests;
   for (auto it = request_models.begin(); it != request_models.end(); it++) {
     Job job = Job(*it);
     job.target_worker_id = target_worker;
-    requests.emplace_back(job);
+    requests.emplace_back(jobs.Alloc(std::move(job)));
   }
   const int count_requests = requests.size();
 
@@ -271,15 +277,19 @@ TEST_P(ModelLevelWithLatencyTestsFixture, ShortestExepectedLatencyRequestTests)
   std::set<int> available_workers = std::get<1>(GetParam());
   size_t window_size = 5;
 
-  std::deque<Job> requests;
+  JobSlab jobs;
+  JobQueue requests;
   for (auto i = 0; i < model_latencies.size(); i++) {
     auto temp = Job(i);
     temp.expected_latency = model_latencies[i]; // consider job's expected_latency is the model's shortest expected latency
-    requests.emplace_back(temp);
+    requests.emplace_back(jobs.Alloc(std::move(temp)));
   }
   
   const int count_requests = requests.size();
-  auto sorted_req = std::deque<Job>(requests);
+  std::deque<Job> sorted_req;
+  for (const JobHandle& request : requests) {
+    sorted_req.push_back(*request);
+  }
   std::sort(sorted_req.begin(), sorted_req.end(), [](Job a, Job b){
     return a.expected_latency > b.expected_latency;
   });
@@ -302,7 +312,7 @@ TEST_P(ModelLevelWithLatencyTestsFixture, ShortestExepectedLatencyRequestTests)
 
   // scheduled results should me the same as requests descending-sorted by latency (LARGEST shortest subgraph-latency)
   for(int i=0; i<context.action_.size(); i++){
-    EXPECT_EQ(context.action_[i].first.model_id, sorted_req[i].model_id);
+    EXPECT_EQ(context.action_[i].first->model_id, sorted_req[i].model_id);
   }
 
 }
@@ -317,13 +327,14 @@ TEST_P(HeftFixture, HEFTRequestTests) {
 
   assert(target_workers.size() == model_latencies.size());
 
-  std::deque<Job> requests;
+  JobSlab jobs;
+  JobQueue requests;
   for (auto i = 0; i < model_latencies.size(); i++) {
     auto temp = Job(i);
     temp.job_id = i;
     temp.expected_latency = model_latencies[i]; // consider job's expected_latency is the model's shortest expected latency
     temp.target_worker_id = target_workers[i];
-    requests.emplace_back(temp);
+    requests.emplace_back(jobs.Alloc(std::move(temp)));
   }
 
   const int count_requests = requests.size();
@@ -347,7 +358,7 @@ TEST_P(HeftFixture, HEFTRequestTests) {
   EXPECT_EQ(count_requests - count_scheduled, requests.size());
 
   for(int i=0; i<expected_scheduling_result.size(); i++){
-    EXPECT_EQ(context.action_[i].first.model_id, expected_scheduling_result[i]);
+    EXPECT_EQ(context.action_[i].first->model_id, expected_scheduling_result[i]);
   }
 }
 
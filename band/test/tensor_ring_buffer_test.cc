@@ -0,0 +1,162 @@
+// Copyright 2023 Seoul National University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "band/tensor_ring_buffer.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "band/tensor.h"
+
+namespace band {
+namespace test {
+
+struct FloatTensor : public interface::ITensor {
+  explicit FloatTensor(size_t num_elements)
+      : data(num_elements), dims({static_cast<int>(num_elements)}) {}
+
+  DataType GetType() const override { return DataType::kFloat32; }
+  void SetType(DataType type) override {}
+  const char* GetData() const override {
+    return reinterpret_cast<const char*>(data.data());
+  }
+  char* GetData() override { return reinterpret_cast<char*>(data.data()); }
+  const int* GetDims() const override { return dims.data(); }
+  size_t GetNumDims() const override { return dims.size(); }
+  void SetDims(const std::vector<int>& dims) override {}
+  const char* GetName() const override { return "float"; }
+  Quantization GetQuantization() const override {
+    return {QuantizationType::kNoQuantization, nullptr};
+  }
+  absl::Status SetQuantization(Quantization quantization) override {
+    return absl::OkStatus();
+  }
+
+  std::vector<float> data;
+  std::vector<int> dims;
+};
+
+std::unique_ptr<TensorRingBuffer> CreateBuffer(int size) {
+  return std::make_unique<TensorRingBuffer>(
+      std::vector<std::shared_ptr<interface::ITensor>>{
+          std::make_shared<FloatTensor>(2)},
+      std::vector<int>{0}, size);
+}
+
+TEST(TensorRingBufferTest, AllocUntilExhausted) {
+  auto buffer = CreateBuffer(2);
+  auto handle0 = buffer->Alloc();
+  auto handle1 = buffer->Alloc();
+  ASSERT_TRUE(handle0.ok() && handle1.ok());
+  EXPECT_NE(handle0.value(), handle1.value());
+  EXPECT_EQ(buffer->GetNumFreeSlots(), 0);
+
+  auto handle2 = buffer->Alloc();
+  EXPECT_EQ(handle2.status().code(), absl::StatusCode::kResourceExhausted);
+
+  EXPECT_TRUE(buffer->Release(handle0.value()).ok());
+  EXPECT_EQ(buffer->GetNumFreeSlots(), 1);
+  EXPECT_TRUE(buffer->Alloc().ok());
+}
+
+TEST(TensorRingBufferTest, StaleHandle) {
+  auto buffer = CreateBuffer(1);
+  int handle = buffer->Alloc().value();
+  EXPECT_TRUE(buffer->IsHandleValid(handle));
+  EXPECT_TRUE(buffer->Release(handle).ok());
+  EXPECT_FALSE(buffer->IsHandleValid(handle));
+  // Double release is rejected
+  EXPECT_FALSE(buffer->Release(handle).ok());
+
+  // The same slot is reused with a different handle
+  int new_handle = buffer->Alloc().value();
+  EXPECT_NE(handle, new_handle);
+  EXPECT_FALSE(buffer->Release(handle).ok());
+  EXPECT_TRUE(buffer->IsHandleValid(new_handle));
+
+  FloatTensor tensor(2);
+  EXPECT_FALSE(buffer->PutTensorToHandle(&tensor, 0, handle).ok());
+  EXPECT_TRUE(buffer->PutTensorToHandle(&tensor, 0, new_handle).ok());
+}
+
+TEST(TensorRingBufferTest, RetainRelease) {
+  auto buffer = CreateBuffer(1);
+  int handle = buffer->Alloc().value();
+  EXPECT_TRUE(buffer->Retain(handle).ok());
+  EXPECT_TRUE(buffer->Release(handle).ok());
+  // Still referenced once
+  EXPECT_TRUE(buffer->IsHandleValid(handle));
+  EXPECT_EQ(buffer->GetNumFreeSlots(), 0);
+  EXPECT_TRUE(buffer->Release(handle).ok());
+  EXPECT_FALSE(buffer->IsHandleValid(handle));
+  EXPECT_FALSE(buffer->Retain(handle).ok());
+}
+
+TEST(TensorRingBufferTest, PutGet) {
+  auto buffer = CreateBuffer(4);
+  int handle = buffer->Alloc().value();
+
+  FloatTensor src(2);
+  src.data = {1.f, 2.f};
+  std::vector<interface::ITensor*> srcs = {&src};
+  EXPECT_TRUE(buffer->PutTensorsToHandle(srcs, handle).ok());
+
+  FloatTensor dst(2);
+  std::vector<interface::ITensor*> dsts = {&dst};
+  EXPECT_TRUE(buffer->GetTensorsFromHandle(dsts, handle).ok());
+  EXPECT_EQ(dst.data, src.data);
+}
+
+TEST(TensorRingBufferTest, BlockingAlloc) {
+  auto buffer = CreateBuffer(1);
+  int handle = buffer->Alloc().value();
+
+  std::thread releaser([&buffer, handle]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_TRUE(buffer->Release(handle).ok());
+  });
+
+  auto new_handle = buffer->Alloc(/*blocking=*/true);
+  EXPECT_TRUE(new_handle.ok());
+  releaser.join();
+}
+
+TEST(TensorRingBufferTest, ConcurrentAllocRelease) {
+  const int num_slots = 8;
+  auto buffer = CreateBuffer(num_slots);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&buffer]() {
+      for (int i = 0; i < 10000; i++) {
+        auto handle = buffer->Alloc(/*blocking=*/true);
+        EXPECT_TRUE(handle.ok());
+        EXPECT_TRUE(buffer->Release(handle.value()).ok());
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(buffer->GetNumFreeSlots(), num_slots);
+}
+
+}  // namespace test
+}  // namespace band
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
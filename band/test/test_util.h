@@ -31,6 +31,7 @@ struct MockEngineBase : public IEngine {
   MOCK_CONST_METHOD0(UpdateWorkersWaiting, void(void));
   MOCK_CONST_METHOD0(GetWorkerWaitingTime, WorkerWaitingTime(void));
   MOCK_CONST_METHOD0(GetIdleWorkers, std::set<WorkerId>(void));
+  MOCK_METHOD2(SetWorkerIdle, void(WorkerId, bool));
 
   /* subgraph */
   MOCK_CONST_METHOD2(GetLargestSubgraphKey, SubgraphKey(ModelId, WorkerId));
@@ -39,7 +40,8 @@ struct MockEngineBase : public IEngine {
   MOCK_CONST_METHOD1(HasSubgraph, bool(const SubgraphKey&));
   MOCK_CONST_METHOD1(ForEachSubgraph,
                      void(std::function<void(const SubgraphKey&)>));
-  MOCK_METHOD1(Invoke, absl::Status(const SubgraphKey&));
+  MOCK_METHOD2(Invoke, absl::Status(const SubgraphKey&, int));
+  MOCK_CONST_METHOD1(GetBatchSizes, std::vector<int>(const SubgraphKey&));
 
   /* model */
   MOCK_CONST_METHOD1(GetModelSpec, const ModelSpec*(ModelId));
@@ -65,16 +67,17 @@ struct MockEngineBase : public IEngine {
                                  const std::set<WorkerId>&));
 
   /* profiler */
-  MOCK_METHOD2(UpdateLatency, void(const SubgraphKey&, int64_t));
-  MOCK_CONST_METHOD1(GetProfiled, int64_t(const SubgraphKey&));
-  MOCK_CONST_METHOD1(GetExpected, int64_t(const SubgraphKey&));
+  MOCK_METHOD3(UpdateLatency, void(const SubgraphKey&, int64_t, int));
+  MOCK_CONST_METHOD2(GetProfiled, int64_t(const SubgraphKey&, int));
+  MOCK_CONST_METHOD2(GetExpected, int64_t(const SubgraphKey&, int));
 
   /* planner */
   MOCK_METHOD0(Trigger, void());
   MOCK_METHOD2(EnqueueRequest, JobId(Job, bool));
   MOCK_METHOD2(EnqueueBatch, std::vector<JobId>(std::vector<Job>, bool));
   MOCK_METHOD1(PrepareReenqueue, void(Job&));
-  MOCK_METHOD1(EnqueueFinishedJob, void(Job&));
+  MOCK_METHOD1(ReenqueueBatch, void(const std::vector<JobHandle>&));
+  MOCK_METHOD1(EnqueueFinishedJob, void(JobHandle));
   MOCK_METHOD1(EnqueueToWorker, bool(const ScheduleAction&));
   MOCK_METHOD1(EnqueueToWorkerBatch, bool(const std::vector<ScheduleAction>&));
 
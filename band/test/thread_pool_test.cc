@@ -0,0 +1,74 @@
+// Copyright 2023 Seoul National University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "band/thread_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <functional>
+#include <vector>
+
+namespace band {
+namespace test {
+
+TEST(ThreadPoolTest, Wait) {
+  ThreadPool pool(4);
+  EXPECT_EQ(pool.GetNumThreads(), 4);
+  std::atomic<int> count{0};
+  for (int i = 0; i < 100; i++) {
+    pool.Schedule([&count]() { count++; });
+  }
+  pool.Wait();
+  EXPECT_EQ(count, 100);
+
+  // The pool is reusable after a wait
+  pool.Schedule([&count]() { count++; });
+  pool.Wait();
+  EXPECT_EQ(count, 101);
+}
+
+TEST(ThreadPoolTest, Destroy) {
+  std::atomic<int> count{0};
+  {
+    ThreadPool pool(0);
+    EXPECT_EQ(pool.GetNumThreads(), 1);
+    for (int i = 0; i < 10; i++) {
+      pool.Schedule([&count]() { count++; });
+    }
+  }
+  // The destructor runs the scheduled tasks
+  EXPECT_EQ(count, 10);
+}
+
+TEST(ThreadPoolTest, RunAll) {
+  std::vector<int> results(8);
+  std::vector<std::function<void()>> tasks;
+  for (int i = 0; i < results.size(); i++) {
+    tasks.push_back([&results, i]() { results[i] = i * i; });
+  }
+  ThreadPool::RunAll(std::move(tasks));
+  for (int i = 0; i < results.size(); i++) {
+    EXPECT_EQ(results[i], i * i);
+  }
+  ThreadPool::RunAll({});
+}
+
+}  // namespace test
+}  // namespace band
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -16,9 +16,35 @@
 
 #include <gtest/gtest.h>
 
+#include <fstream>
+#include <string>
+
+#include "band/json_util.h"
+
 namespace band {
 namespace test {
 
+TEST(BenchmarkTest, LatencyStats) {
+  std::vector<int64_t> samples;
+  for (int i = 1000; i >= 1; i--) {
+    samples.push_back(i);
+  }
+  tool::LatencyStats stats = tool::LatencyStats::FromSamples(samples);
+  EXPECT_EQ(stats.count, 1000);
+  EXPECT_DOUBLE_EQ(stats.average, 500.5);
+  EXPECT_EQ(stats.p50, 500);
+  EXPECT_EQ(stats.p90, 900);
+  EXPECT_EQ(stats.p99, 990);
+  EXPECT_EQ(stats.p999, 999);
+  EXPECT_EQ(stats.max, 1000);
+
+  stats = tool::LatencyStats::FromSamples({7});
+  EXPECT_EQ(stats.p50, 7);
+  EXPECT_EQ(stats.p999, 7);
+  EXPECT_EQ(tool::LatencyStats::FromSamples({}).count, 0);
+}
+
+#ifdef BAND_TFLITE
 TEST(BenchmarkTest, BenchmarkConfigLoadSuccess) {
   tool::Benchmark benchmark;
   const char* argv[] = {"", "band/test/data/benchmark_config.json"};
@@ -40,14 +66,100 @@ TEST(BenchmarkTest, BenchmarkConfigRunSuccess) {
   EXPECT_EQ(benchmark.Initialize(2, argv), absl::OkStatus());
   EXPECT_EQ(benchmark.Run(), absl::OkStatus());
 }
+#endif  // BAND_TFLITE
+
+#ifdef BAND_SIMULATED
+TEST(BenchmarkTest, BenchmarkWorkloadRunSuccess) {
+  tool::Benchmark benchmark;
+  const char* argv[] = {"", "band/test/data/benchmark_workload_config.json"};
+  EXPECT_EQ(benchmark.Initialize(2, argv), absl::OkStatus());
+  EXPECT_EQ(benchmark.Run(), absl::OkStatus());
+
+  Json::Value report =
+      json::LoadFromFile("band/test/data/benchmark_report.json");
+  ASSERT_EQ(report["results"].size(), 3);
+  for (const Json::Value& result : report["results"]) {
+    EXPECT_GT(result["num_requests"].asUInt64(), 0);
+    EXPECT_LE(result["latency_us"]["p50"].asInt64(),
+              result["latency_us"]["p99"].asInt64());
+    EXPECT_LE(result["latency_us"]["p99"].asInt64(),
+              result["latency_us"]["max"].asInt64());
+    EXPECT_FALSE(result["execution_us"].isNull());
+  }
+  ASSERT_EQ(report["workers"].size(), 2);
+  for (const Json::Value& worker : report["workers"]) {
+    EXPECT_GT(worker["utilization"].asDouble(), 0);
+    EXPECT_LE(worker["utilization"].asDouble(), 100);
+  }
+
+  // a header and a row per result
+  std::ifstream csv("band/test/data/benchmark_report.csv");
+  std::string line;
+  int num_lines = 0;
+  while (std::getline(csv, line)) {
+    num_lines++;
+  }
+  EXPECT_EQ(num_lines, 4);
+}
+
+TEST(BenchmarkTest, BenchmarkSweepRunSuccess) {
+  tool::Benchmark benchmark;
+  const char* argv[] = {"", "band/test/data/benchmark_sweep_config.json"};
+  EXPECT_EQ(benchmark.Initialize(2, argv), absl::OkStatus());
+  EXPECT_EQ(benchmark.Run(), absl::OkStatus());
+
+  Json::Value report =
+      json::LoadFromFile("band/test/data/benchmark_sweep_report.json");
+  const Json::Value& steps = report["sweep"]["steps"];
+  ASSERT_GT(steps.size(), 2);
+  EXPECT_LE(steps.size(), 6);
+  // the range is searched from both ends, and the top of it is overloaded
+  EXPECT_EQ(steps[0]["offered_rate_per_sec"].asDouble(), 2000);
+  EXPECT_FALSE(steps[0]["satisfied"].asBool());
+  EXPECT_EQ(steps[1]["offered_rate_per_sec"].asDouble(), 10);
+  EXPECT_TRUE(steps[1]["satisfied"].asBool());
+  EXPECT_TRUE(report["sweep"]["knee_within_range"].asBool());
+
+  // the knee is the highest rate that met the target
+  const double knee_rate = report["sweep"]["knee_rate_per_sec"].asDouble();
+  for (const Json::Value& step : steps) {
+    const double rate = step["offered_rate_per_sec"].asDouble();
+    EXPECT_EQ(step["satisfied"].asBool(), rate <= knee_rate);
+    EXPECT_LE(step["latency_us"]["p50"].asInt64(),
+              step["latency_us"]["p99"].asInt64());
+  }
+  EXPECT_GT(report["sweep"]["sustainable_throughput_per_sec"].asDouble(), 0);
+
+  // a header and a row per step
+  std::ifstream csv("band/test/data/benchmark_sweep_report.csv");
+  std::string line;
+  int num_lines = 0;
+  while (std::getline(csv, line)) {
+    num_lines++;
+  }
+  EXPECT_EQ(num_lines, steps.size() + 1);
+}
+
+TEST(BenchmarkTest, BenchmarkSweepRequiresSLO) {
+  Json::Value config =
+      json::LoadFromFile("band/test/data/benchmark_sweep_config.json");
+  config["models"][1].removeMember("slo_scale");
+  const std::string path = testing::TempDir() + "/benchmark_sweep_config.json";
+  ASSERT_EQ(json::WriteToFile(config, path), absl::OkStatus());
+
+  tool::Benchmark benchmark;
+  const char* argv[] = {"", path.c_str()};
+  EXPECT_FALSE(benchmark.Initialize(2, argv).ok());
+}
+#endif  // BAND_SIMULATED
 
 }  // namespace test
 }  // namespace band
 
 int main(int argc, char** argv) {
-#ifdef BAND_TFLITE
+#if defined(BAND_TFLITE) || defined(BAND_SIMULATED)
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
-#endif  // BAND_TFLITE
+#endif  // defined(BAND_TFLITE) || defined(BAND_SIMULATED)
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,128 @@
+// Copyright 2023 Seoul National University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "band/tool/workload.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+namespace band {
+namespace test {
+
+bool IsSorted(const std::vector<tool::Arrival>& arrivals) {
+  return std::is_sorted(arrivals.begin(), arrivals.end(),
+                        [](const tool::Arrival& lhs,
+                           const tool::Arrival& rhs) {
+                          return lhs.time_us < rhs.time_us;
+                        });
+}
+
+tool::ArrivalConfig Parse(const char* json) {
+  Json::Value root;
+  Json::Reader().parse(json, root);
+  tool::ArrivalConfig config;
+  EXPECT_TRUE(tool::ParseArrivalConfig(root, config).ok());
+  return config;
+}
+
+TEST(WorkloadTest, Poisson) {
+  tool::ArrivalConfig config =
+      Parse(R"({"type": "poisson", "rate_per_sec": 1000})");
+  auto arrivals = tool::GenerateArrivals(config, 10 * 1000 * 1000);
+  ASSERT_TRUE(arrivals.ok());
+  // 10000 expected, with a standard deviation of 100
+  EXPECT_NEAR(arrivals->size(), 10000, 500);
+  EXPECT_TRUE(IsSorted(*arrivals));
+  EXPECT_LT(arrivals->back().time_us, 10 * 1000 * 1000);
+
+  // Same config, same arrivals
+  auto arrivals_again = tool::GenerateArrivals(config, 10 * 1000 * 1000);
+  ASSERT_TRUE(arrivals_again.ok());
+  ASSERT_EQ(arrivals->size(), arrivals_again->size());
+  for (size_t i = 0; i < arrivals->size(); i++) {
+    EXPECT_EQ((*arrivals)[i].time_us, (*arrivals_again)[i].time_us);
+  }
+
+  config.seed = 1;
+  auto arrivals_other_seed = tool::GenerateArrivals(config, 10 * 1000 * 1000);
+  ASSERT_TRUE(arrivals_other_seed.ok());
+  EXPECT_NE((*arrivals)[0].time_us, (*arrivals_other_seed)[0].time_us);
+}
+
+TEST(WorkloadTest, MMPP) {
+  // Alternates between silence and bursts of the same mean length
+  tool::ArrivalConfig config = Parse(R"({
+    "type": "mmpp",
+    "state_rates_per_sec": [0, 2000],
+    "state_durations_ms": [100, 100]
+  })");
+  auto arrivals = tool::GenerateArrivals(config, 20 * 1000 * 1000);
+  ASSERT_TRUE(arrivals.ok());
+  EXPECT_NEAR(arrivals->size(), 20000, 5000);
+  EXPECT_TRUE(IsSorted(*arrivals));
+
+  // Silent periods leave gaps far longer than the intervals of a burst
+  int64_t max_gap_us = 0;
+  for (size_t i = 1; i < arrivals->size(); i++) {
+    max_gap_us = std::max(
+        max_gap_us, (*arrivals)[i].time_us - (*arrivals)[i - 1].time_us);
+  }
+  EXPECT_GT(max_gap_us, 100 * 1000);
+}
+
+TEST(WorkloadTest, Trace) {
+  tool::ArrivalConfig config = Parse(
+      R"({"type": "trace", "path": "band/test/data/workload_trace.json"})");
+  auto arrivals = tool::GenerateArrivals(config, 100 * 1000);
+  ASSERT_TRUE(arrivals.ok());
+  // Sorted by time, and the request after the duration is dropped
+  ASSERT_EQ(arrivals->size(), 4);
+  EXPECT_EQ((*arrivals)[0].time_us, 0);
+  EXPECT_EQ((*arrivals)[0].slo_us, -1);
+  EXPECT_EQ((*arrivals)[1].time_us, 10000);
+  EXPECT_EQ((*arrivals)[1].slo_us, 5000);
+  EXPECT_EQ((*arrivals)[2].time_us, 10000);
+  EXPECT_EQ((*arrivals)[2].slo_us, -1);
+  EXPECT_EQ((*arrivals)[3].time_us, 30000);
+  EXPECT_EQ((*arrivals)[3].slo_us, 20000);
+}
+
+TEST(WorkloadTest, InvalidConfig) {
+  Json::Value root;
+  tool::ArrivalConfig config;
+  EXPECT_FALSE(tool::ParseArrivalConfig(root, config).ok());
+  root["type"] = "uniform";
+  EXPECT_FALSE(tool::ParseArrivalConfig(root, config).ok());
+  root["type"] = "trace";
+  EXPECT_FALSE(tool::ParseArrivalConfig(root, config).ok());
+
+  EXPECT_FALSE(
+      tool::GenerateArrivals(Parse(R"({"type": "poisson"})"), 1000).ok());
+  EXPECT_FALSE(tool::GenerateArrivals(Parse(R"({
+    "type": "mmpp",
+    "state_rates_per_sec": [10, 20],
+    "state_durations_ms": [100]
+  })"),
+                                      1000)
+                   .ok());
+}
+
+}  // namespace test
+}  // namespace band
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -18,6 +18,9 @@
 #include <gtest/gtest.h>
 
 #include <future>
+#include <map>
+#include <mutex>
+#include <vector>
 
 #include "band/test/test_util.h"
 #include "band/time.h"
@@ -26,8 +29,10 @@ namespace band {
 namespace test {
 
 struct MockEngine : public MockEngineBase {
-  void EnqueueFinishedJob(Job& job) override { finished.insert(job.job_id); }
-  absl::Status Invoke(const SubgraphKey& key) override {
+  void EnqueueFinishedJob(JobHandle job) override {
+    finished.insert(job->job_id);
+  }
+  absl::Status Invoke(const SubgraphKey& key, int batch_size) override {
     time::SleepForMicros(50);
     return absl::OkStatus();
   }
@@ -49,7 +54,8 @@ Job GetEmptyJob() {
 TYPED_TEST(WorkerSuite, JobHelper) {
   MockEngine engine;
   TypeParam worker(&engine, 0, DeviceFlag::kCPU);
-  Job job = GetEmptyJob();
+  JobSlab jobs;
+  JobHandle job = jobs.Alloc(GetEmptyJob());
 
   worker.Start();
 
@@ -58,7 +64,7 @@ TYPED_TEST(WorkerSuite, JobHelper) {
 
   EXPECT_TRUE(worker.EnqueueJob(job));
   EXPECT_TRUE(worker.HasJob());
-  EXPECT_EQ(worker.GetCurrentJobId(), job.job_id);
+  EXPECT_EQ(worker.GetCurrentJobId(), job->job_id);
 
   worker.End();
 }
@@ -71,7 +77,8 @@ TYPED_TEST(WorkerSuite, Wait) {
   EXPECT_CALL(engine, TryCopyOutputTensors).Times(testing::AtLeast(1));
 
   TypeParam worker(&engine, 0, DeviceFlag::kCPU);
-  Job job = GetEmptyJob();
+  JobSlab jobs;
+  JobHandle job = jobs.Alloc(GetEmptyJob());
 
   worker.Start();
 
@@ -84,8 +91,129 @@ TYPED_TEST(WorkerSuite, Wait) {
   auto now1 = time::NowMicros();
   EXPECT_GE(now1, now0 + 50);
 
-  EXPECT_NE(engine.finished.find(job.job_id), engine.finished.end());
+  EXPECT_NE(engine.finished.find(job->job_id), engine.finished.end());
+  worker.End();
+}
+
+TYPED_TEST(WorkerSuite, WaitingTime) {
+  MockEngine engine;
+  TypeParam worker(&engine, 0, DeviceFlag::kCPU);
+  JobSlab jobs;
+  Job job = GetEmptyJob();
+  job.expected_execution_time = 1000;
+  JobHandle handle = jobs.Alloc(std::move(job));
+
+  EXPECT_EQ(worker.GetWaitingTime(), 0);
+  EXPECT_CALL(engine, SetWorkerIdle(0, false)).Times(1);
+  EXPECT_TRUE(worker.EnqueueJob(handle));
+  // Not started yet
+  EXPECT_EQ(worker.GetWaitingTime(), 1000);
+
+  testing::Mock::VerifyAndClearExpectations(&engine);
+  EXPECT_CALL(engine, SetWorkerIdle(0, false)).Times(testing::AnyNumber());
+  EXPECT_CALL(engine, SetWorkerIdle(0, true)).Times(testing::AtLeast(1));
+  worker.Start();
+  worker.Wait();
   worker.End();
+  EXPECT_EQ(worker.GetWaitingTime(), 0);
+}
+
+// Runs every subgraph 100 times faster on worker 1 than on worker 0
+struct WorkStealEngine : public MockEngineBase {
+  void EnqueueFinishedJob(JobHandle job) override {
+    std::lock_guard<std::mutex> lock(mtx);
+    finished_workers[job->job_id] = job->subgraph_key.GetWorkerId();
+  }
+  absl::Status Invoke(const SubgraphKey& key, int batch_size) override {
+    time::SleepForMicros(GetExpected(key, batch_size));
+    return absl::OkStatus();
+  }
+  bool HasSubgraph(const SubgraphKey& key) const override { return true; }
+  int64_t GetExpected(const SubgraphKey& key, int batch_size) const override {
+    return key.GetWorkerId() == 0 ? 20000 : 200;
+  }
+  size_t GetNumWorkers() const override { return workers.size(); }
+  Worker* GetWorker(WorkerId id) override { return workers[id]; }
+
+  std::vector<Worker*> workers;
+  std::mutex mtx;
+  std::map<JobId, WorkerId> finished_workers;
+};
+
+TEST(DeviceQueueWorkerSuite, WorkSteal) {
+  WorkStealEngine engine;
+  DeviceQueueWorker slow_worker(&engine, 0, DeviceFlag::kCPU);
+  DeviceQueueWorker fast_worker(&engine, 1, DeviceFlag::kGPU);
+  fast_worker.AllowWorkSteal();
+  engine.workers = {&slow_worker, &fast_worker};
+
+  JobSlab jobs;
+  std::vector<JobHandle> handles;
+  for (int i = 0; i < 4; i++) {
+    Job job = GetEmptyJob();
+    job.job_id = i;
+    job.subgraph_key = SubgraphKey(0, i < 3 ? 0 : 1);
+    job.expected_execution_time = engine.GetExpected(job.subgraph_key, 1);
+    handles.push_back(jobs.Alloc(std::move(job)));
+  }
+  {
+    std::lock_guard<std::mutex> lock(slow_worker.GetDeviceMtx());
+    for (int i = 0; i < 3; i++) {
+      EXPECT_TRUE(slow_worker.EnqueueJob(handles[i]));
+    }
+  }
+  slow_worker.Start();
+  fast_worker.Start();
+  {
+    std::lock_guard<std::mutex> lock(fast_worker.GetDeviceMtx());
+    EXPECT_TRUE(fast_worker.EnqueueJob(handles[3]));
+  }
+
+  slow_worker.Wait();
+  fast_worker.Wait();
+  slow_worker.End();
+  fast_worker.End();
+
+  // Only the job that the slow worker started stays there
+  std::map<JobId, WorkerId> expected = {{0, 0}, {1, 1}, {2, 1}, {3, 1}};
+  EXPECT_EQ(engine.finished_workers, expected);
+}
+
+TEST(DeviceQueueWorkerSuite, WorkStealWhileIdle) {
+  WorkStealEngine engine;
+  DeviceQueueWorker slow_worker(&engine, 0, DeviceFlag::kCPU);
+  DeviceQueueWorker fast_worker(&engine, 1, DeviceFlag::kGPU);
+  fast_worker.AllowWorkSteal();
+  engine.workers = {&slow_worker, &fast_worker};
+  slow_worker.Start();
+  fast_worker.Start();
+
+  JobSlab jobs;
+  std::vector<JobHandle> handles;
+  for (int i = 0; i < 3; i++) {
+    Job job = GetEmptyJob();
+    job.job_id = i;
+    job.subgraph_key = SubgraphKey(0, 0);
+    job.expected_execution_time = engine.GetExpected(job.subgraph_key, 1);
+    handles.push_back(jobs.Alloc(std::move(job)));
+  }
+  // The fast worker never ran a job, so only the backlog of its peer wakes
+  // it up
+  {
+    std::lock_guard<std::mutex> lock(slow_worker.GetDeviceMtx());
+    for (JobHandle& handle : handles) {
+      EXPECT_TRUE(slow_worker.EnqueueJob(handle));
+    }
+  }
+  slow_worker.NotifyBacklog();
+
+  slow_worker.Wait();
+  fast_worker.Wait();
+  slow_worker.End();
+  fast_worker.End();
+
+  std::map<JobId, WorkerId> expected = {{0, 0}, {1, 1}, {2, 1}};
+  EXPECT_EQ(engine.finished_workers, expected);
 }
 
 // TODO: throttling test
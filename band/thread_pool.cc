@@ -0,0 +1,98 @@
+// Copyright 2023 Seoul National University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "band/thread_pool.h"
+
+#include <algorithm>
+
+namespace band {
+
+ThreadPool::ThreadPool(size_t num_threads) {
+  num_threads = std::max<size_t>(num_threads, 1);
+  threads_.reserve(num_threads);
+  for (size_t i = 0; i < num_threads; i++) {
+    threads_.emplace_back([this]() { Run(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  Wait();
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    is_stopping_ = true;
+  }
+  task_cv_.notify_all();
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+}
+
+void ThreadPool::Schedule(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    tasks_.push_back(std::move(task));
+    num_pending_++;
+  }
+  task_cv_.notify_one();
+}
+
+void ThreadPool::Wait() {
+  std::unique_lock<std::mutex> lock(mtx_);
+  idle_cv_.wait(lock, [this]() { return num_pending_ == 0; });
+}
+
+size_t ThreadPool::GetNumThreadsFor(size_t num_tasks) {
+  const size_t num_cores = std::max(std::thread::hardware_concurrency(), 1u);
+  return std::max<size_t>(std::min(num_tasks, num_cores), 1);
+}
+
+void ThreadPool::RunAll(std::vector<std::function<void()>> tasks) {
+  if (tasks.size() <= 1) {
+    for (auto& task : tasks) {
+      task();
+    }
+    return;
+  }
+  ThreadPool pool(GetNumThreadsFor(tasks.size()));
+  for (auto& task : tasks) {
+    pool.Schedule(std::move(task));
+  }
+  pool.Wait();
+}
+
+void ThreadPool::Run() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mtx_);
+      task_cv_.wait(lock, [this]() { return is_stopping_ || !tasks_.empty(); });
+      if (tasks_.empty()) {
+        return;
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+    task();
+    bool is_idle = false;
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      is_idle = --num_pending_ == 0;
+    }
+    if (is_idle) {
+      idle_cv_.notify_all();
+    }
+  }
+}
+
+}  // namespace band
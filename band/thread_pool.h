@@ -0,0 +1,72 @@
+/*
+ * Copyright 2023 Seoul National University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BAND_THREAD_POOL_H_
+#define BAND_THREAD_POOL_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace band {
+
+/*
+  Fixed number of threads that run scheduled tasks in the order they were
+  scheduled. Used for short-lived parallel work of the engine (e.g., model
+  registration), not for the execution of requests.
+
+  Tasks run on threads that are not attached to the engine clock.
+*/
+class ThreadPool {
+ public:
+  // At least one thread
+  explicit ThreadPool(size_t num_threads);
+  // Waits for the scheduled tasks
+  ~ThreadPool();
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  void Schedule(std::function<void()> task);
+  // Blocks until all tasks scheduled so far have finished
+  void Wait();
+  size_t GetNumThreads() const { return threads_.size(); }
+
+  // Threads for `num_tasks` independent tasks, bounded by the hardware
+  static size_t GetNumThreadsFor(size_t num_tasks);
+  // Runs independent tasks on a pool of `GetNumThreadsFor` threads and
+  // waits for them, or runs a single task on the calling thread
+  static void RunAll(std::vector<std::function<void()>> tasks);
+
+ private:
+  void Run();
+
+  std::mutex mtx_;
+  std::condition_variable task_cv_;
+  std::condition_variable idle_cv_;
+  std::deque<std::function<void()>> tasks_;
+  // Scheduled tasks that have not finished yet
+  size_t num_pending_ = 0;
+  bool is_stopping_ = false;
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace band
+
+#endif  // BAND_THREAD_POOL_H_
@@ -21,6 +21,8 @@
 
 namespace band {
 namespace time {
+// Monotonic time since an arbitrary point (e.g., boot). Engines read the
+// time through their `Clock` instead.
 uint64_t NowMicros();
 uint64_t NowNanos();
 void SleepForMicros(uint64_t micros);
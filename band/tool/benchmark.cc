@@ -15,17 +15,21 @@
 #include "band/tool/benchmark.h"
 
 #include <algorithm>
+#include <fstream>
+#include <functional>
 #include <iomanip>
 #include <iostream>
+#include <map>
 #include <random>
 #include <thread>
+#include <tuple>
 
+#include "absl/strings/str_format.h"
 #include "band/config_builder.h"
 #include "band/logger.h"
 #include "band/model.h"
 #include "band/profiler.h"
 #include "band/tensor.h"
-#include "band/time.h"
 #include "benchmark.h"
 
 namespace band {
@@ -43,14 +47,49 @@ Benchmark::~Benchmark() {
 }
 
 absl::Status Benchmark::Run() {
+  // Engine-side timing of the completed requests, to split their latency
+  CallbackId callback_id =
+      engine_->SetOnEndRequest([this](int job_id, absl::Status status) {
+        if (!status.ok()) {
+          return;
+        }
+        auto times = engine_->GetRequestTimes(job_id);
+        if (!times.ok()) {
+          return;
+        }
+        std::lock_guard<std::mutex> lock(request_times_mtx_);
+        for (auto model_context : model_contexts_) {
+          if (model_context->model.GetId() == times->model_id) {
+            model_context->request_times.push_back(times.value());
+            break;
+          }
+        }
+      });
+  Clock* clock = engine_->GetClock();
+  const std::vector<WorkerStats> start_worker_stats =
+      engine_->GetWorkerStats();
+  const int64_t start_time = clock->NowMicros();
+
+  absl::Status run_status = absl::OkStatus();
   if (benchmark_config_.execution_mode == "periodic") {
     RunPeriodic();
   } else if (benchmark_config_.execution_mode == "stream") {
     RunStream();
   } else if (benchmark_config_.execution_mode == "workload") {
     RunWorkload();
+  } else if (benchmark_config_.execution_mode == "sweep") {
+    run_status = RunSweep();
   }
 
+  run_time_us_ = clock->NowMicros() - start_time;
+  worker_stats_ = engine_->GetWorkerStats();
+  for (size_t i = 0; i < worker_stats_.size(); i++) {
+    worker_stats_[i].num_invokes -= start_worker_stats[i].num_invokes;
+    worker_stats_[i].busy_time_us -= start_worker_stats[i].busy_time_us;
+  }
+  RETURN_IF_ERROR(engine_->UnsetOnEndRequest(callback_id));
+  RETURN_IF_ERROR(run_status);
+
   return LogResults();
 }
 
@@ -118,7 +157,8 @@ bool Benchmark::LoadBenchmarkConfigs(const Json::Value& root) {
 
   json::AssignIfValid(benchmark_config_.execution_mode, root, "execution_mode");
 
-  std::set<std::string> supported_execution_modes{"periodic", "stream"};
+  std::set<std::string> supported_execution_modes{"periodic", "stream",
+                                                  "workload", "sweep"};
   if (supported_execution_modes.find(benchmark_config_.execution_mode) ==
       supported_execution_modes.end()) {
     std::cout << "Please check if argument execution mode "
@@ -128,6 +168,14 @@ bool Benchmark::LoadBenchmarkConfigs(const Json::Value& root) {
 
   json::AssignIfValid(benchmark_config_.running_time_ms, root,
                       "running_time_ms");
+  json::AssignIfValid(benchmark_config_.report_json_path, root,
+                      "report_json_path");
+  json::AssignIfValid(benchmark_config_.report_csv_path, root,
+                      "report_csv_path");
+
+  if (!root["backend"].isNull()) {
+    target_backend_ = FromString<BackendType>(root["backend"].asCString());
+  }
 
   if (benchmark_config_.running_time_ms == 0) {
     std::cout << "Please check if argument running_time_ms "
@@ -135,6 +183,35 @@ bool Benchmark::LoadBenchmarkConfigs(const Json::Value& root) {
     return false;
   }
 
+  // Set `sweep`.
+  // Required for `sweep` mode.
+  if (benchmark_config_.execution_mode == "sweep") {
+    SweepConfig& sweep = benchmark_config_.sweep;
+    const Json::Value& sweep_json_value = root["sweep"];
+    json::AssignIfValid(sweep.min_rate_per_sec, sweep_json_value,
+                        "min_rate_per_sec");
+    json::AssignIfValid(sweep.max_rate_per_sec, sweep_json_value,
+                        "max_rate_per_sec");
+    json::AssignIfValid(sweep.target_slo_rate, sweep_json_value,
+                        "target_slo_rate");
+    json::AssignIfValid(sweep.max_steps, sweep_json_value, "max_steps");
+    json::AssignIfValid(sweep.tolerance, sweep_json_value, "tolerance");
+    if (sweep.min_rate_per_sec <= 0 ||
+        sweep.max_rate_per_sec <= sweep.min_rate_per_sec) {
+      std::cout << "Please check if `sweep` is given with 0 < "
+                   "`min_rate_per_sec` < `max_rate_per_sec`"
+                << std::endl;
+      return false;
+    }
+    if (sweep.target_slo_rate <= 0 || sweep.target_slo_rate > 100 ||
+        sweep.max_steps == 0) {
+      std::cout << "Please check if `target_slo_rate` of `sweep` is in (0, "
+                   "100] and `max_steps` > 0"
+                << std::endl;
+      return false;
+    }
+  }
+
   if (root["models"].size() == 0) {
     std::cout << "Please specify at list one model in `models` argument"
               << std::endl;
@@ -167,6 +244,32 @@ bool Benchmark::LoadBenchmarkConfigs(const Json::Value& root) {
       }
     }
 
+    // Set `arrival`.
+    // Required for `workload` mode.
+    if (benchmark_config_.execution_mode == "workload") {
+      auto status =
+          ParseArrivalConfig(model_json_value["arrival"], model.arrival);
+      if (!status.ok()) {
+        std::cout << status.message() << std::endl;
+        return false;
+      }
+      if (model.arrival.seed < 0) {
+        model.arrival.seed = i;
+      }
+    }
+
+    // Set `weight`.
+    // Poisson arrivals of `sweep` mode split the offered load by weight.
+    if (benchmark_config_.execution_mode == "sweep") {
+      json::AssignIfValid(model.weight, model_json_value, "weight");
+      if (model.weight <= 0) {
+        std::cout << "Please check if argument `weight` is > 0" << std::endl;
+        return false;
+      }
+      model.arrival.type = "poisson";
+      model.arrival.seed = i;
+    }
+
     json::AssignIfValid(model.batch_size, model_json_value, "batch_size");
     json::AssignIfValid(model.worker_id, model_json_value, "worker_id");
     json::AssignIfValid(model.slo_us, model_json_value, "slo_us");
@@ -194,6 +297,10 @@ bool tool::Benchmark::LoadRuntimeConfigs(const Json::Value& root) {
     if (root["profile_smoothing_factor"].isNumeric()) {
       builder.AddSmoothingFactor(root["profile_smoothing_factor"].asFloat());
     }
+    if (root["profile_latency_drift_threshold"].isNumeric()) {
+      builder.AddLatencyDriftThreshold(
+          root["profile_latency_drift_threshold"].asFloat());
+    }
     if (root["profile_data_path"].isString()) {
       builder.AddProfileDataPath(root["profile_data_path"].asCString());
     }
@@ -204,6 +311,19 @@ bool tool::Benchmark::LoadRuntimeConfigs(const Json::Value& root) {
     if (root["schedule_window_size"].isInt()) {
       builder.AddScheduleWindowSize(root["schedule_window_size"].asInt());
     }
+    if (root["max_batch_size"].isInt()) {
+      builder.AddMaxBatchSize(root["max_batch_size"].asInt());
+    }
+    if (root["batch_timeout_us"].isInt64()) {
+      builder.AddBatchTimeoutUs(root["batch_timeout_us"].asInt64());
+    }
+    if (root["latency_cache_size"].isInt()) {
+      builder.AddLatencyCacheSize(root["latency_cache_size"].asInt());
+    }
+    if (root["min_planning_interval_us"].isInt64()) {
+      builder.AddMinPlanningIntervalUs(
+          root["min_planning_interval_us"].asInt64());
+    }
 
     std::vector<SchedulerType> schedulers;
     for (auto scheduler : root["schedulers"]) {
@@ -269,10 +389,32 @@ bool tool::Benchmark::LoadRuntimeConfigs(const Json::Value& root) {
           root["subgraph_preparation_type"].asCString()));
     }
 
+    if (root["lazy_subgraphs"].isBool()) {
+      builder.AddLazySubgraphs(root["lazy_subgraphs"].asBool());
+    }
+
+    if (root["subgraph_memory_budget"].isUInt64()) {
+      builder.AddSubgraphMemoryBudget(
+          root["subgraph_memory_budget"].asUInt64());
+    }
+
     if (root["cpu_masks"].isString()) {
       builder.AddCPUMask(
           FromString<CPUMaskFlag>(root["cpu_masks"].asCString()));
     }
+
+    if (root["tensor_pool_size"].isInt()) {
+      builder.AddTensorPoolSize(root["tensor_pool_size"].asInt());
+    }
+
+    if (root["block_on_tensor_pool_full"].isBool()) {
+      builder.AddBlockOnTensorPoolFull(
+          root["block_on_tensor_pool_full"].asBool());
+    }
+
+    if (root["virtual_clock"].isBool()) {
+      builder.AddVirtualClock(root["virtual_clock"].asBool());
+    }
   }
 
   auto builder_status = builder.Build();
@@ -307,24 +449,33 @@ absl::Status Benchmark::Initialize(int argc, const char** argv) {
   if (!engine_) {
     return absl::InternalError("Failed to create engine");
   }
+  global_profiler_.SetClock(engine_->GetClock());
 
-  // load models
+  // load models, and register them at once to overlap their preparation
+  std::vector<ModelContext*> model_contexts;
+  std::vector<Model*> models;
   for (auto& benchmark_model : benchmark_config_.model_configs) {
     ModelContext* engine = new ModelContext;
+    engine->profiler.SetClock(engine_->GetClock());
+    model_contexts.push_back(engine);
 
-    {
-      auto status =
-          engine->model.FromPath(target_backend_, benchmark_model.path.c_str());
-      if (!status.ok()) {
-        return status;
-      }
+    auto status =
+        engine->model.FromPath(target_backend_, benchmark_model.path.c_str());
+    if (!status.ok()) {
+      return status;
     }
-    {
-      auto status = engine_->RegisterModel(&engine->model);
-      if (!status.ok()) {
-        return status;
-      }
+    models.push_back(&engine->model);
+  }
+  {
+    auto status = engine_->RegisterModels(models);
+    if (!status.ok()) {
+      return status;
     }
+  }
+
+  for (size_t i = 0; i < model_contexts.size(); i++) {
+    auto& benchmark_model = benchmark_config_.model_configs[i];
+    ModelContext* engine = model_contexts[i];
 
     const int model_id = engine->model.GetId();
     const auto input_indices = engine_->GetInputTensorIndices(model_id);
@@ -366,6 +517,13 @@ absl::Status Benchmark::Initialize(int argc, const char** argv) {
       }
     }
 
+    if (benchmark_config_.execution_mode == "sweep" &&
+        benchmark_model.slo_us <= 0) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Model %s needs `slo_us` or `slo_scale` in sweep mode",
+          benchmark_model.path));
+    }
+
     engine->model_ids =
         std::vector<ModelId>(benchmark_model.batch_size, model_id);
     engine->request_options = std::vector<RequestOption>(
@@ -420,6 +578,15 @@ absl::Status Benchmark::Initialize(int argc, const char** argv) {
       inputs.push_back(input_tensor);
     }
     engine->model_inputs = inputs;
+
+    if (benchmark_config_.execution_mode == "workload") {
+      auto status_or_arrivals = GenerateArrivals(
+          benchmark_model.arrival, benchmark_config_.running_time_ms * 1000);
+      if (!status_or_arrivals.ok()) {
+        return status_or_arrivals.status();
+      }
+      engine->arrivals = std::move(status_or_arrivals.value());
+    }
     model_contexts_.push_back(engine);
   }
 
@@ -427,10 +594,15 @@ absl::Status Benchmark::Initialize(int argc, const char** argv) {
 }
 
 void Benchmark::RunPeriodic() {
+  // Request threads attach to the clock so that a virtual clock waits for
+  // them between requests
+  Clock* clock = engine_->GetClock();
+  clock->AttachThread();
   for (int model_index = 0; model_index < model_contexts_.size();
        model_index++) {
     std::thread t(
-        [this](ModelContext* model_context, const size_t period_us) {
+        [this, clock](ModelContext* model_context, const size_t period_us) {
+          clock->AttachThread();
           while (true) {
             if (!model_context->PrepareInput().ok()) {
               BAND_LOG(LogSeverity::kWarning, "Failed to prepare input");
@@ -444,15 +616,17 @@ void Benchmark::RunPeriodic() {
                 model_context->model_request_outputs);
             model_context->profiler.EndEvent(id, status);
 
-            if (kill_app_) return;
+            if (kill_app_) {
+              clock->DetachThread();
+              return;
+            }
 
             size_t elapsed_us =
                 model_context->profiler
                     .GetElapsedTimeAt<std::chrono::microseconds>(id);
 
             if (elapsed_us < period_us) {
-              std::this_thread::sleep_for(
-                  std::chrono::microseconds(period_us - elapsed_us));
+              clock->SleepForMicros(period_us - elapsed_us);
             }
           }
         },
@@ -462,15 +636,17 @@ void Benchmark::RunPeriodic() {
     t.detach();
   }
   // wait for some time until we stop the benchmark
-  std::this_thread::sleep_for(
-      std::chrono::milliseconds(benchmark_config_.running_time_ms));
+  clock->SleepForMicros(benchmark_config_.running_time_ms * 1000);
   kill_app_ = true;
   engine_->WaitAll();
+  clock->DetachThread();
 }
 
 void Benchmark::RunStream() {
   int run_duration_us = benchmark_config_.running_time_ms * 1000;
-  int64_t start = time::NowMicros();
+  Clock* clock = engine_->GetClock();
+  clock->AttachThread();
+  int64_t start = clock->NowMicros();
   while (true) {
     std::vector<ModelId> model_ids;
     std::vector<RequestOption> request_options;
@@ -499,12 +675,266 @@ void Benchmark::RunStream() {
     auto status =
         engine_->RequestSync(model_ids, request_options, inputs, outputs);
     global_profiler_.EndEvent(id, status);
-    int64_t current = time::NowMicros();
+    int64_t current = clock->NowMicros();
     if (current - start >= run_duration_us) break;
   }
+  clock->DetachThread();
+}
+
+void Benchmark::RunWorkload() {
+  // Requests are issued open-loop at their arrival time, regardless of the
+  // previous ones, so that the queueing delay is a part of their latency
+  struct Request {
+    ModelContext* model_context;
+    size_t event_id;
+    int num_pending_jobs;
+    absl::Status status;
+  };
+  struct ScheduledRequest {
+    int64_t time_us;
+    ModelContext* model_context;
+    int slo_us;
+  };
+
+  std::vector<ScheduledRequest> schedule;
+  for (auto model_context : model_contexts_) {
+    for (const Arrival& arrival : model_context->arrivals) {
+      schedule.push_back({arrival.time_us, model_context, arrival.slo_us});
+    }
+  }
+  // simultaneous requests are issued in the order of the models
+  std::stable_sort(schedule.begin(), schedule.end(),
+                   [](const ScheduledRequest& lhs,
+                      const ScheduledRequest& rhs) {
+                     return lhs.time_us < rhs.time_us;
+                   });
+
+  Clock* clock = engine_->GetClock();
+  std::mutex request_mtx;
+  ClockCondition request_cv(clock);
+  int num_pending_requests = 0;
+  // (request, batch index) of the jobs in flight
+  std::map<JobId, std::pair<std::shared_ptr<Request>, size_t>> pending_jobs;
+  // jobs that finished before their request registered them
+  std::set<JobId> early_finished_jobs;
+
+  // requires `request_mtx`
+  auto finish_job = [&](JobId job_id, Request& request, size_t batch_index) {
+    ModelContext* model_context = request.model_context;
+    // reads the outputs to return the tensor slots of the job
+    auto status = engine_->GetOutputTensors(
+        job_id, model_context->model_request_outputs[batch_index]);
+    if (request.status.ok()) {
+      request.status = status;
+    }
+    if (--request.num_pending_jobs == 0) {
+      model_context->profiler.EndEvent(request.event_id, request.status);
+      if (--num_pending_requests == 0) {
+        request_cv.NotifyAll();
+      }
+    }
+  };
+
+  CallbackId callback_id =
+      engine_->SetOnEndRequest([&](int job_id, absl::Status status) {
+        std::lock_guard<std::mutex> lock(request_mtx);
+        auto it = pending_jobs.find(job_id);
+        if (it == pending_jobs.end()) {
+          early_finished_jobs.insert(job_id);
+          return;
+        }
+        finish_job(job_id, *it->second.first, it->second.second);
+        pending_jobs.erase(it);
+      });
+
+  clock->AttachThread();
+  const int64_t start_time = clock->NowMicros();
+  for (const ScheduledRequest& scheduled : schedule) {
+    clock->SleepUntil(start_time + scheduled.time_us);
+
+    ModelContext* model_context = scheduled.model_context;
+    if (!model_context->PrepareInput().ok()) {
+      BAND_LOG(LogSeverity::kWarning, "Failed to prepare input");
+      continue;
+    }
+    std::vector<RequestOption> request_options =
+        model_context->request_options;
+    if (scheduled.slo_us > 0) {
+      for (auto& request_option : request_options) {
+        request_option.slo_us = scheduled.slo_us;
+      }
+    }
+
+    auto request = std::make_shared<Request>();
+    request->model_context = model_context;
+    {
+      std::lock_guard<std::mutex> lock(request_mtx);
+      request->event_id = model_context->profiler.BeginEvent();
+      if (scheduled.slo_us > 0) {
+        model_context->profiler.SetEventSLO(request->event_id,
+                                            scheduled.slo_us);
+      }
+    }
+
+    auto status_or_job_ids =
+        engine_->RequestAsync(model_context->model_ids, request_options,
+                              model_context->model_request_inputs);
+
+    std::lock_guard<std::mutex> lock(request_mtx);
+    if (!status_or_job_ids.ok()) {
+      model_context->profiler.EndEvent(request->event_id,
+                                       status_or_job_ids.status());
+      continue;
+    }
+    const std::vector<JobId>& job_ids = status_or_job_ids.value();
+    request->num_pending_jobs = job_ids.size();
+    num_pending_requests++;
+    for (size_t batch_index = 0; batch_index < job_ids.size();
+         batch_index++) {
+      const JobId job_id = job_ids[batch_index];
+      if (early_finished_jobs.erase(job_id) > 0) {
+        finish_job(job_id, *request, batch_index);
+      } else {
+        pending_jobs[job_id] = {request, batch_index};
+      }
+    }
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(request_mtx);
+    request_cv.Wait(lock, [&]() { return num_pending_requests == 0; });
+  }
+  clock->DetachThread();
+  if (!engine_->UnsetOnEndRequest(callback_id).ok()) {
+    BAND_LOG(LogSeverity::kWarning, "Failed to unset the request callback");
+  }
+}
+
+absl::StatusOr<Benchmark::SweepStep> Benchmark::RunSweepStep(
+    double rate_per_sec) {
+  double total_weight = 0.;
+  for (const ModelConfig& model_config : benchmark_config_.model_configs) {
+    total_weight += model_config.weight;
+  }
+
+  // every step starts from the same seeds, so that a higher rate only
+  // compresses the same arrivals instead of drawing new ones
+  for (size_t model_index = 0; model_index < model_contexts_.size();
+       model_index++) {
+    ModelContext* model_context = model_contexts_[model_index];
+    const ModelConfig& model_config =
+        benchmark_config_.model_configs[model_index];
+    ArrivalConfig arrival = model_config.arrival;
+    arrival.rate_per_sec = rate_per_sec * model_config.weight / total_weight;
+    auto status_or_arrivals =
+        GenerateArrivals(arrival, benchmark_config_.running_time_ms * 1000);
+    if (!status_or_arrivals.ok()) {
+      return status_or_arrivals.status();
+    }
+    model_context->arrivals = std::move(status_or_arrivals.value());
+    model_context->profiler = BenchmarkProfiler();
+    model_context->profiler.SetClock(engine_->GetClock());
+    std::lock_guard<std::mutex> lock(request_times_mtx_);
+    model_context->request_times.clear();
+  }
+
+  Clock* clock = engine_->GetClock();
+  const int64_t start_time = clock->NowMicros();
+  RunWorkload();
+  // at least the offered window, even if the last requests finish early
+  const int64_t step_time_us =
+      std::max<int64_t>(clock->NowMicros() - start_time,
+                        benchmark_config_.running_time_ms * 1000);
+
+  SweepStep step;
+  step.offered_rate_per_sec = rate_per_sec;
+  std::vector<int64_t> latencies;
+  for (size_t model_index = 0; model_index < model_contexts_.size();
+       model_index++) {
+    const BenchmarkProfiler& profiler = model_contexts_[model_index]->profiler;
+    step.num_requests += profiler.GetNumEvents();
+    step.num_slo_satisfied += profiler.GetNumSLOSatisfiedEvents(
+        benchmark_config_.model_configs[model_index].slo_us);
+    const std::vector<int64_t> model_latencies = profiler.GetLatencies();
+    latencies.insert(latencies.end(), model_latencies.begin(),
+                     model_latencies.end());
+  }
+  step.latency = LatencyStats::FromSamples(std::move(latencies));
+  step.throughput_per_sec =
+      step_time_us > 0 ? step.latency.count * 1e6 / step_time_us : 0.;
+  step.slo_satisfactory_rate =
+      step.num_requests > 0
+          ? static_cast<double>(step.num_slo_satisfied) / step.num_requests *
+                100
+          : 100.;
+  step.satisfied =
+      step.slo_satisfactory_rate >= benchmark_config_.sweep.target_slo_rate;
+
+  BAND_LOG(LogSeverity::kInfo,
+           "Sweep step %zu: %.2f req/s offered, %.2f req/s served, %.2f %% "
+           "within SLO",
+           sweep_steps_.size(), step.offered_rate_per_sec,
+           step.throughput_per_sec, step.slo_satisfactory_rate);
+  return step;
 }
 
-void Benchmark::RunWorkload() { BAND_NOT_IMPLEMENTED; }
+absl::Status Benchmark::RunSweep() {
+  const SweepConfig& sweep = benchmark_config_.sweep;
+  sweep_steps_.clear();
+  knee_step_ = -1;
+
+  // runs a step and returns whether it met the target
+  auto run_step = [this](double rate_per_sec) -> absl::StatusOr<bool> {
+    auto status_or_step = RunSweepStep(rate_per_sec);
+    if (!status_or_step.ok()) {
+      return status_or_step.status();
+    }
+    sweep_steps_.push_back(status_or_step.value());
+    const bool satisfied = sweep_steps_.back().satisfied;
+    if (satisfied &&
+        (knee_step_ < 0 ||
+         sweep_steps_[knee_step_].offered_rate_per_sec < rate_per_sec)) {
+      knee_step_ = sweep_steps_.size() - 1;
+    }
+    return satisfied;
+  };
+
+  // Binary search on the offered rate, assuming the SLO satisfactory rate
+  // falls as the load grows. Both ends are checked first, since the whole
+  // range may be sustainable (or none of it).
+  double lower_rate = sweep.min_rate_per_sec;
+  double upper_rate = sweep.max_rate_per_sec;
+  auto status_or_satisfied = run_step(upper_rate);
+  if (!status_or_satisfied.ok()) {
+    return status_or_satisfied.status();
+  }
+  if (status_or_satisfied.value() || sweep_steps_.size() >= sweep.max_steps) {
+    return absl::OkStatus();
+  }
+
+  status_or_satisfied = run_step(lower_rate);
+  if (!status_or_satisfied.ok()) {
+    return status_or_satisfied.status();
+  }
+  if (!status_or_satisfied.value()) {
+    return absl::OkStatus();
+  }
+
+  while (sweep_steps_.size() < sweep.max_steps &&
+         upper_rate - lower_rate > sweep.tolerance * upper_rate) {
+    const double rate = (lower_rate + upper_rate) / 2;
+    status_or_satisfied = run_step(rate);
+    if (!status_or_satisfied.ok()) {
+      return status_or_satisfied.status();
+    }
+    if (status_or_satisfied.value()) {
+      lower_rate = rate;
+    } else {
+      upper_rate = rate;
+    }
+  }
+  return absl::OkStatus();
+}
 
 void PrintHeader(std::string key, size_t indent_level = 0) {
   std::cout << std::left << std::string(indent_level * 2, ' ') << "<" << key
@@ -517,6 +947,101 @@ void PrintLine(std::string key, const T& value, size_t indent_level = 0) {
             << "] : " << std::right << value << std::endl;
 }
 
+Json::Value ToJson(const LatencyStats& stats) {
+  Json::Value value;
+  value["count"] = Json::UInt64(stats.count);
+  value["avg"] = stats.average;
+  value["p50"] = Json::Int64(stats.p50);
+  value["p90"] = Json::Int64(stats.p90);
+  value["p99"] = Json::Int64(stats.p99);
+  value["p99.9"] = Json::Int64(stats.p999);
+  value["max"] = Json::Int64(stats.max);
+  return value;
+}
+
+// One row per result of `report`, for tracking across runs
+absl::Status WriteCSVReport(const Json::Value& report,
+                            const std::string& path) {
+  std::ofstream out(path, std::ios::out);
+  if (!out.is_open()) {
+    return absl::InternalError(
+        absl::StrFormat("Cannot write the report to %s", path));
+  }
+
+  const std::vector<std::string> count_keys = {
+      "num_requests", "num_completed", "num_canceled", "num_failed",
+      "num_slo_violations", "slo_satisfactory_rate"};
+  const std::vector<std::string> stats_keys = {
+      "latency_us",     "queueing_us",     "execution_us",
+      "planner_us",     "worker_queue_us", "input_copy_us",
+      "output_copy_us", "completion_us"};
+  const std::vector<std::string> stat_keys = {"avg",  "p50",   "p90",
+                                              "p99", "p99.9", "max"};
+  out << "name";
+  for (const auto& key : count_keys) {
+    out << "," << key;
+  }
+  for (const auto& stats_key : stats_keys) {
+    for (const auto& stat_key : stat_keys) {
+      out << "," << stats_key << "_" << stat_key;
+    }
+  }
+  out << "\n";
+
+  for (const Json::Value& result : report["results"]) {
+    out << "\"" << result["name"].asString() << "\"";
+    for (const auto& key : count_keys) {
+      out << "," << (result[key].isNull() ? "" : result[key].asString());
+    }
+    for (const auto& stats_key : stats_keys) {
+      for (const auto& stat_key : stat_keys) {
+        const Json::Value& value = result[stats_key][stat_key];
+        out << "," << (value.isNull() ? "" : value.asString());
+      }
+    }
+    out << "\n";
+  }
+  return absl::OkStatus();
+}
+
+// One row per step of a `sweep` report
+absl::Status WriteSweepCSVReport(const Json::Value& sweep_report,
+                                 const std::string& path) {
+  std::ofstream out(path, std::ios::out);
+  if (!out.is_open()) {
+    return absl::InternalError(
+        absl::StrFormat("Cannot write the report to %s", path));
+  }
+
+  const std::vector<std::string> step_keys = {
+      "offered_rate_per_sec", "throughput_per_sec", "num_requests",
+      "num_slo_satisfied", "slo_satisfactory_rate", "satisfied"};
+  const std::vector<std::string> stat_keys = {"avg",  "p50",   "p90",
+                                              "p99", "p99.9", "max"};
+  out << "step";
+  for (const auto& key : step_keys) {
+    out << "," << key;
+  }
+  for (const auto& stat_key : stat_keys) {
+    out << ",latency_us_" << stat_key;
+  }
+  out << "\n";
+
+  for (Json::ArrayIndex step_index = 0;
+       step_index < sweep_report["steps"].size(); step_index++) {
+    const Json::Value& step = sweep_report["steps"][step_index];
+    out << step_index;
+    for (const auto& key : step_keys) {
+      out << "," << step[key].asString();
+    }
+    for (const auto& stat_key : stat_keys) {
+      out << "," << step["latency_us"][stat_key].asString();
+    }
+    out << "\n";
+  }
+  return absl::OkStatus();
+}
+
 absl::Status Benchmark::LogResults() {
   const std::string header = "--\t\t Band Benchmark Tool \t\t--";
   size_t length = header.size();
@@ -534,19 +1059,36 @@ absl::Status Benchmark::LogResults() {
   for (auto& model_config : benchmark_config_.model_configs) {
     PrintHeader(model_config.path, 1);
     PrintLine("Batch size", model_config.batch_size, 2);
-    PrintLine("Request period (ms)", model_config.period_ms, 2);
+    if (benchmark_config_.execution_mode == "periodic") {
+      PrintLine("Request period (ms)", model_config.period_ms, 2);
+    } else if (benchmark_config_.execution_mode == "workload") {
+      PrintLine("Arrival", model_config.arrival.type, 2);
+    } else if (benchmark_config_.execution_mode == "sweep") {
+      PrintLine("Weight", model_config.weight, 2);
+    }
     PrintLine("SLO (us)", model_config.slo_us, 2);
     PrintLine("SLO scale", model_config.slo_scale, 2);
   }
 
-  auto print_profiler = [](const std::string& prefix,
-                           const BenchmarkProfiler& profiler,
-                           const ModelConfig* model_config = nullptr) {
+  Json::Value report;
+  report["execution_mode"] = benchmark_config_.execution_mode;
+  report["running_time_ms"] = Json::UInt64(benchmark_config_.running_time_ms);
+  report["measured_time_us"] = Json::Int64(run_time_us_);
+  for (auto& scheduler : runtime_config_->planner_config.schedulers) {
+    report["schedulers"].append(ToString(scheduler));
+  }
+
+  auto print_profiler = [&report](const std::string& prefix,
+                                  const BenchmarkProfiler& profiler,
+                                  const ModelConfig* model_config = nullptr,
+                                  const ModelContext* model_context =
+                                      nullptr) {
     const double batch_size = model_config ? model_config->batch_size : 1;
     double average_ms =
         (profiler.GetAverageElapsedTime<std::chrono::milliseconds>() /
          batch_size);
     double average_fps = 1000 / average_ms;
+    const LatencyStats latency = profiler.GetLatencyStats();
 
     PrintHeader("Result - " + prefix);
     PrintLine("# Processed requests", profiler.GetNumEvents() * batch_size, 1);
@@ -555,30 +1097,105 @@ absl::Status Benchmark::LogResults() {
     PrintLine("Total # requests", profiler.GetNumEvents() * batch_size, 1);
     PrintLine("Total # canceled requests",
               profiler.GetNumCanceledEvents() * batch_size, 1);
-
-    if (model_config && model_config->slo_us > 0) {
+    PrintLine("Total # failed requests",
+              profiler.GetNumFailedEvents() * batch_size, 1);
+    PrintLine("p50 / p90 / p99 / p99.9 Latency (ms)",
+              absl::StrFormat("%.3f / %.3f / %.3f / %.3f", latency.p50 / 1e3,
+                              latency.p90 / 1e3, latency.p99 / 1e3,
+                              latency.p999 / 1e3),
+              1);
+    PrintLine("Max. Latency (ms)", latency.max / 1e3, 1);
+
+    Json::Value result;
+    result["name"] = prefix;
+    result["num_requests"] =
+        Json::UInt64(profiler.GetNumEvents() * batch_size);
+    result["num_completed"] = Json::UInt64(latency.count * batch_size);
+    result["num_canceled"] =
+        Json::UInt64(profiler.GetNumCanceledEvents() * batch_size);
+    result["num_failed"] =
+        Json::UInt64(profiler.GetNumFailedEvents() * batch_size);
+    result["latency_us"] = ToJson(latency);
+
+    if (model_config) {
       double slo_satisfactory_count = 0;
+      double num_events = 0;
       for (size_t i = 0; i < profiler.GetNumEvents(); i++) {
-        if (!profiler.IsEventCanceled(i) &&
-            profiler.GetElapsedTimeAt<std::chrono::microseconds>(i) <
-                model_config->slo_us) {
+        // event handles start from 1
+        const size_t event_handle = i + 1;
+        const int64_t slo_us =
+            profiler.GetEventSLO(event_handle, model_config->slo_us);
+        if (slo_us <= 0 || profiler.IsEventCanceled(event_handle) ||
+            profiler.IsEventFailed(event_handle)) {
+          continue;
+        }
+        num_events++;
+        if (profiler.GetElapsedTimeAt<std::chrono::microseconds>(i) <
+            slo_us) {
           slo_satisfactory_count++;
         }
       }
 
-      double num_events =
-          profiler.GetNumEvents() - profiler.GetNumCanceledEvents();
+      if (num_events > 0) {
+        const double slo_satisfactory_rate =
+            slo_satisfactory_count / num_events * 100;
+        PrintLine("SLO Satisfactory Rate (%)", slo_satisfactory_rate, 1);
+        PrintLine("Total # SLO violations",
+                  (num_events - slo_satisfactory_count) * batch_size, 1);
+        result["num_slo_violations"] =
+            Json::UInt64((num_events - slo_satisfactory_count) * batch_size);
+        result["slo_satisfactory_rate"] = slo_satisfactory_rate;
+      }
+    }
 
-      PrintLine("SLO Satisfactory Rate (%)",
-                slo_satisfactory_count / num_events * 100, 1);
+    if (model_context && !model_context->request_times.empty()) {
+      // engine-side latency of each job, split into queueing and execution,
+      // and the stages that the queueing time consists of
+      const std::vector<
+          std::tuple<std::string, std::string,
+                     std::function<int64_t(const RequestTimes&)>>>
+          stages = {
+              {"Queueing", "queueing_us",
+               [](const RequestTimes& t) { return t.GetQueueingTime(); }},
+              {"Execution", "execution_us",
+               [](const RequestTimes& t) { return t.execution_time; }},
+              {"Planner", "planner_us",
+               [](const RequestTimes& t) { return t.planner_time; }},
+              {"Worker Queue", "worker_queue_us",
+               [](const RequestTimes& t) { return t.worker_queue_time; }},
+              {"Input Copy", "input_copy_us",
+               [](const RequestTimes& t) { return t.input_copy_time; }},
+              {"Output Copy", "output_copy_us",
+               [](const RequestTimes& t) { return t.output_copy_time; }},
+              {"Completion", "completion_us",
+               [](const RequestTimes& t) { return t.GetCompletionTime(); }},
+          };
+      for (const auto& stage : stages) {
+        std::vector<int64_t> samples;
+        samples.reserve(model_context->request_times.size());
+        for (const RequestTimes& times : model_context->request_times) {
+          samples.push_back(std::get<2>(stage)(times));
+        }
+        const LatencyStats stats =
+            LatencyStats::FromSamples(std::move(samples));
+        PrintLine(absl::StrFormat("Avg. / p99 %s (ms)", std::get<0>(stage)),
+                  absl::StrFormat("%.3f / %.3f", stats.average / 1e3,
+                                  stats.p99 / 1e3),
+                  1);
+        result[std::get<1>(stage)] = ToJson(stats);
+      }
     }
+
+    report["results"].append(result);
   };
 
   if (global_profiler_.GetNumEvents() > 0) {
     print_profiler("Global", global_profiler_);
   }
 
-  for (size_t model_index = 0; model_index < model_contexts_.size();
+  // the profilers of `sweep` mode only hold its last step
+  for (size_t model_index = 0; model_index < model_contexts_.size() &&
+                               benchmark_config_.execution_mode != "sweep";
        model_index++) {
     auto& model_context = model_contexts_[model_index];
     auto& model_config = benchmark_config_.model_configs[model_index];
@@ -586,10 +1203,116 @@ absl::Status Benchmark::LogResults() {
     if (model_context->profiler.GetNumEvents() > 0) {
       print_profiler(
           model_context->model.GetBackendModel(target_backend_)->GetPath(),
-          model_context->profiler, &model_config);
+          model_context->profiler, &model_config, model_context);
     }
   }
 
+  if (benchmark_config_.execution_mode == "sweep") {
+    const SweepConfig& sweep = benchmark_config_.sweep;
+    Json::Value& sweep_report = report["sweep"];
+    PrintHeader("Sweep");
+    PrintLine("Target SLO Satisfactory Rate (%)", sweep.target_slo_rate, 1);
+    sweep_report["target_slo_rate"] = sweep.target_slo_rate;
+    for (size_t step_index = 0; step_index < sweep_steps_.size();
+         step_index++) {
+      const SweepStep& step = sweep_steps_[step_index];
+      PrintHeader(absl::StrFormat("Step %d", step_index), 1);
+      PrintLine("Offered rate (req/s)", step.offered_rate_per_sec, 2);
+      PrintLine("Throughput (req/s)", step.throughput_per_sec, 2);
+      PrintLine("SLO Satisfactory Rate (%)", step.slo_satisfactory_rate, 2);
+      PrintLine("p50 / p99 / p99.9 Latency (ms)",
+                absl::StrFormat("%.3f / %.3f / %.3f", step.latency.p50 / 1e3,
+                                step.latency.p99 / 1e3,
+                                step.latency.p999 / 1e3),
+                2);
+
+      Json::Value step_report;
+      step_report["offered_rate_per_sec"] = step.offered_rate_per_sec;
+      step_report["throughput_per_sec"] = step.throughput_per_sec;
+      step_report["num_requests"] = Json::UInt64(step.num_requests);
+      step_report["num_slo_satisfied"] = Json::UInt64(step.num_slo_satisfied);
+      step_report["slo_satisfactory_rate"] = step.slo_satisfactory_rate;
+      step_report["satisfied"] = step.satisfied;
+      step_report["latency_us"] = ToJson(step.latency);
+      sweep_report["steps"].append(step_report);
+    }
+
+    // the knee is the highest offered rate that met the target, which is
+    // only bounded from above if some step missed it
+    const bool has_knee = knee_step_ >= 0;
+    const double knee_rate =
+        has_knee ? sweep_steps_[knee_step_].offered_rate_per_sec : 0.;
+    const double sustainable_throughput =
+        has_knee ? sweep_steps_[knee_step_].throughput_per_sec : 0.;
+    bool knee_within_range = false;
+    for (const SweepStep& step : sweep_steps_) {
+      knee_within_range |= !step.satisfied;
+    }
+    PrintLine("Knee rate (req/s)", knee_rate, 1);
+    PrintLine("Sustainable throughput (req/s)", sustainable_throughput, 1);
+    if (!knee_within_range) {
+      PrintLine("Note", "max_rate_per_sec met the target", 1);
+    }
+    sweep_report["knee_rate_per_sec"] = knee_rate;
+    sweep_report["sustainable_throughput_per_sec"] = sustainable_throughput;
+    sweep_report["knee_within_range"] = knee_within_range;
+  }
+
+  PrintHeader("Worker");
+  for (size_t worker_id = 0; worker_id < worker_stats_.size(); worker_id++) {
+    const WorkerStats& stats = worker_stats_[worker_id];
+    const double utilization =
+        run_time_us_ > 0 ? static_cast<double>(stats.busy_time_us) /
+                               run_time_us_ * 100
+                         : 0;
+    PrintHeader(absl::StrFormat("%d (%s)", worker_id,
+                                ToString(stats.device_flag)),
+                1);
+    PrintLine("# Invokes", stats.num_invokes, 2);
+    PrintLine("Utilization (%)", utilization, 2);
+
+    Json::Value worker;
+    worker["id"] = Json::UInt64(worker_id);
+    worker["device"] = ToString(stats.device_flag);
+    worker["num_invokes"] = Json::UInt64(stats.num_invokes);
+    worker["busy_time_us"] = Json::Int64(stats.busy_time_us);
+    worker["utilization"] = utilization;
+    report["workers"].append(worker);
+  }
+
+  const LatencyCacheStats cache_stats = engine_->GetLatencyCacheStats();
+  PrintHeader("Latency cache");
+  PrintLine("Hits", cache_stats.hits, 1);
+  PrintLine("Misses", cache_stats.misses, 1);
+  PrintLine("Invalidations", cache_stats.invalidations, 1);
+  PrintLine("Evictions", cache_stats.evictions, 1);
+  report["latency_cache"]["hits"] = Json::UInt64(cache_stats.hits);
+  report["latency_cache"]["misses"] = Json::UInt64(cache_stats.misses);
+  report["latency_cache"]["invalidations"] =
+      Json::UInt64(cache_stats.invalidations);
+  report["latency_cache"]["evictions"] = Json::UInt64(cache_stats.evictions);
+
+  const PlannerStats planner_stats = engine_->GetPlannerStats();
+  PrintHeader("Planner");
+  PrintLine("Wakeups", planner_stats.wakeups, 1);
+  PrintLine("Scheduling passes", planner_stats.scheduling_passes, 1);
+  report["planner"]["wakeups"] = Json::UInt64(planner_stats.wakeups);
+  report["planner"]["scheduling_passes"] =
+      Json::UInt64(planner_stats.scheduling_passes);
+
+  if (!benchmark_config_.report_json_path.empty()) {
+    RETURN_IF_ERROR(
+        json::WriteToFile(report, benchmark_config_.report_json_path));
+  }
+  if (!benchmark_config_.report_csv_path.empty()) {
+    if (benchmark_config_.execution_mode == "sweep") {
+      RETURN_IF_ERROR(WriteSweepCSVReport(report["sweep"],
+                                          benchmark_config_.report_csv_path));
+    } else {
+      RETURN_IF_ERROR(
+          WriteCSVReport(report, benchmark_config_.report_csv_path));
+    }
+  }
   return absl::OkStatus();
 }
 
@@ -17,6 +17,7 @@
 #ifndef BAND_TOOL_BENCHMARK_H_
 #define BAND_TOOL_BENCHMARK_H_
 #include <memory>
+#include <mutex>
 
 #include "band/engine.h"
 #include "band/json_util.h"
@@ -24,6 +25,7 @@
 #include "band/profiler.h"
 #include "band/tool/benchmark_config.h"
 #include "band/tool/benchmark_profiler.h"
+#include "band/tool/workload.h"
 
 namespace band {
 namespace tool {
@@ -49,6 +51,21 @@ class Benchmark {
     std::vector<Tensors> model_request_outputs;
     // randomly generated input
     Tensors model_inputs;
+    // requests of `workload` mode, each with `batch_size` jobs
+    std::vector<Arrival> arrivals;
+    // engine-side timing of the finished jobs
+    std::vector<RequestTimes> request_times;
+  };
+
+  // result of a single offered load of `sweep` mode
+  struct SweepStep {
+    double offered_rate_per_sec = 0.;
+    size_t num_requests = 0;
+    size_t num_slo_satisfied = 0;
+    double throughput_per_sec = 0.;  // completed requests
+    double slo_satisfactory_rate = 0.;
+    LatencyStats latency;  // of all models
+    bool satisfied = false;
   };
 
   // initialization
@@ -60,16 +77,27 @@ class Benchmark {
   void RunPeriodic();
   void RunStream();
   void RunWorkload();
+  absl::Status RunSweep();
+  absl::StatusOr<SweepStep> RunSweepStep(double rate_per_sec);
 
   absl::Status LogResults();
 
-  const BackendType target_backend_;
+  BackendType target_backend_;
   BenchmarkConfig benchmark_config_;
   RuntimeConfig* runtime_config_ = nullptr;
   std::unique_ptr<Engine> engine_ = nullptr;
   std::vector<ModelContext*> model_contexts_;
   BenchmarkProfiler global_profiler_;
   bool kill_app_ = false;
+
+  std::mutex request_times_mtx_;
+  // counters of the workers and the time of the last run
+  std::vector<WorkerStats> worker_stats_;
+  int64_t run_time_us_ = 0;
+  // steps of `sweep` mode in the order they ran, and the index of the one
+  // with the highest rate that met the target (-1 if none did)
+  std::vector<SweepStep> sweep_steps_;
+  int knee_step_ = -1;
 };
 }  // namespace tool
 }  // namespace band
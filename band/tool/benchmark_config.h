@@ -17,11 +17,30 @@
 #ifndef BAND_TOOL_BENCHMARK_CONFIG_H_
 #define BAND_TOOL_BENCHMARK_CONFIG_H_
 
+#include <string>
+#include <vector>
+
 #include "band/config.h"
 
 namespace band {
 namespace tool {
 
+// Arrival process of the requests of a model in `workload` mode
+struct ArrivalConfig {
+  // `poisson`, `mmpp` (Markov-modulated Poisson process), or `trace`
+  std::string type;
+  // for `poisson`
+  double rate_per_sec = 0.;
+  // for `mmpp`, the request rate and the mean duration of each state.
+  // States are visited in order, and the last one is followed by the first.
+  std::vector<double> state_rates_per_sec;
+  std::vector<double> state_durations_ms;
+  // for `trace`, a JSON file with the requests of the model
+  std::string trace_path;
+  // seed of the random arrivals, the index of the model by default
+  int seed = -1;
+};
+
 struct ModelConfig {
   /* mendatory */
   std::string path;
@@ -31,6 +50,8 @@ struct ModelConfig {
   int worker_id = -1;
   int slo_us = -1;
   float slo_scale = -1.f;
+  ArrivalConfig arrival;  // for workload requests
+  double weight = 1.;     // share of the offered load in `sweep` mode
 
   const RequestOption GetRequestOption() const {
     RequestOption option = RequestOption::GetDefaultOption();
@@ -47,11 +68,26 @@ struct ModelConfig {
   }
 };
 
+// Search range of `sweep` mode, which looks for the highest request rate of
+// the model mix that keeps `target_slo_rate` % of the requests within SLO
+struct SweepConfig {
+  double min_rate_per_sec = 1.;
+  double max_rate_per_sec = 0.;
+  double target_slo_rate = 99.;
+  // the search stops after `max_steps` runs, or once the range is narrower
+  // than `tolerance` of its upper bound
+  size_t max_steps = 8;
+  double tolerance = 0.05;
+};
+
 struct BenchmarkConfig {
   std::vector<ModelConfig> model_configs;
   std::string execution_mode;
-  size_t running_time_ms = 60000;
-  // TODO: add workload simulator
+  size_t running_time_ms = 60000;  // per step in `sweep` mode
+  SweepConfig sweep;
+  // machine-readable copies of the report, if given
+  std::string report_json_path;
+  std::string report_csv_path;
 };
 }  // namespace tool
 }  // namespace band
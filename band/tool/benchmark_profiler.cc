@@ -14,16 +14,45 @@
 
 #include "band/tool/benchmark_profiler.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include "band/logger.h"
 
 namespace band {
 namespace tool {
+LatencyStats LatencyStats::FromSamples(std::vector<int64_t> samples) {
+  LatencyStats stats;
+  stats.count = samples.size();
+  if (samples.empty()) {
+    return stats;
+  }
+  std::sort(samples.begin(), samples.end());
+  auto percentile = [&samples](double p) {
+    const size_t rank = static_cast<size_t>(std::ceil(p * samples.size()));
+    return samples[std::min(std::max<size_t>(rank, 1), samples.size()) - 1];
+  };
+  double sum = 0;
+  for (int64_t sample : samples) {
+    sum += sample;
+  }
+  stats.average = sum / samples.size();
+  stats.p50 = percentile(0.5);
+  stats.p90 = percentile(0.9);
+  stats.p99 = percentile(0.99);
+  stats.p999 = percentile(0.999);
+  stats.max = samples.back();
+  return stats;
+}
+
 void BenchmarkProfiler::EndEvent(size_t event_handle, absl::Status status) {
   if (status.ok()) {
     band::Profiler::EndEvent(event_handle);
-  } else if (status.code() == absl::StatusCode::kDeadlineExceeded) {
+  } else if (status.code() == absl::StatusCode::kDeadlineExceeded ||
+             status.code() == absl::StatusCode::kResourceExhausted) {
     canceled_events_.insert(event_handle);
   } else {
+    failed_events_.insert(event_handle);
     BAND_LOG(LogSeverity::kError, "Event %zu failed: %s", event_handle,
                   status.ToString().c_str());
   }
@@ -35,5 +64,55 @@ bool BenchmarkProfiler::IsEventCanceled(size_t event_handle) const {
 size_t BenchmarkProfiler::GetNumCanceledEvents() const {
   return canceled_events_.size();
 }
+
+bool BenchmarkProfiler::IsEventFailed(size_t event_handle) const {
+  return failed_events_.find(event_handle) != failed_events_.end();
+}
+
+size_t BenchmarkProfiler::GetNumFailedEvents() const {
+  return failed_events_.size();
+}
+
+std::vector<int64_t> BenchmarkProfiler::GetLatencies() const {
+  std::vector<int64_t> latencies;
+  latencies.reserve(GetNumEvents());
+  for (size_t i = 0; i < GetNumEvents(); i++) {
+    // event handles start from 1
+    if (!IsEventCanceled(i + 1) && !IsEventFailed(i + 1)) {
+      latencies.push_back(
+          GetElapsedTimeAt<std::chrono::microseconds>(i));
+    }
+  }
+  return latencies;
+}
+
+LatencyStats BenchmarkProfiler::GetLatencyStats() const {
+  return LatencyStats::FromSamples(GetLatencies());
+}
+
+void BenchmarkProfiler::SetEventSLO(size_t event_handle, int64_t slo_us) {
+  event_slos_[event_handle] = slo_us;
+}
+
+int64_t BenchmarkProfiler::GetEventSLO(size_t event_handle,
+                                       int64_t default_slo_us) const {
+  auto it = event_slos_.find(event_handle);
+  return it == event_slos_.end() ? default_slo_us : it->second;
+}
+
+size_t BenchmarkProfiler::GetNumSLOSatisfiedEvents(
+    int64_t default_slo_us) const {
+  size_t num_satisfied = 0;
+  for (size_t i = 0; i < GetNumEvents(); i++) {
+    const size_t event_handle = i + 1;
+    const int64_t slo_us = GetEventSLO(event_handle, default_slo_us);
+    if (slo_us > 0 && !IsEventCanceled(event_handle) &&
+        !IsEventFailed(event_handle) &&
+        GetElapsedTimeAt<std::chrono::microseconds>(i) < slo_us) {
+      num_satisfied++;
+    }
+  }
+  return num_satisfied;
+}
 }  // namespace tool
 }  // namespace band
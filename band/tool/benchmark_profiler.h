@@ -17,7 +17,9 @@
 #ifndef BAND_TOOL_BENCHMARK_PROFILER_H_
 #define BAND_TOOL_BENCHMARK_PROFILER_H_
 
+#include <map>
 #include <set>
+#include <vector>
 
 #include "absl/status/status.h"
 #include "band/profiler.h"
@@ -25,18 +27,45 @@
 namespace band {
 namespace tool {
 
+// Distribution of latencies in us. Percentiles are nearest-rank.
+struct LatencyStats {
+  size_t count = 0;
+  double average = 0;
+  int64_t p50 = 0;
+  int64_t p90 = 0;
+  int64_t p99 = 0;
+  int64_t p999 = 0;
+  int64_t max = 0;
+
+  static LatencyStats FromSamples(std::vector<int64_t> samples);
+};
+
 class BenchmarkProfiler : public band::Profiler {
  public:
   BenchmarkProfiler() = default;
   ~BenchmarkProfiler() = default;
 
+  // Events that missed their SLO or were rejected by a full tensor pool are
+  // canceled.
   void EndEvent(size_t event_handle, absl::Status status);
   bool IsEventCanceled(size_t event_handle) const;
   size_t GetNumCanceledEvents() const;
+  bool IsEventFailed(size_t event_handle) const;
+  size_t GetNumFailedEvents() const;
+  // Latencies (us) of the events that were neither canceled nor failed
+  std::vector<int64_t> GetLatencies() const;
+  LatencyStats GetLatencyStats() const;
+  // SLO of a single event, which overrides the SLO of its model
+  void SetEventSLO(size_t event_handle, int64_t slo_us);
+  int64_t GetEventSLO(size_t event_handle, int64_t default_slo_us) const;
+  // Events that finished within their SLO, or `default_slo_us` if not set
+  size_t GetNumSLOSatisfiedEvents(int64_t default_slo_us) const;
 
  private:
   using band::Profiler::EndEvent;
   std::set<size_t> canceled_events_;
+  std::set<size_t> failed_events_;
+  std::map<size_t, int64_t> event_slos_;
 };
 
 }  // namespace tool
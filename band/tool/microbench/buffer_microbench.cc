@@ -0,0 +1,121 @@
+// Copyright 2023 Seoul National University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Each `buffer::` operator on a camera frame, from VGA to full HD. The
+// output buffer is reused across iterations, as in an `ImageProcessor`.
+
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+#include <functional>
+
+#include "band/buffer/buffer.h"
+#include "band/buffer/common_operator.h"
+#include "band/buffer/image_operator.h"
+
+namespace band {
+namespace microbench {
+namespace {
+
+struct OperatorCase {
+  BufferFormat input_format;
+  // creates the operator for a `width` x `height` input
+  std::function<std::unique_ptr<IBufferOperator>(int width, int height)>
+      create;
+  // float output with the input format and size, for the operators that
+  // convert the data type
+  bool float_output = false;
+};
+
+void BM_BufferOperator(benchmark::State& state, OperatorCase op_case) {
+  const int width = state.range(0);
+  const int height = state.range(1);
+  std::unique_ptr<Buffer> input(Buffer::CreateEmpty(
+      width, height, op_case.input_format, DataType::kUInt8));
+  if (input->GetNumPlanes() == 1) {
+    // a gray frame, the content only matters to the normalization
+    std::memset((*input)[0].GetMutableData(), 128, input->GetBytes());
+  }
+
+  std::unique_ptr<IBufferOperator> op = op_case.create(width, height);
+  std::vector<float> output_data;
+  std::unique_ptr<Buffer> output;
+  if (op_case.float_output) {
+    output_data.resize(input->GetNumElements());
+    output.reset(Buffer::CreateFromRaw(
+        reinterpret_cast<const unsigned char*>(output_data.data()), width,
+        height, op_case.input_format, DataType::kFloat32));
+    op->SetOutput(output.get());
+  }
+
+  for (auto _ : state) {
+    absl::Status status = op->Process(*input);
+    if (!status.ok()) {
+      state.SkipWithError(status.ToString().c_str());
+      break;
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed(state.iterations() * input->GetBytes());
+}
+
+#define BAND_BUFFER_BENCHMARK(name, ...)                         \
+  BENCHMARK_CAPTURE(BM_BufferOperator, name, OperatorCase{__VA_ARGS__}) \
+      ->ArgNames({"width", "height"})                             \
+      ->Args({640, 480})                                          \
+      ->Args({1280, 720})                                         \
+      ->Args({1920, 1080})
+
+// center square of the frame
+BAND_BUFFER_BENCHMARK(crop, BufferFormat::kRGB, [](int width, int height) {
+  const int size = std::min(width, height);
+  const int x0 = (width - size) / 2, y0 = (height - size) / 2;
+  return std::unique_ptr<IBufferOperator>(
+      new buffer::Crop(x0, y0, x0 + size - 1, y0 + size - 1));
+});
+// to a typical model input
+BAND_BUFFER_BENCHMARK(resize, BufferFormat::kRGB, [](int width, int height) {
+  return std::unique_ptr<IBufferOperator>(new buffer::Resize(224, 224));
+});
+BAND_BUFFER_BENCHMARK(rotate, BufferFormat::kRGB, [](int width, int height) {
+  return std::unique_ptr<IBufferOperator>(new buffer::Rotate(90));
+});
+BAND_BUFFER_BENCHMARK(flip, BufferFormat::kRGB, [](int width, int height) {
+  return std::unique_ptr<IBufferOperator>(new buffer::Flip(true, false));
+});
+// the preview format of Android cameras
+BAND_BUFFER_BENCHMARK(color_space_convert, BufferFormat::kNV21,
+                      [](int width, int height) {
+                        return std::unique_ptr<IBufferOperator>(
+                            new buffer::ColorSpaceConvert(BufferFormat::kRGB));
+                      });
+BAND_BUFFER_BENCHMARK(
+    normalize, BufferFormat::kRGB,
+    [](int width, int height) {
+      return std::unique_ptr<IBufferOperator>(
+          new buffer::Normalize(127.5f, 127.5f, false));
+    },
+    true);
+BAND_BUFFER_BENCHMARK(
+    data_type_convert, BufferFormat::kRGB,
+    [](int width, int height) {
+      return std::unique_ptr<IBufferOperator>(new buffer::DataTypeConvert());
+    },
+    true);
+
+#undef BAND_BUFFER_BENCHMARK
+
+}  // anonymous namespace
+}  // namespace microbench
+}  // namespace band
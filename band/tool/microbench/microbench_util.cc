@@ -0,0 +1,230 @@
+// Copyright 2023 Seoul National University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "band/tool/microbench/microbench_util.h"
+
+#include <cstring>
+
+#include "band/config_builder.h"
+#include "band/logger.h"
+
+namespace band {
+namespace microbench {
+namespace {
+
+// Ops 2, 4 and 6 fall back from some accelerator, and the input is a
+// typical camera frame
+const char* kSimModel = R"({
+  "num_ops": 8,
+  "tensor_shape": [1, 224, 224, 3],
+  "op_latency_us": {
+    "CPU": 400,
+    "GPU": [100, 120, 100, 80, 150, 100, 90, 60],
+    "DSP": 150,
+    "NPU": [50, 60, 50, 40, 70, 50, 45, 30]
+  },
+  "unsupported_ops": {"GPU": [4], "DSP": [2, 6], "NPU": [2, 4]}
+})";
+
+}  // anonymous namespace
+
+SimEngine* SimEngine::Get() {
+  static SimEngine* sim_engine = []() -> SimEngine* {
+    SimEngine* sim_engine = new SimEngine;
+    absl::Status status = sim_engine->Init();
+    if (!status.ok()) {
+      BAND_LOG(LogSeverity::kError, "Failed to create the engine: %s",
+               status.ToString().c_str());
+      delete sim_engine;
+      return nullptr;
+    }
+    return sim_engine;
+  }();
+  return sim_engine;
+}
+
+absl::Status SimEngine::Init() {
+  // keep the output of the benchmarks readable
+  Logger::Get().SetVerbosity(LogSeverity::kWarning);
+
+  RuntimeConfigBuilder builder;
+  auto status_or_config =
+      builder
+          .AddSchedulers({SchedulerType::kHeterogeneousEarliestFinishTime})
+          .AddSubgraphPreparationType(
+              SubgraphPreparationType::kMergeUnitSubgraph)
+          .AddMinimumSubgraphSize(1)
+          .AddWorkers({DeviceFlag::kCPU, DeviceFlag::kGPU, DeviceFlag::kDSP,
+                       DeviceFlag::kNPU})
+          .AddWorkerNumThreads({1, 1, 1, 1})
+          .AddWorkerCPUMasks({CPUMaskFlag::kAll, CPUMaskFlag::kAll,
+                              CPUMaskFlag::kAll, CPUMaskFlag::kAll})
+          .AddOnline(true)
+          .AddNumWarmups(1)
+          .AddNumRuns(1)
+          .Build();
+  if (!status_or_config.ok()) {
+    return status_or_config.status();
+  }
+  engine_ = Engine::Create(status_or_config.value());
+  if (!engine_) {
+    return absl::InternalError("Failed to create engine");
+  }
+
+  for (int i = 0; i < kNumModels; i++) {
+    auto model = std::make_unique<Model>();
+    RETURN_IF_ERROR(model->FromBuffer(BackendType::kSimulated, kSimModel,
+                                      strlen(kSimModel)));
+    RETURN_IF_ERROR(engine_->RegisterModel(model.get()));
+    model_ids_.push_back(model->GetId());
+    models_.push_back(std::move(model));
+  }
+  return absl::OkStatus();
+}
+
+DryRunEngine::DryRunEngine(IEngine& engine) : engine_(engine) { Reset(); }
+
+void DryRunEngine::Reset() {
+  for (WorkerId worker_id = 0; worker_id < engine_.GetNumWorkers();
+       worker_id++) {
+    waiting_time_[worker_id] = 0;
+  }
+  num_scheduled_ = 0;
+}
+
+WorkerWaitingTime DryRunEngine::GetWorkerWaitingTime() const {
+  return waiting_time_;
+}
+
+std::set<WorkerId> DryRunEngine::GetIdleWorkers() const {
+  std::set<WorkerId> idle_workers;
+  for (const auto& it : waiting_time_) {
+    if (it.second == 0) {
+      idle_workers.insert(it.first);
+    }
+  }
+  return idle_workers;
+}
+
+SubgraphKey DryRunEngine::GetLargestSubgraphKey(ModelId model_id,
+                                                WorkerId worker_id) const {
+  return engine_.GetLargestSubgraphKey(model_id, worker_id);
+}
+
+bool DryRunEngine::IsBegin(const SubgraphKey& key) const {
+  return engine_.IsBegin(key);
+}
+
+bool DryRunEngine::IsEnd(const SubgraphKey& key) const {
+  return engine_.IsEnd(key);
+}
+
+bool DryRunEngine::HasSubgraph(const SubgraphKey& key) const {
+  return engine_.HasSubgraph(key);
+}
+
+void DryRunEngine::ForEachSubgraph(
+    std::function<void(const SubgraphKey&)> visitor) const {
+  engine_.ForEachSubgraph(visitor);
+}
+
+absl::Status DryRunEngine::Invoke(const SubgraphKey& key, int batch_size) {
+  return absl::OkStatus();
+}
+
+std::vector<int> DryRunEngine::GetBatchSizes(const SubgraphKey& key) const {
+  return engine_.GetBatchSizes(key);
+}
+
+const ModelSpec* DryRunEngine::GetModelSpec(ModelId model_id) const {
+  return engine_.GetModelSpec(model_id);
+}
+
+WorkerId DryRunEngine::GetModelWorker(ModelId model_id) const {
+  return engine_.GetModelWorker(model_id);
+}
+
+std::pair<SubgraphKey, int64_t> DryRunEngine::GetShortestLatency(
+    int model_id, BitMask resolved_unit_subgraphs, int64_t start_time,
+    const std::map<WorkerId, int64_t>& worker_waiting) const {
+  return engine_.GetShortestLatency(model_id, resolved_unit_subgraphs,
+                                    start_time, worker_waiting);
+}
+
+std::pair<std::vector<SubgraphKey>, int64_t>
+DryRunEngine::GetShortestLatencyWithUnitSubgraph(
+    int model_id, int start_unit_idx,
+    const std::map<WorkerId, int64_t>& worker_waiting) const {
+  return engine_.GetShortestLatencyWithUnitSubgraph(model_id, start_unit_idx,
+                                                    worker_waiting);
+}
+
+std::pair<std::vector<SubgraphKey>, int64_t>
+DryRunEngine::GetSubgraphWithShortestLatency(
+    const Job& job, const std::map<WorkerId, int64_t>& worker_waiting) const {
+  return engine_.GetSubgraphWithShortestLatency(job, worker_waiting);
+}
+
+SubgraphKey DryRunEngine::GetSubgraphIdxSatisfyingSLO(
+    const Job& job, const std::map<WorkerId, int64_t>& worker_waiting,
+    const std::set<WorkerId>& idle_workers) const {
+  return engine_.GetSubgraphIdxSatisfyingSLO(job, worker_waiting,
+                                             idle_workers);
+}
+
+int64_t DryRunEngine::GetProfiled(const SubgraphKey& key,
+                                  int batch_size) const {
+  return engine_.GetProfiled(key, batch_size);
+}
+
+int64_t DryRunEngine::GetExpected(const SubgraphKey& key,
+                                  int batch_size) const {
+  return engine_.GetExpected(key, batch_size);
+}
+
+JobId DryRunEngine::EnqueueRequest(Job job, bool push_front) { return -1; }
+
+std::vector<JobId> DryRunEngine::EnqueueBatch(std::vector<Job> jobs,
+                                              bool push_front) {
+  return std::vector<JobId>(jobs.size(), -1);
+}
+
+bool DryRunEngine::EnqueueToWorker(const ScheduleAction& schedule_action) {
+  const SubgraphKey& key = schedule_action.second;
+  // at least 1 us, so that the worker is no longer idle
+  waiting_time_[key.GetWorkerId()] +=
+      std::max<int64_t>(GetExpected(key, schedule_action.first->batch_size), 1);
+  num_scheduled_++;
+  return true;
+}
+
+bool DryRunEngine::EnqueueToWorkerBatch(
+    const std::vector<ScheduleAction>& schedule_action) {
+  bool success = true;
+  for (const ScheduleAction& action : schedule_action) {
+    success &= EnqueueToWorker(action);
+  }
+  return success;
+}
+
+absl::Status DryRunEngine::TryCopyInputTensors(const Job& job) {
+  return absl::OkStatus();
+}
+
+absl::Status DryRunEngine::TryCopyOutputTensors(const Job& job) {
+  return absl::OkStatus();
+}
+
+}  // namespace microbench
+}  // namespace band
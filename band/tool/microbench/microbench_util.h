@@ -0,0 +1,148 @@
+/*
+ * Copyright 2023 Seoul National University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BAND_TOOL_MICROBENCH_MICROBENCH_UTIL_H_
+#define BAND_TOOL_MICROBENCH_MICROBENCH_UTIL_H_
+
+#include <memory>
+#include <vector>
+
+#include "band/engine.h"
+#include "band/model.h"
+
+namespace band {
+namespace microbench {
+
+/*
+  Engine on the simulated backend shared by the benchmarks that query an
+  engine. It has a CPU, GPU, DSP and NPU worker and `kNumModels` copies of a
+  model whose unsupported ops create a fallback subgraph on every
+  accelerator, so that the latency lookups search a realistic table.
+  Created once, on the first call to `Get`.
+*/
+class SimEngine {
+ public:
+  static constexpr int kNumModels = 4;
+
+  // Returns nullptr if the simulated backend is not built in
+  // (`--config=sim`).
+  static SimEngine* Get();
+
+  Engine& GetEngine() { return *engine_; }
+  // The scheduling interface, which `Engine` only exposes through `IEngine`
+  IEngine& GetInterface() { return *engine_; }
+  const std::vector<ModelId>& GetModelIds() const { return model_ids_; }
+
+ private:
+  SimEngine() = default;
+  absl::Status Init();
+
+  std::unique_ptr<Engine> engine_;
+  std::vector<std::unique_ptr<Model>> models_;
+  std::vector<ModelId> model_ids_;
+};
+
+/*
+  Forwards the queries of a scheduler to a real engine, but only records
+  the scheduled jobs instead of running them. Workers are busy with the jobs
+  scheduled to them since the last `Reset`, so a scheduling pass sees the
+  same idle workers and waiting times every time.
+*/
+class DryRunEngine : public IEngine {
+ public:
+  explicit DryRunEngine(IEngine& engine);
+
+  void Reset();
+  size_t GetNumScheduled() const { return num_scheduled_; }
+
+  Clock* GetClock() const override { return engine_.GetClock(); }
+
+  /* worker */
+  void UpdateWorkersWaiting() const override {}
+  WorkerWaitingTime GetWorkerWaitingTime() const override;
+  std::set<WorkerId> GetIdleWorkers() const override;
+  void SetWorkerIdle(WorkerId worker_id, bool is_idle) override {}
+
+  /* subgraph */
+  SubgraphKey GetLargestSubgraphKey(ModelId model_id,
+                                    WorkerId worker_id) const override;
+  bool IsBegin(const SubgraphKey& key) const override;
+  bool IsEnd(const SubgraphKey& key) const override;
+  bool HasSubgraph(const SubgraphKey& key) const override;
+  void ForEachSubgraph(
+      std::function<void(const SubgraphKey&)> visitor) const override;
+  absl::Status Invoke(const SubgraphKey& key, int batch_size = 1) override;
+  std::vector<int> GetBatchSizes(const SubgraphKey& key) const override;
+
+  /* model */
+  const ModelSpec* GetModelSpec(ModelId model_id) const override;
+  WorkerId GetModelWorker(ModelId model_id) const override;
+
+  /* scheduling */
+  std::pair<SubgraphKey, int64_t> GetShortestLatency(
+      int model_id, BitMask resolved_unit_subgraphs, int64_t start_time,
+      const std::map<WorkerId, int64_t>& worker_waiting) const override;
+  std::pair<std::vector<SubgraphKey>, int64_t>
+  GetShortestLatencyWithUnitSubgraph(
+      int model_id, int start_unit_idx,
+      const std::map<WorkerId, int64_t>& worker_waiting) const override;
+  std::pair<std::vector<SubgraphKey>, int64_t> GetSubgraphWithShortestLatency(
+      const Job& job,
+      const std::map<WorkerId, int64_t>& worker_waiting) const override;
+  SubgraphKey GetSubgraphIdxSatisfyingSLO(
+      const Job& job, const std::map<WorkerId, int64_t>& worker_waiting,
+      const std::set<WorkerId>& idle_workers) const override;
+
+  /* profiler */
+  void UpdateLatency(const SubgraphKey& key, int64_t latency,
+                     int batch_size = 1) override {}
+  int64_t GetProfiled(const SubgraphKey& key,
+                      int batch_size = 1) const override;
+  int64_t GetExpected(const SubgraphKey& key,
+                      int batch_size = 1) const override;
+
+  /* planner */
+  void Trigger() override {}
+  JobId EnqueueRequest(Job job, bool push_front = false) override;
+  std::vector<JobId> EnqueueBatch(std::vector<Job> jobs,
+                                  bool push_front = false) override;
+  void PrepareReenqueue(Job& job) override {}
+  void ReenqueueBatch(const std::vector<JobHandle>& jobs) override {}
+  void EnqueueFinishedJob(JobHandle job) override {}
+  bool EnqueueToWorker(const ScheduleAction& schedule_action) override;
+  bool EnqueueToWorkerBatch(
+      const std::vector<ScheduleAction>& schedule_action) override;
+
+  /* getters */
+  const Worker* GetWorker(WorkerId id) const override { return nullptr; }
+  Worker* GetWorker(WorkerId id) override { return nullptr; }
+  size_t GetNumWorkers() const override { return engine_.GetNumWorkers(); }
+
+  /* tensor communication */
+  absl::Status TryCopyInputTensors(const Job& job) override;
+  absl::Status TryCopyOutputTensors(const Job& job) override;
+
+ private:
+  IEngine& engine_;
+  // expected time until each worker finishes its scheduled jobs
+  WorkerWaitingTime waiting_time_;
+  size_t num_scheduled_ = 0;
+};
+
+}  // namespace microbench
+}  // namespace band
+
+#endif  // BAND_TOOL_MICROBENCH_MICROBENCH_UTIL_H_
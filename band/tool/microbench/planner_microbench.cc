@@ -0,0 +1,132 @@
+// Copyright 2023 Seoul National University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// The request path of the planner: `Planner::EnqueueBatch` moves the jobs of
+// client threads into the job slab and the request queue, and the planner
+// thread drains the queue into its local queues (`CopyToLocalQueues`).
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <thread>
+
+#include "band/job_slab.h"
+#include "band/request_queue.h"
+
+namespace band {
+namespace microbench {
+namespace {
+
+// Shared by the threads of `BM_EnqueueBatch`
+struct EnqueueContext {
+  JobSlab jobs;
+  RequestQueue requests;
+  std::atomic<bool> stop{false};
+  std::thread planner;
+};
+EnqueueContext* enqueue_context = nullptr;
+
+// Releases the drained jobs right away, like a planner whose jobs finish
+// immediately, so that the slab stays warm.
+void DrainAndRelease(EnqueueContext& context, JobQueue& local_queue) {
+  context.requests.Drain(local_queue);
+  for (const JobHandle& job : local_queue) {
+    context.jobs.Release(job);
+  }
+  local_queue.clear();
+}
+
+// Client threads enqueue batches of `range(0)` jobs while a planner thread
+// drains them.
+void BM_EnqueueBatch(benchmark::State& state) {
+  if (state.thread_index() == 0) {
+    enqueue_context = new EnqueueContext;
+    enqueue_context->planner = std::thread([context = enqueue_context]() {
+      JobQueue local_queue;
+      while (!context->stop.load(std::memory_order_acquire)) {
+        DrainAndRelease(*context, local_queue);
+        std::this_thread::yield();
+      }
+    });
+  }
+
+  const size_t batch_size = state.range(0);
+  std::vector<JobHandle> handles;
+  handles.reserve(batch_size);
+  JobId next_job_id = state.thread_index() << 24;
+  // The benchmark waits for every thread here, so `enqueue_context` is set
+  for (auto _ : state) {
+    handles.clear();
+    for (size_t i = 0; i < batch_size; i++) {
+      Job job(i % 4);
+      job.job_id = next_job_id++;
+      JobHandle handle = enqueue_context->jobs.Alloc(std::move(job));
+      if (handle.IsValid()) {
+        handles.push_back(handle);
+      }
+    }
+    enqueue_context->requests.PushBatch(handles);
+  }
+  state.SetItemsProcessed(state.iterations() * batch_size);
+
+  // ... and after the loop, so no thread pushes anymore
+  if (state.thread_index() == 0) {
+    enqueue_context->stop.store(true, std::memory_order_release);
+    enqueue_context->planner.join();
+    JobQueue local_queue;
+    DrainAndRelease(*enqueue_context, local_queue);
+    delete enqueue_context;
+    enqueue_context = nullptr;
+  }
+}
+BENCHMARK(BM_EnqueueBatch)
+    ->ArgName("batch")
+    ->Arg(1)
+    ->Arg(8)
+    ->Threads(1)
+    ->Threads(2)
+    ->Threads(4)
+    ->UseRealTime();
+
+// The planner thread drains `range(0)` queued jobs at once.
+void BM_CopyToLocalQueues(benchmark::State& state) {
+  const size_t num_jobs = state.range(0);
+  JobSlab jobs(num_jobs);
+  RequestQueue requests;
+  std::vector<JobHandle> handles;
+  for (size_t i = 0; i < num_jobs; i++) {
+    Job job(i % 4);
+    job.job_id = i;
+    handles.push_back(jobs.Alloc(std::move(job)));
+  }
+
+  JobQueue local_queue;
+  for (auto _ : state) {
+    state.PauseTiming();
+    local_queue.clear();
+    for (const JobHandle& handle : handles) {
+      requests.Push(handle);
+    }
+    state.ResumeTiming();
+
+    requests.Drain(local_queue);
+    benchmark::DoNotOptimize(local_queue.front());
+  }
+  state.SetItemsProcessed(state.iterations() * num_jobs);
+}
+BENCHMARK(BM_CopyToLocalQueues)->ArgName("jobs")->Arg(16)->Arg(256);
+
+}  // anonymous namespace
+}  // namespace microbench
+}  // namespace band
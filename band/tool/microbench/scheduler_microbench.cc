@@ -0,0 +1,146 @@
+// Copyright 2023 Seoul National University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// A scheduling pass of each `IScheduler` and the latency lookup
+// (`Engine::GetShortestLatency`) that the SLO-aware schedulers repeat for
+// every job in their window.
+
+#include <benchmark/benchmark.h>
+
+#include <functional>
+
+#include "band/job_slab.h"
+#include "band/scheduler/fixed_worker_scheduler.h"
+#include "band/scheduler/heterogeneous_earliest_finish_time_scheduler.h"
+#include "band/scheduler/least_slack_first_scheduler.h"
+#include "band/scheduler/round_robin_scheduler.h"
+#include "band/scheduler/shortest_expected_latency_scheduler.h"
+#include "band/tool/microbench/microbench_util.h"
+
+namespace band {
+namespace microbench {
+namespace {
+
+using SchedulerFactory =
+    std::function<std::unique_ptr<IScheduler>(IEngine&, int window_size)>;
+
+// A pass over `range(0)` queued jobs from all models, with every worker idle.
+// Jobs and worker waiting times are restored outside of the timed region, so
+// each pass sees the same queue.
+void BM_Schedule(benchmark::State& state, SchedulerFactory factory) {
+  SimEngine* sim_engine = SimEngine::Get();
+  if (!sim_engine) {
+    state.SkipWithError("Requires the simulated backend (--config=sim)");
+    return;
+  }
+  const std::vector<ModelId>& model_ids = sim_engine->GetModelIds();
+  IEngine& interface = sim_engine->GetInterface();
+  DryRunEngine engine(interface);
+  const int window_size = state.range(0);
+  std::unique_ptr<IScheduler> scheduler = factory(engine, window_size);
+
+  JobSlab jobs(window_size);
+  std::vector<JobHandle> handles;
+  JobQueue requests;
+  size_t num_scheduled = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    for (const JobHandle& handle : handles) {
+      jobs.Release(handle);
+    }
+    handles.clear();
+    requests.clear();
+    const int64_t now = interface.GetClock()->NowMicros();
+    for (int i = 0; i < window_size; i++) {
+      // job ids repeat across passes, like the bounded set of jobs in flight
+      Job job(model_ids[i % model_ids.size()], 10000);
+      job.job_id = i;
+      job.enqueue_time = now;
+      handles.push_back(jobs.Alloc(std::move(job)));
+      requests.push_back(handles.back());
+    }
+    engine.Reset();
+    state.ResumeTiming();
+
+    scheduler->Schedule(requests);
+    num_scheduled += engine.GetNumScheduled();
+  }
+  state.SetItemsProcessed(state.iterations() * window_size);
+  state.counters["scheduled"] =
+      benchmark::Counter(num_scheduled, benchmark::Counter::kAvgIterations);
+}
+
+#define BAND_SCHEDULER_BENCHMARK(name, factory)                   \
+  BENCHMARK_CAPTURE(BM_Schedule, name, SchedulerFactory(factory)) \
+      ->ArgName("window")                                         \
+      ->Arg(1)                                                    \
+      ->Arg(4)                                                    \
+      ->Arg(16)                                                   \
+      ->Arg(64)
+
+BAND_SCHEDULER_BENCHMARK(fixed_worker, [](IEngine& engine, int window_size) {
+  return std::make_unique<FixedWorkerScheduler>(engine);
+});
+BAND_SCHEDULER_BENCHMARK(round_robin, [](IEngine& engine, int window_size) {
+  return std::make_unique<RoundRobinScheduler>(engine);
+});
+BAND_SCHEDULER_BENCHMARK(shortest_expected_latency,
+                         [](IEngine& engine, int window_size) {
+                           return std::make_unique<
+                               ShortestExpectedLatencyScheduler>(engine,
+                                                                 window_size);
+                         });
+BAND_SCHEDULER_BENCHMARK(least_slack_first,
+                         [](IEngine& engine, int window_size) {
+                           return std::make_unique<LeastSlackFirstScheduler>(
+                               engine, window_size);
+                         });
+BAND_SCHEDULER_BENCHMARK(heft, [](IEngine& engine, int window_size) {
+  return std::make_unique<HEFTScheduler>(engine, window_size, false);
+});
+BAND_SCHEDULER_BENCHMARK(heft_reserved, [](IEngine& engine, int window_size) {
+  return std::make_unique<HEFTScheduler>(engine, window_size, true);
+});
+
+#undef BAND_SCHEDULER_BENCHMARK
+
+// The best subgraph sequence of a whole model. `range(0)` is 0 when every
+// worker is idle, which the engine answers from its cache, and 1 when the
+// workers are busy and the lookup searches all unit subgraphs.
+void BM_GetShortestLatency(benchmark::State& state) {
+  SimEngine* sim_engine = SimEngine::Get();
+  if (!sim_engine) {
+    state.SkipWithError("Requires the simulated backend (--config=sim)");
+    return;
+  }
+  IEngine& engine = sim_engine->GetInterface();
+  const ModelId model_id = sim_engine->GetModelIds().front();
+  const bool busy = state.range(0);
+
+  std::map<WorkerId, int64_t> worker_waiting;
+  for (WorkerId worker_id = 0; worker_id < engine.GetNumWorkers();
+       worker_id++) {
+    worker_waiting[worker_id] = busy ? 100 * (worker_id + 1) : 0;
+  }
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        engine.GetShortestLatency(model_id, BitMask(), 0, worker_waiting));
+  }
+}
+BENCHMARK(BM_GetShortestLatency)->ArgName("busy")->Arg(0)->Arg(1);
+
+}  // anonymous namespace
+}  // namespace microbench
+}  // namespace band
@@ -0,0 +1,187 @@
+// Copyright 2023 Seoul National University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Input / output slots of a model (`TensorRingBuffer`) and the tensor copies
+// of a job (`Engine::TryCopyInputTensors`).
+
+#include <benchmark/benchmark.h>
+
+#include "band/tensor.h"
+#include "band/tensor_ring_buffer.h"
+#include "band/tool/microbench/microbench_util.h"
+
+namespace band {
+namespace microbench {
+namespace {
+
+struct FloatTensor : public interface::ITensor {
+  explicit FloatTensor(size_t num_elements)
+      : data(num_elements), dims({static_cast<int>(num_elements)}) {}
+
+  DataType GetType() const override { return DataType::kFloat32; }
+  void SetType(DataType type) override {}
+  const char* GetData() const override {
+    return reinterpret_cast<const char*>(data.data());
+  }
+  char* GetData() override { return reinterpret_cast<char*>(data.data()); }
+  const int* GetDims() const override { return dims.data(); }
+  size_t GetNumDims() const override { return dims.size(); }
+  void SetDims(const std::vector<int>& dims) override {}
+  const char* GetName() const override { return "float"; }
+  Quantization GetQuantization() const override {
+    return {QuantizationType::kNoQuantization, nullptr};
+  }
+  absl::Status SetQuantization(Quantization quantization) override {
+    return absl::OkStatus();
+  }
+
+  std::vector<float> data;
+  std::vector<int> dims;
+};
+
+std::unique_ptr<TensorRingBuffer> CreateBuffer(size_t num_elements) {
+  return std::make_unique<TensorRingBuffer>(
+      std::vector<std::shared_ptr<interface::ITensor>>{
+          std::make_shared<FloatTensor>(num_elements)},
+      std::vector<int>{0});
+}
+
+// A request puts its input into a slot and a worker reads it back.
+void BM_TensorRingBufferPutGet(benchmark::State& state) {
+  const size_t num_elements = state.range(0);
+  auto buffer = CreateBuffer(num_elements);
+  FloatTensor src(num_elements), dst(num_elements);
+  std::vector<interface::ITensor*> srcs = {&src};
+  std::vector<interface::ITensor*> dsts = {&dst};
+
+  for (auto _ : state) {
+    const int handle = buffer->Alloc().value();
+    if (!buffer->PutTensorsToHandle(srcs, handle).ok() ||
+        !buffer->GetTensorsFromHandle(dsts, handle).ok() ||
+        !buffer->Release(handle).ok()) {
+      state.SkipWithError("Failed to copy the tensor");
+      break;
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * num_elements * sizeof(float) *
+                          2);
+}
+// A feature vector, and float 224x224 and 640x480 RGB frames
+BENCHMARK(BM_TensorRingBufferPutGet)
+    ->ArgName("elements")
+    ->Arg(1 << 10)
+    ->Arg(224 * 224 * 3)
+    ->Arg(640 * 480 * 3);
+
+// Client threads reserve and return slots of the same model.
+void BM_TensorRingBufferAllocRelease(benchmark::State& state) {
+  static std::unique_ptr<TensorRingBuffer> buffer;
+  if (state.thread_index() == 0) {
+    buffer = CreateBuffer(1);
+  }
+  for (auto _ : state) {
+    auto status_or_handle = buffer->Alloc();
+    if (status_or_handle.ok()) {
+      buffer->Release(status_or_handle.value());
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+  if (state.thread_index() == 0) {
+    buffer.reset();
+  }
+}
+BENCHMARK(BM_TensorRingBufferAllocRelease)
+    ->Threads(1)
+    ->Threads(2)
+    ->Threads(4)
+    ->UseRealTime();
+
+// Copies the tensors of a job before its invoke. `range(0)` selects the
+// subgraph: 0 for the whole model, which reads the model inputs, and 1 for
+// a fallback subgraph, which reads the outputs of the subgraph before it.
+void BM_TryCopyInputTensors(benchmark::State& state) {
+  SimEngine* sim_engine = SimEngine::Get();
+  if (!sim_engine) {
+    state.SkipWithError("Requires the simulated backend (--config=sim)");
+    return;
+  }
+  Engine& engine = sim_engine->GetEngine();
+  IEngine& interface = sim_engine->GetInterface();
+  // the last model, so that the other benchmarks never see it bound
+  const ModelId model_id = sim_engine->GetModelIds().back();
+
+  // Inputs are read from tensors bound to the model, since the ring buffer
+  // slots of a request are private to the engine
+  static Tensors bound_inputs, bound_outputs;
+  if (bound_inputs.empty()) {
+    for (int index : engine.GetInputTensorIndices(model_id)) {
+      bound_inputs.push_back(engine.CreateTensor(model_id, index));
+    }
+    for (int index : engine.GetOutputTensorIndices(model_id)) {
+      bound_outputs.push_back(engine.CreateTensor(model_id, index));
+    }
+    if (!engine.BindIOTensors(model_id, bound_inputs, bound_outputs).ok()) {
+      state.SkipWithError("Failed to bind the model tensors");
+      return;
+    }
+  }
+
+  Job job(model_id);
+  job.io_bound = true;
+  if (state.range(0) == 0) {
+    job.subgraph_key = engine.GetLargestSubgraphKey(model_id, 0);
+  } else {
+    // any fallback subgraph whose inputs are all produced by another
+    std::vector<SubgraphKey> keys;
+    interface.ForEachSubgraph([&](const SubgraphKey& key) {
+      if (key.GetModelId() == model_id) {
+        keys.push_back(key);
+      }
+    });
+    for (const SubgraphKey& key : keys) {
+      if (interface.IsBegin(key) || !job.previous_subgraph_keys.empty()) {
+        continue;
+      }
+      for (const SubgraphKey& preceded_key : keys) {
+        if (!interface.IsBegin(preceded_key) ||
+            (preceded_key.GetUnitIndices() & key.GetUnitIndices()).any()) {
+          continue;
+        }
+        job.subgraph_key = key;
+        job.previous_subgraph_keys = {preceded_key};
+        if (interface.TryCopyInputTensors(job).ok()) {
+          break;
+        }
+        job.previous_subgraph_keys.clear();
+      }
+    }
+    if (job.previous_subgraph_keys.empty()) {
+      state.SkipWithError("No fallback subgraph");
+      return;
+    }
+  }
+
+  for (auto _ : state) {
+    if (!interface.TryCopyInputTensors(job).ok()) {
+      state.SkipWithError("Failed to copy the input tensors");
+      break;
+    }
+  }
+  state.SetLabel(job.subgraph_key.ToString());
+}
+BENCHMARK(BM_TryCopyInputTensors)->ArgName("fallback")->Arg(0)->Arg(1);
+
+}  // anonymous namespace
+}  // namespace microbench
+}  // namespace band
@@ -0,0 +1,177 @@
+// Copyright 2023 Seoul National University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "band/tool/workload.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+
+#include "absl/strings/str_format.h"
+#include "band/json_util.h"
+
+namespace band {
+namespace tool {
+namespace {
+
+// Exponentially distributed interval with the given mean. Sampled from the
+// raw engine output, since `std::exponential_distribution` differs between
+// standard libraries and would change the workload across platforms.
+double SampleExponential(std::mt19937& random_engine, double mean) {
+  const double u = (static_cast<double>(random_engine()) + 0.5) /
+                   (static_cast<double>(std::mt19937::max()) + 1.);
+  return -std::log(u) * mean;
+}
+
+absl::StatusOr<std::vector<Arrival>> GeneratePoisson(
+    const ArrivalConfig& config, int64_t duration_us,
+    std::mt19937& random_engine) {
+  if (config.rate_per_sec <= 0) {
+    return absl::InvalidArgumentError(
+        "`rate_per_sec` of a poisson arrival should be > 0");
+  }
+  std::vector<Arrival> arrivals;
+  const double mean_interval_us = 1e6 / config.rate_per_sec;
+  double time_us = SampleExponential(random_engine, mean_interval_us);
+  while (time_us < duration_us) {
+    arrivals.push_back({static_cast<int64_t>(time_us)});
+    time_us += SampleExponential(random_engine, mean_interval_us);
+  }
+  return arrivals;
+}
+
+absl::StatusOr<std::vector<Arrival>> GenerateMMPP(const ArrivalConfig& config,
+                                                  int64_t duration_us,
+                                                  std::mt19937& random_engine) {
+  const size_t num_states = config.state_rates_per_sec.size();
+  if (num_states == 0 || config.state_durations_ms.size() != num_states) {
+    return absl::InvalidArgumentError(
+        "`state_rates_per_sec` and `state_durations_ms` of an mmpp arrival "
+        "should have the same, non-zero length");
+  }
+  for (size_t i = 0; i < num_states; i++) {
+    if (config.state_rates_per_sec[i] < 0 ||
+        config.state_durations_ms[i] <= 0) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "State %d of an mmpp arrival should have a rate >= 0 and a "
+          "duration > 0",
+          i));
+    }
+  }
+
+  std::vector<Arrival> arrivals;
+  size_t state = 0;
+  double time_us = 0.;
+  double state_end_us = SampleExponential(
+      random_engine, config.state_durations_ms[state] * 1000);
+  while (time_us < duration_us) {
+    const double rate = config.state_rates_per_sec[state];
+    // Intervals are memoryless, so the one that crosses the end of the state
+    // is discarded and sampled again in the next state
+    const double next_us =
+        rate > 0 ? time_us + SampleExponential(random_engine, 1e6 / rate)
+                 : std::numeric_limits<double>::infinity();
+    if (next_us < state_end_us) {
+      time_us = next_us;
+      if (time_us < duration_us) {
+        arrivals.push_back({static_cast<int64_t>(time_us)});
+      }
+    } else {
+      time_us = state_end_us;
+      state = (state + 1) % num_states;
+      state_end_us = time_us + SampleExponential(
+                                   random_engine,
+                                   config.state_durations_ms[state] * 1000);
+    }
+  }
+  return arrivals;
+}
+
+absl::StatusOr<std::vector<Arrival>> LoadTrace(const ArrivalConfig& config,
+                                               int64_t duration_us) {
+  Json::Value root = json::LoadFromFile(config.trace_path);
+  if (!root.isArray()) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Trace %s should be a list of requests", config.trace_path));
+  }
+
+  std::vector<Arrival> arrivals;
+  for (const Json::Value& request : root) {
+    if (!request["time_us"].isNumeric() || request["time_us"].asInt64() < 0) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Requests of trace %s should have `time_us` >= 0",
+          config.trace_path));
+    }
+    Arrival arrival{request["time_us"].asInt64()};
+    json::AssignIfValid(arrival.slo_us, request, "slo_us");
+    if (arrival.time_us < duration_us) {
+      arrivals.push_back(arrival);
+    }
+  }
+  std::stable_sort(arrivals.begin(), arrivals.end(),
+                   [](const Arrival& lhs, const Arrival& rhs) {
+                     return lhs.time_us < rhs.time_us;
+                   });
+  return arrivals;
+}
+
+}  // anonymous namespace
+
+absl::Status ParseArrivalConfig(const Json::Value& root,
+                                ArrivalConfig& config) {
+  if (!root.isObject() || !root["type"].isString()) {
+    return absl::InvalidArgumentError(
+        "Please check if `arrival` is given with its `type`");
+  }
+  config.type = root["type"].asString();
+  json::AssignIfValid(config.seed, root, "seed");
+
+  if (config.type == "poisson") {
+    json::AssignIfValid(config.rate_per_sec, root, "rate_per_sec");
+  } else if (config.type == "mmpp") {
+    for (const Json::Value& rate : root["state_rates_per_sec"]) {
+      config.state_rates_per_sec.push_back(rate.asDouble());
+    }
+    for (const Json::Value& duration : root["state_durations_ms"]) {
+      config.state_durations_ms.push_back(duration.asDouble());
+    }
+  } else if (config.type == "trace") {
+    if (!json::AssignIfValid(config.trace_path, root, "path")) {
+      return absl::InvalidArgumentError(
+          "Please check if `path` is given for a trace arrival");
+    }
+  } else {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Unknown arrival type %s", config.type));
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::vector<Arrival>> GenerateArrivals(
+    const ArrivalConfig& config, int64_t duration_us) {
+  std::mt19937 random_engine(static_cast<uint32_t>(std::max(config.seed, 0)));
+  if (config.type == "poisson") {
+    return GeneratePoisson(config, duration_us, random_engine);
+  } else if (config.type == "mmpp") {
+    return GenerateMMPP(config, duration_us, random_engine);
+  } else if (config.type == "trace") {
+    return LoadTrace(config, duration_us);
+  }
+  return absl::InvalidArgumentError(
+      absl::StrFormat("Unknown arrival type %s", config.type));
+}
+
+}  // namespace tool
+}  // namespace band
@@ -0,0 +1,52 @@
+/*
+ * Copyright 2023 Seoul National University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BAND_TOOL_WORKLOAD_H_
+#define BAND_TOOL_WORKLOAD_H_
+
+#include <json/json.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "band/tool/benchmark_config.h"
+
+namespace band {
+namespace tool {
+
+// A request of a model in `workload` mode
+struct Arrival {
+  // time since the start of the run
+  int64_t time_us;
+  // SLO of this request, or -1 to use the SLO of the model
+  int slo_us = -1;
+};
+
+// Parses the `arrival` field of a model config.
+absl::Status ParseArrivalConfig(const Json::Value& root,
+                                ArrivalConfig& config);
+
+// Arrivals of a model before `duration_us`, sorted by time.
+// Random arrival processes only depend on the config.
+absl::StatusOr<std::vector<Arrival>> GenerateArrivals(
+    const ArrivalConfig& config, int64_t duration_us);
+
+}  // namespace tool
+}  // namespace band
+
+#endif  // BAND_TOOL_WORKLOAD_H_
@@ -14,15 +14,21 @@
 
 #include "band/worker.h"
 
+#include <algorithm>
+
 #include "absl/strings/str_format.h"
 #include "band/common.h"
 #include "band/job_tracer.h"
 #include "band/logger.h"
-#include "band/time.h"
+#include "band/runtime_tracer.h"
 
 namespace band {
 Worker::Worker(IEngine* engine, WorkerId worker_id, DeviceFlag device_flag)
-    : engine_(engine), worker_id_(worker_id), device_flag_(device_flag) {}
+    : engine_(engine),
+      request_cv_(engine->GetClock()),
+      wait_cv_(engine->GetClock()),
+      worker_id_(worker_id),
+      device_flag_(device_flag) {}
 
 Worker::~Worker() {
   if (!kill_worker_) {
@@ -77,9 +83,12 @@ absl::Status Worker::UpdateWorkerThread(const CpuSet thread_affinity_mask,
 
 void Worker::WaitUntilDeviceAvailable(SubgraphKey& subgraph) {
   while (true) {
-    time::SleepForMicros(1000 * availability_check_interval_ms_);
+    engine_->GetClock()->SleepForMicros(1000 *
+                                        availability_check_interval_ms_);
     BAND_LOG(LogSeverity::kInternal, "Availability check at %d ms.",
-             time::NowMicros());
+             engine_->GetClock()->NowMicros());
+    std::shared_lock<std::shared_mutex> io_bindings_lock =
+        engine_->LockIOBindings();
     if (engine_->Invoke(subgraph).ok()) {
       return;
     }
@@ -89,6 +98,12 @@ void Worker::WaitUntilDeviceAvailable(SubgraphKey& subgraph) {
 bool Worker::IsAvailable() const { return !is_throttling_ && !is_paused_; }
 
 void Worker::Start() {
+  {
+    std::lock_guard<std::mutex> lock(device_mtx_);
+    // peers may already have a backlog
+    is_steal_requested_ = true;
+    UpdateIdle();
+  }
   std::call_once(device_cpu_start_flag_, [&]() {
     device_cpu_thread_ = std::thread([this] { this->Work(); });
   });
@@ -99,26 +114,51 @@ void Worker::End() {
     std::lock_guard<std::mutex> lock(device_mtx_);
     kill_worker_ = true;
   }
-  request_cv_.notify_all();
+  request_cv_.NotifyAll();
   device_cpu_thread_.join();
 }
 
 void Worker::Pause() {
   std::lock_guard<std::mutex> lock(device_mtx_);
   is_paused_ = true;
+  UpdateIdle();
 }
 
 void Worker::Resume() {
   std::unique_lock<std::mutex> lock(device_mtx_);
   is_paused_ = false;
+  is_steal_requested_ = true;
+  UpdateIdle();
   lock.unlock();
 
-  request_cv_.notify_one();
+  request_cv_.NotifyAll();
 }
 
 void Worker::Wait() {
   std::unique_lock<std::mutex> lock(device_mtx_);
-  wait_cv_.wait(lock, [&]() { return !HasJob(); });
+  wait_cv_.Wait(lock, [&]() { return !HasJob(); });
+}
+
+int64_t Worker::GetWaitingTime() const {
+  if (!IsAvailable()) {
+    return LARGE_WAITING_TIME;
+  }
+
+  int64_t total = expected_backlog_us_.load(std::memory_order_acquire);
+  const int64_t invoke_time =
+      head_invoke_time_.load(std::memory_order_acquire);
+  if (invoke_time > 0) {
+    // the current job is expected to be done in part
+    const int64_t progress = std::min<int64_t>(
+        engine_->GetClock()->NowMicros() - invoke_time,
+        head_expected_us_.load(std::memory_order_acquire));
+    total -= std::max<int64_t>(progress, 0);
+  }
+  return std::max<int64_t>(total, 0);
+}
+
+void Worker::UpdateIdle() {
+  engine_->SetWorkerIdle(worker_id_, IsAvailable() && !HasJob());
 }
 
 const CpuSet& Worker::GetWorkerThreadAffinity() const { return cpu_set_; }
@@ -161,23 +201,48 @@ absl::Status Worker::TryUpdateWorkerThread() {
 }
 
 void Worker::Work() {
+  Clock* clock = engine_->GetClock();
+  RuntimeTracer& tracer = RuntimeTracer::Get();
+  clock->AttachThread();
   while (true) {
     if (!HasJob()) {
-      wait_cv_.notify_all();
+      wait_cv_.NotifyAll();
     }
 
     std::unique_lock<std::mutex> lock(device_mtx_);
-    request_cv_.wait(
-        lock, [this]() { return (kill_worker_ || HasJob()) && !is_paused_; });
+    request_cv_.Wait(lock, [this]() {
+      return (kill_worker_ || HasJob() || is_steal_requested_) && !is_paused_;
+    });
 
     if (kill_worker_) {
       break;
     }
 
-    Job* current_job = GetCurrentJob();
+    if (is_steal_requested_) {
+      is_steal_requested_ = false;
+      if (!HasJob()) {
+        TryStealJob();
+      }
+      if (!HasJob()) {
+        continue;
+      }
+    }
+
+    JobHandle current_job_handle = GetCurrentJob();
+    Job* current_job = current_job_handle.Get();
+    if (current_job) {
+      head_expected_us_.store(current_job->expected_execution_time,
+                              std::memory_order_release);
+    }
     lock.unlock();
 
-    if (!current_job || !IsValid(*current_job)) {
+    if (!current_job) {
+      BAND_LOG(LogSeverity::kError, "%s worker spotted a stale job",
+               ToString(device_flag_));
+      break;
+    }
+
+    if (!IsValid(*current_job)) {
       BAND_LOG(LogSeverity::kError,
                "%s worker spotted an invalid job (model id %d, "
                "subgraph valid %d (%d, %d), "
@@ -192,6 +257,10 @@ void Worker::Work() {
     }
 
     SubgraphKey subgraph_key = current_job->subgraph_key;
+    if (current_job->dispatch_time > 0) {
+      current_job->worker_queue_time +=
+          clock->NowMicros() - current_job->dispatch_time;
+    }
 
     if (!TryUpdateWorkerThread().ok()) {
       // TODO #21: Handle errors in multi-thread environment
@@ -199,30 +268,61 @@ void Worker::Work() {
                worker_id_);
     }
 
-    if (engine_->TryCopyInputTensors(*current_job).ok()) {
+    const bool is_traced = tracer.IsSampled(current_job->job_id);
+    // Binding re-plans the backend tensors, so the I/O tensors of the model
+    // stay bound from the input copy to the output copy
+    std::shared_lock<std::shared_mutex> io_bindings_lock =
+        engine_->LockIOBindings();
+    const int64_t copy_start_time = clock->NowMicros();
+    const bool input_copied = engine_->TryCopyInputTensors(*current_job).ok();
+    const int64_t copy_end_time = clock->NowMicros();
+    current_job->input_copy_time += copy_end_time - copy_start_time;
+    if (is_traced) {
+      tracer.RecordCopy(TraceEventType::kInputCopy, *current_job,
+                        copy_start_time, copy_end_time);
+    }
+    if (input_copied) {
       lock.lock();
-      current_job->invoke_time = time::NowMicros();
+      current_job->invoke_time = clock->NowMicros();
+      head_invoke_time_.store(current_job->invoke_time,
+                              std::memory_order_release);
       lock.unlock();
 
       BAND_TRACER_BEGIN_SUBGRAPH(*current_job);
-      absl::Status status = engine_->Invoke(subgraph_key);
+      absl::Status status =
+          engine_->Invoke(subgraph_key, current_job->batch_size);
       if (status.ok()) {
         // end_time is never read/written by any other thread as long as
         // is_busy == true, so it's safe to update it w/o grabbing the lock
-        current_job->end_time = time::NowMicros();
-        engine_->UpdateLatency(
-            subgraph_key, (current_job->end_time - current_job->invoke_time));
-        if (current_job->following_jobs.size() != 0) {
-          engine_->EnqueueBatch(current_job->following_jobs, true);
-        }
+        current_job->end_time = clock->NowMicros();
+        const int64_t execution_time =
+            current_job->end_time - current_job->invoke_time;
+        current_job->total_execution_time += execution_time;
+        num_invokes_.fetch_add(1, std::memory_order_relaxed);
+        busy_time_us_.fetch_add(execution_time, std::memory_order_relaxed);
+        engine_->UpdateLatency(subgraph_key, execution_time,
+                               current_job->batch_size);
         {
           auto status = engine_->TryCopyOutputTensors(*current_job);
           if (!status.ok()) {
             BAND_LOG(LogSeverity::kWarning, "%s", status.ToString().c_str());
           }
         }
+        // the following subgraph, if any, is ready from here
+        current_job->ready_time = clock->NowMicros();
+        current_job->output_copy_time +=
+            current_job->ready_time - current_job->end_time;
+        if (is_traced) {
+          tracer.RecordSubgraph(*current_job);
+          tracer.RecordCopy(TraceEventType::kOutputCopy, *current_job,
+                            current_job->end_time, current_job->ready_time);
+        }
         current_job->status = JobStatus::kSuccess;
       } else if (!status.ok()) {
+        if (io_bindings_lock.owns_lock()) {
+          // the availability checks lock it for each invoke
+          io_bindings_lock.unlock();
+        }
         HandleDeviceError(*current_job);
         engine_->Trigger();
         BAND_LOG(LogSeverity::kError, "Worker %d failed to invoke job %d",
@@ -231,7 +331,7 @@ void Worker::Work() {
       } else {
         // end_time is never read/written by any other thread as long as
         // !requests_.empty(), so it's safe to update it w/o grabbing the lock
-        current_job->end_time = time::NowMicros();
+        current_job->end_time = clock->NowMicros();
         // TODO #21: Handle errors in multi-thread environment
         current_job->status = JobStatus::kInvokeFailure;
       }
@@ -241,17 +341,28 @@ void Worker::Work() {
       // TODO #21: Handle errors in multi-thread environment
       current_job->status = JobStatus::kInputCopyFailure;
     }
+    if (io_bindings_lock.owns_lock()) {
+      io_bindings_lock.unlock();
+    }
     BAND_TRACER_END_SUBGRAPH(*current_job);
-    engine_->EnqueueFinishedJob(*current_job);
+    // the job record may be recycled once it is handed over to the planner
+    const JobId job_id = current_job->job_id;
+    engine_->EnqueueFinishedJob(current_job_handle);
 
     lock.lock();
     EndEnqueue();
+    expected_backlog_us_.fetch_sub(
+        head_expected_us_.load(std::memory_order_relaxed),
+        std::memory_order_release);
+    head_invoke_time_.store(0, std::memory_order_release);
+    UpdateIdle();
     lock.unlock();
 
     engine_->Trigger();
     BAND_LOG(LogSeverity::kInternal, "Worker %d finished job %d", worker_id_,
-             current_job->job_id);
+             job_id);
   }
+  clock->DetachThread();
 }
 
 }  // namespace band
\ No newline at end of file
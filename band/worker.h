@@ -17,13 +17,15 @@
 #ifndef BAND_WORKER_H_
 #define BAND_WORKER_H_
 
-#include <condition_variable>
+#include <atomic>
 #include <memory>
 #include <mutex>
 #include <thread>
 
+#include "band/clock.h"
 #include "band/config.h"
 #include "band/engine_interface.h"
+#include "band/metrics.h"
 #include "band/device/cpu.h"
 
 namespace band {
@@ -40,7 +42,7 @@ class Worker {
   DeviceFlag GetDeviceFlag() const { return device_flag_; }
   WorkerId GetId() const { return worker_id_; }
   std::mutex& GetDeviceMtx() { return device_mtx_; }
-  std::condition_variable& GetRequestCv() { return request_cv_; }
+  ClockCondition& GetRequestCv() { return request_cv_; }
   absl::Status UpdateWorkerThread(const CpuSet thread_affinity_mask,
                                   int num_threads);
   void WaitUntilDeviceAvailable(SubgraphKey& subgraph);
@@ -57,31 +59,63 @@ class Worker {
   const CpuSet& GetWorkerThreadAffinity() const;
   int GetNumThreads() const;
   virtual int GetCurrentJobId() = 0;
-  virtual int64_t GetWaitingTime() = 0;
+  // Expected time until the worker finishes its queued jobs. Lock-free.
+  int64_t GetWaitingTime() const;
+  // Successful invokes and the time spent in them. Lock-free.
+  size_t GetNumInvokes() const {
+    return num_invokes_.load(std::memory_order_relaxed);
+  }
+  int64_t GetBusyTime() const {
+    return busy_time_us_.load(std::memory_order_relaxed);
+  }
+  // Jobs enqueued to the worker and not finished yet. Lock-free.
+  int64_t GetNumQueuedJobs() const { return num_queued_jobs_.Get(); }
   // Make sure the worker lock is acquired before calling below functions.
-  virtual bool EnqueueJob(Job& job) = 0;
+  virtual bool EnqueueJob(JobHandle job) = 0;
   virtual bool IsEnqueueReady() const;
   virtual bool HasJob() = 0;
+  // Wakes up the idle workers that may steal from the queue of this one.
+  // Called after an enqueue, without the worker lock.
+  virtual void NotifyBacklog() {}
 
  protected:
   bool IsValid(Job& job);
   absl::Status TryUpdateWorkerThread();
   void Work();
   // Helper functions that work utilizes
-  virtual Job* GetCurrentJob() = 0;
+  virtual JobHandle GetCurrentJob() = 0;
   virtual void EndEnqueue() = 0;
   virtual void HandleDeviceError(Job& current_job) = 0;
+  // Takes jobs from other workers while the worker is idle, if it allows
+  // it. Requires `device_mtx_`.
+  virtual void TryStealJob() {}
+  // Reports whether the worker can take a job right away to the engine.
+  // Requires `device_mtx_`.
+  void UpdateIdle();
 
   IEngine* const engine_;
 
   std::once_flag device_cpu_start_flag_;
   std::thread device_cpu_thread_;
   mutable std::mutex device_mtx_;
-  std::condition_variable request_cv_;
-  std::condition_variable wait_cv_;
+  ClockCondition request_cv_;
+  ClockCondition wait_cv_;
   bool kill_worker_ = false;
-  bool is_throttling_ = false;
-  bool is_paused_ = false;
+  // Set when the worker may find a job to steal (e.g., a peer has a
+  // backlog, or the worker became available again). Guarded by
+  // `device_mtx_`.
+  bool is_steal_requested_ = false;
+  std::atomic<bool> is_throttling_{false};
+  std::atomic<bool> is_paused_{false};
+  // Sum of `expected_execution_time` of the queued jobs. Updated on enqueue
+  // and dequeue, under `device_mtx_`.
+  std::atomic<int64_t> expected_backlog_us_{0};
+  // Expected latency and invoke time (0 until invoked) of the current job
+  std::atomic<int64_t> head_expected_us_{0};
+  std::atomic<int64_t> head_invoke_time_{0};
+  std::atomic<size_t> num_invokes_{0};
+  std::atomic<int64_t> busy_time_us_{0};
+  Gauge num_queued_jobs_;
   int availability_check_interval_ms_;
   WorkerId worker_id_ = -1;
 
@@ -101,18 +135,21 @@ class DeviceQueueWorker : public Worker {
                              DeviceFlag device_flag)
       : Worker(engine, worker_id, device_flag) {}
   int GetCurrentJobId() override;
-  int64_t GetWaitingTime() override;
-  bool EnqueueJob(Job& job) override;
+  bool EnqueueJob(JobHandle job) override;
   bool HasJob() override;
   JobQueue& GetDeviceRequests();
   void AllowWorkSteal();
+  void NotifyBacklog() override;
 
  protected:
-  Job* GetCurrentJob() override;
+  JobHandle GetCurrentJob() override;
   void EndEnqueue() override;
   void HandleDeviceError(Job& current_job) override;
+  void TryStealJob() override;
 
  private:
+  // Moves a job that has not started yet from the back of another worker's
+  // queue if it finishes earlier here. Requires `device_mtx_`.
   void TryWorkSteal();
 
   JobQueue requests_;
@@ -125,18 +162,17 @@ class GlobalQueueWorker : public Worker {
                              DeviceFlag device_flag)
       : Worker(engine, worker_id, device_flag) {}
   int GetCurrentJobId() override;
-  int64_t GetWaitingTime() override;
-  bool EnqueueJob(Job& job) override;
+  bool EnqueueJob(JobHandle job) override;
   bool IsEnqueueReady() const override;
   bool HasJob() override;
 
  protected:
-  Job* GetCurrentJob() override;
+  JobHandle GetCurrentJob() override;
   void EndEnqueue() override;
   void HandleDeviceError(Job& current_job) override;
 
  private:
-  Job current_job_{-1};
+  JobHandle current_job_;
   bool is_busy_ = false;
 };
 
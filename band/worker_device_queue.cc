@@ -24,176 +24,179 @@ JobQueue& DeviceQueueWorker::GetDeviceRequests() { return requests_; }
 
 void DeviceQueueWorker::AllowWorkSteal() { allow_work_steal_ = true; }
 
-bool DeviceQueueWorker::HasJob() { return !requests_.empty(); }
-
-int DeviceQueueWorker::GetCurrentJobId() {
-  if (requests_.empty()) {
-    return -1;
-  }
-  return requests_.front().job_id;
-}
-
-int64_t DeviceQueueWorker::GetWaitingTime() {
-  std::unique_lock<std::mutex> lock(device_mtx_);
-  if (!IsAvailable()) {
-    return LARGE_WAITING_TIME;
+void DeviceQueueWorker::NotifyBacklog() {
+  // A peer only steals jobs that wait behind the current one
+  if (GetNumQueuedJobs() < 2) {
+    return;
   }
-
-  int64_t total = 0;
-  for (JobQueue::iterator it = requests_.begin(); it != requests_.end(); ++it) {
-    int64_t expected_latency = engine_->GetExpected(it->subgraph_key);
-
-    total += expected_latency;
-    if (it == requests_.begin()) {
-      int64_t current_time = time::NowMicros();
-      int64_t invoke_time = (*it).invoke_time;
-      if (invoke_time > 0 && current_time > invoke_time) {
-        int64_t progress = (current_time - invoke_time) > expected_latency
-                               ? expected_latency
-                               : (current_time - invoke_time);
-        total -= progress;
-      }
+  for (WorkerId worker_id = 0; worker_id < engine_->GetNumWorkers();
+       worker_id++) {
+    if (worker_id == worker_id_) {
+      continue;
+    }
+    auto* worker =
+        static_cast<DeviceQueueWorker*>(engine_->GetWorker(worker_id));
+    if (!worker->allow_work_steal_) {
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(worker->device_mtx_);
+    if (worker->HasJob() || !worker->IsAvailable()) {
+      continue;
     }
+    worker->is_steal_requested_ = true;
+    lock.unlock();
+    worker->request_cv_.NotifyAll();
   }
-  lock.unlock();
+}
+
+bool DeviceQueueWorker::HasJob() { return !requests_.empty(); }
 
-  return total;
+int DeviceQueueWorker::GetCurrentJobId() {
+  const Job* job = requests_.empty() ? nullptr : requests_.front().Get();
+  return job ? job->job_id : -1;
 }
 
-bool DeviceQueueWorker::EnqueueJob(Job& job) {
+bool DeviceQueueWorker::EnqueueJob(JobHandle job) {
   if (!IsEnqueueReady()) {
     return false;
   }
   requests_.push_back(job);
-  request_cv_.notify_one();
+  num_queued_jobs_.Add(1);
+  expected_backlog_us_.fetch_add(job->expected_execution_time,
+                                 std::memory_order_release);
+  UpdateIdle();
+  request_cv_.NotifyAll();
   return true;
 }
 
-Job* DeviceQueueWorker::GetCurrentJob() {
-  return HasJob() ? &requests_.front() : nullptr;
+JobHandle DeviceQueueWorker::GetCurrentJob() {
+  return HasJob() ? requests_.front() : JobHandle();
 }
 
 void DeviceQueueWorker::EndEnqueue() {
   requests_.pop_front();
+  num_queued_jobs_.Add(-1);
 
   if (allow_work_steal_ && requests_.empty()) {
-    // TODO: call this function once we re-implement
-    // and test TryWorkSteal()
-    // TryWorkSteal();
+    TryWorkSteal();
   }
 }
 
 void DeviceQueueWorker::HandleDeviceError(Job& current_job) {
   std::unique_lock<std::mutex> lock(device_mtx_);
-  lock.lock();
   is_throttling_ = true;
   engine_->PrepareReenqueue(current_job);
-  std::vector<Job> jobs(requests_.begin(), requests_.end());
+  std::vector<JobHandle> jobs(requests_.begin(), requests_.end());
   requests_.clear();
+  num_queued_jobs_.Set(0);
+  expected_backlog_us_.store(0, std::memory_order_release);
+  head_invoke_time_.store(0, std::memory_order_release);
+  UpdateIdle();
   lock.unlock();
 
-  engine_->EnqueueBatch(jobs, true);
+  engine_->ReenqueueBatch(jobs);
   WaitUntilDeviceAvailable(current_job.subgraph_key);
 
   lock.lock();
   is_throttling_ = false;
+  is_steal_requested_ = true;
+  UpdateIdle();
   lock.unlock();
 }
 
-void DeviceQueueWorker::TryWorkSteal() {
-  // Note: Due to the removal of attribute `Worker::worker_id_`,
-  // `target_worker->GetWorkerId() == worker_id_` should be updated to
-  // `target_worker == this`, and the type of `max_latency_gain_worker` should
-  // be changed from `int` to `Worker*`.
-
-  BAND_NOT_IMPLEMENTED;
-  /*
-    std::shared_ptr<Planner> planner_ptr = planner_.lock();
-    if (!planner_ptr) {
-      TFLITE_LOG(ERROR) << "Worker " << worker_id_
-                        << " TryWorkSteal() Failed to acquire pointer to
-    Planner"; return;
-    }
-
-    Interpreter* interpreter_ptr = planner_ptr->GetModelExecutor();
-    int64_t max_latency_gain = -1;
-    int max_latency_gain_worker = -1;
-    int max_latency_gain_subgraph_idx = -1;
-    for (auto& worker : interpreter_ptr->GetWorkers()) {
-      Worker* target_worker = worker.get();
-      if (target_worker->GetWorkerId() == worker_id_) {
-        continue;
-      }
-
-      int64_t waiting_time = target_worker->GetWaitingTime();
+void DeviceQueueWorker::TryStealJob() {
+  if (allow_work_steal_) {
+    TryWorkSteal();
+    UpdateIdle();
+  }
+}
 
-      std::unique_lock<std::mutex> lock(target_worker->GetDeviceMtx());
-      if (target_worker->GetDeviceRequests().size() < 2) {
-        // There is nothing to steal here or
-        // the job is being processed by the target worker,
-        // so leave it alone.
-        continue;
-      }
+void DeviceQueueWorker::TryWorkSteal() {
+  if (!IsAvailable()) {
+    return;
+  }
 
-      Job& job = target_worker->GetDeviceRequests().back();
-      lock.unlock();
+  DeviceQueueWorker* victim = nullptr;
+  JobHandle target_job;
+  SubgraphKey target_key;
+  int64_t max_latency_gain = 0;
+  for (WorkerId worker_id = 0; worker_id < engine_->GetNumWorkers();
+       worker_id++) {
+    if (worker_id == worker_id_) {
+      continue;
+    }
+    // every worker of the engine shares the worker type of the planner
+    auto* worker =
+        static_cast<DeviceQueueWorker*>(engine_->GetWorker(worker_id));
+    // a peer that holds its lock may be stealing from us, so never block
+    std::unique_lock<std::mutex> lock(worker->device_mtx_, std::try_to_lock);
+    if (!lock.owns_lock() || worker->requests_.size() < 2) {
+      // There is nothing to steal here, or the only job is being processed
+      continue;
+    }
 
-      Subgraph* orig_subgraph = interpreter_ptr->subgraph(job.subgraph_idx);
-      SubgraphKey& orig_key = orig_subgraph->GetKey();
-      SubgraphKey new_key(job.model_id, device_flag_, orig_key.input_ops,
-                          orig_key.output_ops);
-      int64_t expected_latency = interpreter_ptr->GetExpectedLatency(new_key);
-      if (expected_latency == -1 || expected_latency > waiting_time) {
-        // no point in stealing this job, it's just going to take longer
+    const JobHandle& job = worker->requests_.back();
+    if (job->invoke_time > 0) {
+      continue;
+    }
+    SubgraphKey key(job->model_id, worker_id_,
+                    job->subgraph_key.GetUnitIndicesSet());
+    if (!engine_->HasSubgraph(key)) {
+      continue;
+    }
+    if (job->batch_size > 1) {
+      const std::vector<int> batch_sizes = engine_->GetBatchSizes(key);
+      if (std::find(batch_sizes.begin(), batch_sizes.end(), job->batch_size) ==
+          batch_sizes.end()) {
         continue;
       }
-
-      int64_t latency_gain = waiting_time - expected_latency;
-      if (latency_gain > max_latency_gain) {
-        max_latency_gain = latency_gain;
-        max_latency_gain_worker = target_worker->GetWorkerId();
-        max_latency_gain_subgraph_idx =
-    interpreter_ptr->GetSubgraphIdx(new_key);
-      }
-    }
-
-    if (max_latency_gain < 0) {
-      // no viable job to steal -- do nothing
-      return;
     }
 
-    Worker* target_worker =
-    interpreter_ptr->GetWorker(max_latency_gain_worker);
-    std::unique_lock<std::mutex> lock(target_worker->GetDeviceMtx(),
-    std::defer_lock); std::unique_lock<std::mutex> my_lock(device_mtx_,
-    std::defer_lock); std::lock(lock, my_lock);
-
-    if (target_worker->GetDeviceRequests().empty()) {
-      // target worker has went on and finished all of its jobs
-      // while we were slacking off
-      return;
+    // The job finishes after the whole queue of the peer, or right after
+    // its own execution here
+    const int64_t waiting_time = worker->GetWaitingTime();
+    const int64_t expected_latency = engine_->GetExpected(key, job->batch_size);
+    if (expected_latency < 0 || expected_latency >= waiting_time) {
+      continue;
     }
-
-    // this must not be a reference,
-    // otherwise the pop_back() below will invalidate it
-    Job job = target_worker->GetDeviceRequests().back();
-    if (job.invoke_time > 0) {
-      // make sure the target worker hasn't started processing the job yet
-      return;
+    if (waiting_time - expected_latency > max_latency_gain) {
+      max_latency_gain = waiting_time - expected_latency;
+      victim = worker;
+      target_job = job;
+      target_key = key;
     }
+  }
 
-    if (!requests_.empty()) {
-      // make sure that I still don't have any work to do
-      return;
-    }
+  if (victim == nullptr) {
+    return;
+  }
 
-    job.subgraph_idx = max_latency_gain_subgraph_idx;
-    job.device_id = device_flag_;
+  std::unique_lock<std::mutex> lock(victim->device_mtx_, std::try_to_lock);
+  // make sure the job is still waiting at the back of the peer's queue
+  if (!lock.owns_lock() || victim->requests_.size() < 2 ||
+      victim->requests_.back() != target_job ||
+      target_job->invoke_time > 0) {
+    return;
+  }
+  victim->requests_.pop_back();
+  victim->num_queued_jobs_.Add(-1);
+  victim->expected_backlog_us_.fetch_sub(target_job->expected_execution_time,
+                                         std::memory_order_release);
+  lock.unlock();
 
-    // finally, we perform the swap
-    target_worker->GetDeviceRequests().pop_back();
-    requests_.push_back(job);
-  */
+  target_job->subgraph_key = target_key;
+  target_job->profiled_execution_time =
+      engine_->GetProfiled(target_key, target_job->batch_size);
+  target_job->expected_execution_time =
+      engine_->GetExpected(target_key, target_job->batch_size);
+  requests_.push_back(target_job);
+  num_queued_jobs_.Add(1);
+  expected_backlog_us_.fetch_add(target_job->expected_execution_time,
+                                 std::memory_order_release);
+  BAND_LOG(LogSeverity::kInternal,
+           "Worker %d stole job %d from worker %d (expected gain %lld us)",
+           worker_id_, target_job->job_id, victim->GetId(),
+           static_cast<long long>(max_latency_gain));
 }
 
 }  // namespace band
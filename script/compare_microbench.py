@@ -0,0 +1,73 @@
+#!/usr/bin/env python
+# Copyright 2023 Seoul National University
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Compares two JSON outputs of `band_microbench` and fails if a benchmark
+# got slower than the threshold. See band/docs/microbench.md.
+
+import argparse
+import json
+import sys
+
+
+def load_times(path):
+    # benchmark name -> time per iteration, the median of the repetitions if
+    # the run reported aggregates
+    with open(path) as f:
+        benchmarks = json.load(f)['benchmarks']
+
+    times = {}
+    medians = {}
+    for benchmark in benchmarks:
+        if benchmark.get('error_occurred'):
+            continue
+        if benchmark.get('run_type') == 'aggregate':
+            if benchmark.get('aggregate_name') == 'median':
+                medians[benchmark['run_name']] = benchmark['real_time']
+        else:
+            times.setdefault(benchmark.get('run_name', benchmark['name']),
+                             benchmark['real_time'])
+    times.update(medians)
+    return times
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(
+        description='Compare two runs of band_microbench')
+    parser.add_argument('baseline', help='JSON output of the baseline')
+    parser.add_argument('contender', help='JSON output to check')
+    parser.add_argument('-t', '--threshold', type=float, default=10.,
+                        help='Allowed slowdown in percent (default: 10)')
+    args = parser.parse_args()
+
+    baseline = load_times(args.baseline)
+    contender = load_times(args.contender)
+
+    regressions = []
+    for name in sorted(baseline.keys() & contender.keys()):
+        change = (contender[name] / baseline[name] - 1.) * 100.
+        print(f'{name:<72} {baseline[name]:>12.1f} {contender[name]:>12.1f} '
+              f'{change:>+7.1f}%')
+        if change > args.threshold:
+            regressions.append(name)
+
+    for name in sorted(baseline.keys() ^ contender.keys()):
+        print(f'{name:<72} only in one of the runs')
+
+    if regressions:
+        print(f'{len(regressions)} benchmark(s) regressed by more than '
+              f'{args.threshold}%:')
+        for name in regressions:
+            print(f'  {name}')
+        sys.exit(1)